@@ -1,6 +1,11 @@
 #include <HardwareSerial.h>
+#include <GC_Sensor.h>   // readSensor, GetFullPer and the fullness model (GC_Common library)
+#include <GC_A02Bus.h>   // Concurrent multi-UART acquisition (GC_Common library)
 
-#define PI 3.14159
+// Acquisition mode
+// 1 = every UART is drained in the background and both sensors are sampled together
+// 0 = old behaviour, read the sensors one after the other
+#define CONCURRENT_ACQUISITION 1
 
 // Assign UART ports and pins
 #define SENSOR15_RX 10  // Sensor 15° RX (sensor TX → ESP32 RX)
@@ -12,10 +17,21 @@
 HardwareSerial sensor15(1);  // UART1
 HardwareSerial sensor60(2);  // UART2
 
-// Define constants and variables
-long defaultHeight1, duration, distance, defaultHeight2, dist15, dist60, h15, h60, realHeight;
-long trashVolume, dumpsterHeight, dumpsterWidth, dumpsterlen, totalVolume, fullnessPer, x15, x60;
-long testDumpLen, testDumpWidth, testDumpHeight, defaultD15, defaultD60, offsetDist60, offsetHeight60, offsetDist15;
+// Sensor bus, one parser per UART. For the three sensor design, add the third
+// sensor's HardwareSerial here (and bump the size) if your board has a free UART.
+HardwareSerial *sensorPorts[] = { &sensor15, &sensor60 };
+A02Bus<2> sensorBus(sensorPorts);
+
+// Specs for test dumpster (in inches)
+// Change these values to the real dumpster's specs when using a real dumpster
+// Computed at compile time, including the sin/cos constants (GC_Geometry.h)
+constexpr DumpsterGeometry dumpster = dumpsterGeometry(
+  36,                   // length
+  24,                   // width
+  36,                   // height
+  4.5,                  // 15° sensor casing offset
+  4.5 * gcCosDeg(60),  // 60° sensor offset from the wall
+  3);                   // 60° sensor height offset
 
 void setup() {
   Serial.begin(115200); // Serial monitor
@@ -25,102 +41,21 @@ void setup() {
   // Start hardware serials with pins
   sensor15.begin(9600, SERIAL_8N1, SENSOR15_RX, SENSOR15_TX);
   sensor60.begin(9600, SERIAL_8N1, SENSOR60_RX, SENSOR60_TX);
-
-  // Specs for test dumpster (in inches)
-  testDumpLen = 36;
-  testDumpWidth = 24;
-  testDumpHeight = 36;
-
-  // Set dumpster specs (change when using real dumpster)
-  dumpsterHeight = testDumpHeight;
-  dumpsterWidth = testDumpWidth;
-  dumpsterlen = testDumpLen;
-
-  // Default distances
-  defaultD15 = dumpsterlen / cos(radians(15));
-  defaultD60 = dumpsterHeight / cos(radians(30));
-  realHeight = 0;
-
-  // Sensor mounting offsets
-  offsetDist60 = 4.5 * cos(60 * PI / 180);
-  offsetHeight60 = 3;
-  offsetDist15 = 4.5;
-
-  // Volume initialization
-  trashVolume = 0;
-  totalVolume = dumpsterHeight * dumpsterWidth * dumpsterlen;
-  fullnessPer = 0;
+#if CONCURRENT_ACQUISITION
+  sensorBus.begin();  // Must come after the begin() calls above
+#endif
 }
 
 void loop() {
-  // Read both sensors
-  dist15 = readSensor(sensor15) + offsetDist15;
-  delay(50);
-  dist60 = readSensor(sensor60) + offsetDist60;
-  delay(50);
-
-  // Compute heights and x-distances
-  h15 = dumpsterHeight - (dist15 * sin(15 * PI / 180));
-  h60 = dumpsterHeight - ((dist60) * sin(60 * PI / 180) + offsetHeight60);
-  x15 = dumpsterlen - (dist15 * cos(radians(15)));
-  x60 = dumpsterlen - (dist60 * cos(radians(60)));
-
-  // Debug printouts
-  Serial.print("dist15: ");
-  Serial.println(dist15 - offsetDist15);
-  Serial.print("dist60: ");
-  Serial.println(dist60 - offsetDist60);
-  Serial.print("h60: ");
-  Serial.println(h60);
-  Serial.print("h15: ");
-  Serial.println(h15);
-
-  trashVolume = 0;
-
-  // Calculate trash volume
-  if (dist60 <= defaultD60 * 0.85) {  // Sensor 60 detects trash
-    trashVolume = h60 * dumpsterWidth * x60;
-
-    if (dist15 <= defaultD15 * 0.85) {  // Both detect trash
-      long bottomVol = h60 * dumpsterWidth * x60;
-      long topVol = (x60 + x15) * (h15 - h60) / 2 * dumpsterWidth;
-      trashVolume = topVol + bottomVol;
-    }
-  }
-
-  // Display results
-  Serial.print("Trash Volume: ");
-  Serial.println(trashVolume);
-  Serial.print("Total Volume: ");
-  Serial.println(totalVolume);
-
-  fullnessPer = ((float)trashVolume / (float)totalVolume) * 100;
-  Serial.print("Fullness: ");
-  Serial.print(fullnessPer);
-  Serial.println("%");
+  // Read both sensors and compute the fullness (GC_Geometry.h)
+#if CONCURRENT_ACQUISITION
+  // Both readings come from the same frame period (~100ms)
+  long dist[2];
+  sensorBus.acquire(300, dist);  // 300ms timeout, missing sensors read -1
+  FullnessResult result = fullnessFromDistances(dumpster, dist[0], dist[1]);
+  printFullness(Serial, dist[0], dist[1], result, dumpster);
+#else
+  GetFullPer(Serial, sensor15, sensor60, dumpster);
+#endif
   delay(1000);
 }
-
-// --- Reading ultrasonic sensor data ---
-long readSensor(HardwareSerial &sensor) {
-  unsigned char data[4] = {0};
-  unsigned long startTime = millis();
-
-  while (millis() - startTime < 300) { // 300ms timeout
-    if (sensor.available() > 0) {
-      if (sensor.read() == 0xFF) {
-        delay(10); // Wait for data
-        if (sensor.available() >= 3) {
-          data[1] = sensor.read(); // High byte
-          data[2] = sensor.read(); // Low byte
-          data[3] = sensor.read(); // Checksum
-
-          if (data[3] == (byte)(0xFF + data[1] + data[2])) {
-            return ((data[1] << 8) + data[2]) * 0.0393700787; // Convert mm → inches
-          }
-        }
-      }
-    }
-  }
-  return -1; // Timeout or bad data
-}
\ No newline at end of file
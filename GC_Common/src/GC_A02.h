@@ -0,0 +1,140 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_A02.h
+
+This header is part of the GC_Common library, which holds the code shared by the
+Arduino Uno and the ESP32 sketches. Copy (or symlink) the whole GC_Common folder
+into your Arduino "libraries" folder and include it with #include <GC_A02.h>.
+
+It contains an incremental parser for the A02YYUW ultrasonic sensor. The sensor
+sends a 4 byte frame roughly every 100ms:
+
+  | 0xFF (header) | Data High | Data Low | Checksum |
+
+  distance (mm) = (Data High << 8) + Data Low
+  checksum      = (0xFF + Data High + Data Low) & 0xFF
+
+The parser is fed one byte at a time, as the bytes arrive, and never waits or
+calls delay(). When a 0xFF shows up inside the data (e.g. a distance of 255mm,
+or a checksum of 0xFF), the old readSensor() lost the frame. Here, when the
+checksum fails, the parser looks for the next 0xFF in the bytes it already has
+and resyncs from there instead of throwing them away.
+
+Link to the A02YYUW wiki:
+https://wiki.dfrobot.com/A02YYUW%20Waterproof%20Ultrasonic%20Sensor%20SKU:%20SEN0311
+*/
+
+#ifndef GC_A02_H
+#define GC_A02_H
+
+#include <stdint.h>
+
+// ======================== CONSTANTS ========================
+#define A02_FRAME_HEADER    0xFF
+#define A02_FRAME_SIZE      4
+
+// ======================== CLASS DEFINITION ========================
+class A02Parser {
+public:
+  A02Parser() { reset(); }
+
+  /*
+  reset - Forget any partial frame and clear the counters.
+  */
+  void reset() {
+    clearFrame();
+    lastMm = 0;
+    frameCount = 0;
+    checksumErrors = 0;
+  }
+
+  /*
+  clearFrame - Drop a partially received frame but keep the last distance.
+
+  Use after switching a SoftwareSerial port with listen(), since listen()
+  throws away the bytes that were already buffered.
+  */
+  void clearFrame() { count = 0; }
+
+  /*
+  push - Feed one byte from the sensor into the parser.
+
+  Parameters:
+    c - The byte read from the sensor's serial port.
+
+  Returns true when this byte completed a frame with a valid checksum. The
+  distance of that frame can then be read with distanceMm() or distanceInches().
+  */
+  bool push(uint8_t c) {
+    // Wait for a header before storing anything
+    if (count == 0 && c != A02_FRAME_HEADER) {
+      return false;
+    }
+
+    frame[count++] = c;
+    if (count < A02_FRAME_SIZE) {
+      return false;
+    }
+
+    // Verify checksum (overflow handled by byte casting)
+    if (frame[3] == (uint8_t)(frame[0] + frame[1] + frame[2])) {
+      lastMm = ((uint16_t)frame[1] << 8) | frame[2];
+      frameCount++;
+      count = 0;
+      return true;
+    }
+
+    // Bad checksum, resync on the next 0xFF we already have (if any)
+    checksumErrors++;
+    uint8_t next = 1;
+    while (next < A02_FRAME_SIZE && frame[next] != A02_FRAME_HEADER) {
+      next++;
+    }
+    count = 0;
+    for (uint8_t i = next; i < A02_FRAME_SIZE; i++) {
+      frame[count++] = frame[i];
+    }
+    return false;
+  }
+
+  /*
+  poll - Drain every byte currently waiting on a serial port into the parser.
+
+  Parameters:
+    port - Any object with available() and read(), e.g. SoftwareSerial or
+           HardwareSerial.
+
+  Returns true if at least one valid frame was completed. If several frames
+  were waiting, the most recent distance is kept. Never blocks.
+  */
+  template <typename Port>
+  bool poll(Port &port) {
+    bool got = false;
+    while (port.available() > 0) {
+      if (push((uint8_t)port.read())) {
+        got = true;
+      }
+    }
+    return got;
+  }
+
+  // Distance of the last valid frame in millimeters
+  uint16_t distanceMm() const { return lastMm; }
+
+  // Distance of the last valid frame in whole inches (1 in = 25.4 mm, truncated)
+  long distanceInches() const { return ((long)lastMm * 10) / 254; }
+
+  // Number of valid frames and checksum failures seen since reset()
+  uint32_t frames() const { return frameCount; }
+  uint32_t errors() const { return checksumErrors; }
+
+private:
+  uint8_t frame[A02_FRAME_SIZE];
+  uint8_t count;
+  uint16_t lastMm;
+  uint32_t frameCount;
+  uint32_t checksumErrors;
+};
+
+#endif
+// GC_A02_H
@@ -0,0 +1,136 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_A02Bus.h
+
+ESP32 only. Reads several A02 ultrasonic sensors at the same time, one per
+hardware UART.
+
+On the Uno only one SoftwareSerial port can listen at a time, so the sensors have
+to be read one after the other. The ESP32 has real UARTs, and each UART driver
+already fills its own RX ring buffer from an interrupt. A02Bus hooks every UART
+with onReceive(), so the bytes of each sensor are pushed into that sensor's
+A02Parser by the UART event task as soon as they arrive, while loop() is busy
+doing something else.
+
+acquire() then just waits until every sensor has delivered a frame that started
+after the call. Since the sensors free run at ~100ms per frame, all readings of
+one cycle are taken within one frame period of each other, instead of ~1s apart.
+
+Usage:
+  HardwareSerial sensor15(1);
+  HardwareSerial sensor60(2);
+  HardwareSerial *ports[] = { &sensor15, &sensor60 };
+  A02Bus<2> bus(ports);
+
+  setup(): sensor15.begin(...); sensor60.begin(...); bus.begin();
+  loop():  long dist[2]; if (bus.acquire(300, dist) == bus.allMask()) { ... }
+
+Requires the arduino-esp32 core 2.0.0 or newer (HardwareSerial::onReceive).
+*/
+
+#ifndef GC_A02BUS_H
+#define GC_A02BUS_H
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+#include <Arduino.h>
+#include <HardwareSerial.h>
+#include "GC_A02.h"
+
+// ======================== CLASS DEFINITION ========================
+template <uint8_t N>
+class A02Bus {
+public:
+  explicit A02Bus(HardwareSerial *const (&serialPorts)[N]) : lock(portMUX_INITIALIZER_UNLOCKED) {
+    for (uint8_t i = 0; i < N; i++) {
+      ports[i] = serialPorts[i];
+      lastMm[i] = 0;
+      lastMs[i] = 0;
+    }
+  }
+
+  /*
+  begin - Register the UART receive callbacks.
+
+  Call after every port's begin(), since begin() resets the UART driver.
+  */
+  void begin() {
+    for (uint8_t i = 0; i < N; i++) {
+      ports[i]->onReceive([this, i]() { drain(i); });
+    }
+  }
+
+  /*
+  acquire - Wait for one fresh frame from every sensor.
+
+  Parameters:
+    timeoutMs - Longest time to wait, in milliseconds.
+    inches    - Output array of N distances in inches. Sensors that did not
+                answer in time are set to -1.
+
+  Returns a bitmask with bit i set when sensor i delivered a frame. Compare
+  with allMask() to check that every sensor answered.
+  */
+  uint32_t acquire(unsigned long timeoutMs, long *inches) {
+    unsigned long start = millis();
+    uint32_t got = 0;
+
+    while (got != allMask() && millis() - start < timeoutMs) {
+      got = freshMask(start);
+      yield();
+    }
+
+    for (uint8_t i = 0; i < N; i++) {
+      inches[i] = (got & (1UL << i)) ? mmToInches(i) : -1;
+    }
+    return got;
+  }
+
+  uint32_t allMask() const { return (N >= 32) ? 0xFFFFFFFFUL : ((1UL << N) - 1); }
+
+  // Number of valid frames and checksum failures seen on sensor i
+  uint32_t frames(uint8_t i) const { return parsers[i].frames(); }
+  uint32_t errors(uint8_t i) const { return parsers[i].errors(); }
+
+private:
+  // Runs in the UART event task
+  void drain(uint8_t i) {
+    if (parsers[i].poll(*ports[i])) {
+      portENTER_CRITICAL(&lock);
+      lastMm[i] = parsers[i].distanceMm();
+      lastMs[i] = millis();
+      portEXIT_CRITICAL(&lock);
+    }
+  }
+
+  uint32_t freshMask(unsigned long since) {
+    uint32_t mask = 0;
+    portENTER_CRITICAL(&lock);
+    for (uint8_t i = 0; i < N; i++) {
+      if ((long)(lastMs[i] - since) >= 0 && lastMs[i] != 0) {
+        mask |= (1UL << i);
+      }
+    }
+    portEXIT_CRITICAL(&lock);
+    return mask;
+  }
+
+  long mmToInches(uint8_t i) {
+    portENTER_CRITICAL(&lock);
+    uint16_t mm = lastMm[i];
+    portEXIT_CRITICAL(&lock);
+    return ((long)mm * 10) / 254;
+  }
+
+  HardwareSerial *ports[N];
+  A02Parser parsers[N];
+  uint16_t lastMm[N];
+  unsigned long lastMs[N];
+  portMUX_TYPE lock;
+};
+
+#endif
+// ARDUINO_ARCH_ESP32
+
+#endif
+// GC_A02BUS_H
@@ -0,0 +1,100 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Batch.h
+
+Collects readings in RAM so several of them go out in one HTTP POST.
+
+Opening the TCP connection and waiting for "Connection: close" takes most of
+the time the modem is on, and it used to happen once for every reading. With a
+batch, readings are added as they come in. The batch is sent with
+postBatch() (GC_Soracom.h) once it is full or its oldest reading is older than
+a set time, so the connection cost is paid once per batch.
+
+Readings still in the batch are lost on a reset. Move them into the
+store-and-forward queue (GC_Queue.h) if the send fails. sendQueued() drains
+that queue through a batch as well.
+*/
+
+#ifndef GC_BATCH_H
+#define GC_BATCH_H
+
+#include <Arduino.h>
+#include "GC_Telemetry.h"
+
+// ======================== CLASS DEFINITION ========================
+template <uint8_t N>
+class ReadingBatch {
+  static_assert(N > 0, "ReadingBatch needs room for at least one reading");
+
+public:
+  ReadingBatch() : count(0) {}
+
+  /*
+  add - Add a reading to the batch.
+
+  Parameters:
+    record - The reading.
+    stamp  - millis() when it was taken, now by default.
+
+  If the batch is already full, the oldest reading is dropped. A reading with
+  the age GC_AGE_UNKNOWN (queued in another boot) keeps it, its stamp is not
+  used.
+  */
+  void add(const TelemetryRecord &record, unsigned long stamp = millis()) {
+    if (count == N) {
+      for (uint8_t i = 1; i < N; i++) {
+        records[i - 1] = records[i];
+        stamps[i - 1] = stamps[i];
+      }
+      count--;
+    }
+    records[count] = record;
+    stamps[count] = stamp;
+    count++;
+  }
+
+  /*
+  due - Check if the batch should be sent now.
+
+  Parameters:
+    maxAgeMs - Send once the oldest reading is this old, in milliseconds.
+
+  True if the batch is full, or not empty and its oldest reading is too old.
+  */
+  bool due(unsigned long maxAgeMs) const {
+    return count == N || (count > 0 && millis() - stamps[0] >= maxAgeMs);
+  }
+
+  /*
+  get - Get one reading with its age filled in.
+
+  Parameters:
+    i   - Index, 0 is the oldest reading.
+    now - millis() at the time of sending.
+  */
+  TelemetryRecord get(uint8_t i, unsigned long now) const {
+    TelemetryRecord record = records[i];
+    if (record.age == GC_AGE_UNKNOWN) {
+      return record;
+    }
+    unsigned long ageSec = (now - stamps[i]) / 1000;
+    record.age = (ageSec > 0xFFFE) ? 0xFFFE : (uint16_t)ageSec;
+    return record;
+  }
+
+  // millis() when reading i was taken
+  unsigned long stamp(uint8_t i) const { return stamps[i]; }
+
+  uint8_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  bool full() const { return count == N; }
+  void clear() { count = 0; }
+
+private:
+  TelemetryRecord records[N];
+  unsigned long stamps[N];
+  uint8_t count;
+};
+
+#endif
+// GC_BATCH_H
@@ -0,0 +1,268 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Calibration.h
+
+Empty-bin baseline, measured on site and kept in EEPROM.
+
+fullnessFromDistances() only counts a sensor as seeing trash when its reading
+is below 85% of the reading of the empty bin (seesTrash(), GC_Geometry.h).
+That empty reading used to come from the nominal dimensions (defaultD15 and
+defaultD60 of dumpsterGeometry()), or from EMPTY_READING_15/60 in the old
+sensor code. Every real bin and mounting is a bit different, so each install
+had to be measured by hand and flashed again.
+
+Now the bin measures itself:
+- EmptyBinCalibrator collects GC_CAL_SAMPLES readings of the empty bin, right
+  after a pickup (GC_REPORT_PICKUP) or on command. The baseline of each
+  sensor is the median of its readings. It is only taken if the readings agree
+  (median absolute deviation up to GC_CAL_TOLERANCE) and the median is above
+  GC_CAL_MIN_PCT and up to GC_CAL_MAX_PCT of the nominal value, so a blocked
+  sensor or a bin that was not emptied completely does not become the new
+  zero. GC_CAL_MIN_PCT is the seesTrash() threshold: a reading the nominal bin
+  would count as trash is never taken as empty.
+- CalibrationStore keeps the baseline in EEPROM (NVS on the ESP32) with a
+  CRC-16, right after the reading queue. At boot it is loaded before the first
+  reading, so a cold start reads correctly without a warm up or a visit.
+
+EEPROM layout, starting at the base address (after ReadingQueue::STORAGE_SIZE):
+
+  | offset | size | field                                           |
+  |--------|------|-------------------------------------------------|
+  | 0      | 2    | magic "GK"                                      |
+  | 2      | 1    | layout version                                  |
+  | 3      | 2    | nominal 15° empty reading the baseline is for   |
+  | 5      | 2    | nominal 60° empty reading                       |
+  | 7      | 2    | measured 15° empty reading (with casing offset) |
+  | 9      | 2    | measured 60° empty reading (with casing offset) |
+  | 11     | 2    | CRC-16/CCITT of bytes 0-10                      |
+
+The nominal readings tie the baseline to the geometry it was measured with. If
+the sketch is flashed with other dimensions, the stored baseline is ignored.
+*/
+
+#ifndef GC_CALIBRATION_H
+#define GC_CALIBRATION_H
+
+#include <stdint.h>
+#include "GC_Geometry.h"
+
+// ======================== CONSTANTS ========================
+#define GC_CAL_MAGIC0         'G'
+#define GC_CAL_MAGIC1         'K'
+#define GC_CAL_VERSION        1
+#define GC_CAL_STORAGE_SIZE   13        // Bytes of EEPROM used, see the layout above
+
+#define GC_CAL_SAMPLES        5         // Empty-bin readings per calibration
+#define GC_CAL_TOLERANCE      2         // Largest median absolute deviation, in inches
+#define GC_CAL_MIN_PCT        85        // Baseline must be above this percent (seesTrash())
+#define GC_CAL_MAX_PCT        140       // and up to this percent of the nominal empty reading
+
+// Results of EmptyBinCalibrator::add()
+#define GC_CAL_BUSY           0         // more readings needed
+#define GC_CAL_DONE           1         // baseline ready
+#define GC_CAL_REJECTED       2         // readings unusable, nothing changed
+
+// ======================== STRUCTS ========================
+// Empty-bin readings of both sensors, including the casing offset
+struct Baseline {
+  long d15;
+  long d60;
+};
+
+// ======================== FUNCTION DEFINITIONS ========================
+/*
+gcCrc16 - CRC-16/CCITT-FALSE (polynomial 0x1021, start 0xFFFF) of some bytes.
+*/
+inline uint16_t gcCrc16(const uint8_t *data, uint8_t length) {
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+// Use a measured baseline for the empty-bin readings of a geometry
+inline void applyBaseline(DumpsterGeometry &g, const Baseline &b) {
+  g.defaultD15 = b.d15;
+  g.defaultD60 = b.d60;
+}
+
+// ======================== CLASS DEFINITIONS ========================
+/*
+CalibrationStore - The baseline in EEPROM, see the layout above.
+
+Store is the byte storage, EepromStore (GC_Queue.h) on the boards.
+*/
+template <typename Store>
+class CalibrationStore {
+public:
+  explicit CalibrationStore(int base) : base(base) {}
+
+  /*
+  load - Read the baseline stored for a geometry.
+
+  Parameters:
+    nominal  - The geometry from the sketch, with the nominal empty readings.
+    baseline - Filled in with the stored baseline.
+
+  Returns false if nothing valid is stored for this geometry.
+  */
+  bool load(const DumpsterGeometry &nominal, Baseline &baseline) {
+    Store::begin(base + GC_CAL_STORAGE_SIZE);
+    uint8_t bytes[GC_CAL_STORAGE_SIZE];
+    for (uint8_t i = 0; i < GC_CAL_STORAGE_SIZE; i++) {
+      bytes[i] = Store::read(base + i);
+    }
+    if (bytes[0] != GC_CAL_MAGIC0 || bytes[1] != GC_CAL_MAGIC1 || bytes[2] != GC_CAL_VERSION ||
+        get16(bytes + 11) != gcCrc16(bytes, 11) ||
+        get16(bytes + 3) != (uint16_t)nominal.defaultD15 || get16(bytes + 5) != (uint16_t)nominal.defaultD60) {
+      return false;
+    }
+    baseline.d15 = get16(bytes + 7);
+    baseline.d60 = get16(bytes + 9);
+    return true;
+  }
+
+  /*
+  save - Store a new baseline.
+
+  Parameters:
+    nominal  - The geometry from the sketch, not the calibrated one.
+    baseline - The measured empty-bin readings.
+  */
+  void save(const DumpsterGeometry &nominal, const Baseline &baseline) {
+    uint8_t bytes[GC_CAL_STORAGE_SIZE];
+    bytes[0] = GC_CAL_MAGIC0;
+    bytes[1] = GC_CAL_MAGIC1;
+    bytes[2] = GC_CAL_VERSION;
+    put16(bytes + 3, nominal.defaultD15);
+    put16(bytes + 5, nominal.defaultD60);
+    put16(bytes + 7, baseline.d15);
+    put16(bytes + 9, baseline.d60);
+    put16(bytes + 11, gcCrc16(bytes, 11));
+    for (uint8_t i = 0; i < GC_CAL_STORAGE_SIZE; i++) {
+      Store::write(base + i, bytes[i]);
+    }
+    Store::commit();
+  }
+
+private:
+  static uint16_t get16(const uint8_t *p) { return ((uint16_t)p[0] << 8) | p[1]; }
+  static void put16(uint8_t *p, uint16_t value) {
+    p[0] = value >> 8;
+    p[1] = value & 0xFF;
+  }
+
+  const int base;
+};
+
+
+/*
+EmptyBinCalibrator - Turn a few readings of the empty bin into a Baseline.
+
+Call start() after a pickup or on command, then add() with every reading
+until it returns GC_CAL_DONE or GC_CAL_REJECTED. Readings where a sensor
+timed out (-1) are skipped. After 2 * N readings without N good ones, the
+calibration is rejected.
+*/
+template <uint8_t N = GC_CAL_SAMPLES>
+class EmptyBinCalibrator {
+  static_assert(N >= 3, "EmptyBinCalibrator needs at least 3 readings for a median");
+
+public:
+  EmptyBinCalibrator() : count(0), tries(0), running(false) {}
+
+  void start() {
+    count = 0;
+    tries = 0;
+    running = true;
+  }
+
+  void stop() { running = false; }
+  bool active() const { return running; }
+
+  /*
+  add - Take one reading of the empty bin.
+
+  Parameters:
+    nominal  - The geometry from the sketch, to check the result against.
+    raw15    - Reading of the 15° sensor in inches, -1 on timeout.
+    raw60    - Reading of the 60° sensor in inches, -1 on timeout.
+    baseline - Filled in when GC_CAL_DONE is returned.
+
+  Returns GC_CAL_BUSY, GC_CAL_DONE or GC_CAL_REJECTED. Stops itself when it
+  returns anything but GC_CAL_BUSY.
+  */
+  uint8_t add(const DumpsterGeometry &nominal, long raw15, long raw60, Baseline &baseline) {
+    if (!running) {
+      return GC_CAL_REJECTED;
+    }
+    tries++;
+    if (raw15 >= 0 && raw60 >= 0) {
+      d15[count] = raw15 + nominal.offsetDist15;
+      d60[count] = raw60 + nominal.offsetDist60;
+      count++;
+    }
+    if (count < N) {
+      if (tries >= 2 * N) {
+        running = false;
+        return GC_CAL_REJECTED;
+      }
+      return GC_CAL_BUSY;
+    }
+
+    running = false;
+    long spread15, spread60;
+    baseline.d15 = robustMedian(d15, spread15);
+    baseline.d60 = robustMedian(d60, spread60);
+    if (spread15 > GC_CAL_TOLERANCE || spread60 > GC_CAL_TOLERANCE ||
+        !plausible(baseline.d15, nominal.defaultD15) || !plausible(baseline.d60, nominal.defaultD60)) {
+      return GC_CAL_REJECTED;
+    }
+    return GC_CAL_DONE;
+  }
+
+private:
+  // Median of the N values (sorted in place), and their median absolute deviation
+  static long robustMedian(long *v, long &mad) {
+    sort(v);
+    long median = v[N / 2];
+    long dev[N];
+    for (uint8_t i = 0; i < N; i++) {
+      dev[i] = v[i] >= median ? v[i] - median : median - v[i];
+    }
+    sort(dev);
+    mad = dev[N / 2];
+    return median;
+  }
+
+  // Insertion sort, N is a handful of readings
+  static void sort(long *v) {
+    for (uint8_t i = 1; i < N; i++) {
+      long x = v[i];
+      uint8_t j = i;
+      while (j > 0 && v[j - 1] > x) {
+        v[j] = v[j - 1];
+        j--;
+      }
+      v[j] = x;
+    }
+  }
+
+  // Not short enough to count as trash in the nominal bin, not past the far end
+  static bool plausible(long measured, long nominal) {
+    return measured * 100 > nominal * GC_CAL_MIN_PCT && measured * 100 <= nominal * GC_CAL_MAX_PCT;
+  }
+
+  long d15[N];
+  long d60[N];
+  uint8_t count;
+  uint8_t tries;
+  bool running;
+};
+
+#endif
+// GC_CALIBRATION_H
@@ -0,0 +1,235 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Clock.h
+
+Device time without asking the modem for every reading.
+
+getISOTimestamp used to ask the modem (AT+CCLK?) on every send, and parse the
+answer with String. Now the modem is asked once after the connection is up and
+then every GC_CLOCK_RESYNC_MS (syncClock() in GC_Soracom.h). In between, the
+time is the epoch the modem gave plus the millis() since, which costs nothing.
+
+Everything here is plain integer math on fixed buffers:
+- parseCclk()      "24/04/13,13:37:20+08" -> UTC epoch seconds. The modem
+                   gives the time zone in quarter hours (+08 is UTC+2).
+- daysFromCivil()  date -> days since 1970-01-01, and civilFromDays() back.
+                   No TimeLib, no tables, correct for any Gregorian date.
+- EpochClock       epoch anchored to millis(), formats ISO-8601 or epoch.
+
+Why the old time was wrong: the SIM7000 clock starts at 1980 (or whatever it
+held) and only follows the network once AT+CLTS=1 is set. syncClock() turns it
+on, and a time before GC_CLOCK_MIN_YEAR is not accepted as valid.
+*/
+
+#ifndef GC_CLOCK_H
+#define GC_CLOCK_H
+
+#include <Arduino.h>
+#include <stdio.h>
+
+// ======================== CONSTANTS ========================
+#define GC_CLOCK_RESYNC_MS    3600000UL   // Ask the modem again every hour
+#define GC_CLOCK_RETRY_MS     60000UL     // Until the first valid time, ask every minute
+#define GC_CLOCK_MIN_YEAR     2024        // Earlier times mean the modem clock is not set
+#define GC_ISO_TIME_SIZE      25          // "2022-10-05T11:30:45.000Z" and the terminating 0
+
+// ======================== DATE MATH ========================
+/*
+daysFromCivil - Days from 1970-01-01 to a date (proleptic Gregorian).
+
+Parameters:
+  y - Year, e.g. 2024.
+  m - Month, 1-12.
+  d - Day, 1-31.
+
+From Howard Hinnant's date algorithms. Counts in 400 year eras that start in
+March, so leap days fall at the end of the year.
+*/
+inline long daysFromCivil(long y, uint8_t m, uint8_t d) {
+  y -= m <= 2;
+  long era = (y >= 0 ? y : y - 399) / 400;
+  long yoe = y - era * 400;                                   // [0, 399]
+  long doy = (153L * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;  // [0, 365]
+  long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;           // [0, 146096]
+  return era * 146097L + doe - 719468L;
+}
+
+/*
+civilFromDays - The date of a day count from 1970-01-01. Inverse of daysFromCivil.
+*/
+inline void civilFromDays(long z, long &y, uint8_t &m, uint8_t &d) {
+  z += 719468L;
+  long era = (z >= 0 ? z : z - 146096L) / 146097L;
+  long doe = z - era * 146097L;
+  long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  long mp = (5 * doy + 2) / 153;
+  d = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+  m = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+  y = yoe + era * 400 + (m <= 2);
+}
+
+namespace gc_detail {
+  // Value of the two digits at s, -1 if they are not digits
+  inline int twoDigits(const char *s) {
+    if (s[0] < '0' || s[0] > '9' || s[1] < '0' || s[1] > '9') {
+      return -1;
+    }
+    return (s[0] - '0') * 10 + (s[1] - '0');
+  }
+}
+
+/*
+parseCclk - Turn the time of a +CCLK answer into UTC epoch seconds.
+
+Parameters:
+  s     - The text between the quotes, "yy/MM/dd,hh:mm:ss+zz".
+  epoch - Filled in with the seconds since 1970-01-01 UTC.
+
+zz is the time zone in quarter hours, "-20" is UTC-5. It may be missing, the
+time is taken as UTC then.
+Returns false if the text does not have that shape.
+*/
+inline bool parseCclk(const char *s, uint32_t &epoch) {
+  int yy = gc_detail::twoDigits(s);
+  int mm = gc_detail::twoDigits(s + 3);
+  int dd = gc_detail::twoDigits(s + 6);
+  int hour = gc_detail::twoDigits(s + 9);
+  int minute = gc_detail::twoDigits(s + 12);
+  int second = gc_detail::twoDigits(s + 15);
+  if (yy < 0 || s[2] != '/' || mm < 1 || mm > 12 || s[5] != '/' || dd < 1 || dd > 31 ||
+      s[8] != ',' || hour < 0 || hour > 23 || minute < 0 || minute > 59 ||
+      second < 0 || second > 60) {
+    return false;
+  }
+
+  long offsetMinutes = 0;
+  if (s[17] == '+' || s[17] == '-') {
+    int quarters = gc_detail::twoDigits(s + 18);
+    if (quarters < 0) {
+      return false;
+    }
+    offsetMinutes = (s[17] == '-' ? -15L : 15L) * quarters;
+  }
+
+  // Normalize year (assuming years >= 70 are 1970s, else 2000s)
+  long fullYear = (yy >= 70) ? (1900 + yy) : (2000 + yy);
+  long local = daysFromCivil(fullYear, mm, dd) * 86400L + hour * 3600L + minute * 60L + second;
+  epoch = (uint32_t)(local - offsetMinutes * 60L);   // local time minus the zone is UTC
+  return true;
+}
+
+/*
+formatIsoTime - Write an epoch as ISO-8601 UTC, e.g. "2022-10-05T11:30:45.000Z".
+
+Parameters:
+  buf   - At least GC_ISO_TIME_SIZE chars.
+  size  - Size of buf.
+  epoch - Seconds since 1970-01-01 UTC.
+*/
+inline void formatIsoTime(char *buf, size_t size, uint32_t epoch) {
+  long y;
+  uint8_t m, d;
+  civilFromDays((long)(epoch / 86400UL), y, m, d);
+  uint32_t secs = epoch % 86400UL;
+  // A uint32_t epoch ends in 2106, m and d are 1-12 and 1-31. The % only
+  // tells the compiler the fields fit GC_ISO_TIME_SIZE.
+  snprintf(buf, size, "%04u-%02u-%02uT%02u:%02u:%02u.000Z",
+           (unsigned)(y % 10000), (unsigned)(m % 100), (unsigned)(d % 100),
+           (unsigned)(secs / 3600), (unsigned)(secs / 60 % 60), (unsigned)(secs % 60));
+}
+
+// ======================== CLASS DEFINITION ========================
+class EpochClock {
+public:
+  constexpr EpochClock() : anchorEpoch(0), anchorMs(0), lastTryMs(0), synced(false), tried(false) {}
+
+  /*
+  set - Anchor the clock to a time from the modem.
+
+  Parameters:
+    epoch - Seconds since 1970-01-01 UTC, now.
+
+  Times before GC_CLOCK_MIN_YEAR are rejected, the modem clock is not set yet.
+  Returns true if the time was taken.
+  */
+  bool set(uint32_t epoch) {
+    lastTryMs = millis();
+    tried = true;
+    if ((long)(epoch / 86400UL) < daysFromCivil(GC_CLOCK_MIN_YEAR, 1, 1)) {
+      return false;
+    }
+    anchorEpoch = epoch;
+    anchorMs = lastTryMs;
+    synced = true;
+    return true;
+  }
+
+  // Note a failed attempt, so syncDue() waits before the next one
+  void failed() {
+    lastTryMs = millis();
+    tried = true;
+  }
+
+  // True if it is time to ask the modem again
+  bool syncDue() const {
+    return !tried || millis() - lastTryMs >= (synced ? GC_CLOCK_RESYNC_MS : GC_CLOCK_RETRY_MS);
+  }
+
+  // True once a valid time was set
+  bool valid() const { return synced; }
+
+  // Seconds since 1970-01-01 UTC, 0 if the clock was never set
+  uint32_t now() const { return at(millis()); }
+
+  /*
+  at - The epoch of an earlier (or later) millis() stamp, 0 if not valid.
+
+  Works within about 24 days of the last sync, which the hourly resync covers.
+  */
+  uint32_t at(unsigned long stamp) const {
+    if (!synced) {
+      return 0;
+    }
+    long deltaMs = (long)(stamp - anchorMs);
+    return anchorEpoch + (deltaMs >= 0 ? deltaMs / 1000 : -((999 - deltaMs) / 1000));
+  }
+
+  /*
+  iso - Write the current time as ISO-8601 UTC.
+
+  Parameters:
+    buf  - At least GC_ISO_TIME_SIZE chars.
+    size - Size of buf.
+
+  Returns false, and an empty buf, if the clock was never set.
+  */
+  bool iso(char *buf, size_t size) const {
+    if (!synced) {
+      buf[0] = '\0';
+      return false;
+    }
+    formatIsoTime(buf, size, now());
+    return true;
+  }
+
+private:
+  uint32_t anchorEpoch;       // epoch at anchorMs
+  unsigned long anchorMs;     // millis() when the modem gave anchorEpoch
+  unsigned long lastTryMs;    // millis() of the last sync attempt
+  bool synced;
+  bool tried;
+};
+
+/*
+deviceClock - The one clock of the firmware.
+
+Set by syncClock() (GC_Soracom.h), read by telemetryToJson() for the "time" key.
+*/
+inline EpochClock &deviceClock() {
+  static EpochClock clock;
+  return clock;
+}
+
+#endif
+// GC_CLOCK_H
@@ -0,0 +1,187 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Filter.h
+
+Per-sensor filter for the distance readings. Replaces addToFilterSmart() from
+Sensor Code/Slightly_changed_but_commented_code.ino, which needed nine
+reference parameters of per-sensor state living in parallel globals and shared
+one filtersReady flag between the sensors.
+
+Each DistanceFilter<N> object owns the state of one sensor. N, the window size,
+is fixed at compile time, so the memory used is known up front (about 4 bytes
+per window slot) and every update costs the same.
+
+How a new reading is handled:
+1. Readings outside [minValid, maxValid] are dropped.
+2. The first reading is accepted as is.
+3. Hampel check: if the reading is within max(smallSpike, 3 * MAD) of the
+   window median, it is accepted. MAD is the median absolute deviation of the
+   window, so the threshold follows how noisy the sensor currently is.
+4. Otherwise it is treated as a possible jump (e.g. trash was added or the bin
+   was emptied). It is only accepted after `confirm` readings in a row that agree
+   with each other within `tolerance`. Then the window restarts from the new
+   value. The old version rewrote every slot of the window at this point, here
+   only the count is reset.
+
+The filtered value is the median of the window.
+*/
+
+#ifndef GC_FILTER_H
+#define GC_FILTER_H
+
+#include <stdint.h>
+
+// ======================== CLASS DEFINITION ========================
+template <uint8_t N>
+class DistanceFilter {
+  static_assert(N > 0 && N < 128, "DistanceFilter window must hold 1 to 127 readings");
+
+public:
+  /*
+  Parameters:
+    minValid, maxValid - Readings outside this range are dropped.
+    smallSpike         - Changes up to this size always go through.
+    tolerance          - Readings within this of each other confirm a jump.
+    confirm            - Readings in a row needed to accept a jump.
+  */
+  DistanceFilter(int16_t minValid, int16_t maxValid,
+                 int16_t smallSpike = 2, int16_t tolerance = 1, uint8_t confirm = 3)
+    : minValid(minValid), maxValid(maxValid),
+      smallSpike(smallSpike), tolerance(tolerance), confirmNeeded(confirm) {
+    reset();
+  }
+
+  // Empty the window, value() goes back to -1
+  void reset() {
+    count = 0;
+    head = 0;
+    pending = 0;
+    filled = false;
+    lastRaw = -1;
+  }
+
+  /*
+  update - Add one raw reading and return the filtered value.
+
+  Returns -1 until the first valid reading arrives.
+  */
+  int16_t update(int16_t reading) {
+    // Reject obvious outliers
+    if (reading < minValid || reading > maxValid) {
+      return value();
+    }
+
+    // If we don't have a value yet, just add it
+    if (count == 0) {
+      push(reading);
+      lastRaw = reading;
+      return value();
+    }
+
+    int16_t median = value();
+    int16_t difference = reading - median;
+    if (difference < 0) difference = -difference;
+
+    int16_t threshold = 3 * mad(median);
+    if (threshold < smallSpike) threshold = smallSpike;
+
+    // Within the Hampel window, accept it
+    if (difference <= threshold) {
+      push(reading);
+      lastRaw = reading;
+      pending = 0;
+      return value();
+    }
+
+    // Large jump, needs consecutive confirmation
+    int16_t step = reading - lastRaw;
+    if (step < 0) step = -step;
+    bool isConsistent = (lastRaw > 0 && step <= tolerance);
+    pending = isConsistent ? pending + 1 : 1;
+    lastRaw = reading;
+
+    // Enough readings agree, restart the window from the new value.
+    // Only the count is reset, the old slots are never rewritten.
+    if (pending >= confirmNeeded) {
+      count = 0;
+      head = 0;
+      pending = 0;
+      push(reading);
+    }
+    return value();
+  }
+
+  // Median of the window, -1 if empty
+  int16_t value() const { return (count == 0) ? -1 : sorted[(count - 1) / 2]; }
+
+  // True once the window has been full, stays true after a jump is accepted
+  bool ready() const { return filled; }
+
+  // Number of readings in the window
+  uint8_t size() const { return count; }
+
+  // Readings in a row seen so far for a jump that is not confirmed yet
+  uint8_t confirming() const { return pending; }
+
+private:
+  /*
+  push - Add a reading to the ring and to the sorted copy of the window.
+
+  When the ring is full, the oldest reading is removed from the sorted copy
+  first. Both steps shift at most N entries.
+  */
+  void push(int16_t reading) {
+    if (count == N) {
+      int16_t oldest = ring[head];
+      uint8_t i = 0;
+      while (sorted[i] != oldest) i++;
+      for (; i + 1 < count; i++) sorted[i] = sorted[i + 1];
+      count--;
+    }
+
+    ring[head] = reading;
+    head = (head + 1) % N;
+
+    uint8_t j = count++;
+    while (j > 0 && sorted[j - 1] > reading) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = reading;
+    if (count == N) filled = true;
+  }
+
+  /*
+  mad - Median absolute deviation of the window around `median`.
+
+  The deviations grow when walking away from the middle of the sorted copy in
+  either direction, so the two sides are merged until the middle one is found.
+  */
+  int16_t mad(int16_t median) const {
+    int8_t lo = (count - 1) / 2;
+    uint8_t hi = lo + 1;
+    int16_t d = 0;
+    for (uint8_t k = 0; k <= (count - 1) / 2; k++) {
+      int16_t dl = (lo >= 0) ? median - sorted[lo] : 0x7FFF;
+      int16_t dh = (hi < count) ? sorted[hi] - median : 0x7FFF;
+      if (dl <= dh) { d = dl; lo--; }
+      else          { d = dh; hi++; }
+    }
+    return d;
+  }
+
+  int16_t ring[N];      // readings in arrival order
+  int16_t sorted[N];    // the same readings, sorted
+  uint8_t count;
+  uint8_t head;
+  uint8_t pending;
+  bool filled;
+  int16_t lastRaw;
+
+  const int16_t minValid, maxValid;
+  const int16_t smallSpike, tolerance;
+  const uint8_t confirmNeeded;
+};
+
+#endif
+// GC_FILTER_H
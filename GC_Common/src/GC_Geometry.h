@@ -0,0 +1,267 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Geometry.h
+
+Dumpster geometry and the two sensor (15° and 60°) fullness model that used to be
+copied into GC_Uno.cpp and Fullness_Dection_esp32.ino.
+
+The 15° sensor looks down the length of the bin from the top, the 60° sensor
+looks down at the floor. Each reading is turned into a hit point (x, h), where
+x is measured from the far wall and h is the trash height at that point:
+
+  h = dumpsterHeight - dist * sin(angle)
+  x = dumpsterLen    - dist * cos(angle)
+
+The trash surface is then modelled as a piecewise-linear profile through the
+hit points and integrated across the bin (see fillVolume()). Sensors are listed
+in filling order, lowest (steepest) first. With the 60° and 15° sensors this
+gives the old "bottom rectangle plus top trapezoid" volume, and a third, fourth
+or fifth sensor is just one more SensorMount in the list.
+
+The Uno has no FPU, so calling sin()/cos() in double precision on every loop is
+expensive. Here the mounting angles and dimensions go into a constexpr
+DumpsterGeometry. The compiler works out the sines and cosines once, as Q14
+fixed point numbers (value * 16384), and fullnessFromDistances() only uses
+integer multiplies, shifts and one division.
+
+All lengths are in inches, volumes in cubic inches. This header has no Arduino
+dependencies.
+*/
+
+#ifndef GC_GEOMETRY_H
+#define GC_GEOMETRY_H
+
+#include <stdint.h>
+
+// ======================== CONSTANTS ========================
+#define GC_Q14_SHIFT    14
+#define GC_Q14_ONE      (1L << GC_Q14_SHIFT)   // 1.0 in Q14
+
+#define GC_PI           3.14159265358979323846
+
+// ======================== COMPILE-TIME TRIG ========================
+// Taylor series, only meant to be evaluated by the compiler (or once at load).
+// Valid for angles between 0 and 90 degrees, which covers every mounting angle.
+constexpr double gcSinTerm(double x, double term, int n) {
+  return (n > 10) ? 0.0 : term + gcSinTerm(x, -term * x * x / ((2.0 * n) * (2.0 * n + 1.0)), n + 1);
+}
+
+// sin/cos of an angle in degrees
+constexpr double gcSinDeg(double deg) {
+  return gcSinTerm(deg * GC_PI / 180.0, deg * GC_PI / 180.0, 1);
+}
+constexpr double gcCosDeg(double deg) {
+  return gcSinDeg(90.0 - deg);
+}
+
+// sin/cos of an angle in degrees, in Q14 fixed point (rounded)
+constexpr int32_t gcSinQ14(double deg) {
+  return (int32_t)(gcSinDeg(deg) * GC_Q14_ONE + 0.5);
+}
+constexpr int32_t gcCosQ14(double deg) {
+  return (int32_t)(gcCosDeg(deg) * GC_Q14_ONE + 0.5);
+}
+
+// ======================== STRUCTS ========================
+// Dimensions of the dumpster and how the sensors are mounted in it.
+// Build with dumpsterGeometry() so the derived values are filled in.
+struct DumpsterGeometry {
+  long len;             // length of the dumpster in inches
+  long width;           // width of the dumpster in inches
+  long height;          // height of the dumpster in inches
+
+  long offsetDist15;    // distance from the 15° sensor face to the casing edge
+  long offsetDist60;    // distance the 60° sensor is placed away from the wall
+  long offsetHeight60;  // height the 60° sensor is placed away from the top
+
+  int32_t sin15, cos15; // Q14 trig of the top (15°) sensor angle
+  int32_t sin60, cos60; // Q14 trig of the bottom (60°) sensor angle
+
+  long defaultD15;      // 15° reading when the bin is empty
+  long defaultD60;      // 60° reading when the bin is empty
+  long totalVolume;     // volume of the dumpster in cubic inches
+};
+
+// How one sensor is mounted. Build with sensorMount().
+struct SensorMount {
+  int32_t sinQ, cosQ;   // Q14 trig of the mounting angle
+  long offsetDist;      // casing offset added to every reading
+  long offsetHeight;    // how far below the top of the bin the sensor sits
+  long emptyDist;       // reading when the bin is empty
+};
+
+// One point of the trash profile, x from the far wall, h from the floor
+struct ProfilePoint {
+  long x, h;
+};
+
+// Intermediate values of one fullness computation, kept for debug prints
+struct FullnessResult {
+  long h15, h60;        // trash height at each hit point
+  long x15, x60;        // distance of each hit point from the far wall
+  long trashVolume;     // estimated trash volume in cubic inches
+  long fullness;        // fullness percentage (0-100)
+};
+
+// ======================== FUNCTION DEFINITIONS ========================
+/*
+dumpsterGeometry - Build a DumpsterGeometry and fill in the derived values.
+
+Parameters:
+  len, width, height - Dumpster dimensions in inches.
+  offsetDist15       - Casing offset of the 15° sensor.
+  offsetDist60       - Casing offset of the 60° sensor.
+  offsetHeight60     - Height offset of the 60° sensor.
+  angle15, angle60   - Mounting angles in degrees, 15 and 60 by default.
+
+Declare the result constexpr (or const at file scope) and everything, including
+the trig constants, is computed at compile time.
+*/
+constexpr DumpsterGeometry dumpsterGeometry(long len, long width, long height,
+                                            long offsetDist15, long offsetDist60,
+                                            long offsetHeight60,
+                                            double angle15 = 15, double angle60 = 60) {
+  return DumpsterGeometry{
+    len, width, height,
+    offsetDist15, offsetDist60, offsetHeight60,
+    gcSinQ14(angle15), gcCosQ14(angle15),
+    gcSinQ14(angle60), gcCosQ14(angle60),
+    (long)(len / gcCosDeg(angle15)),
+    (long)(height / gcSinDeg(angle60)),
+    height * width * len
+  };
+}
+
+/*
+sensorMount - Describe how one sensor is mounted.
+
+Parameters:
+  angle        - Mounting angle in degrees below the horizontal.
+  offsetDist   - Casing offset added to every reading, in inches.
+  offsetHeight - How far below the top of the bin the sensor sits, in inches.
+  emptyDist    - Reading when the bin is empty. Use gcFloorDistance() for
+                 sensors that look at the floor, gcWallDistance() for sensors
+                 that look at the far wall.
+*/
+constexpr SensorMount sensorMount(double angle, long offsetDist, long offsetHeight, long emptyDist) {
+  return SensorMount{ gcSinQ14(angle), gcCosQ14(angle), offsetDist, offsetHeight, emptyDist };
+}
+
+// Empty-bin reading of a sensor that looks down at the floor
+constexpr long gcFloorDistance(long height, double angle) {
+  return (long)(height / gcSinDeg(angle));
+}
+
+// Empty-bin reading of a sensor that looks down the length of the bin at the far wall
+constexpr long gcWallDistance(long len, double angle) {
+  return (long)(len / gcCosDeg(angle));
+}
+
+// The 15° and 60° sensors of a DumpsterGeometry as SensorMounts
+constexpr SensorMount mount15(const DumpsterGeometry &g) {
+  return SensorMount{ g.sin15, g.cos15, g.offsetDist15, 0, g.defaultD15 };
+}
+constexpr SensorMount mount60(const DumpsterGeometry &g) {
+  return SensorMount{ g.sin60, g.cos60, g.offsetDist60, g.offsetHeight60, g.defaultD60 };
+}
+
+// Convert a Q14 value to whole inches, truncated toward zero like a (long) cast
+inline long gcQ14ToLong(long q) {
+  return (q >= 0) ? (q >> GC_Q14_SHIFT) : -((-q) >> GC_Q14_SHIFT);
+}
+
+/*
+profilePoint - Turn one sensor reading into a hit point.
+
+Parameters:
+  g    - Geometry of the dumpster.
+  m    - How the sensor is mounted.
+  raw  - Reading in inches (without the casing offset).
+
+Kept in Q14 until the end, so the rounding matches the old float code.
+*/
+inline ProfilePoint profilePoint(const DumpsterGeometry &g, const SensorMount &m, long raw) {
+  long dist = raw + m.offsetDist;
+  ProfilePoint p;
+  p.x = gcQ14ToLong(g.len * GC_Q14_ONE - dist * m.cosQ);
+  p.h = gcQ14ToLong((g.height - m.offsetHeight) * GC_Q14_ONE - dist * m.sinQ);
+  return p;
+}
+
+// True if the reading is shorter than 85% of the empty reading (dist * 20 <= empty * 17)
+inline bool seesTrash(const SensorMount &m, long raw) {
+  return raw >= 0 && (raw + m.offsetDist) * 20 <= m.emptyDist * 17;
+}
+
+/*
+fillVolume - Integrate the trash profile of N sensors across the bin.
+
+Parameters:
+  g      - Geometry of the dumpster.
+  mounts - How each sensor is mounted, lowest (steepest) sensor first.
+  raw    - Reading of each sensor in inches (without the casing offset).
+  n      - Number of sensors.
+
+The trash surface is the line through the hit points, taken in filling order,
+and the trash fills the bin from the far wall up to that line. Walking up the
+line, every pair of neighbouring hit points adds one trapezoid slice:
+
+  slice k = (x[k-1] + x[k]) / 2 * (h[k] - h[k-1])
+
+on top of the rectangle h[0] * x[0] under the lowest hit point. This is the
+same area as integrating the piecewise-linear profile along the length, and
+for two sensors it is exactly the old bottomVol + topVol. A sensor only counts
+if every sensor below it also sees trash, so the walk stops at the first one
+that reads empty. One pass over the sensors, O(N).
+
+Returns the trash volume in cubic inches, between 0 and totalVolume.
+*/
+inline long fillVolume(const DumpsterGeometry &g, const SensorMount *mounts, const long *raw, uint8_t n) {
+  if (n == 0 || !seesTrash(mounts[0], raw[0])) {
+    return 0;
+  }
+
+  ProfilePoint prev = profilePoint(g, mounts[0], raw[0]);
+  long volume = prev.h * g.width * prev.x;   // rectangle under the lowest hit point
+
+  for (uint8_t i = 1; i < n && seesTrash(mounts[i], raw[i]); i++) {
+    ProfilePoint p = profilePoint(g, mounts[i], raw[i]);
+    volume += (prev.x + p.x) * (p.h - prev.h) / 2 * g.width;
+    prev = p;
+  }
+
+  if (volume < 0) volume = 0;
+  if (volume > g.totalVolume) volume = g.totalVolume;
+  return volume;
+}
+
+/*
+fullnessFromDistances - Estimate the fullness from one pair of sensor readings.
+
+Parameters:
+  g      - Geometry of the dumpster.
+  raw15  - Reading of the 15° sensor in inches (without the casing offset).
+  raw60  - Reading of the 60° sensor in inches (without the casing offset).
+
+Returns the hit points, trash volume and fullness percentage. Integer math only.
+This is fillVolume() with the 60° sensor below the 15° sensor.
+*/
+inline FullnessResult fullnessFromDistances(const DumpsterGeometry &g, long raw15, long raw60) {
+  const SensorMount mounts[2] = { mount60(g), mount15(g) };  // lowest sensor first
+  const long raw[2] = { raw60, raw15 };
+
+  FullnessResult r;
+  ProfilePoint p15 = profilePoint(g, mounts[1], raw15);
+  ProfilePoint p60 = profilePoint(g, mounts[0], raw60);
+  r.h15 = p15.h;
+  r.x15 = p15.x;
+  r.h60 = p60.h;
+  r.x60 = p60.x;
+
+  r.trashVolume = fillVolume(g, mounts, raw, 2);
+  r.fullness = (r.trashVolume * 100) / g.totalVolume;
+  return r;
+}
+
+#endif
+// GC_GEOMETRY_H
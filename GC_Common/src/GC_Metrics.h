@@ -0,0 +1,153 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Metrics.h
+
+Where the time of a report goes, in numbers instead of println messages.
+
+When a report is slow or fails in the field, the serial log only says which
+step printed last. With GC_METRICS set to 1, every phase of the work is timed
+with micros() and counted:
+
+  | phase              | timed around                                     |
+  |--------------------|--------------------------------------------------|
+  | GC_PHASE_POWER_ON  | RST and PWRKEY holds, modem boot                 |
+  | GC_PHASE_RESTART   | modem.restart()                                  |
+  | GC_PHASE_REGISTER  | waiting for the network registration             |
+  | GC_PHASE_GPRS      | modem.gprsConnect()                              |
+  | GC_PHASE_CONNECT   | opening the TCP/UDP connection to Soracom        |
+  | GC_PHASE_WRITE     | writing the request and payload                  |
+  | GC_PHASE_RESPONSE  | waiting for the HTTP response or SEND OK         |
+  | GC_PHASE_SENSOR    | each read of one ultrasonic sensor               |
+
+Each phase keeps its runs, failures, last, average and longest time. Sensor
+timeouts and A02 checksum failures are counted as well. Everything is in one
+fixed struct (phaseMetrics()), nothing is allocated.
+
+The firmware only uses the GC_METRIC_* macros. With GC_METRICS 0 (the default)
+they expand to nothing and their arguments are not evaluated, so the struct
+and every timing call are compiled out. Never pass an argument with a side
+effect, e.g. GC_METRIC_END(GC_PHASE_RESTART, modem.restart()).
+
+Set GC_METRICS (and GC_METRICS_IN_PAYLOAD to also send the last phase times
+with each JSON report, see telemetryToJson in GC_Soracom.h) in the sketch
+header, BEFORE including the GC_Common headers.
+
+A phase may only be timed by one task at a time. On the ESP32 pipeline the
+sensor and uplink tasks time different phases.
+*/
+
+#ifndef GC_METRICS_H
+#define GC_METRICS_H
+
+#include <Arduino.h>
+#include "GC_Task.h"
+
+// ======================== CONSTANTS ========================
+#if !defined(GC_METRICS)
+#define GC_METRICS            0
+#endif
+
+#if !defined(GC_METRICS_IN_PAYLOAD)
+#define GC_METRICS_IN_PAYLOAD 0
+#endif
+
+#if GC_METRICS_IN_PAYLOAD && !GC_METRICS
+#error "GC_METRICS_IN_PAYLOAD needs GC_METRICS"
+#endif
+
+#define GC_PHASE_POWER_ON     0
+#define GC_PHASE_RESTART      1
+#define GC_PHASE_REGISTER     2
+#define GC_PHASE_GPRS         3
+#define GC_PHASE_CONNECT      4
+#define GC_PHASE_WRITE        5
+#define GC_PHASE_RESPONSE     6
+#define GC_PHASE_SENSOR       7
+#define GC_PHASE_COUNT        8
+
+#if GC_METRICS
+// ======================== STRUCT DEFINITION ========================
+struct PhaseMetrics {
+  StageTiming phases[GC_PHASE_COUNT];   // runs, last/avg/max duration (GC_Task.h)
+  uint16_t fails[GC_PHASE_COUNT];       // runs that ended with ok == false
+  uint32_t sensorTimeouts;              // sensor reads without a valid frame
+  uint32_t checksumErrors;              // A02 frames with a bad checksum
+
+  void begin(uint8_t phase) { phases[phase].begin(); }
+
+  void end(uint8_t phase, bool ok) {
+    phases[phase].end();
+    if (!ok) {
+      fails[phase]++;
+    }
+  }
+
+  // Name of a GC_PHASE_* for the serial log
+  static const char *name(uint8_t phase) {
+    switch (phase) {
+      case GC_PHASE_POWER_ON: return "power on";
+      case GC_PHASE_RESTART:  return "restart";
+      case GC_PHASE_REGISTER: return "register";
+      case GC_PHASE_GPRS:     return "gprs";
+      case GC_PHASE_CONNECT:  return "connect";
+      case GC_PHASE_WRITE:    return "write";
+      case GC_PHASE_RESPONSE: return "response";
+      default:                return "sensor";
+    }
+  }
+
+  /*
+  print - Print one line per phase that ran, then the sensor counters.
+
+  Parameters:
+    SerialMon - The serial monitor stream for debug output.
+  */
+  void print(Stream &SerialMon) const {
+    for (uint8_t i = 0; i < GC_PHASE_COUNT; i++) {
+      const StageTiming &t = phases[i];
+      if (t.runs == 0) {
+        continue;
+      }
+      SerialMon.print(name(i));
+      SerialMon.print(": runs "); SerialMon.print(t.runs);
+      SerialMon.print(", fails "); SerialMon.print(fails[i]);
+      SerialMon.print(", last "); SerialMon.print(t.lastUs);
+      SerialMon.print(" us, avg "); SerialMon.print(t.averageUs());
+      SerialMon.print(" us, max "); SerialMon.print(t.maxUs);
+      SerialMon.println(" us");
+    }
+    SerialMon.print("sensor timeouts: "); SerialMon.print(sensorTimeouts);
+    SerialMon.print(", checksum errors: "); SerialMon.println(checksumErrors);
+  }
+};
+
+/*
+phaseMetrics - The one set of metrics of the firmware.
+
+Zero at start up, kept until the next reset.
+*/
+inline PhaseMetrics &phaseMetrics() {
+  static PhaseMetrics metrics;
+  return metrics;
+}
+
+// ======================== MACROS ========================
+#define GC_METRIC_BEGIN(phase)        phaseMetrics().begin(phase)
+#define GC_METRIC_END(phase, ok)      phaseMetrics().end(phase, ok)
+#define GC_METRIC_COUNT(counter)      (phaseMetrics().counter++)
+#define GC_METRIC_ADD(counter, n)     (phaseMetrics().counter += (n))
+#define GC_METRICS_PRINT(SerialMon)   phaseMetrics().print(SerialMon)
+
+#else
+
+#define GC_METRIC_BEGIN(phase)        ((void)0)
+#define GC_METRIC_END(phase, ok)      ((void)0)
+#define GC_METRIC_COUNT(counter)      ((void)0)
+#define GC_METRIC_ADD(counter, n)     ((void)0)
+#define GC_METRICS_PRINT(SerialMon)   ((void)0)
+
+#endif
+// GC_METRICS
+
+#endif
+// GC_METRICS_H
@@ -0,0 +1,797 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Ota.h
+
+ESP32 only in practice. Firmware updates over the cellular link.
+
+Every fix used to mean a visit to each dumpster with a laptop. OtaUpdater gets
+the new firmware through the modem instead, over a second TinyGsmClient, next
+to the one kept open to Harvest:
+
+1. GET GC_OTA_MANIFEST_PATH from GC_OTA_HOST, one line of text:
+
+     <version> <size in bytes> <sha256 of the image, 64 hex digits> [lz4]
+
+   Nothing more happens if the version is not newer than GC_FIRMWARE_VERSION.
+   e.g. "2 1048576 9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08"
+   "lz4" at the end means the packed image (below) is published as well.
+2. GET GC_OTA_IMAGE_PATH in chunks of GC_OTA_CHUNK_SIZE bytes, with a Range
+   header, straight into the OTA partition that is not running. The server
+   has to answer Range requests (206 Partial Content). With "lz4", the
+   blocks of GC_OTA_PACKED_PATH are fetched instead and unpacked on the way.
+3. After every chunk, OtaState keeps how far the download got in EEPROM (NVS).
+   When the connection drops, the time budget of the report runs out or the
+   board resets, the next call goes on from there. No byte is fetched twice,
+   which matters on a data plan billed by the byte.
+4. Once the whole image is there, its SHA-256 is computed from what was
+   actually written to flash and compared with the manifest. Only then does
+   the board boot from that partition (esp_ota_set_boot_partition, which
+   checks the image format as well).
+
+Rollback: a new firmware starts as "pending verify". The sketch confirms it
+(otaConfirm) once a report was delivered. If the new firmware crashes, resets
+or goes to deep sleep before that, or has not delivered a report within
+GC_OTA_CONFIRM_MS, the bootloader boots the previous firmware again. That
+needs verifyRollbackLater() to return true (see lot_esp32.ino), otherwise the
+Arduino core confirms every firmware as soon as it boots.
+
+Packed image: LZ4 takes a third or more off an ESP32 firmware, and the data
+plan is billed by the byte. Every GC_OTA_CHUNK_SIZE bytes of the image
+are an LZ4 block of their own (the block format, no frame), so a block
+unpacks straight into the sector buffer, a resumed download starts at any
+block, and OtaState stays the same as for the plain image. The file is
+
+  | offset   | size | field                                            |
+  |----------|------|--------------------------------------------------|
+  | 0        | 2    | number of blocks N, big endian                   |
+  | 2        | 2N   | packed size of each block, big endian            |
+  | 2 + 2N   | ...  | the blocks, each unpacks to GC_OTA_CHUNK_SIZE    |
+  |          |      | bytes (the last one to the rest of the image)    |
+
+The block sizes are fetched once per update() (2 bytes per 4 KB), then
+every block with one Range request. The SHA-256 in the manifest is the one
+of the unpacked image, checked from flash like before. A corrupt block
+starts the download over. No packed file on the server falls back to the
+plain image. Delta images are not supported, they need a patch tool on the
+board and the old image to patch.
+
+To publish a firmware: put the .bin (Arduino IDE: Sketch > Export Compiled
+Binary) on the server, then the manifest line, e.g. with
+  echo "$VERSION $(stat -c %s fw.bin) $(sha256sum fw.bin | cut -c1-64)"
+ota_pack.py (in the repository root) writes the packed image next to the
+.bin and prints the manifest line with "lz4". Change the manifest last, so no
+board sees it before the image is complete.
+
+EEPROM layout of OtaState, starting at the base address:
+
+  | offset | size | field                                       |
+  |--------|------|---------------------------------------------|
+  | 0      | 2    | magic "GO"                                  |
+  | 2      | 1    | layout version                              |
+  | 3      | 4    | firmware version being downloaded           |
+  | 7      | 4    | image size                                  |
+  | 11     | 4    | flash address of the partition written to   |
+  | 15     | 4    | bytes written so far                        |
+  | 19     | 32   | SHA-256 from the manifest                   |
+  | 51     | 2    | CRC-16/CCITT of bytes 0-50                  |
+*/
+
+#ifndef GC_OTA_H
+#define GC_OTA_H
+
+#include <Arduino.h>
+#include "GC_Soracom.h"
+#include "GC_Calibration.h"
+#include "GC_Task.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+#endif
+
+// ======================== CONSTANTS ========================
+// Where the firmware is published, set in the sketch header
+#if !defined(GC_OTA_HOST)
+#define GC_OTA_HOST           "harvest-files.soracom.io"
+#endif
+#if !defined(GC_OTA_PORT)
+#define GC_OTA_PORT           80
+#endif
+#if !defined(GC_OTA_MANIFEST_PATH)
+#define GC_OTA_MANIFEST_PATH  "/firmware/esp32.txt"
+#endif
+#if !defined(GC_OTA_IMAGE_PATH)
+#define GC_OTA_IMAGE_PATH     "/firmware/esp32.bin"
+#endif
+#if !defined(GC_OTA_PACKED_PATH)
+#define GC_OTA_PACKED_PATH    "/firmware/esp32.pack"
+#endif
+#if !defined(GC_OTA_MUX)
+#define GC_OTA_MUX            2         // Modem socket, Harvest uses 0 and UDP GC_UDP_MUX
+#endif
+
+#define GC_OTA_CHUNK_SIZE     4096      // Bytes per Range request, one flash sector
+#define GC_OTA_MAX_BLOCKS     512       // Blocks of a packed image, 2 MB unpacked
+#define GC_OTA_PACKED_MAX     (GC_OTA_CHUNK_SIZE + GC_OTA_CHUNK_SIZE / 255 + 16)  // LZ4 worst case for one block
+#define GC_OTA_TIMEOUT_MS     10000UL   // Longest wait for each line or chunk of a response
+#define GC_OTA_CONFIRM_MS     600000UL  // A new firmware has this long to deliver a report
+
+#define GC_OTA_MAGIC0         'G'
+#define GC_OTA_MAGIC1         'O'
+#define GC_OTA_VERSION        1
+#define GC_OTA_STORAGE_SIZE   53        // Bytes of EEPROM used, see the layout above
+
+// Results of OtaUpdater::update()
+#define GC_OTA_NONE           0         // no newer firmware
+#define GC_OTA_PARTIAL        1         // download stopped, goes on with the next call
+#define GC_OTA_READY          2         // verified, boots after the next restart
+#define GC_OTA_FAILED         3         // bad manifest, image or answer, starts over next time
+
+// Why OtaUpdater::unpack() stopped reading
+#define GC_OTA_BODY_TIMEOUT   1         // connection closed or nothing came in time
+#define GC_OTA_BODY_OVERRUN   2         // the block needs more bytes than it has
+
+// ======================== STRUCTS ========================
+// One line of the manifest
+struct OtaManifest {
+  uint32_t version;
+  uint32_t size;
+  uint8_t sha256[32];
+  bool packed;              // GC_OTA_PACKED_PATH is there too
+};
+
+// ======================== FUNCTION DEFINITIONS ========================
+namespace gc_detail {
+  inline int8_t hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+}
+
+/*
+parseOtaManifest - Read "<version> <size> <sha256 hex> [lz4]".
+
+Returns false if a field is missing or the hash is not 64 hex digits.
+*/
+inline bool parseOtaManifest(const char *line, OtaManifest &manifest) {
+  char *end;
+  manifest.version = strtoul(line, &end, 10);
+  if (end == line || *end != ' ') {
+    return false;
+  }
+  const char *p = end + 1;
+  manifest.size = strtoul(p, &end, 10);
+  if (end == p || *end != ' ' || manifest.size == 0) {
+    return false;
+  }
+  p = end + 1;
+  for (uint8_t i = 0; i < 32; i++) {
+    int8_t hi = gc_detail::hexDigit(p[2 * i]);
+    int8_t lo = hi < 0 ? -1 : gc_detail::hexDigit(p[2 * i + 1]);
+    if (lo < 0) {
+      return false;
+    }
+    manifest.sha256[i] = (hi << 4) | lo;
+  }
+  manifest.packed = strncmp(p + 64, " lz4", 4) == 0;
+  return true;
+}
+
+// ======================== CLASS DEFINITIONS ========================
+/*
+OtaState - How far a download got, in EEPROM. See the layout above.
+
+Store is the byte storage, EepromStore (GC_Queue.h) on the boards.
+*/
+template <typename Store>
+class OtaState {
+public:
+  explicit OtaState(int base) : base(base) {}
+
+  /*
+  load - Read the stored progress.
+
+  Parameters:
+    manifest - Filled in with the firmware being downloaded.
+    address  - Filled in with the flash address of its partition.
+    offset   - Filled in with the bytes written so far.
+
+  Returns false if no download is stored.
+  */
+  bool load(OtaManifest &manifest, uint32_t &address, uint32_t &offset) {
+    Store::begin(base + GC_OTA_STORAGE_SIZE);
+    uint8_t bytes[GC_OTA_STORAGE_SIZE];
+    for (uint8_t i = 0; i < GC_OTA_STORAGE_SIZE; i++) {
+      bytes[i] = Store::read(base + i);
+    }
+    uint16_t crc = ((uint16_t)bytes[51] << 8) | bytes[52];
+    if (bytes[0] != GC_OTA_MAGIC0 || bytes[1] != GC_OTA_MAGIC1 ||
+        bytes[2] != GC_OTA_VERSION || crc != gcCrc16(bytes, 51)) {
+      return false;
+    }
+    manifest.version = get32(bytes + 3);
+    manifest.size = get32(bytes + 7);
+    address = get32(bytes + 11);
+    offset = get32(bytes + 15);
+    memcpy(manifest.sha256, bytes + 19, 32);
+    return true;
+  }
+
+  void save(const OtaManifest &manifest, uint32_t address, uint32_t offset) {
+    uint8_t bytes[GC_OTA_STORAGE_SIZE];
+    bytes[0] = GC_OTA_MAGIC0;
+    bytes[1] = GC_OTA_MAGIC1;
+    bytes[2] = GC_OTA_VERSION;
+    put32(bytes + 3, manifest.version);
+    put32(bytes + 7, manifest.size);
+    put32(bytes + 11, address);
+    put32(bytes + 15, offset);
+    memcpy(bytes + 19, manifest.sha256, 32);
+    uint16_t crc = gcCrc16(bytes, 51);
+    bytes[51] = crc >> 8;
+    bytes[52] = crc & 0xFF;
+    for (uint8_t i = 0; i < GC_OTA_STORAGE_SIZE; i++) {
+      Store::write(base + i, bytes[i]);
+    }
+    Store::commit();
+  }
+
+  // Forget the download, after it was used or failed
+  void clear() {
+    Store::begin(base + GC_OTA_STORAGE_SIZE);
+    Store::write(base, 0);
+    Store::commit();
+  }
+
+private:
+  static uint32_t get32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+  }
+  static void put32(uint8_t *p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+  }
+
+  const int base;
+};
+
+
+/*
+OtaUpdater - Check for a newer firmware and download it in resumable chunks.
+
+Client is a TinyGsmClient of its own, so the Harvest connection stays open.
+Partition is where the image goes, EspOtaPartition below on the ESP32. It
+needs begin(size), address(), write(offset, data, length),
+sha256(size, digest) and activate().
+Store is the byte storage for OtaState, EepromStore (GC_Queue.h).
+
+RAM: the sector buffer (GC_OTA_CHUNK_SIZE) and the block sizes of a packed
+image (2 * GC_OTA_MAX_BLOCKS). Packed blocks are unpacked as they arrive.
+*/
+template <typename Client, typename Partition, typename Store>
+class OtaUpdater {
+public:
+  /*
+  Parameters:
+    client    - The connection to GC_OTA_HOST.
+    partition - Where the image is written.
+    base      - EEPROM address of OtaState, after everything else stored there.
+  */
+  OtaUpdater(Client &client, Partition &partition, int base)
+    : client(client), partition(partition), state(base), packedStart(0),
+      bodyLeft(0), bodyError(0), bodyTime(0), received(0), requests(0), resumedAt(0) {}
+
+  // True if a download was started and not finished, e.g. before a reset
+  bool pending() {
+    OtaManifest manifest;
+    uint32_t address, offset;
+    return state.load(manifest, address, offset);
+  }
+
+  /*
+  update - Check the manifest and download as much as the deadline allows.
+
+  Parameters:
+    SerialMon - The serial monitor stream for debug output.
+    current   - Version of the running firmware (GC_FIRMWARE_VERSION).
+    deadline  - Stop between chunks once it expires. Not started means no limit.
+
+  Returns GC_OTA_NONE, GC_OTA_PARTIAL, GC_OTA_READY or GC_OTA_FAILED. After
+  GC_OTA_READY the caller restarts the board (ESP.restart()) when it suits.
+  */
+  uint8_t update(Stream &SerialMon, uint32_t current, const TaskTimer &deadline = TaskTimer()) {
+    OtaManifest manifest;
+    int8_t got = fetchManifest(SerialMon, manifest);
+    if (got <= 0) {
+      close();
+      return got < 0 ? GC_OTA_FAILED : GC_OTA_PARTIAL;
+    }
+    if (manifest.version <= current) {
+      SerialMon.println("Firmware is up to date");
+      state.clear();
+      close();
+      return GC_OTA_NONE;
+    }
+    if (!partition.begin(manifest.size)) {
+      SerialMon.println("Firmware does not fit the OTA partition");
+      close();
+      return GC_OTA_FAILED;
+    }
+
+    // Go on where the last call stopped, if it was the same image
+    OtaManifest stored;
+    uint32_t address, offset = 0;
+    if (!state.load(stored, address, offset) || address != partition.address() ||
+        stored.version != manifest.version || stored.size != manifest.size ||
+        memcmp(stored.sha256, manifest.sha256, 32) != 0 ||
+        offset > manifest.size || offset % GC_OTA_CHUNK_SIZE != 0) {
+      offset = 0;
+      state.save(manifest, partition.address(), 0);
+    }
+    resumedAt = offset;
+    SerialMon.print("Downloading firmware "); SerialMon.print(manifest.version);
+    SerialMon.print(" from byte "); SerialMon.print(offset);
+    SerialMon.print(" of "); SerialMon.println(manifest.size);
+
+    if (manifest.packed) {
+      got = fetchBlockSizes(SerialMon, manifest.size);
+      if (got == 0) {
+        close();
+        return GC_OTA_PARTIAL;
+      }
+      if (got < 0) {
+        SerialMon.println("Fetching the plain image instead");
+        close();
+        manifest.packed = false;
+      }
+    }
+
+    while (offset < manifest.size) {
+      if (deadline.expired()) {
+        close();
+        return GC_OTA_PARTIAL;
+      }
+      uint32_t length = manifest.size - offset;
+      if (length > GC_OTA_CHUNK_SIZE) {
+        length = GC_OTA_CHUNK_SIZE;
+      }
+      got = manifest.packed ? fetchBlock(SerialMon, offset / GC_OTA_CHUNK_SIZE, length)
+                            : fetchChunk(SerialMon, offset, length);
+      if (got < 0) {
+        close();
+        state.clear();
+        return GC_OTA_FAILED;
+      }
+      if (got == 0 || !partition.write(offset, chunk, length)) {
+        close();
+        return GC_OTA_PARTIAL;
+      }
+      offset += length;
+      state.save(manifest, partition.address(), offset);
+    }
+    close();
+
+    // All there, check what is in flash against the manifest
+    uint8_t digest[32];
+    state.clear();
+    if (!partition.sha256(manifest.size, digest) || memcmp(digest, manifest.sha256, 32) != 0) {
+      SerialMon.println("Firmware hash does not match, discarded");
+      return GC_OTA_FAILED;
+    }
+    if (!partition.activate()) {
+      SerialMon.println("Firmware image rejected");
+      return GC_OTA_FAILED;
+    }
+    SerialMon.println("Firmware verified, boots after the restart");
+    return GC_OTA_READY;
+  }
+
+  /*
+  print - Print what the downloads cost since start up.
+
+  Parameters:
+    SerialMon - The serial monitor stream for debug output.
+  */
+  void print(Stream &SerialMon) const {
+    SerialMon.print("ota: bytes received "); SerialMon.print(received);
+    SerialMon.print(", requests "); SerialMon.print(requests);
+    SerialMon.print(", resumed at "); SerialMon.println(resumedAt);
+  }
+
+  // Body bytes received since start up, manifest and image (packed or not)
+  uint32_t bytesReceived() const { return received; }
+
+private:
+  void close() {
+    if (client.connected()) {
+      client.stop();
+    }
+  }
+
+  bool open() {
+    return client.connected() || client.connect(GC_OTA_HOST, GC_OTA_PORT);
+  }
+
+  // Send a GET, with a Range header if length is not 0
+  void request(const char *path, uint32_t offset, uint32_t length) {
+    requests++;
+    client.print("GET "); client.print(path); client.print(" HTTP/1.1\r\n");
+    client.print("Host: " GC_OTA_HOST "\r\n");
+    if (length > 0) {
+      client.print("Range: bytes="); client.print(offset);
+      client.print("-"); client.print(offset + length - 1); client.print("\r\n");
+    }
+    client.print("Connection: keep-alive\r\n\r\n");
+    client.flush();
+  }
+
+  /*
+  readHeaders - Read the status line and headers of a response.
+
+  Returns the HTTP status, 0 on timeout. Sets contentLength (-1 if not sent)
+  and closes the connection afterwards if the server asked for that.
+  */
+  int readHeaders(long &contentLength, bool &serverCloses) {
+    char line[GC_RESPONSE_LINE_SIZE];
+    contentLength = -1;
+    serverCloses = false;
+    if (gc_detail::readLine(client, line, sizeof(line), GC_OTA_TIMEOUT_MS) < 0) {
+      return 0;
+    }
+    const char *code = strchr(line, ' ');
+    int status = code != NULL ? atoi(code + 1) : 0;
+    int n;
+    while ((n = gc_detail::readLine(client, line, sizeof(line), GC_OTA_TIMEOUT_MS)) > 0) {
+      if (strncasecmp(line, "Content-Length:", 15) == 0) {
+        contentLength = atol(line + 15);
+      } else if (strncasecmp(line, "Connection:", 11) == 0 && strstr(line + 11, "close") != NULL) {
+        serverCloses = true;
+      }
+    }
+    return n == 0 ? status : 0;
+  }
+
+  // Read exactly length bytes of body into buf, false on timeout
+  bool readBody(uint8_t *buf, size_t length) {
+    size_t got = 0;
+    unsigned long start = millis();
+    while (got < length && millis() - start < GC_OTA_TIMEOUT_MS) {
+      if (client.available() > 0) {
+        buf[got++] = client.read();
+        start = millis();
+      } else if (!client.connected()) {
+        break;
+      }
+    }
+    received += got;
+    return got == length;
+  }
+
+  /*
+  fetchManifest - Get and read the manifest.
+
+  Returns 1 if it was read, 0 if the connection or a timeout got in the way
+  (try again later), -1 if there is no usable manifest.
+  */
+  int8_t fetchManifest(Stream &SerialMon, OtaManifest &manifest) {
+    if (!open()) {
+      SerialMon.println("Failed to connect to " GC_OTA_HOST);
+      return 0;
+    }
+    request(GC_OTA_MANIFEST_PATH, 0, 0);
+    long contentLength;
+    bool serverCloses;
+    int status = readHeaders(contentLength, serverCloses);
+    if (status == 0) {
+      return 0;
+    }
+    if (status != 200 || contentLength <= 0 || contentLength >= (long)sizeof(chunk)) {
+      SerialMon.print("Firmware manifest not available: "); SerialMon.println(status);
+      return -1;
+    }
+    if (!readBody(chunk, contentLength)) {
+      return 0;
+    }
+    chunk[contentLength] = '\0';
+    if (serverCloses) {
+      close();
+    }
+    if (!parseOtaManifest((const char *)chunk, manifest)) {
+      SerialMon.println("Firmware manifest not understood");
+      return -1;
+    }
+    return 1;
+  }
+
+  /*
+  fetchChunk - Get length bytes of the image from offset into chunk.
+
+  Returns 1 if they arrived, 0 if the connection or a timeout got in the way
+  (try again later), -1 if the server answered with something else (start over).
+  */
+  int8_t fetchChunk(Stream &SerialMon, uint32_t offset, uint32_t length) {
+    if (!open()) {
+      return 0;
+    }
+    request(GC_OTA_IMAGE_PATH, offset, length);
+    long contentLength;
+    bool serverCloses;
+    int status = readHeaders(contentLength, serverCloses);
+    if (status == 0) {
+      return 0;
+    }
+    // A whole-file 200 is only the asked-for bytes if the file is that short
+    bool whole = status == 200 && offset == 0 && contentLength == (long)length;
+    if ((status != 206 && !whole) || contentLength != (long)length) {
+      SerialMon.print("Firmware image not available: "); SerialMon.println(status);
+      return -1;
+    }
+    if (!readBody(chunk, length)) {
+      return 0;
+    }
+    if (serverCloses) {
+      close();
+    }
+    return 1;
+  }
+
+  /*
+  fetchBlockSizes - Get the block sizes at the start of the packed image.
+
+  Parameters:
+    SerialMon - The serial monitor stream for debug output.
+    size      - Size of the unpacked image, from the manifest.
+
+  Returns 1 if they arrived, 0 if the connection or a timeout got in the way
+  (try again later), -1 if there is no packed image that fits the manifest.
+  */
+  int8_t fetchBlockSizes(Stream &SerialMon, uint32_t size) {
+    uint32_t count = (size + GC_OTA_CHUNK_SIZE - 1) / GC_OTA_CHUNK_SIZE;
+    if (count > GC_OTA_MAX_BLOCKS) {
+      SerialMon.println("Packed firmware has too many blocks");
+      return -1;
+    }
+    if (!open()) {
+      return 0;
+    }
+    packedStart = 2 + 2 * count;
+    request(GC_OTA_PACKED_PATH, 0, packedStart);
+    long contentLength;
+    bool serverCloses;
+    int status = readHeaders(contentLength, serverCloses);
+    if (status == 0) {
+      return 0;
+    }
+    if (status != 206 || contentLength != (long)packedStart) {
+      SerialMon.print("Packed firmware not available: "); SerialMon.println(status);
+      return -1;
+    }
+    if (!readBody(chunk, packedStart)) {
+      return 0;
+    }
+    if (serverCloses) {
+      close();
+    }
+    if (((uint32_t)chunk[0] << 8 | chunk[1]) != count) {
+      SerialMon.println("Packed firmware does not match the manifest");
+      return -1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+      blockSize[i] = (uint16_t)chunk[2 + 2 * i] << 8 | chunk[3 + 2 * i];
+      if (blockSize[i] == 0 || blockSize[i] > GC_OTA_PACKED_MAX) {
+        SerialMon.println("Packed firmware has a bad block size");
+        return -1;
+      }
+    }
+    return 1;
+  }
+
+  /*
+  fetchBlock - Get block index of the packed image and unpack it into chunk.
+
+  Parameters:
+    SerialMon - The serial monitor stream for debug output.
+    index     - Block number, the image offset / GC_OTA_CHUNK_SIZE.
+    length    - Bytes the block unpacks to.
+
+  Returns like fetchChunk(). A block that does not unpack to length bytes
+  counts as a wrong answer.
+  */
+  int8_t fetchBlock(Stream &SerialMon, uint32_t index, uint32_t length) {
+    if (!open()) {
+      return 0;
+    }
+    uint32_t offset = packedStart;
+    for (uint32_t i = 0; i < index; i++) {
+      offset += blockSize[i];
+    }
+    request(GC_OTA_PACKED_PATH, offset, blockSize[index]);
+    long contentLength;
+    bool serverCloses;
+    int status = readHeaders(contentLength, serverCloses);
+    if (status == 0) {
+      return 0;
+    }
+    if (status != 206 || contentLength != (long)blockSize[index]) {
+      SerialMon.print("Packed firmware not available: "); SerialMon.println(status);
+      return -1;
+    }
+    int8_t got = unpack(blockSize[index], length);
+    if (got < 0) {
+      SerialMon.print("Packed firmware block "); SerialMon.print(index); SerialMon.println(" is corrupt");
+    }
+    if (got > 0 && serverCloses) {
+      close();
+    }
+    return got;
+  }
+
+  /*
+  unpack - Unpack one LZ4 block from the response body into chunk.
+
+  Parameters:
+    packed - Bytes of the block in the body.
+    length - Bytes it has to unpack to.
+
+  Reads the body as it arrives, the matches only point back into chunk.
+  Returns 1, 0 or -1 like fetchChunk().
+  */
+  int8_t unpack(uint32_t packed, uint32_t length) {
+    bodyLeft = packed;
+    bodyError = 0;
+    bodyTime = millis();
+    uint32_t out = 0;
+    while (bodyLeft > 0 && bodyError == 0) {
+      uint8_t token = nextByte();
+      uint32_t run = runLength(token >> 4);     // literals
+      if (run > length - out) {
+        return -1;
+      }
+      for (; run > 0; run--) {
+        chunk[out++] = nextByte();
+      }
+      if (bodyLeft == 0) {
+        break;                                  // the last sequence has no match
+      }
+      uint16_t distance = nextByte();
+      distance |= (uint16_t)nextByte() << 8;
+      run = runLength(token & 0x0F) + 4;        // match
+      if (bodyError != 0) {
+        break;
+      }
+      if (distance == 0 || distance > out || run > length - out) {
+        return -1;
+      }
+      for (; run > 0; run--, out++) {
+        chunk[out] = chunk[out - distance];
+      }
+    }
+    if (bodyError == GC_OTA_BODY_TIMEOUT) {
+      return 0;
+    }
+    return bodyError == 0 && out == length ? 1 : -1;
+  }
+
+  // A literal or match length: the nibble, plus bytes while they are 255
+  uint32_t runLength(uint8_t nibble) {
+    uint32_t run = nibble;
+    if (nibble == 15) {
+      uint8_t more;
+      do {
+        more = nextByte();
+        run += more;
+      } while (more == 255 && bodyError == 0);
+    }
+    return run;
+  }
+
+  // Next byte of the body for unpack(). 0 once bodyError is set.
+  uint8_t nextByte() {
+    if (bodyError != 0) {
+      return 0;
+    }
+    if (bodyLeft == 0) {
+      bodyError = GC_OTA_BODY_OVERRUN;
+      return 0;
+    }
+    while (client.available() <= 0) {
+      if (!client.connected() || millis() - bodyTime >= GC_OTA_TIMEOUT_MS) {
+        bodyError = GC_OTA_BODY_TIMEOUT;
+        return 0;
+      }
+    }
+    bodyLeft--;
+    received++;
+    bodyTime = millis();
+    return (uint8_t)client.read();
+  }
+
+  Client &client;
+  Partition &partition;
+  OtaState<Store> state;
+  uint8_t chunk[GC_OTA_CHUNK_SIZE];
+  uint16_t blockSize[GC_OTA_MAX_BLOCKS];   // of the packed image
+  uint32_t packedStart;                    // offset of its first block
+  uint32_t bodyLeft;                       // unpack(): body bytes not read yet
+  uint8_t bodyError;                       // unpack(): GC_OTA_BODY_TIMEOUT or GC_OTA_BODY_OVERRUN
+  unsigned long bodyTime;                  // unpack(): when the last byte came
+  uint32_t received;
+  uint32_t requests;
+  uint32_t resumedAt;
+};
+
+
+#if defined(ARDUINO_ARCH_ESP32)
+// ======================== ESP32 PARTITION ========================
+/*
+EspOtaPartition - The OTA partition that is not running, for OtaUpdater.
+
+Written with esp_partition_* instead of esp_ota_begin/esp_ota_write, since
+esp_ota_begin erases the whole partition and a resumed download must keep
+what it already wrote. Each chunk starts on a sector, so erasing the sectors
+it covers right before writing it is enough.
+*/
+class EspOtaPartition {
+public:
+  EspOtaPartition() : part(NULL) {}
+
+  bool begin(uint32_t size) {
+    part = esp_ota_get_next_update_partition(NULL);
+    return part != NULL && size <= part->size;
+  }
+
+  // Flash address of the partition, to tell the two OTA slots apart
+  uint32_t address() const { return part != NULL ? part->address : 0; }
+
+  bool write(uint32_t offset, const uint8_t *data, size_t length) {
+    size_t erase = (length + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+    return esp_partition_erase_range(part, offset, erase) == ESP_OK &&
+           esp_partition_write(part, offset, data, length) == ESP_OK;
+  }
+
+  // SHA-256 of the first size bytes, read back from flash
+  bool sha256(uint32_t size, uint8_t *digest) {
+    uint8_t buf[256];
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    bool ok = true;
+    for (uint32_t offset = 0; ok && offset < size; offset += sizeof(buf)) {
+      size_t length = size - offset < sizeof(buf) ? size - offset : sizeof(buf);
+      ok = esp_partition_read(part, offset, buf, length) == ESP_OK;
+      mbedtls_sha256_update(&ctx, buf, length);
+    }
+    mbedtls_sha256_finish(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    return ok;
+  }
+
+  // Boot from this partition after the next restart
+  bool activate() { return esp_ota_set_boot_partition(part) == ESP_OK; }
+
+private:
+  const esp_partition_t *part;
+};
+
+// True if the running firmware is new and not confirmed yet
+inline bool otaPendingVerify() {
+  esp_ota_img_states_t state;
+  return esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) == ESP_OK &&
+         state == ESP_OTA_IMG_PENDING_VERIFY;
+}
+
+// Keep the running firmware, no rollback any more
+inline void otaConfirm() { esp_ota_mark_app_valid_cancel_rollback(); }
+
+// Boot the previous firmware again. Does not return.
+inline void otaRollback() { esp_ota_mark_app_invalid_rollback_and_reboot(); }
+#endif
+// ARDUINO_ARCH_ESP32
+
+#endif
+// GC_OTA_H
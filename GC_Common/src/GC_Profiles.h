@@ -0,0 +1,169 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Profiles.h
+
+Dumpster sizes as a table, picked at run time.
+
+The dimensions, sensor angles and casing offsets used to be constants in each
+sketch (testDumpLen, offsetHeight60, sensor60Angle, ...), edited by hand and
+flashed into every bin separately. The campus has several container sizes, so
+one firmware image now carries a table of them:
+
+  const GeometryProfile binProfiles[] = {
+    // id, len, width, height, offset15, offset60, offsetHeight60, angle15, angle60
+    { 1, 36, 24, 36, 4, 2, 3, 15, 60 },
+  };
+
+A profile is 9 bytes. Only the active one is turned into a DumpsterGeometry
+(geometryFromProfile), once at boot or when it changes, so the sines, cosines
+and the volume are worked out once and every reading only uses the integer
+math of fullnessFromDistances().
+
+Which profile is active can be changed over the air, by id or with a whole new
+profile, from a downlink in the Harvest response (parseDownlink, GC_Soracom.h).
+ProfileStore keeps that choice in EEPROM, after the calibration, so it holds
+across resets. Changing the profile also changes the nominal empty readings,
+so a stored calibration (GC_Calibration.h) stops matching and the bin is
+calibrated again after the next pickup.
+
+EEPROM layout, starting at the base address:
+
+  | offset | size | field                          |
+  |--------|------|--------------------------------|
+  | 0      | 2    | magic "GP"                     |
+  | 2      | 1    | layout version                 |
+  | 3      | 9    | the active GeometryProfile     |
+  | 12     | 2    | CRC-16/CCITT of bytes 0-11     |
+*/
+
+#ifndef GC_PROFILES_H
+#define GC_PROFILES_H
+
+#include <stdint.h>
+#include "GC_Geometry.h"
+#include "GC_Calibration.h"
+
+// ======================== CONSTANTS ========================
+#define GC_PROFILE_MAGIC0         'G'
+#define GC_PROFILE_MAGIC1         'P'
+#define GC_PROFILE_VERSION        1
+#define GC_PROFILE_SIZE           9     // Bytes of one GeometryProfile
+#define GC_PROFILE_STORAGE_SIZE   (3 + GC_PROFILE_SIZE + 2)
+#define GC_PROFILE_CUSTOM         0     // id of a profile sent in full by a downlink
+
+// ======================== STRUCTS ========================
+// One container size and how the sensors sit in it. Lengths in whole inches,
+// angles in degrees below the horizontal.
+struct GeometryProfile {
+  uint8_t id;
+  uint8_t len, width, height;
+  uint8_t offsetDist15;     // casing offset of the 15° (top) sensor
+  uint8_t offsetDist60;     // casing offset of the 60° (bottom) sensor
+  uint8_t offsetHeight60;   // how far below the top the 60° sensor sits
+  uint8_t angle15;          // mounting angle of the top sensor, 15 by default
+  uint8_t angle60;          // mounting angle of the bottom sensor, 60 by default
+};
+
+// ======================== FUNCTION DEFINITIONS ========================
+/*
+geometryFromProfile - Work out the DumpsterGeometry of a profile.
+
+Runs the same dumpsterGeometry() the sketches used at compile time, here
+once at load. Costs a few ms of software floating point on the Uno.
+*/
+inline DumpsterGeometry geometryFromProfile(const GeometryProfile &p) {
+  return dumpsterGeometry(p.len, p.width, p.height,
+                          p.offsetDist15, p.offsetDist60, p.offsetHeight60,
+                          p.angle15, p.angle60);
+}
+
+/*
+findProfile - Look up a profile by id.
+
+Parameters:
+  table - The profiles of the firmware.
+  count - Number of profiles in table.
+  id    - The id to look for.
+
+Returns NULL if there is no such profile.
+*/
+inline const GeometryProfile *findProfile(const GeometryProfile *table, uint8_t count, uint8_t id) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (table[i].id == id) {
+      return &table[i];
+    }
+  }
+  return NULL;
+}
+
+/*
+profileValid - True if a profile describes a bin fullnessFromDistances() can use.
+
+A downlink could send anything, so the sizes must be non-zero, the angles
+between 1 and 89 degrees, and the bottom sensor steeper than the top one.
+*/
+inline bool profileValid(const GeometryProfile &p) {
+  return p.len > 0 && p.width > 0 && p.height > 0 && p.offsetHeight60 < p.height &&
+         p.angle15 >= 1 && p.angle60 <= 89 && p.angle15 < p.angle60;
+}
+
+// ======================== CLASS DEFINITION ========================
+/*
+ProfileStore - The active profile in EEPROM, see the layout above.
+
+Store is the byte storage, EepromStore (GC_Queue.h) on the boards.
+*/
+template <typename Store>
+class ProfileStore {
+public:
+  explicit ProfileStore(int base) : base(base) {}
+
+  // Read the stored profile, returns false if there is none (or it is damaged)
+  bool load(GeometryProfile &profile) {
+    Store::begin(base + GC_PROFILE_STORAGE_SIZE);
+    uint8_t bytes[GC_PROFILE_STORAGE_SIZE];
+    for (uint8_t i = 0; i < GC_PROFILE_STORAGE_SIZE; i++) {
+      bytes[i] = Store::read(base + i);
+    }
+    uint16_t crc = ((uint16_t)bytes[12] << 8) | bytes[13];
+    if (bytes[0] != GC_PROFILE_MAGIC0 || bytes[1] != GC_PROFILE_MAGIC1 ||
+        bytes[2] != GC_PROFILE_VERSION || crc != gcCrc16(bytes, 12)) {
+      return false;
+    }
+    fromBytes(bytes + 3, profile);
+    return profileValid(profile);
+  }
+
+  void save(const GeometryProfile &profile) {
+    uint8_t bytes[GC_PROFILE_STORAGE_SIZE];
+    bytes[0] = GC_PROFILE_MAGIC0;
+    bytes[1] = GC_PROFILE_MAGIC1;
+    bytes[2] = GC_PROFILE_VERSION;
+    toBytes(profile, bytes + 3);
+    uint16_t crc = gcCrc16(bytes, 12);
+    bytes[12] = crc >> 8;
+    bytes[13] = crc & 0xFF;
+    for (uint8_t i = 0; i < GC_PROFILE_STORAGE_SIZE; i++) {
+      Store::write(base + i, bytes[i]);
+    }
+    Store::commit();
+  }
+
+private:
+  // Field by field, so the layout does not depend on the compiler's padding
+  static void toBytes(const GeometryProfile &p, uint8_t *b) {
+    b[0] = p.id; b[1] = p.len; b[2] = p.width; b[3] = p.height;
+    b[4] = p.offsetDist15; b[5] = p.offsetDist60; b[6] = p.offsetHeight60;
+    b[7] = p.angle15; b[8] = p.angle60;
+  }
+  static void fromBytes(const uint8_t *b, GeometryProfile &p) {
+    p.id = b[0]; p.len = b[1]; p.width = b[2]; p.height = b[3];
+    p.offsetDist15 = b[4]; p.offsetDist60 = b[5]; p.offsetHeight60 = b[6];
+    p.angle15 = b[7]; p.angle60 = b[8];
+  }
+
+  const int base;
+};
+
+#endif
+// GC_PROFILES_H
@@ -0,0 +1,372 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Queue.h
+
+Store-and-forward queue for readings that could not be sent.
+
+When GPRS or the connection to Harvest fails, sendDataToSoracom used to drop the
+reading (ESP32) or retry forever and stall the loop (Uno). Now the reading goes
+into this queue, and the queue is drained the next time a send works.
+
+The queue is a ring of slots in EEPROM, so it survives a reset or power loss.
+On the ESP32 the Arduino EEPROM library keeps its data in NVS, so the same code
+runs on both boards.
+
+EEPROM layout, starting at the base address:
+
+  | offset | size | field                                         |
+  |--------|------|-----------------------------------------------|
+  | 0      | 2    | magic "GQ"                                    |
+  | 2      | 1    | layout version                                |
+  | 3      | 1    | number of slots                               |
+  | 4      | 2    | seq of the oldest reading not sent yet (head) |
+  | 6      | 1    | boot number of the last boot that wrote       |
+  | 7      | 15   | slot 0: seq (2), boot number (1),             |
+  |        |      |         millis() stamp (4),                   |
+  |        |      |         record (GC_TELEMETRY_SIZE)            |
+  | 22     | 15   | slot 1 ...                                    |
+
+Reading number `seq` goes into slot seq % SLOTS, and the slot remembers its seq.
+At boot the queue walks forward from the head for as long as the slots carry the
+seq that is expected there. This rebuilds the tail without storing it, so
+adding a reading never rewrites the header.
+
+Ages: millis() starts at 0 again after every reset, and on the ESP32 after
+every wake from deep sleep, so a stamp only means something in the boot that
+wrote it. Every boot takes the next boot number, and each slot keeps the
+number of the boot that wrote it. A reading from another boot gets the age
+GC_AGE_UNKNOWN. The number is written to the header with the first reading a
+boot writes, so a boot that queues nothing writes nothing.
+
+Wear:
+- Each slot is written once per lap of the ring.
+- The header is only rewritten when a drain finishes (commit()), when a
+  full queue drops its oldest reading, and once in a boot that queues a
+  reading (the boot number).
+- Readings are staged in RAM and written STAGE at a time. On the ESP32 every
+  EEPROM.commit() rewrites the NVS blob, so this saves flash wear. On the Uno
+  EEPROM.update() skips bytes that did not change, and STAGE defaults to 1,
+  so a reading is on EEPROM as soon as it is queued.
+- A reset loses the staged readings that were not written yet (up to STAGE - 1).
+*/
+
+#ifndef GC_QUEUE_H
+#define GC_QUEUE_H
+
+#include <stdint.h>
+#include "GC_Telemetry.h"
+
+#include <Arduino.h>
+#if defined(ARDUINO)
+#include <EEPROM.h>
+#endif
+
+// ======================== CONSTANTS ========================
+#define GC_QUEUE_MAGIC0         'G'
+#define GC_QUEUE_MAGIC1         'Q'
+#define GC_QUEUE_VERSION        2
+#define GC_QUEUE_HEADER_SIZE    7
+#define GC_QUEUE_SLOT_SIZE      (7 + GC_TELEMETRY_SIZE)
+
+// Readings staged in RAM before they are written
+#if !defined(GC_QUEUE_STAGE)
+#if defined(ARDUINO_ARCH_ESP32)
+#define GC_QUEUE_STAGE          4
+#else
+#define GC_QUEUE_STAGE          1
+#endif
+#endif
+
+// Bytes of EEPROM (NVS) that EepromStore opens on the ESP32. The ESP32 EEPROM
+// library cuts the stored data to the size given to EEPROM.begin(), so the
+// queue and the calibration (GC_Calibration.h) behind it both open it with
+// this size, never with just their own part.
+#if !defined(GC_EEPROM_SIZE)
+#define GC_EEPROM_SIZE          1024
+#endif
+
+// ======================== STORAGE ========================
+#if defined(ARDUINO)
+// Byte storage on the board's EEPROM (NVS on the ESP32)
+struct EepromStore {
+  static void begin(int size) {
+#if defined(ARDUINO_ARCH_ESP32)
+    // Only once, a second EEPROM.begin() would drop what is not committed yet
+    static int opened = 0;
+    if (size < GC_EEPROM_SIZE) {
+      size = GC_EEPROM_SIZE;
+    }
+    if (size > opened) {
+      EEPROM.begin(size);
+      opened = size;
+    }
+#else
+    (void)size;
+#endif
+  }
+  static uint8_t read(int addr) { return EEPROM.read(addr); }
+  static void write(int addr, uint8_t value) {
+#if defined(ARDUINO_ARCH_ESP32)
+    EEPROM.write(addr, value);   // only marks the page dirty if the byte changed
+#else
+    EEPROM.update(addr, value);  // skips the write if the byte did not change
+#endif
+  }
+  static void commit() {
+#if defined(ARDUINO_ARCH_ESP32)
+    EEPROM.commit();
+#endif
+  }
+};
+#endif
+
+// ======================== CLASS DEFINITION ========================
+// Store is the byte storage, EepromStore on the boards. Anything with the same
+// static begin/read/write/commit functions works.
+template <uint8_t SLOTS, typename Store, uint8_t STAGE = GC_QUEUE_STAGE>
+class ReadingQueue {
+  static_assert((SLOTS & (SLOTS - 1)) == 0 && SLOTS >= 2, "ReadingQueue slots must be a power of two");
+  static_assert(STAGE >= 1, "ReadingQueue needs at least one stage entry");
+  static_assert(SLOTS <= 128, "ReadingQueue needs a free boot number for every boot");
+
+public:
+  // Bytes of EEPROM used, starting at the base address
+  static const int STORAGE_SIZE = GC_QUEUE_HEADER_SIZE + SLOTS * GC_QUEUE_SLOT_SIZE;
+
+  explicit ReadingQueue(int base = 0)
+    : base(base), head(0), tail(0), savedHead(0), boot(0), bootSaved(false), staged(0), corrupt(0) {}
+
+  /*
+  begin - Load the queue from EEPROM, call once in setup().
+
+  Formats the area if it holds no queue (first boot, or another layout).
+  Returns the number of readings left over from before the reset.
+  */
+  uint16_t begin() {
+    Store::begin(base + STORAGE_SIZE);
+
+    if (Store::read(base) != GC_QUEUE_MAGIC0 || Store::read(base + 1) != GC_QUEUE_MAGIC1 ||
+        Store::read(base + 2) != GC_QUEUE_VERSION || Store::read(base + 3) != SLOTS) {
+      format();
+      return 0;
+    }
+
+    head = read16(base + 4);
+    savedHead = head;
+    tail = head;
+    while ((uint16_t)(tail - head) < SLOTS && read16(slotAddr(tail)) == tail) {
+      tail++;
+    }
+    staged = 0;
+    nextBoot(Store::read(base + 6));
+    return size();
+  }
+
+  /*
+  push - Queue a reading that could not be sent.
+
+  Parameters:
+    record - The reading. Its age is filled in when it is sent.
+    stamp  - millis() when it was taken, now by default.
+
+  When the queue is full, the oldest reading is dropped.
+  */
+  void push(const TelemetryRecord &record, unsigned long stamp = millis()) {
+    if (staged == STAGE) {
+      flush();
+    }
+    stage[staged].record = record;
+    stage[staged].stamp = stamp;
+    staged++;
+    if (staged == STAGE) {
+      flush();
+    }
+  }
+
+  /*
+  peek - Get a queued reading without removing it.
+
+  Parameters:
+    record - Filled in with the reading. The age is set to the seconds since
+             it was queued (GC_AGE_UNKNOWN if it was queued in another boot),
+             and GC_HEALTH_QUEUED is added to the health flags.
+    index  - 0 for the oldest reading, 1 for the one after it, ...
+
+  A slot at the head whose record cannot be decoded (a bad EEPROM byte) is
+  dropped and counted in dropped(), and the next reading is returned, so one
+  bad slot does not hold up the readings behind it. The new head is saved by
+  commit(), like after pop(). A bad slot further back ends the look ahead
+  instead, it is dropped once it gets to the head.
+
+  Returns false if there is no readable reading at index.
+  */
+  bool peek(TelemetryRecord &record, uint16_t index = 0) {
+    unsigned long stamp;
+    bool thisBoot = true;
+    while (head != tail && !readSlot(head, record, stamp, thisBoot)) {
+      head++;
+      corrupt++;
+    }
+    uint16_t stored = (uint16_t)(tail - head);
+    if (index >= stored) {
+      if (index - stored >= staged) {
+        return false;
+      }
+      record = stage[index - stored].record;
+      stamp = stage[index - stored].stamp;
+      thisBoot = true;
+    } else if (index > 0 && !readSlot(head + index, record, stamp, thisBoot)) {
+      return false;
+    }
+
+    unsigned long now = millis();
+    unsigned long ageSec = (now - stamp) / 1000;
+    record.age = (!thisBoot || stamp > now || ageSec >= GC_AGE_UNKNOWN) ? GC_AGE_UNKNOWN : (uint16_t)ageSec;
+    record.health |= GC_HEALTH_QUEUED;
+    return true;
+  }
+
+  /*
+  pop - Remove the oldest queued reading, after it was sent.
+
+  The new head is written by commit(), not here. If the board resets before
+  commit(), the reading is sent again.
+  */
+  void pop() {
+    if (head != tail) {
+      head++;
+    } else if (staged > 0) {
+      for (uint8_t i = 1; i < staged && i < STAGE; i++) {
+        stage[i - 1] = stage[i];
+      }
+      staged--;
+    }
+  }
+
+  /*
+  flush - Write the readings staged in RAM to EEPROM.
+  */
+  void flush() {
+    if (staged > 0 && !bootSaved) {
+      Store::write(base + 6, boot);
+      bootSaved = true;
+    }
+    for (uint8_t i = 0; i < staged; i++) {
+      if ((uint16_t)(tail - head) == SLOTS) {
+        head++;              // full, drop the oldest
+        savedHead = head;
+        write16(base + 4, head);
+      }
+      int addr = slotAddr(tail);
+      uint8_t bytes[GC_TELEMETRY_SIZE];
+      encodeTelemetry(stage[i].record, bytes);
+      Store::write(addr + 2, boot);
+      write32(addr + 3, stage[i].stamp);
+      for (uint8_t j = 0; j < GC_TELEMETRY_SIZE; j++) {
+        Store::write(addr + 7 + j, bytes[j]);
+      }
+      write16(addr, tail);   // seq last, the slot only counts once it is complete
+      tail++;
+    }
+    staged = 0;
+    Store::commit();
+  }
+
+  /*
+  commit - Save the head after a drain, so sent readings stay sent after a reset.
+  */
+  void commit() {
+    if (head != savedHead) {
+      write16(base + 4, head);
+      savedHead = head;
+      Store::commit();
+    }
+  }
+
+  // Number of queued readings, on EEPROM and staged
+  uint16_t size() const { return (uint16_t)(tail - head) + staged; }
+  bool empty() const { return size() == 0; }
+
+  // Slots peek() dropped because they could not be decoded, this boot
+  uint16_t dropped() const { return corrupt; }
+
+private:
+  struct Staged {
+    TelemetryRecord record;
+    unsigned long stamp;
+  };
+
+  void format() {
+    // Clear the slot seqs so no old slot matches the first lap
+    for (uint8_t i = 0; i < SLOTS; i++) {
+      write16(base + GC_QUEUE_HEADER_SIZE + i * GC_QUEUE_SLOT_SIZE, (uint16_t)(i + 1));
+    }
+    Store::write(base, GC_QUEUE_MAGIC0);
+    Store::write(base + 1, GC_QUEUE_MAGIC1);
+    Store::write(base + 2, GC_QUEUE_VERSION);
+    Store::write(base + 3, SLOTS);
+    write16(base + 4, 0);
+    Store::write(base + 6, 0);
+    head = tail = savedHead = 0;
+    staged = 0;
+    nextBoot(0);
+    Store::commit();
+  }
+
+  // Take the boot number after `last`, skipping numbers still in a queued
+  // slot (from 256 boots ago). There are more numbers than slots.
+  void nextBoot(uint8_t last) {
+    boot = last + 1;
+    for (uint16_t seq = head; seq != tail; seq++) {
+      if (Store::read(slotAddr(seq) + 2) == boot) {
+        boot++;
+        seq = head - 1;   // check the new number from the start
+      }
+    }
+    bootSaved = false;
+  }
+
+  // Read the slot of seq, false if its record cannot be decoded
+  bool readSlot(uint16_t seq, TelemetryRecord &record, unsigned long &stamp, bool &thisBoot) const {
+    int addr = slotAddr(seq);
+    thisBoot = Store::read(addr + 2) == boot;
+    stamp = read32(addr + 3);
+    uint8_t bytes[GC_TELEMETRY_SIZE];
+    for (uint8_t i = 0; i < GC_TELEMETRY_SIZE; i++) {
+      bytes[i] = Store::read(addr + 7 + i);
+    }
+    return decodeTelemetry(bytes, GC_TELEMETRY_SIZE, record);
+  }
+
+  int slotAddr(uint16_t seq) const {
+    return base + GC_QUEUE_HEADER_SIZE + (seq & (SLOTS - 1)) * GC_QUEUE_SLOT_SIZE;
+  }
+
+  uint16_t read16(int addr) const {
+    return ((uint16_t)Store::read(addr) << 8) | Store::read(addr + 1);
+  }
+  void write16(int addr, uint16_t value) {
+    Store::write(addr, value >> 8);
+    Store::write(addr + 1, value & 0xFF);
+  }
+  uint32_t read32(int addr) const {
+    return ((uint32_t)read16(addr) << 16) | read16(addr + 2);
+  }
+  void write32(int addr, uint32_t value) {
+    write16(addr, value >> 16);
+    write16(addr + 2, value & 0xFFFF);
+  }
+
+  const int base;
+  uint16_t head;         // seq of the oldest reading on EEPROM
+  uint16_t tail;         // seq the next reading written gets
+  uint16_t savedHead;    // head as it is stored in the header
+  uint8_t boot;          // boot number of this boot
+  bool bootSaved;        // boot is in the header
+  uint8_t staged;
+  Staged stage[STAGE];
+  uint16_t corrupt;      // slots dropped by peek()
+};
+
+#endif
+// GC_QUEUE_H
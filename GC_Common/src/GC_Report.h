@@ -0,0 +1,101 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Report.h
+
+Decides which readings are worth sending.
+
+The main loops used to upload every reading, every 5 seconds, even when the
+fullness did not change. An idle bin overnight sent thousands of identical
+reports. ReportGate sits between GetFullPer() and sendDataToSoracom() and only
+lets a reading through when:
+
+- it is the first reading after a reset,
+- the fullness moved by at least `deadband` percent since the last report,
+- the fullness dropped by at least `pickupDrop` percent (the bin was emptied),
+  which is reported right away, even when batching,
+- the sensors stopped or started answering (fullness < 0 or back to >= 0),
+- or nothing was reported for `heartbeatMs`, so the server knows the device
+  is still alive.
+
+A reading that passes counts as reported, even if the send fails later. The
+store-and-forward queue (GC_Queue.h) takes care of that case.
+*/
+
+#ifndef GC_REPORT_H
+#define GC_REPORT_H
+
+#include <Arduino.h>
+
+// ======================== CONSTANTS ========================
+// Why a reading was let through, returned by ReportGate::check()
+#define GC_REPORT_NONE        0     // not worth sending
+#define GC_REPORT_FIRST       1     // first reading after a reset
+#define GC_REPORT_CHANGE      2     // fullness moved past the deadband
+#define GC_REPORT_PICKUP      3     // large drop, the bin was emptied
+#define GC_REPORT_SENSOR      4     // the sensors stopped or started answering
+#define GC_REPORT_HEARTBEAT   5     // nothing was sent for too long
+
+// ======================== CLASS DEFINITION ========================
+class ReportGate {
+public:
+  /*
+  Parameters:
+    deadband    - Smallest change in fullness (percent) that gets reported.
+    pickupDrop  - Drop in fullness (percent) that counts as a pickup.
+    heartbeatMs - Longest time without a report, in milliseconds.
+  */
+  ReportGate(uint8_t deadband, uint8_t pickupDrop, unsigned long heartbeatMs)
+    : deadband(deadband), pickupDrop(pickupDrop), heartbeatMs(heartbeatMs),
+      lastFullness(-1), lastReportMs(0), reported(false) {}
+
+  /*
+  check - Decide if a reading should be sent.
+
+  Parameters:
+    fullness - Fullness percentage, negative if the sensors did not answer.
+
+  Returns one of the GC_REPORT_* reasons. For anything but GC_REPORT_NONE, the
+  reading becomes the new reference for the deadband.
+  */
+  uint8_t check(long fullness) {
+    uint8_t reason = GC_REPORT_NONE;
+    bool known = fullness >= 0;
+    bool wasKnown = lastFullness >= 0;
+
+    if (!reported) {
+      reason = GC_REPORT_FIRST;
+    } else if (known != wasKnown) {
+      reason = GC_REPORT_SENSOR;
+    } else if (known && lastFullness - fullness >= pickupDrop) {
+      reason = GC_REPORT_PICKUP;
+    } else if (known && (fullness - lastFullness >= deadband || lastFullness - fullness >= deadband)) {
+      reason = GC_REPORT_CHANGE;
+    } else if (millis() - lastReportMs >= heartbeatMs) {
+      reason = GC_REPORT_HEARTBEAT;
+    }
+
+    if (reason != GC_REPORT_NONE) {
+      lastFullness = fullness;
+      lastReportMs = millis();
+      reported = true;
+    }
+    return reason;
+  }
+
+  // True if the next reading will be sent because of the heartbeat
+  bool heartbeatDue() const { return !reported || millis() - lastReportMs >= heartbeatMs; }
+
+  // Fullness of the last reading that was let through, -1 if none
+  long lastReported() const { return lastFullness; }
+
+private:
+  const uint8_t deadband;
+  const uint8_t pickupDrop;
+  const unsigned long heartbeatMs;
+  long lastFullness;
+  unsigned long lastReportMs;
+  bool reported;
+};
+
+#endif
+// GC_REPORT_H
@@ -0,0 +1,168 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Retry.h
+
+One retry policy for everything that talks to the network.
+
+Every retry loop used to pick its own fixed interval: 10s between modem
+restarts and GPRS attempts (forever in setup()), 5 tries 5s apart for the
+Harvest connection, a single try for a GPRS reconnect during a report. A bin
+with bad coverage then either hung in a loop or kept the modem on for minutes.
+
+Backoff waits longer after each failure, up to a cap, and stops after a number
+of tries:
+
+  wait after failure   1     2     3     4    ...
+  GC_LINK_RETRY_*      1s    2s    4s    (gives up after 4 tries)
+  GC_STARTUP_RETRY_*   5s    10s   20s   40s   80s   80s ...
+
+Each wait is picked at random between half and the full value ("equal jitter"),
+so bins that lost the network together do not all retry at the same moment.
+That needs a different random() sequence on every board: setup() calls
+seedJitter() first, otherwise every bin draws the same waits.
+
+Inside a report, the retries are also bounded by a deadline, a TaskTimer
+started with GC_REPORT_BUDGET_MS when the report starts (see
+sendDataToSoracom). Once the next wait would end past the deadline, Backoff
+gives up and the caller queues the readings (GC_Queue.h) and goes back to
+sensing. A TaskTimer that was never started is no deadline at all.
+
+Between tries the deadline is checked by Backoff. The waits inside a try,
+for the connection to Harvest and for its response, are cut to what is left
+of the deadline (budgetMs). gprsConnect() can still take as long as TinyGsm
+lets it.
+*/
+
+#ifndef GC_RETRY_H
+#define GC_RETRY_H
+
+#include <Arduino.h>
+#include "GC_Task.h"
+
+// ======================== CONSTANTS ========================
+// Retries inside a report (GPRS reconnect, Harvest connection)
+#define GC_LINK_RETRY_MS          1000UL    // wait after the first failure
+#define GC_LINK_RETRY_MAX_MS      8000UL    // longest wait
+#define GC_LINK_RETRY_ATTEMPTS    4         // tries in total
+
+// Retries while the modem starts (restart, first GPRS connection), no limit
+#define GC_STARTUP_RETRY_MS       5000UL
+#define GC_STARTUP_RETRY_MAX_MS   80000UL
+
+// Longest time one report may spend on retries, set in the sketch header
+#if !defined(GC_REPORT_BUDGET_MS)
+#define GC_REPORT_BUDGET_MS       30000UL
+#endif
+
+// Analog pin that is not connected, its noise seeds random() on the Uno
+#if !defined(GC_SEED_PIN)
+#define GC_SEED_PIN               A0
+#endif
+
+// ======================== CLASS DEFINITION ========================
+class Backoff {
+public:
+  /*
+  Parameters:
+    firstMs  - Wait after the first failure.
+    maxMs    - Longest wait, the doubling stops there.
+    attempts - Tries in total, 0 for no limit.
+  */
+  Backoff(unsigned long firstMs, unsigned long maxMs, uint8_t attempts = 0)
+    : firstMs(firstMs), maxMs(maxMs), attempts(attempts), failures(0) {}
+
+  // Start over, e.g. after a try worked
+  void reset() { failures = 0; }
+
+  // Failed tries since the last reset()
+  uint8_t failed() const { return failures; }
+
+  // True if another try is allowed after the current failure
+  bool more() const { return attempts == 0 || failures + 1 < attempts; }
+
+  /*
+  next - Count a failure and return the wait before the next try, in ms.
+
+  For cooperative tasks, which wait with a TaskTimer instead of delay().
+  */
+  unsigned long next() {
+    unsigned long ms = firstMs;
+    for (uint8_t i = 0; i < failures && ms < maxMs; i++) {
+      ms *= 2;
+    }
+    if (ms > maxMs) {
+      ms = maxMs;
+    }
+    if (failures < 255) {
+      failures++;
+    }
+    return ms / 2 + random(0, ms / 2 + 1);
+  }
+
+  /*
+  wait - After a failed try, wait before the next one.
+
+  Parameters:
+    deadline - The report's time budget. Not started means no deadline.
+
+  Returns false, without waiting, if no try is left or the deadline would
+  pass before the next try.
+  */
+  bool wait(const TaskTimer &deadline = TaskTimer()) {
+    if (!more()) {
+      return false;
+    }
+    unsigned long ms = next();
+    if (deadline.running() && ms >= deadline.remaining()) {
+      return false;
+    }
+    delay(ms);
+    return true;
+  }
+
+private:
+  const unsigned long firstMs;
+  const unsigned long maxMs;
+  const uint8_t attempts;
+  uint8_t failures;
+};
+
+// ======================== FUNCTION DEFINITIONS ========================
+/*
+seedJitter - Seed random() differently on every board and every boot.
+
+The ESP32 has a hardware random number generator (esp_random). The Uno has
+none, so it takes the lowest bit of 32 reads of the floating GC_SEED_PIN,
+mixed with micros(). Call once at the start of setup().
+*/
+inline void seedJitter() {
+#if defined(ARDUINO_ARCH_ESP32)
+  randomSeed(esp_random());
+#else
+  uint32_t seed = 0;
+  for (uint8_t i = 0; i < 32; i++) {
+    seed = (seed << 1 | (analogRead(GC_SEED_PIN) & 1)) ^ micros();
+  }
+  randomSeed(seed);
+#endif
+}
+
+/*
+budgetMs - A timeout, cut to what is left of a deadline.
+
+Parameters:
+  deadline - The report's time budget. Not started means no deadline.
+  ms       - The timeout without a deadline.
+
+Returns the shorter of the two, 0 once the deadline passed.
+*/
+inline unsigned long budgetMs(const TaskTimer &deadline, unsigned long ms) {
+  if (!deadline.running()) {
+    return ms;
+  }
+  unsigned long left = deadline.remaining();
+  return left < ms ? left : ms;
+}
+
+#endif
+// GC_RETRY_H
@@ -0,0 +1,284 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Sensor.h
+
+The sensor read path, written once for every board.
+
+readSensor used to exist in five copies that only differed in taking a
+SoftwareSerial& (Uno) or a HardwareSerial& (ESP32). Here the sensor is a
+template on its transport type, so the compiler builds one specialised version
+per port type. There is no virtual dispatch, so it costs nothing on the Uno.
+
+The only real difference between the transports is that a SoftwareSerial port
+has to be selected with listen() before it receives anything. selectPort()
+calls listen() when the port type has one, and does nothing otherwise.
+
+GetFullPer is also here, so the Uno and ESP32 sketches share one fullness model
+(see GC_Geometry.h).
+*/
+
+#ifndef GC_SENSOR_H
+#define GC_SENSOR_H
+
+#include <Arduino.h>
+#include "GC_A02.h"
+#include "GC_Geometry.h"
+#include "GC_Task.h"
+#include "GC_Metrics.h"
+
+// ======================== TRANSPORT HELPERS ========================
+namespace gc_detail {
+  // Picked when the port has listen() (SoftwareSerial, AltSoftSerial)
+  template <typename Port>
+  auto selectPort(Port &port, int) -> decltype(port.listen(), void()) {
+    port.listen();
+  }
+
+  // Picked for everything else (HardwareSerial, plain Stream)
+  template <typename Port>
+  void selectPort(Port &, long) {}
+}
+
+// ======================== CLASS DEFINITION ========================
+template <typename Transport>
+class DistanceSensor {
+public:
+  explicit DistanceSensor(Transport &port) : port(port) {}
+
+  /*
+  read - Wait for one valid frame from the sensor.
+
+  Parameters:
+    timeoutMs - Longest time to wait, in milliseconds.
+
+  Selects the port, then returns the distance in inches as soon as a frame with
+  a valid checksum arrives, or -1 on timeout.
+  */
+  long read(unsigned long timeoutMs = 300) {
+    select();
+    GC_METRIC_BEGIN(GC_PHASE_SENSOR);
+
+    unsigned long startTime = millis();
+    while (millis() - startTime < timeoutMs) {
+      if (poll()) {
+        GC_METRIC_END(GC_PHASE_SENSOR, true);
+        return parser.distanceInches();
+      }
+    }
+    GC_METRIC_END(GC_PHASE_SENSOR, false);
+    GC_METRIC_COUNT(sensorTimeouts);
+    return -1;
+  }
+
+  // Select the port and forget any half received frame, never blocks
+  void select() {
+    gc_detail::selectPort(port, 0);
+    parser.clearFrame();
+  }
+
+  /*
+  poll - Drain whatever is waiting on the port, never blocks.
+
+  Returns true if a new distance is available through inches().
+  Bad checksums are added to the metrics (GC_Metrics.h).
+  */
+  bool poll() {
+#if GC_METRICS
+    uint32_t errors = parser.errors();
+    bool got = parser.poll(port);
+    GC_METRIC_ADD(checksumErrors, parser.errors() - errors);
+    return got;
+#else
+    return parser.poll(port);
+#endif
+  }
+
+  long inches() const { return parser.distanceInches(); }
+  const A02Parser &stats() const { return parser; }
+
+private:
+  Transport &port;
+  A02Parser parser;
+};
+
+// ======================== FUNCTION DEFINITIONS ========================
+/*
+readSensor - Read data from the ultrasonic sensor.
+
+Parameters:
+  sensor - The serial port of the sensor (SoftwareSerial, HardwareSerial, ...).
+
+Returns the distance in inches, or -1 if the sensor times out.
+*/
+template <typename Transport>
+long readSensor(Transport &sensor) {
+  DistanceSensor<Transport> s(sensor);
+  return s.read();
+}
+
+/*
+printFullness - Print the values of one fullness computation.
+
+Parameters:
+  Serial - The serial monitor stream for debug output.
+  raw15  - Reading of the 15° sensor in inches.
+  raw60  - Reading of the 60° sensor in inches.
+  r      - Result of fullnessFromDistances().
+  g      - Geometry of the dumpster.
+*/
+inline void printFullness(Stream &Serial, long raw15, long raw60,
+                          const FullnessResult &r, const DumpsterGeometry &g) {
+  Serial.print("dist15: ");
+  Serial.println(raw15);
+  Serial.print("dist60: ");
+  Serial.println(raw60);
+  Serial.print("h60: ");
+  Serial.println(r.h60);
+  Serial.print("h15: ");
+  Serial.println(r.h15);
+
+  Serial.print("Trash Vol: ");
+  Serial.println(r.trashVolume);
+  Serial.print("Total Vol: ");
+  Serial.println(g.totalVolume);
+
+  Serial.print(r.fullness);
+  Serial.println("%");
+}
+
+/*
+GetFullPer - Get the fullness percentage of the dumpster.
+
+Parameters:
+  Serial   - The serial monitor stream for debug output.
+  sensor15 - The serial port of the 15-degree sensor.
+  sensor60 - The serial port of the 60-degree sensor.
+  g        - Geometry of the dumpster, see dumpsterGeometry().
+
+Reads both sensors and returns the fullness percentage as a long integer.
+On the Uno this takes the SoftwareSerial receiver away from the modem. Use
+FullnessSampler with a SerialBus (GC_SerialBus.h) there instead.
+*/
+template <typename Port15, typename Port60>
+long GetFullPer(Stream &Serial, Port15 &sensor15, Port60 &sensor60, const DumpsterGeometry &g) {
+  long raw15 = readSensor(sensor15); //distance reading of 15-degree sensor
+  long raw60 = readSensor(sensor60); //distance reading of 60-degree sensor
+
+  FullnessResult r = fullnessFromDistances(g, raw15, raw60);
+  printFullness(Serial, raw15, raw60, r, g);
+  return r.fullness;
+}
+
+
+// ======================== SAMPLING TASK ========================
+/*
+FullnessSampler - GetFullPer as a cooperative task (GC_Task.h).
+
+GetFullPer waits up to 300ms for each sensor. The sampler reads the same two
+sensors one after the other, but step() only takes the bytes that already
+arrived and returns. Call start() to take a reading, then step() from every
+loop() until it returns true.
+*/
+template <typename Port15, typename Port60>
+class FullnessSampler {
+public:
+  /*
+  Parameters:
+    sensor15  - The serial port of the 15-degree sensor.
+    sensor60  - The serial port of the 60-degree sensor.
+    g         - Geometry of the dumpster, see dumpsterGeometry().
+    timeoutMs - Longest wait for each sensor, the same as readSensor().
+  */
+  FullnessSampler(Port15 &sensor15, Port60 &sensor60, const DumpsterGeometry &g,
+                  unsigned long timeoutMs = 300)
+    : s15(sensor15), s60(sensor60), g(g), timeoutMs(timeoutMs),
+      phase(IDLE), raw15(-1), raw60(-1), result(-1) {}
+
+  // Start a new reading, ignored while one is running
+  void start() {
+    if (phase == IDLE) {
+      s15.select();
+      GC_METRIC_BEGIN(GC_PHASE_SENSOR);
+      timer.start(timeoutMs);
+      phase = READ15;
+    }
+  }
+
+  /*
+  step - Take what the current sensor sent so far.
+
+  Parameters:
+    Serial - The serial monitor stream for debug output.
+
+  Returns true when the reading is done, fullness() then holds it.
+  */
+  bool step(Stream &Serial) {
+    bool got;
+    switch (phase) {
+      case READ15:
+        got = s15.poll();
+        if (got || timer.expired()) {
+          raw15 = got ? s15.inches() : -1;  // -1 on timeout, like readSensor()
+          endRead(got);
+          s60.select();
+          GC_METRIC_BEGIN(GC_PHASE_SENSOR);
+          timer.start(timeoutMs);
+          phase = READ60;
+        }
+        return false;
+
+      case READ60:
+        got = s60.poll();
+        if (got || timer.expired()) {
+          raw60 = got ? s60.inches() : -1;
+          endRead(got);
+          finish(Serial);
+          phase = IDLE;
+          return true;
+        }
+        return false;
+
+      default:
+        return false;
+    }
+  }
+
+  bool busy() const { return phase != IDLE; }
+
+  // Fullness percentage of the last finished reading
+  long fullness() const { return result; }
+
+  // Distances of the last finished reading in inches, -1 if a sensor timed out
+  long distance15() const { return raw15; }
+  long distance60() const { return raw60; }
+
+private:
+  enum Phase : uint8_t { IDLE, READ15, READ60 };
+
+  // Metrics of one sensor read (GC_Metrics.h)
+  void endRead(bool got) {
+    GC_METRIC_END(GC_PHASE_SENSOR, got);
+    if (!got) {
+      GC_METRIC_COUNT(sensorTimeouts);
+    }
+  }
+
+  void finish(Stream &Serial) {
+    FullnessResult r = fullnessFromDistances(g, raw15, raw60);
+    printFullness(Serial, raw15, raw60, r, g);
+    result = r.fullness;
+  }
+
+  DistanceSensor<Port15> s15;
+  DistanceSensor<Port60> s60;
+  const DumpsterGeometry &g;
+  const unsigned long timeoutMs;
+  Phase phase;
+  TaskTimer timer;
+  long raw15;
+  long raw60;
+  long result;
+};
+
+#endif
+// GC_SENSOR_H
@@ -0,0 +1,154 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_SerialBus.h
+
+Uno only in practice. Decides which SoftwareSerial port may receive.
+
+Only one SoftwareSerial port receives at a time, the one that called listen()
+last. The modem (SerialAT) and both sensors are SoftwareSerial ports on the
+Uno, so every sensor read used to switch the receiver away from the modem
+without telling anyone. Whatever the modem sent in that time (an AT answer,
+"CLOSED" for the kept-open Harvest connection, a +CPSI URC) was lost, and
+TinyGsm lost track of the modem. That is why calling GetFullPer knocked the
+modem off the network.
+
+SerialBus owns the switching:
+- sensorsMayRead() is true only while the modem is quiet: nothing waiting on
+  its port and GC_BUS_HOLDOFF_MS passed since the sketch last used it
+  (modemUsed()), so late answers and URCs of that exchange still arrive.
+- beginSensors() hands the receiver to the sensors, which then switch between
+  themselves (DistanceSensor::select(), GC_Sensor.h).
+- endSensors() gives the receiver back to the modem and drops the pieces of
+  lines that were cut off by the switch.
+- resync() then sends "AT" so the modem and TinyGsm are back in step before
+  the next real command.
+
+What the modem sent while the sensors had the receiver is gone, resync()
+cannot bring it back. That includes "CLOSED" for the kept-open Harvest
+connection, so TinyGsm still thinks the socket is open. After a sensor window
+the sketch asks the modem with the session's recheck() (AT+CIPSTATUS,
+GC_Soracom.h) before it posts again.
+
+If the modem is on a port that receives on its own (HardwareSerial, or
+AltSoftSerial, see GC_MODEM_ALTSERIAL in GC_Uno.h), nothing has to be shared:
+sensorsMayRead() is always true and begin/endSensors() do nothing.
+*/
+
+#ifndef GC_SERIALBUS_H
+#define GC_SERIALBUS_H
+
+#include <Arduino.h>
+#include "GC_Sensor.h"
+
+// ======================== CONSTANTS ========================
+#define GC_BUS_HOLDOFF_MS     500       // Quiet time after modem use before the sensors may listen
+#define GC_BUS_SETTLE_MS      20        // Cut off bytes are dropped until the modem port is quiet this long
+#define GC_BUS_RESYNC_MS      1000UL    // Longest wait for the "AT" answer after a sensor read
+
+// ======================== TRANSPORT HELPERS ========================
+namespace gc_detail {
+  // Picked when the port has listen(): it shares the SoftwareSerial receiver
+  template <typename Port>
+  auto sharesReceiver(Port &port, int) -> decltype(port.listen(), bool()) {
+    return true;
+  }
+
+  // Picked for ports that always receive (HardwareSerial, AltSoftSerial)
+  template <typename Port>
+  bool sharesReceiver(Port &, long) { return false; }
+}
+
+// ======================== CLASS DEFINITION ========================
+template <typename ModemPort>
+class SerialBus {
+public:
+  explicit SerialBus(ModemPort &modemPort)
+    : modemPort(modemPort), lastModemMs(0), lent(false), windows(0), dropped(0), failed(0) {}
+
+  // Call after every exchange with the modem (a report, prewarm, ...)
+  void modemUsed() { lastModemMs = millis(); }
+
+  // True if the sensors may take the receiver now
+  bool sensorsMayRead() {
+    if (!gc_detail::sharesReceiver(modemPort, 0)) {
+      return true;
+    }
+    return !lent && modemPort.available() <= 0 && millis() - lastModemMs >= GC_BUS_HOLDOFF_MS;
+  }
+
+  // The sensors take the receiver, check sensorsMayRead() first
+  void beginSensors() {
+    if (gc_detail::sharesReceiver(modemPort, 0)) {
+      lent = true;
+      windows++;
+    }
+  }
+
+  /*
+  endSensors - Give the receiver back to the modem.
+
+  Waits until the modem port was quiet for GC_BUS_SETTLE_MS, and drops what
+  arrived in that time, usually the end of a line whose start was missed.
+  */
+  void endSensors() {
+    if (!lent) {
+      return;
+    }
+    gc_detail::selectPort(modemPort, 0);
+    unsigned long quietSince = millis();
+    while (millis() - quietSince < GC_BUS_SETTLE_MS) {
+      if (modemPort.available() > 0) {
+        modemPort.read();
+        dropped++;
+        quietSince = millis();
+      }
+    }
+    lent = false;
+  }
+
+  /*
+  resync - Make sure the modem and TinyGsm agree again after a sensor read.
+
+  Parameters:
+    modem - The TinyGsm object representing the modem.
+
+  Only call it once the modem is up. URCs lost in the window stay lost, check
+  the kept connection with the session's recheck() afterwards.
+  Returns true if the modem answered.
+  */
+  template <typename Modem>
+  bool resync(Modem &modem) {
+    bool ok = modem.testAT(GC_BUS_RESYNC_MS);
+    if (!ok) {
+      failed++;
+    }
+    modemUsed();
+    return ok;
+  }
+
+  // True between beginSensors() and endSensors()
+  bool sensorsActive() const { return lent; }
+
+  /*
+  print - Print how often the sensors had the receiver and what it cost.
+
+  Parameters:
+    SerialMon - The serial monitor stream for debug output.
+  */
+  void print(Stream &SerialMon) const {
+    SerialMon.print("serial bus: sensor windows "); SerialMon.print(windows);
+    SerialMon.print(", modem bytes dropped "); SerialMon.print(dropped);
+    SerialMon.print(", resyncs failed "); SerialMon.println(failed);
+  }
+
+private:
+  ModemPort &modemPort;
+  unsigned long lastModemMs;
+  bool lent;
+  uint32_t windows;
+  uint32_t dropped;
+  uint32_t failed;
+};
+
+#endif
+// GC_SERIALBUS_H
@@ -0,0 +1,212 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Sleep.h
+
+Duty cycling: sleep between reports instead of looping with delay().
+
+Two parts:
+
+1. SIM7000 power saving (any board)
+   - PSM: the modem tells the network it will be unreachable for a while
+     (T3412, the periodic TAU timer) after staying reachable for a short time
+     (T3324, the active timer). In PSM the modem draws a few uA but keeps its
+     network registration and PDP context. A short PWRKEY pulse wakes it
+     again, so there is no powerOnModem() (9.3s) and modem.restart() each time.
+   - eDRX: the modem only listens for paging every few seconds instead of
+     continuously. Helps when the modem has to stay reachable.
+   The network decides if it grants the timers. Check with AT+CPSMS? and
+   AT+CEDRXRDP.
+
+2. ESP32 deep sleep
+   The ESP32 wakes up with a fresh RAM, and setup() runs again. Anything that
+   must survive goes into RTC memory (RTC_DATA_ATTR). Only plain structs work
+   there, since constructors run again on every wake.
+   WakeStats keeps the wake-to-report time across sleeps, so the latency
+   budget can be checked over many wakes.
+
+Link to the SIM7000 PSM/eDRX application note:
+https://simcom.ee/documents/SIM7000x/SIM7000%20Series_Low%20Power%20Mode_Application%20Note_V1.03.pdf
+*/
+
+#ifndef GC_SLEEP_H
+#define GC_SLEEP_H
+
+#include <Arduino.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_sleep.h>
+#endif
+
+// ======================== PSM TIMER ENCODING ========================
+// 3GPP TS 24.008 timer coding: 3 bit unit, then a 5 bit value (0-31).
+namespace gc_detail {
+  struct TimerUnit {
+    uint8_t code;
+    unsigned long seconds;
+  };
+
+  // Write `bits` bits of `value` as '0'/'1' characters, MSB first
+  inline void writeBits(char *out, uint8_t value, uint8_t bits) {
+    for (uint8_t i = 0; i < bits; i++) {
+      out[i] = (value & (1 << (bits - 1 - i))) ? '1' : '0';
+    }
+  }
+
+  /*
+  encodeTimer - Pick the smallest unit that fits `seconds` and write the 8 bit
+  string. The time is rounded up to a whole number of units.
+  */
+  inline void encodeTimer(char *out, unsigned long seconds, const TimerUnit *units, uint8_t n) {
+    uint8_t i = 0;
+    while (i + 1 < n && (seconds + units[i].seconds - 1) / units[i].seconds > 31) {
+      i++;
+    }
+    unsigned long value = (seconds + units[i].seconds - 1) / units[i].seconds;
+    if (value > 31) value = 31;
+    writeBits(out, units[i].code, 3);
+    writeBits(out + 3, (uint8_t)value, 5);
+    out[8] = '\0';
+  }
+}
+
+/*
+gcPsmTau - Encode the periodic TAU timer (T3412 extended) for AT+CPSMS.
+
+Parameters:
+  out     - At least 9 chars, gets e.g. "00000110" (6 x 10 min, 1 hour).
+  seconds - How long the modem may stay unreachable.
+*/
+inline void gcPsmTau(char *out, unsigned long seconds) {
+  static const gc_detail::TimerUnit units[] = {
+    {3, 2}, {4, 30}, {5, 60}, {0, 600}, {1, 3600}, {2, 36000}, {6, 1152000}
+  };
+  gc_detail::encodeTimer(out, seconds, units, sizeof(units) / sizeof(units[0]));
+}
+
+/*
+gcPsmActive - Encode the active timer (T3324) for AT+CPSMS.
+
+Parameters:
+  out     - At least 9 chars, gets e.g. "00000101" (10 seconds).
+  seconds - How long the modem stays reachable before it enters PSM.
+*/
+inline void gcPsmActive(char *out, unsigned long seconds) {
+  static const gc_detail::TimerUnit units[] = {
+    {0, 2}, {1, 60}, {2, 360}
+  };
+  gc_detail::encodeTimer(out, seconds, units, sizeof(units) / sizeof(units[0]));
+}
+
+// ======================== MODEM POWER SAVING ========================
+/*
+modemEnablePsm - Ask the network for PSM.
+
+Parameters:
+  modem     - The TinyGsm object representing the modem.
+  tauSec    - Periodic TAU, the longest sleep before the modem checks in.
+  activeSec - How long the modem stays reachable after each send.
+
+Returns true if the modem accepted the command.
+*/
+template <typename Modem>
+bool modemEnablePsm(Modem &modem, unsigned long tauSec, unsigned long activeSec) {
+  char tau[9];
+  char active[9];
+  gcPsmTau(tau, tauSec);
+  gcPsmActive(active, activeSec);
+  modem.sendAT(GF("+CPSMS=1,,,\""), tau, GF("\",\""), active, GF("\""));
+  return modem.waitResponse() == 1;
+}
+
+/*
+modemEnableEdrx - Ask the network for eDRX on LTE Cat-M1.
+
+Parameters:
+  modem - The TinyGsm object representing the modem.
+  cycle - The 4 bit eDRX cycle, e.g. "0101" (81.92s). See AT+CEDRXS.
+*/
+template <typename Modem>
+bool modemEnableEdrx(Modem &modem, const char *cycle) {
+  modem.sendAT(GF("+CEDRXS=1,4,\""), cycle, GF("\""));
+  return modem.waitResponse() == 1;
+}
+
+/*
+modemWake - Wake the modem from PSM (or power it on if it is off).
+
+Parameters:
+  modem - The TinyGsm object representing the modem.
+  PWR   - Pin number for the PWR pin (power key pin).
+
+Checks first if the modem already answers, since a PWRKEY press on a modem
+that is on turns it off. Otherwise presses PWRKEY and waits up to 10s for the
+modem to answer.
+Returns true if the modem answers AT commands.
+*/
+template <typename Modem>
+bool modemWake(Modem &modem, int PWR) {
+  if (modem.testAT(500)) {
+    return true;
+  }
+  pinMode(PWR, OUTPUT);
+  digitalWrite(PWR, LOW);
+  delay(1200);                  // Same hold time as powerOnModem
+  digitalWrite(PWR, HIGH);
+  return modem.testAT(10000);
+}
+
+// ======================== WAKE TIMING ========================
+// Wake-to-report times, kept in RTC memory across deep sleep. Plain struct on purpose.
+struct WakeStats {
+  uint32_t wakes;         // timer wakes measured so far
+  uint32_t lastMs;        // wake-to-report time of the last wake
+  uint32_t maxMs;         // slowest wake so far
+  uint32_t totalMs;       // sum, for the average
+  uint32_t overBudget;    // wakes that took longer than the budget
+};
+
+/*
+wakeStatsRecord - Add one wake-to-report time and print it.
+
+Parameters:
+  stats     - The RTC_DATA_ATTR WakeStats of the sketch.
+  ms        - Time from wake up to the report being sent (millis() at that point).
+  budgetMs  - The latency budget.
+  SerialMon - The serial monitor stream for debug output.
+*/
+inline void wakeStatsRecord(WakeStats &stats, uint32_t ms, uint32_t budgetMs, Stream &SerialMon) {
+  stats.wakes++;
+  stats.lastMs = ms;
+  stats.totalMs += ms;
+  if (ms > stats.maxMs) stats.maxMs = ms;
+  if (ms > budgetMs) stats.overBudget++;
+
+  SerialMon.print("Wake to report: "); SerialMon.print(ms);
+  SerialMon.print(" ms (avg "); SerialMon.print(stats.totalMs / stats.wakes);
+  SerialMon.print(", max "); SerialMon.print(stats.maxMs);
+  SerialMon.print(", over budget "); SerialMon.print(stats.overBudget);
+  SerialMon.print("/"); SerialMon.print(stats.wakes);
+  SerialMon.println(")");
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+// True if this boot is a wake from deep sleep by the timer, not a power on or reset
+inline bool wokeFromSleep() {
+  return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
+}
+
+/*
+deepSleepFor - Put the ESP32 into deep sleep. Does not return, setup() runs
+again on wake up.
+
+Parameters:
+  seconds - How long to sleep.
+*/
+inline void deepSleepFor(unsigned long seconds) {
+  esp_sleep_enable_timer_wakeup((uint64_t)seconds * 1000000ULL);
+  esp_deep_sleep_start();
+}
+#endif
+
+#endif
+// GC_SLEEP_H
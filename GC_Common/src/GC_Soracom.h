@@ -0,0 +1,1283 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Soracom.h
+
+Modem and Soracom Harvest helpers shared by the Uno and ESP32 builds.
+
+powerOnModem, getISOTimestamp and the HTTP POST to Soracom Harvest used to be
+copied into both GC_Uno.cpp files and GC_esp32.cpp, and the copies had already
+started to drift apart. They live here once now. The sketches only build their
+own payload, a JSON document or a binary record (GC_Telemetry.h), and hand it
+to postToHarvest().
+
+This header defines TINY_GSM_MODEM_SIM7000 if the sketch has not picked a modem
+yet, since it has to be defined BEFORE including TinyGsmClient.
+
+Link to the Soracom Harvest Overview page:
+https://developers.soracom.io/en/docs/harvest/
+*/
+
+#ifndef GC_SORACOM_H
+#define GC_SORACOM_H
+
+// ======================== LIBRARY DEFINES ========================
+#if !defined(TINY_GSM_MODEM_SIM7000)
+#define TINY_GSM_MODEM_SIM7000
+#endif
+
+// ======================== INCLUDES ========================
+#include <Arduino.h>
+#include <TinyGsmClient.h>
+#include <ArduinoJson.h>
+#include "GC_Telemetry.h"
+#include "GC_Batch.h"
+#include "GC_Task.h"
+#include "GC_Clock.h"
+#include "GC_Metrics.h"
+#include "GC_Retry.h"
+#include "GC_Profiles.h"
+
+// ======================== CONSTANTS ========================
+#define GC_HARVEST_HOST   "harvest.soracom.io"  // Entrypoint for Soracom Harvest, where data will be sent
+#define GC_HARVEST_PORT   80                    // Default HTTP port for Soracom Harvest
+#define GC_APN            "soracom.io"          // APN for Soracom, used for GPRS reconnection
+#define GC_APN_USER       "sora"                // User for Soracom, used for GPRS reconnection
+#define GC_APN_PASS       "sora"                // Password for Soracom, used for GPRS reconnection
+#define GC_HARVEST_TIMEOUT_MS 10000UL           // Longest wait for each line of a Harvest response
+#define GC_CONNECT_TIMEOUT_MS 75000UL           // Longest wait for a connection, as in TinyGsm
+#define GC_RESPONSE_LINE_SIZE 64                // Longest response line kept, the rest of a line is skipped
+#define GC_REGISTER_TIMEOUT_MS 60000UL          // Longest wait for the network registration before trying GPRS anyway
+#define GC_DOWNLINK_SIZE      48                // Longest response body kept as a downlink, see parseDownlink
+#if !defined(GC_HARVEST_WRITE_SIZE)
+#define GC_HARVEST_WRITE_SIZE 256               // Bytes of request per write, one AT+CIPSEND each
+#endif
+#if !defined(GC_CLIENT_MUX)
+#define GC_CLIENT_MUX         0                 // Modem socket of the TinyGsmClient passed to the sessions
+#endif
+
+// What a downlink asks for, returned by parseDownlink()
+#define GC_DOWNLINK_PROFILE   0x01  // use the profile with Downlink::profileId
+#define GC_DOWNLINK_GEOMETRY  0x02  // use Downlink::geometry, sent in full
+#define GC_DOWNLINK_CALIBRATE 0x04  // measure the empty bin again
+#define GC_DOWNLINK_UPDATE    0x08  // check for a newer firmware (GC_Ota.h)
+
+// Steps of ModemStartup, returned by ModemStartup::state()
+#define GC_MODEM_OFF          0     // begin() not called yet
+#define GC_MODEM_RESET        1     // RST held low
+#define GC_MODEM_POWERKEY     2     // PWRKEY held low
+#define GC_MODEM_BOOTING      3     // waiting for the modem to boot
+#define GC_MODEM_RESTART      4     // modem.restart(), retried with backoff
+#define GC_MODEM_SETTLE       5     // waiting after the restart
+#define GC_MODEM_REGISTER     6     // waiting for the network registration, checked every 1s
+#define GC_MODEM_CONNECT      7     // modem.gprsConnect(), retried with backoff
+#define GC_MODEM_READY        8     // GPRS is up
+
+// ======================== FUNCTION DEFINITIONS ========================
+/*
+powerOnModem - Power on the modem using the RST and PWR pins
+
+Parameters:
+  RST - Pin number for the RST pin (reset pin)
+  PWR - Pin number for the PWR pin (power key pin)
+
+This function initializes the modem by cycling/toggling the RST and PWR pins.
+This is to ensure the modem powers on correctly and is ready for communication.
+
+The hold times are the ones used with the Arduino Uno and the ESP32 and the
+SIM7000A. Pins can be changed in the .ino file.
+
+Link to the SIM7000A schematic:
+https://github.com/botletics/SIM7000-LTE-Shield/blob/master/Schematics/SIM7000%20Shield%20Schematic%20v6.png
+*/
+inline void powerOnModem(int RST, int PWR) {
+  GC_METRIC_BEGIN(GC_PHASE_POWER_ON);
+  // Setup RST Pin
+  pinMode(RST, OUTPUT);
+  // Toggle RST low for 0.1s
+  digitalWrite(RST, LOW);
+  delay(100);                   // Hold Time for RST Low
+  digitalWrite(RST, HIGH);
+
+  // Setup PWR Pin
+  pinMode(PWR, OUTPUT);
+  // Hold PWR low for 1.2s, then high for 8s
+  digitalWrite(PWR, LOW);
+  delay(1200);                  // Hold Time for PWR Low
+  digitalWrite(PWR, HIGH);
+  delay(8000);                  // Hold Time for PWR High
+  GC_METRIC_END(GC_PHASE_POWER_ON, true);
+}
+
+
+namespace gc_detail {
+  // Picked when the port has connected() (a Client)
+  template <typename Port>
+  auto portOpen(Port &port, int) -> decltype(port.connected(), bool()) {
+    return port.connected();
+  }
+
+  // Picked for everything else (plain Stream)
+  template <typename Port>
+  bool portOpen(Port &, long) { return true; }
+
+  /*
+  readLine - Read one line into a fixed buffer.
+
+  Parameters:
+    port      - The Client or Stream to read from.
+    buf       - Where the line goes, without the "\r\n".
+    size      - Size of buf. Longer lines are cut, the rest is skipped.
+    timeoutMs - Longest time to wait for the whole line.
+
+  Returns the length of the line, or -1 on timeout or if the connection closed.
+  */
+  template <typename Port>
+  int readLine(Port &port, char *buf, size_t size, unsigned long timeoutMs) {
+    size_t len = 0;
+    unsigned long start = millis();
+    while (millis() - start < timeoutMs) {
+      if (port.available() <= 0) {
+        if (!portOpen(port, 0)) break;
+        continue;
+      }
+      char c = port.read();
+      if (c == '\n') {
+        buf[len] = '\0';
+        return len;
+      }
+      if (c != '\r' && len + 1 < size) {
+        buf[len++] = c;
+      }
+    }
+    buf[len] = '\0';
+    return -1;
+  }
+}
+
+
+/*
+readModemClock - Ask the modem for its clock (AT+CCLK?).
+
+Parameters:
+  modem - The TinyGsm object representing the modem.
+  epoch - Filled in with the modem time as UTC epoch seconds.
+
+The answer is read and parsed in fixed buffers (parseCclk, GC_Clock.h),
+nothing is allocated. Returns false if the modem gave no valid answer.
+*/
+template <typename Modem>
+bool readModemClock(Modem &modem, uint32_t &epoch) {
+  // Example response: +CCLK: "24/04/13,13:37:20+00"
+  modem.sendAT(GF("+CCLK?"));
+  char line[32];
+  if (modem.waitResponse(1000L, GF("+CCLK: ")) != 1 ||
+      gc_detail::readLine(modem.stream, line, sizeof(line), 1000) < 0) {
+    return false;
+  }
+  modem.waitResponse(); // the OK after the time
+
+  const char *startQuote = strchr(line, '"');
+  return startQuote != NULL && parseCclk(startQuote + 1, epoch);
+}
+
+
+/*
+syncClock - Keep deviceClock() (GC_Clock.h) in step with the modem.
+
+Parameters:
+  modem     - The TinyGsm object representing the modem.
+  SerialMon - The serial monitor stream for debug output.
+
+Cheap to call before every send: it only talks to the modem when a sync is due
+(at the first call, then every GC_CLOCK_RESYNC_MS, or every GC_CLOCK_RETRY_MS
+while the modem has no valid time). The first call also turns on AT+CLTS, so
+the modem takes its time from the network.
+*/
+template <typename Modem>
+void syncClock(Modem &modem, Stream &SerialMon) {
+  EpochClock &clock = deviceClock();
+  if (!clock.syncDue()) {
+    return;
+  }
+  if (!clock.valid()) {
+    modem.sendAT(GF("+CLTS=1"));   // Network time updates the modem clock
+    modem.waitResponse();
+  }
+
+  uint32_t epoch;
+  if (!readModemClock(modem, epoch)) {
+    clock.failed();
+    SerialMon.println("Failed to get modem time.");
+    return;
+  }
+  if (!clock.set(epoch)) {
+    SerialMon.println("Modem clock not set by the network yet.");
+    return;
+  }
+  char isoTime[GC_ISO_TIME_SIZE];
+  clock.iso(isoTime, sizeof(isoTime));
+  SerialMon.print("Clock synced: "); SerialMon.println(isoTime);
+}
+
+
+/*
+getISOTimestamp - Get the current timestamp in ISO-8601 format.
+
+Parameters:
+  modem     - The TinyGsm object representing the modem.
+  SerialMon - The serial monitor stream for debug output.
+  isoTime   - Where the timestamp goes, at least GC_ISO_TIME_SIZE chars.
+  size      - Size of isoTime.
+
+Soracom Harvest already sets a timestamp on the server side, but we can use
+this to provide a more accurate timestamp in case of network delays.
+
+Served from deviceClock(), the modem is only asked when a sync is due
+(syncClock). Returns false (and an empty isoTime) if there is no valid time yet.
+
+Examples of valid timestamps used by Soracom Harvest:
+Date/Time (ISO-8601): 2022-10-05T11:30:45.000Z
+Unix Time (seconds): 1633433445
+Unix Time (milliseconds): 1633433445000
+*/
+template <typename Modem>
+bool getISOTimestamp(Modem &modem, Stream &SerialMon, char *isoTime, size_t size) {
+  syncClock(modem, SerialMon);
+  return deviceClock().iso(isoTime, size);
+}
+
+
+/*
+ensureGprs - Make sure the GPRS (data) connection is up.
+
+Parameters:
+  modem     - The TinyGsm object representing the modem.
+  SerialMon - The serial monitor stream for debug output.
+  deadline  - The report's time budget (GC_REPORT_BUDGET_MS). Not started
+              means no deadline, the tries are still limited.
+
+Retries with backoff (GC_LINK_RETRY_*, GC_Retry.h) and gives up once the
+tries are used up or the deadline would pass.
+Returns true if GPRS is connected.
+*/
+template <typename Modem>
+bool ensureGprs(Modem &modem, Stream &SerialMon, const TaskTimer &deadline) {
+  if (modem.isGprsConnected()) {
+    return true;
+  }
+
+  SerialMon.println("GPRS not connected. Attempting to reconnect...");
+  GC_METRIC_BEGIN(GC_PHASE_GPRS);
+  Backoff retry(GC_LINK_RETRY_MS, GC_LINK_RETRY_MAX_MS, GC_LINK_RETRY_ATTEMPTS);
+  while (!modem.gprsConnect(GC_APN, GC_APN_USER, GC_APN_PASS)) {
+    if (modem.isGprsConnected()) { break; }
+    SerialMon.println("GPRS reconnect failed.");
+    if (!retry.wait(deadline)) {
+      GC_METRIC_END(GC_PHASE_GPRS, false);
+      SerialMon.println("Giving up, aborting send.");
+      return false;
+    }
+  }
+  GC_METRIC_END(GC_PHASE_GPRS, true);
+  return true;
+}
+
+
+
+/*
+ModemStartup - Power on, restart and connect the modem without delay().
+
+Does the same as powerOnModem(), modem.restart() and modem.gprsConnect() in
+setup() used to, with the same hold times. Failed restarts and connections are
+retried with backoff (GC_STARTUP_RETRY_*, GC_Retry.h). Before gprsConnect() it
+waits up to GC_REGISTER_TIMEOUT_MS for the network registration, so the time
+the network takes is not hidden in the GPRS retries. Instead of waiting, each
+step() call checks if the current wait is over, does the next step and returns.
+Call begin() once, then step() from every loop(). Everything else in loop()
+(reading the sensors, queueing readings) keeps running while the modem starts.
+
+restart() and gprsConnect() themselves still wait for the modem's answer.
+*/
+template <typename Modem>
+class ModemStartup {
+public:
+  /*
+  Parameters:
+    modem - The TinyGsm object representing the modem.
+    RST   - Pin number for the RST pin (reset pin)
+    PWR   - Pin number for the PWR pin (power key pin)
+  */
+  ModemStartup(Modem &modem, int RST, int PWR)
+    : modem(modem), rstPin(RST), pwrPin(PWR), current(GC_MODEM_OFF),
+      retry(GC_STARTUP_RETRY_MS, GC_STARTUP_RETRY_MAX_MS), registerStartMs(0) {}
+
+  // Start powering on the modem, toggles RST low for 0.1s first
+  void begin() {
+    pinMode(rstPin, OUTPUT);
+    pinMode(pwrPin, OUTPUT);
+    GC_METRIC_BEGIN(GC_PHASE_POWER_ON);
+    digitalWrite(rstPin, LOW);
+    enter(GC_MODEM_RESET, 100);        // Hold Time for RST Low
+  }
+
+  /*
+  step - Do the next step of the start up, if its wait is over.
+
+  Parameters:
+    SerialMon - The serial monitor stream for debug output.
+  */
+  void step(Stream &SerialMon) {
+    if (current == GC_MODEM_OFF || current == GC_MODEM_READY || !timer.expired()) {
+      return;
+    }
+
+    switch (current) {
+      case GC_MODEM_RESET:
+        digitalWrite(rstPin, HIGH);
+        digitalWrite(pwrPin, LOW);
+        enter(GC_MODEM_POWERKEY, 1200);  // Hold Time for PWR Low
+        break;
+
+      case GC_MODEM_POWERKEY:
+        digitalWrite(pwrPin, HIGH);
+        enter(GC_MODEM_BOOTING, 8000);   // Hold Time for PWR High
+        break;
+
+      case GC_MODEM_BOOTING:
+        GC_METRIC_END(GC_PHASE_POWER_ON, true);
+        SerialMon.println("Initialzing Modem");
+        // fall through
+      case GC_MODEM_RESTART: {
+        GC_METRIC_BEGIN(GC_PHASE_RESTART);
+        bool restarted = modem.restart();
+        GC_METRIC_END(GC_PHASE_RESTART, restarted);
+        if (restarted) {
+          SerialMon.println("Modem initialized successfully.");
+          retry.reset();
+          enter(GC_MODEM_SETTLE, 10000); // Give time to restart
+        } else {
+          SerialMon.println("Failed to restart modem, retrying");
+          enter(GC_MODEM_RESTART, retry.next());
+        }
+        break;
+      }
+
+      case GC_MODEM_SETTLE:
+        SerialMon.println("Waiting for the network...");
+        GC_METRIC_BEGIN(GC_PHASE_REGISTER);
+        registerStartMs = millis();
+        // fall through
+      case GC_MODEM_REGISTER:
+        if (modem.isNetworkConnected()) {
+          GC_METRIC_END(GC_PHASE_REGISTER, true);
+        } else if (millis() - registerStartMs < GC_REGISTER_TIMEOUT_MS) {
+          enter(GC_MODEM_REGISTER, 1000);
+          break;
+        } else {
+          GC_METRIC_END(GC_PHASE_REGISTER, false);
+          SerialMon.println("Not registered, trying GPRS anyway");
+        }
+        SerialMon.print("Connecting to "); SerialMon.println(GC_APN);
+        // fall through
+      case GC_MODEM_CONNECT: {
+        GC_METRIC_BEGIN(GC_PHASE_GPRS);
+        bool connected = modem.gprsConnect(GC_APN, GC_APN_USER, GC_APN_PASS);
+        GC_METRIC_END(GC_PHASE_GPRS, connected);
+        if (connected) {
+          current = GC_MODEM_READY;
+          timer.stop();
+          retry.reset();
+          printConnected(SerialMon);
+        } else {
+          SerialMon.println("Failed to connect, retrying");
+          enter(GC_MODEM_CONNECT, retry.next());
+        }
+        break;
+      }
+    }
+  }
+
+  // True once GPRS is connected
+  bool ready() const { return current == GC_MODEM_READY; }
+
+  // One of the GC_MODEM_* steps
+  uint8_t state() const { return current; }
+
+private:
+  void enter(uint8_t next, unsigned long waitMs) {
+    current = next;
+    timer.start(waitMs);
+  }
+
+  void printConnected(Stream &SerialMon) {
+    SerialMon.println("✅ GPRS is connected");
+    SerialMon.print("CCID:"); SerialMon.println(modem.getSimCCID());
+    SerialMon.print("IMEI:"); SerialMon.println(modem.getIMEI());
+    SerialMon.print("IMSI:"); SerialMon.println(modem.getIMSI());
+    SerialMon.print("Operator:"); SerialMon.println(modem.getOperator());
+    SerialMon.println("✅ Network connected!");
+  }
+
+  Modem &modem;
+  const int rstPin;
+  const int pwrPin;
+  uint8_t current;
+  TaskTimer timer;
+  Backoff retry;
+  unsigned long registerStartMs;  // millis() when the registration wait started
+};
+
+// ======================== WRITE BUFFER ========================
+/*
+WriteBuffer - What is printed to it, handed to a client in writes of up to N
+bytes.
+
+TinyGsmClient sends every write() with its own AT+CIPSEND, each waiting for
+">" and "SEND OK". The request line, every header and serializeJson (a few
+characters at a time) written straight into the client are dozens of these
+round trips for one reading (test_modem measures it). Through this buffer a
+request of up to N bytes, headers and payload, is one write.
+*/
+template <typename Client, size_t N>
+class WriteBuffer : public Print {
+public:
+  explicit WriteBuffer(Client &client) : client(client), length(0), failed(false) {}
+
+  using Print::write;
+  size_t write(uint8_t c) override {
+    buf[length++] = c;
+    if (length == N) {
+      send();
+    }
+    return 1;
+  }
+
+  // Write what is left, returns false if any write fell short
+  bool finish() {
+    send();
+    return !failed;
+  }
+
+private:
+  void send() {
+    if (length > 0 && client.write(buf, length) != length) {
+      failed = true;
+    }
+    length = 0;
+  }
+
+  Client &client;
+  uint8_t buf[N];
+  size_t length;
+  bool failed;
+};
+
+
+namespace gc_detail {
+  /*
+  socketConnected - Ask the modem whether one of its sockets is still connected.
+
+  Parameters:
+    modem - The TinyGsm object representing the modem.
+    mux   - The modem socket.
+
+  Sends AT+CIPSTATUS=<mux>. Example response:
+    +CIPSTATUS: 0,0,"TCP","100.127.111.112","80","CONNECTED"
+  No answer counts as not connected, a new connection is cheaper than a lost
+  report.
+  */
+  template <typename Modem>
+  bool socketConnected(Modem &modem, uint8_t mux) {
+    modem.sendAT(GF("+CIPSTATUS="), mux);
+    if (modem.waitResponse(GF("+CIPSTATUS:")) != 1) {
+      return false;
+    }
+    int8_t state = modem.waitResponse(GF(",\"CONNECTED\""), GF(",\"CLOSED\""), GF(",\"CLOSING\""),
+                                      GF(",\"REMOTE CLOSING\""), GF(",\"INITIAL\""));
+    modem.waitResponse();
+    return state == 1;
+  }
+
+  // Picked when the client takes a timeout in seconds (TinyGsmClient)
+  template <typename Client>
+  auto connectFor(Client &client, const char *host, uint16_t port, int timeoutS, int)
+      -> decltype(client.connect(host, port, timeoutS)) {
+    return client.connect(host, port, timeoutS);
+  }
+
+  // Picked for any other Client, which waits as long as it does
+  template <typename Client>
+  int connectFor(Client &client, const char *host, uint16_t port, int, long) {
+    return client.connect(host, port);
+  }
+
+  /*
+  connectWithin - Open a connection, waiting no longer than the deadline allows.
+
+  TinyGsm takes the timeout in whole seconds, so it is rounded down. With
+  less than a second left, it does not try.
+  */
+  template <typename Client>
+  bool connectWithin(Client &client, const char *host, uint16_t port, const TaskTimer &deadline) {
+    unsigned long ms = budgetMs(deadline, GC_CONNECT_TIMEOUT_MS);
+    if (ms < 1000) {
+      return false;
+    }
+    return connectFor(client, host, port, (int)(ms / 1000), 0);
+  }
+
+  /*
+  harvestConnect - Open the connection to Soracom Harvest.
+
+  Tries up to GC_LINK_RETRY_ATTEMPTS times, with backoff (GC_Retry.h), and
+  not past the deadline.
+  */
+  template <typename Client>
+  bool harvestConnect(Client &client, Stream &SerialMon, const TaskTimer &deadline) {
+    // Close previous connection if still open
+    SerialMon.println("Preparing client to connect to Soracom Harvest...");
+    if (client.connected()) {
+      SerialMon.println("Previous client still connected. Closing...");
+      client.stop();
+      delay(100);
+    }
+
+    // Connect to Soracom Harvest
+    SerialMon.println("Connecting to Soracom Harvest...");
+    GC_METRIC_BEGIN(GC_PHASE_CONNECT);
+    Backoff retry(GC_LINK_RETRY_MS, GC_LINK_RETRY_MAX_MS, GC_LINK_RETRY_ATTEMPTS);
+    // Keep trying to connect until success or max retries
+    // This is to ensure the connection is established before sending data
+    while (!connectWithin(client, GC_HARVEST_HOST, GC_HARVEST_PORT, deadline)) {
+      SerialMon.println("Failed to connect to Soracom Harvest.");
+      if (!retry.wait(deadline)) {
+        break;
+      }
+    }
+
+    if (!client.connected()) {
+      GC_METRIC_END(GC_PHASE_CONNECT, false);
+      SerialMon.println("Failed to connect, giving up.");
+      return false;
+    }
+    GC_METRIC_END(GC_PHASE_CONNECT, true);
+    return true;
+  }
+
+  /*
+  harvestRequest - Write the request line and headers of the POST.
+
+  Parameters:
+    out           - Where the request goes, a WriteBuffer on the connection.
+    contentType   - "application/json" or "application/octet-stream".
+    contentLength - Size of the payload in bytes.
+    keepAlive     - Ask the server to keep the connection open afterwards.
+  */
+  inline void harvestRequest(Print &out, const char *contentType, size_t contentLength, bool keepAlive) {
+    // HTTP Post request
+    // DO NOT MODIFY THIS PART
+    //
+    // These lines format the HTTP POST request. They are correct, so don't change them.
+    // The only thing you might want to change is the content of the payload.
+    out.println("POST / HTTP/1.1");
+    out.print("Host: "); out.println(GC_HARVEST_HOST);
+    out.print("Content-Type: "); out.println(contentType);
+    out.print("Content-Length: "); out.println(contentLength);
+    out.println(keepAlive ? "Connection: keep-alive" : "Connection: close");
+    out.println();
+  }
+
+  /*
+  harvestReadResponse - Print the server response and close the connection.
+
+  The response is read until the server closes the connection, or until
+  a line takes longer than GC_HARVEST_TIMEOUT_MS or the deadline passes.
+  Nothing is allocated, so a long uptime does not fragment the heap.
+  */
+  template <typename Client>
+  void harvestReadResponse(Client &client, Stream &SerialMon, const TaskTimer &deadline) {
+    // Read server response, one line at a time into a fixed buffer.
+    // Each line is printed as it arrives instead of being collected.
+    SerialMon.println("Reading server response");
+    GC_METRIC_BEGIN(GC_PHASE_RESPONSE);
+    char line[GC_RESPONSE_LINE_SIZE];
+    while (readLine(client, line, sizeof(line), budgetMs(deadline, GC_HARVEST_TIMEOUT_MS)) >= 0) {
+      SerialMon.println(line);
+    }
+    if (line[0] != '\0') {
+      SerialMon.println(line);  // last line, without a "\n" before the close
+    }
+    GC_METRIC_END(GC_PHASE_RESPONSE, true);
+
+    if (client.connected()) {
+      client.stop();
+      delay(100); // Allow socket to fully close
+    }
+  }
+}
+
+
+/*
+postToHarvest - Send a JSON document to Soracom Harvest with an HTTP POST.
+
+Parameters:
+  client    - A TinyGsmClient (or any Client) to open the connection with.
+  SerialMon - The serial monitor stream for debug output.
+  jsonDoc   - The payload to send.
+  deadline  - The report's time budget, bounds the connection and the wait
+              for the response. Not started means the fixed timeouts.
+
+Connects to the Soracom Harvest endpoint (with backoff, GC_Retry.h), sends the
+POST request and prints the server response. The response is read until the
+server closes the connection, or until nothing arrived for 10 seconds.
+
+Opens a new connection every time. HarvestSession keeps it open instead.
+
+Returns true if the request was sent.
+*/
+template <typename Client>
+bool postToHarvest(Client &client, Stream &SerialMon, JsonDocument &jsonDoc,
+                   const TaskTimer &deadline = TaskTimer()) {
+  // Measure JSON size
+  int contentLength = measureJson(jsonDoc);
+
+  if (!gc_detail::harvestConnect(client, SerialMon, deadline)) {
+    return false;
+  }
+
+  // Headers and payload in one write (WriteBuffer)
+  GC_METRIC_BEGIN(GC_PHASE_WRITE);
+  WriteBuffer<Client, GC_HARVEST_WRITE_SIZE> out(client);
+  gc_detail::harvestRequest(out, "application/json", contentLength, false);
+  serializeJson(jsonDoc, out);
+  bool written = out.finish();
+  client.flush();  // Ensure it's sent
+  GC_METRIC_END(GC_PHASE_WRITE, written);
+  if (!written) {
+    SerialMon.println("Soracom Harvest write failed.");
+    client.stop();
+    return false;
+  }
+
+  gc_detail::harvestReadResponse(client, SerialMon, deadline);
+  return true;
+}
+
+
+/*
+postToHarvest - Send a binary payload to Soracom Harvest with an HTTP POST.
+
+Parameters:
+  client    - A TinyGsmClient (or any Client) to open the connection with.
+  SerialMon - The serial monitor stream for debug output.
+  payload   - The bytes to send, e.g. from encodeTelemetry() (GC_Telemetry.h).
+  length    - Number of bytes in payload.
+  deadline  - The report's time budget, as for the JSON version.
+
+Same as the JSON version, but sent as application/octet-stream. Harvest runs
+the bytes through the Binary Parser of the SIM group (GC_TELEMETRY_PARSER).
+
+Returns true if the request was sent.
+*/
+template <typename Client>
+bool postToHarvest(Client &client, Stream &SerialMon, const uint8_t *payload, size_t length,
+                   const TaskTimer &deadline = TaskTimer()) {
+  if (!gc_detail::harvestConnect(client, SerialMon, deadline)) {
+    return false;
+  }
+
+  // Headers and payload in one write (WriteBuffer)
+  GC_METRIC_BEGIN(GC_PHASE_WRITE);
+  WriteBuffer<Client, GC_HARVEST_WRITE_SIZE> out(client);
+  gc_detail::harvestRequest(out, "application/octet-stream", length, false);
+  out.write(payload, length);
+  bool written = out.finish();
+  client.flush();  // Ensure it's sent
+  GC_METRIC_END(GC_PHASE_WRITE, written);
+  if (!written) {
+    SerialMon.println("Soracom Harvest write failed.");
+    client.stop();
+    return false;
+  }
+
+  gc_detail::harvestReadResponse(client, SerialMon, deadline);
+  return true;
+}
+
+
+// ======================== CLASS DEFINITION ========================
+/*
+HarvestSession - A connection to Soracom Harvest that stays open between reports.
+
+postToHarvest() resolves harvest.soracom.io, connects, sends "Connection: close"
+and waits for the server to hang up, for every single report. A session instead:
+- keeps the TCP connection open with HTTP/1.1 keep-alive,
+- resolves the host once with AT+CDNSGIP and connects to the cached address,
+  and only resolves again when that address stops working,
+- reads the response by its Content-Length, so it knows when the response is
+  done without waiting for the server to close,
+- writes the request line, headers and payload with one client write
+  (WriteBuffer), one AT+CIPSEND instead of dozens,
+- reconnects only after an error, and never waits with delay(). If open()
+  fails, the caller queues the reading (GC_Queue.h) and tries again later.
+- keeps a short response body (up to GC_DOWNLINK_SIZE - 1 bytes) as a
+  downlink for the bin, see downlink() and parseDownlink().
+
+Call open() before reading the sensors (prewarm) and the report itself is only
+the request and the response.
+
+Pass the session anywhere a client is taken (postRecord, postBatch, sendQueued).
+*/
+template <typename Modem, typename Client>
+class HarvestSession {
+public:
+  HarvestSession(Modem &modem, Client &client) : modem(modem), client(client), status(0) {
+    ip[0] = '\0';
+    body[0] = '\0';
+  }
+
+  /*
+  open - Make sure the connection to Harvest is open.
+
+  Does nothing if it already is. Otherwise connects to the cached address. If
+  that fails, resolves the host again and tries once more. Every wait is cut
+  to what is left of the deadline, if one is given.
+  Returns true if the connection is open.
+  */
+  bool open(Stream &SerialMon, const TaskTimer &deadline = TaskTimer()) {
+    if (client.connected()) {
+      return true;
+    }
+
+    SerialMon.println("Connecting to Soracom Harvest...");
+    GC_METRIC_BEGIN(GC_PHASE_CONNECT);
+    bool connected = connect(SerialMon, deadline);
+    GC_METRIC_END(GC_PHASE_CONNECT, connected);
+    if (!connected) {
+      SerialMon.println("Failed to connect to Soracom Harvest.");
+    }
+    return connected;
+  }
+
+  // Close the connection, the next post() opens a new one
+  void close() {
+    if (client.connected()) {
+      client.stop();
+    }
+  }
+
+  /*
+  recheck - Ask the modem whether the kept connection is still open.
+
+  client.connected() only knows about a "CLOSED" that TinyGsm read. Call this
+  when the modem's bytes may have been lost, after a sensor window on the Uno
+  (GC_SerialBus.h). If the modem says the socket is closed, the connection is
+  dropped here and the next post() opens a new one.
+  Returns true if the connection is still open.
+  */
+  bool recheck() {
+    if (!client.connected()) {
+      return false;
+    }
+    if (gc_detail::socketConnected(modem, GC_CLIENT_MUX)) {
+      return true;
+    }
+    client.stop();
+    return false;
+  }
+
+  /*
+  post - Send a JSON document or a binary payload.
+
+  The connection and the wait for the response stop at the deadline (the
+  report's time budget), if one is given.
+
+  Returns true if the server answered. The HTTP status is in lastStatus().
+  A 4xx answer also counts as delivered, since sending it again will not help.
+  */
+  bool post(Stream &SerialMon, JsonDocument &jsonDoc, const TaskTimer &deadline = TaskTimer()) {
+    if (!open(SerialMon, deadline)) {
+      return false;
+    }
+    GC_METRIC_BEGIN(GC_PHASE_WRITE);
+    WriteBuffer<Client, GC_HARVEST_WRITE_SIZE> out(client);
+    gc_detail::harvestRequest(out, "application/json", measureJson(jsonDoc), true);
+    serializeJson(jsonDoc, out);
+    return finish(SerialMon, out.finish(), deadline);
+  }
+
+  bool post(Stream &SerialMon, const uint8_t *payload, size_t length, const TaskTimer &deadline = TaskTimer()) {
+    if (!open(SerialMon, deadline)) {
+      return false;
+    }
+    GC_METRIC_BEGIN(GC_PHASE_WRITE);
+    WriteBuffer<Client, GC_HARVEST_WRITE_SIZE> out(client);
+    gc_detail::harvestRequest(out, "application/octet-stream", length, true);
+    out.write(payload, length);
+    return finish(SerialMon, out.finish(), deadline);
+  }
+
+  // HTTP status of the last response, 0 if there was none
+  int lastStatus() const { return status; }
+
+  // Cached address of harvest.soracom.io, empty if not resolved
+  const char *address() const { return ip; }
+
+  // Body of the last 2xx response, empty if there was none or it did not fit
+  const char *downlink() const { return body; }
+
+private:
+  // Connect to the cached address, or resolve the host again and try once more
+  bool connect(Stream &SerialMon, const TaskTimer &deadline) {
+    if (ip[0] != '\0' && gc_detail::connectWithin(client, ip, GC_HARVEST_PORT, deadline)) {
+      return true;
+    }
+    if (resolve(SerialMon, deadline) && gc_detail::connectWithin(client, ip, GC_HARVEST_PORT, deadline)) {
+      return true;
+    }
+
+    // DNS did not work, let the modem resolve it
+    ip[0] = '\0';
+    return gc_detail::connectWithin(client, GC_HARVEST_HOST, GC_HARVEST_PORT, deadline);
+  }
+
+  // Flush the request, then wait for the response. A failed write closes
+  // the connection, the next post() opens a new one.
+  bool finish(Stream &SerialMon, bool written, const TaskTimer &deadline) {
+    client.flush();
+    GC_METRIC_END(GC_PHASE_WRITE, written);
+    if (!written) {
+      SerialMon.println("Soracom Harvest write failed.");
+      close();
+      return false;
+    }
+    GC_METRIC_BEGIN(GC_PHASE_RESPONSE);
+    bool answered = readResponse(SerialMon, deadline);
+    GC_METRIC_END(GC_PHASE_RESPONSE, answered);
+    return answered;
+  }
+
+  /*
+  resolve - Look up harvest.soracom.io with the modem's DNS and cache it.
+
+  Example response: +CDNSGIP: 1,"harvest.soracom.io","100.127.111.112"
+  */
+  bool resolve(Stream &SerialMon, const TaskTimer &deadline) {
+    ip[0] = '\0';
+    unsigned long waitMs = budgetMs(deadline, 15000UL);
+    if (waitMs == 0) {
+      return false;
+    }
+    modem.sendAT(GF("+CDNSGIP=\"" GC_HARVEST_HOST "\""));
+    if (modem.waitResponse() != 1) {
+      return false;
+    }
+    if (modem.waitResponse(waitMs, GF("+CDNSGIP:")) != 1) {
+      return false;
+    }
+
+    char line[64];
+    if (gc_detail::readLine(modem.stream, line, sizeof(line), 1000) < 0) {
+      return false;
+    }
+    const char *p = line;
+    while (*p == ' ') p++;
+    char *end = strrchr(line, '"');
+    if (*p != '1' || end == NULL) {
+      return false;
+    }
+    *end = '\0';
+    char *start = strrchr(line, '"');
+    if (start == NULL || end - start > (int)sizeof(ip)) {
+      return false;
+    }
+    strcpy(ip, start + 1);
+
+    SerialMon.print("Resolved " GC_HARVEST_HOST " to "); SerialMon.println(ip);
+    return true;
+  }
+
+  /*
+  readResponse - Read the status line, the headers and exactly Content-Length
+  bytes of body, so the connection is ready for the next request.
+
+  A body that fits in GC_DOWNLINK_SIZE is kept for downlink(). A longer one is
+  read and dropped as a whole, half a command would be worse than none.
+
+  Closes the connection if the server asked for it, if the length is unknown,
+  or if anything timed out. No wait goes past the deadline.
+  */
+  bool readResponse(Stream &SerialMon, const TaskTimer &deadline) {
+    char line[64];
+    long contentLength = -1;
+    bool serverCloses = false;
+    size_t kept = 0;
+    status = 0;
+    body[0] = '\0';
+
+    // Status line, e.g. "HTTP/1.1 201 Created"
+    if (gc_detail::readLine(client, line, sizeof(line), budgetMs(deadline, GC_HARVEST_TIMEOUT_MS)) < 0) {
+      SerialMon.println("No response from Soracom Harvest.");
+      close();
+      return false;
+    }
+    const char *code = strchr(line, ' ');
+    if (code != NULL) {
+      status = atoi(code + 1);
+    }
+
+    // Headers, up to the empty line
+    int n;
+    while ((n = gc_detail::readLine(client, line, sizeof(line), budgetMs(deadline, GC_HARVEST_TIMEOUT_MS))) > 0) {
+      if (strncasecmp(line, "Content-Length:", 15) == 0) {
+        contentLength = atol(line + 15);
+      } else if (strncasecmp(line, "Connection:", 11) == 0 && strstr(line + 11, "close") != NULL) {
+        serverCloses = true;
+      }
+    }
+
+    // Body, kept if it is short enough
+    bool keep = contentLength > 0 && contentLength < GC_DOWNLINK_SIZE;
+    unsigned long start = millis();
+    unsigned long bodyMs = budgetMs(deadline, GC_HARVEST_TIMEOUT_MS);
+    while (n == 0 && contentLength > 0 && millis() - start < bodyMs) {
+      if (client.available() > 0) {
+        char c = client.read();
+        if (keep) {
+          body[kept++] = c;
+        }
+        contentLength--;
+      }
+    }
+    if (keep && contentLength == 0 && status >= 200 && status < 300) {
+      body[kept] = '\0';
+    } else {
+      body[0] = '\0';
+    }
+
+    if (n < 0 || contentLength != 0 || serverCloses) {
+      close();
+    }
+
+    SerialMon.print("Soracom Harvest response: "); SerialMon.println(status);
+    return status >= 200 && status < 500;
+  }
+
+  Modem &modem;
+  Client &client;
+  char ip[16];          // "255.255.255.255" fits
+  char body[GC_DOWNLINK_SIZE];
+  int status;
+};
+
+// Let postRecord, postBatch and sendQueued send through a session
+template <typename Modem, typename Client>
+bool postToHarvest(HarvestSession<Modem, Client> &session, Stream &SerialMon, JsonDocument &jsonDoc,
+                   const TaskTimer &deadline = TaskTimer()) {
+  return session.post(SerialMon, jsonDoc, deadline);
+}
+
+template <typename Modem, typename Client>
+bool postToHarvest(HarvestSession<Modem, Client> &session, Stream &SerialMon, const uint8_t *payload, size_t length,
+                   const TaskTimer &deadline = TaskTimer()) {
+  return session.post(SerialMon, payload, length, deadline);
+}
+
+
+// ======================== DOWNLINK ========================
+/*
+The only way back to a bin is the body of the response to its own report.
+Harvest itself answers with an empty body. To send something to a bin, have
+the response rewritten on the way back (e.g. with Soracom Orbit) to a short
+JSON object, at most GC_DOWNLINK_SIZE - 1 bytes:
+
+  {"profile":2}                         use profile 2 of the firmware's table
+  {"geometry":[72,48,60,4,2,3,15,60]}   use this profile (GeometryProfile
+                                        fields after the id, GC_Profiles.h)
+  {"calibrate":1}                       measure the empty bin again
+  {"update":1}                          check for a newer firmware (GC_Ota.h)
+
+Keys can be combined. The sketch applies them after a report was delivered.
+*/
+struct Downlink {
+  uint8_t profileId;
+  GeometryProfile geometry;
+};
+
+namespace gc_detail {
+  // Picked when the session keeps response bodies (HarvestSession)
+  template <typename Session>
+  auto sessionDownlink(Session &session, int) -> decltype(session.downlink()) {
+    return session.downlink();
+  }
+
+  // Picked for the Unified Endpoint sessions, which get no body back
+  template <typename Session>
+  const char *sessionDownlink(Session &, long) { return ""; }
+}
+
+// Body of the last response of any uplink session, empty if it has none
+template <typename Session>
+const char *downlinkOf(Session &session) {
+  return gc_detail::sessionDownlink(session, 0);
+}
+
+/*
+parseDownlink - Read a downlink, see the formats above.
+
+Parameters:
+  body     - The response body, e.g. downlinkOf(harvest).
+  downlink - Filled in with what was asked for.
+
+Returns the GC_DOWNLINK_* flags of what was asked for, 0 if the body is empty,
+not JSON, or asks for nothing valid. A geometry is only returned if
+profileValid() accepts it.
+*/
+inline uint8_t parseDownlink(const char *body, Downlink &downlink) {
+  if (body == NULL || body[0] == '\0') {
+    return 0;
+  }
+  // Keys are copied into the document, "calibrate" is the longest
+  StaticJsonDocument<JSON_OBJECT_SIZE(4) + JSON_ARRAY_SIZE(8) + 40> doc;
+  if (deserializeJson(doc, body) != DeserializationError::Ok) {
+    return 0;
+  }
+
+  uint8_t flags = 0;
+  if (doc["profile"].is<uint8_t>()) {
+    downlink.profileId = doc["profile"];
+    flags |= GC_DOWNLINK_PROFILE;
+  }
+
+  JsonArrayConst values = doc["geometry"];
+  if (values.size() == 8) {
+    uint8_t v[8];
+    bool ok = true;
+    for (uint8_t i = 0; i < 8; i++) {
+      ok = ok && values[i].is<uint8_t>();
+      v[i] = values[i];
+    }
+    GeometryProfile p = { GC_PROFILE_CUSTOM, v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7] };
+    if (ok && profileValid(p)) {
+      downlink.geometry = p;
+      flags |= GC_DOWNLINK_GEOMETRY;
+    }
+  }
+
+  if (doc["calibrate"].as<int>() != 0) {
+    flags |= GC_DOWNLINK_CALIBRATE;
+  }
+  if (doc["update"].as<int>() != 0) {
+    flags |= GC_DOWNLINK_UPDATE;
+  }
+  return flags;
+}
+
+
+/*
+readingTime - Epoch seconds when a reading was taken, from deviceClock() and its age.
+
+Returns 0 if the clock is not set, or the age is unknown (queued before a reset).
+*/
+inline uint32_t readingTime(const TelemetryRecord &record) {
+  if (!deviceClock().valid() || record.age == GC_AGE_UNKNOWN) {
+    return 0;
+  }
+  return deviceClock().now() - record.age;
+}
+
+
+// Room telemetryToJson needs for the metrics keys (GC_METRICS_IN_PAYLOAD)
+#if GC_METRICS_IN_PAYLOAD
+#define GC_METRICS_JSON_SIZE  (JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(GC_PHASE_COUNT))
+#else
+#define GC_METRICS_JSON_SIZE  0
+#endif
+
+/*
+telemetryToJson - Fill a JSON document with the keys Harvest expects.
+
+Parameters:
+  record  - The reading, see GC_Telemetry.h.
+  jsonDoc - The document to fill.
+
+The keys are the ones soracom_to_arcgis.py reads. A reading that sat in the
+queue (GC_Queue.h) also gets "age", the seconds since it was taken. Once
+deviceClock() is synced (syncClock), every reading also gets "time", the
+epoch seconds (UTC) when it was taken.
+
+With GC_METRICS_IN_PAYLOAD (GC_Metrics.h), it also gets "phaseMs", the last
+time of each GC_PHASE_* in ms in that order, and the "sensorTimeouts" and
+"checksumErrors" counters. The binary record has no room for them.
+*/
+inline void telemetryToJson(const TelemetryRecord &record, JsonDocument &jsonDoc) {
+  jsonDoc["id"] = record.id; // Sensor ID
+  if (record.fullness == GC_FULLNESS_UNKNOWN) {
+    jsonDoc["fullness"] = -1; // No reading
+  } else {
+    jsonDoc["fullness"] = record.fullness; // Fullness percentage
+  }
+  jsonDoc["temperature"] = record.temperature;
+  jsonDoc["humidity"] = record.humidity;
+  jsonDoc["status"] = (record.health & GC_HEALTH_OK) ? "OK" : "ERROR";
+  if (record.health & GC_HEALTH_QUEUED) {
+    jsonDoc["age"] = record.age;
+  }
+  uint32_t time = readingTime(record);
+  if (time != 0) {
+    jsonDoc["time"] = time;
+  }
+#if GC_METRICS_IN_PAYLOAD
+  const PhaseMetrics &metrics = phaseMetrics();
+  JsonArray phaseMs = jsonDoc.createNestedArray("phaseMs");
+  for (uint8_t i = 0; i < GC_PHASE_COUNT; i++) {
+    phaseMs.add(metrics.phases[i].lastUs / 1000);
+  }
+  jsonDoc["sensorTimeouts"] = metrics.sensorTimeouts;
+  jsonDoc["checksumErrors"] = metrics.checksumErrors;
+#endif
+}
+
+
+/*
+postRecord - Send one reading to Soracom Harvest.
+
+Parameters:
+  client    - A HarvestSession, or a TinyGsmClient (or any Client) to open the connection with.
+  SerialMon - The serial monitor stream for debug output.
+  record    - The reading to send.
+  deadline  - The report's time budget, bounds the waits of the POST. Not
+              started means the fixed timeouts.
+
+Sends the 8 byte binary record when GC_PAYLOAD_BINARY is defined, JSON otherwise.
+Returns true if the request was sent.
+*/
+template <typename Client>
+bool postRecord(Client &client, Stream &SerialMon, const TelemetryRecord &record,
+                const TaskTimer &deadline = TaskTimer()) {
+#if defined(GC_PAYLOAD_BINARY)
+  uint8_t payload[GC_TELEMETRY_SIZE];
+  uint8_t length = encodeTelemetry(record, payload);
+  return postToHarvest(client, SerialMon, payload, length, deadline);
+#else
+  StaticJsonDocument<256 + GC_METRICS_JSON_SIZE> jsonDoc;
+  telemetryToJson(record, jsonDoc);
+  return postToHarvest(client, SerialMon, jsonDoc, deadline);
+#endif
+}
+
+
+/*
+postBatch - Send every reading of a ReadingBatch (GC_Batch.h) in one HTTP POST.
+
+Parameters:
+  client    - A HarvestSession, or a TinyGsmClient (or any Client) to open the connection with.
+  SerialMon - The serial monitor stream for debug output.
+  batch     - The readings to send. Not cleared here, clear it once this
+              returned true.
+  deadline  - The report's time budget, as for postRecord.
+
+JSON: the newest reading is sent with the usual top level keys, so
+soracom_to_arcgis.py and anything else that reads "fullness" keeps working.
+The older ones go in a "readings" array, each with its "age" in seconds:
+
+  {"id":1,"fullness":42,...,"readings":[{"fullness":40,...,"age":60}, ...]}
+
+Binary (GC_PAYLOAD_BINARY): only one record per POST. The Binary Parser
+decodes a fixed layout from the start of the payload, so records appended
+behind the first would be stored by nobody. N has to be 1 (GC_BATCH_SIZE,
+the sketch headers stop the build otherwise).
+
+Returns true if the request was sent.
+*/
+template <typename Client, uint8_t N>
+bool postBatch(Client &client, Stream &SerialMon, const ReadingBatch<N> &batch,
+               const TaskTimer &deadline = TaskTimer()) {
+  if (batch.empty()) {
+    return true;
+  }
+  unsigned long now = millis();
+  uint8_t newest = batch.size() - 1;
+
+#if defined(GC_PAYLOAD_BINARY)
+  static_assert(N == 1, "the Binary Parser decodes one record per POST, set GC_BATCH_SIZE to 1");
+  uint8_t payload[GC_TELEMETRY_SIZE];
+  uint8_t length = encodeTelemetry(batch.get(newest, now), payload);
+  return postToHarvest(client, SerialMon, payload, length, deadline);
+#else
+  StaticJsonDocument<JSON_OBJECT_SIZE(9) + JSON_ARRAY_SIZE(N) + N * JSON_OBJECT_SIZE(5) + GC_METRICS_JSON_SIZE> jsonDoc;
+  telemetryToJson(batch.get(newest, now), jsonDoc);
+
+  if (newest == 0) {
+    return postToHarvest(client, SerialMon, jsonDoc, deadline);
+  }
+
+  JsonArray readings = jsonDoc.createNestedArray("readings");
+  for (uint8_t i = 0; i < newest; i++) {
+    TelemetryRecord record = batch.get(i, now);
+    JsonObject reading = readings.createNestedObject();
+    if (record.fullness == GC_FULLNESS_UNKNOWN) {
+      reading["fullness"] = -1; // No reading
+    } else {
+      reading["fullness"] = record.fullness;
+    }
+    reading["temperature"] = record.temperature;
+    reading["humidity"] = record.humidity;
+    reading["age"] = record.age;
+    uint32_t time = readingTime(record);
+    if (time != 0) {
+      reading["time"] = time;
+    }
+  }
+  return postToHarvest(client, SerialMon, jsonDoc, deadline);
+#endif
+}
+
+/*
+sendQueued - Send the readings waiting in a store-and-forward queue.
+
+Parameters:
+  client    - A HarvestSession, or a TinyGsmClient (or any Client) to open the connection with.
+  SerialMon - The serial monitor stream for debug output.
+  queue     - The ReadingQueue (GC_Queue.h) to drain.
+  deadline  - The report's time budget, the rest waits for the next report.
+              Each POST stops waiting at it too. Not started means send
+              everything.
+
+N is the number of readings per POST, GC_BATCH_SIZE in the sketches: up to N
+readings are taken from the front of the queue and sent with postBatch().
+They are only removed once the POST worked. Sends oldest first and stops at
+the first failure, so the order is kept. N has to be 1 with GC_PAYLOAD_BINARY,
+like for postBatch().
+Call after a send worked. Returns the number of readings sent.
+*/
+template <uint8_t N = 1, typename Client, typename Queue>
+uint16_t sendQueued(Client &client, Stream &SerialMon, Queue &queue,
+                    const TaskTimer &deadline = TaskTimer()) {
+  uint16_t sent = 0;
+  ReadingBatch<N> batch;
+  TelemetryRecord record;
+  while (!deadline.expired()) {
+    batch.clear();
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < N && queue.peek(record, i); i++) {
+      batch.add(record, now - record.age * 1000UL);   // GC_AGE_UNKNOWN stays unknown
+    }
+    if (batch.empty() || !postBatch(client, SerialMon, batch, deadline)) {
+      break;
+    }
+    for (uint8_t i = 0; i < batch.size(); i++) {
+      queue.pop();
+    }
+    sent += batch.size();
+  }
+  queue.commit();
+
+  if (sent > 0) {
+    SerialMon.print("Sent queued readings: "); SerialMon.println(sent);
+  }
+  return sent;
+}
+
+#endif
+// GC_SORACOM_H
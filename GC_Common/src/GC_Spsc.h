@@ -0,0 +1,85 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Spsc.h
+
+Lock-free hand-off between two tasks, one that only writes and one that only
+reads (single producer, single consumer).
+
+In the ESP32 pipeline (GC_PIPELINE in GC_esp32.h) the sensor task on one core
+pushes readings and the modem task on the other core pops them. Neither side
+ever waits for the other. A full queue makes push() return false instead of
+blocking the sensor task, and an empty queue makes pop() return false.
+
+How it stays safe without a lock:
+- Only the producer writes `tail`, only the consumer writes `head`.
+- push() stores the element first, then publishes it with a release store of
+  `tail`. pop() reads `tail` with an acquire load before it reads the element,
+  so it never sees a half written element.
+- The indexes run freely and wrap at 2^16, N is a power of two, so
+  tail - head is the number of elements even after the indexes wrap.
+
+Uses the GCC __atomic builtins, which the ESP32 and AVR compilers both have.
+*/
+
+#ifndef GC_SPSC_H
+#define GC_SPSC_H
+
+#include <stdint.h>
+
+// ======================== CLASS DEFINITION ========================
+template <typename T, uint8_t N>
+class SpscQueue {
+  static_assert((N & (N - 1)) == 0 && N >= 2, "SpscQueue size must be a power of two");
+
+public:
+  SpscQueue() : head(0), tail(0) {}
+
+  /*
+  push - Add an element. Producer side only.
+
+  Returns false, and drops the element, if the queue is full.
+  */
+  bool push(const T &item) {
+    uint16_t t = tail;                                    // only this side writes tail
+    uint16_t h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    if ((uint16_t)(t - h) == N) {
+      return false;
+    }
+    items[t & (N - 1)] = item;
+    __atomic_store_n(&tail, (uint16_t)(t + 1), __ATOMIC_RELEASE);
+    return true;
+  }
+
+  /*
+  pop - Take the oldest element. Consumer side only.
+
+  Returns false if the queue is empty.
+  */
+  bool pop(T &item) {
+    uint16_t h = head;                                    // only this side writes head
+    uint16_t t = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+    if (h == t) {
+      return false;
+    }
+    item = items[h & (N - 1)];
+    __atomic_store_n(&head, (uint16_t)(h + 1), __ATOMIC_RELEASE);
+    return true;
+  }
+
+  // Number of elements, exact on either side, a snapshot from anywhere else
+  uint8_t size() const {
+    return (uint8_t)(uint16_t)(__atomic_load_n(&tail, __ATOMIC_ACQUIRE) -
+                               __atomic_load_n(&head, __ATOMIC_ACQUIRE));
+  }
+  bool empty() const { return size() == 0; }
+
+  static uint8_t capacity() { return N; }
+
+private:
+  T items[N];
+  uint16_t head;    // next element to pop, written by the consumer
+  uint16_t tail;    // next free slot, written by the producer
+};
+
+#endif
+// GC_SPSC_H
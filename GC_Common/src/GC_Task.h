@@ -0,0 +1,139 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Task.h
+
+millis() deadlines for cooperative tasks.
+
+The sketches used to wait with delay(): 9.3s to power on the modem, 10s after
+the restart, 10s between GPRS retries, 5s between readings. Nothing else could
+run during those waits. Now every job (modem start up, reading the sensors,
+reporting) is a small state machine with a step() function. loop() calls each
+step() in turn, and a step only does the part of the job that is due, then
+returns. A TaskTimer holds the deadline a task is waiting for.
+
+Keep step() functions short. A TinyGsm call that waits for the modem
+(restart(), gprsConnect(), a POST) still blocks until the modem answers. The
+tasks only remove the waits around those calls.
+*/
+
+#ifndef GC_TASK_H
+#define GC_TASK_H
+
+#include <Arduino.h>
+
+// ======================== CLASS DEFINITION ========================
+class TaskTimer {
+public:
+  TaskTimer() : startMs(0), periodMs(0), armed(false) {}
+
+  /*
+  start - Set the deadline.
+
+  Parameters:
+    ms - Time from now until the timer expires, and the period for due().
+  */
+  void start(unsigned long ms) {
+    startMs = millis();
+    periodMs = ms;
+    armed = true;
+  }
+
+  void stop() { armed = false; }
+  bool running() const { return armed; }
+
+  // True once the deadline passed, until the timer is started again
+  bool expired() const { return armed && millis() - startMs >= periodMs; }
+
+  /*
+  due - Periodic use: true once per period.
+
+  The next deadline is one period after the last one, not after the call, so
+  a late loop does not shift the schedule. If the loop fell behind by more
+  than a period, the missed runs are skipped instead of run back to back.
+  */
+  bool due() {
+    if (!expired()) {
+      return false;
+    }
+    startMs += periodMs;
+    if (millis() - startMs >= periodMs) {
+      startMs = millis();
+    }
+    return true;
+  }
+
+  // Milliseconds left until the deadline, 0 if it passed or the timer is stopped
+  unsigned long remaining() const {
+    if (!armed || expired()) {
+      return 0;
+    }
+    return periodMs - (millis() - startMs);
+  }
+
+private:
+  unsigned long startMs;
+  unsigned long periodMs;
+  bool armed;
+};
+
+
+/*
+StageTiming - How long one stage of the work takes, and how regularly it runs.
+
+Call begin() when the stage starts a run and end() when it is done.
+- duration: time from begin() to end() (last, max, average)
+- gap: time from one begin() to the next, shows if the stage kept its cadence
+  while another stage was stuck (e.g. sampling while the modem waits 30s)
+
+Only one task may call begin()/end(). Others reading the fields get a snapshot
+that can be one run out of date.
+*/
+struct StageTiming {
+  uint32_t runs;
+  uint32_t lastUs;      // duration of the last run
+  uint32_t maxUs;       // longest run
+  uint64_t totalUs;     // sum of all runs, for the average. 64 bit: 32 would
+                        // wrap after 4295 s of stage time, a few hundred reports
+                        // of a stage that runs for seconds
+  uint32_t maxGapMs;    // longest time between the start of two runs
+  uint32_t startUs;
+  uint32_t startMs;
+
+  void begin() {
+    uint32_t now = millis();
+    if (runs > 0 && now - startMs > maxGapMs) {
+      maxGapMs = now - startMs;
+    }
+    startMs = now;
+    startUs = micros();
+  }
+
+  void end() {
+    lastUs = micros() - startUs;
+    if (lastUs > maxUs) maxUs = lastUs;
+    totalUs += lastUs;
+    runs++;
+  }
+
+  uint32_t averageUs() const { return runs ? (uint32_t)(totalUs / runs) : 0; }
+
+  /*
+  print - Print one line with the timing of this stage.
+
+  Parameters:
+    SerialMon - The serial monitor stream for debug output.
+    name      - Name of the stage.
+  */
+  void print(Stream &SerialMon, const char *name) const {
+    SerialMon.print(name);
+    SerialMon.print(": runs "); SerialMon.print(runs);
+    SerialMon.print(", last "); SerialMon.print(lastUs);
+    SerialMon.print(" us, avg "); SerialMon.print(averageUs());
+    SerialMon.print(" us, max "); SerialMon.print(maxUs);
+    SerialMon.print(" us, max gap "); SerialMon.print(maxGapMs);
+    SerialMon.println(" ms");
+  }
+};
+
+#endif
+// GC_TASK_H
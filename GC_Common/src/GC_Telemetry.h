@@ -0,0 +1,135 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Telemetry.h
+
+Binary telemetry record for Soracom Harvest.
+
+The JSON payload ({"id":1,"fullness":42,"temperature":71,"humidity":40,"status":"OK"})
+is about 70 bytes for roughly 4 bytes of information. This is the bit segment
+layout the TODO in sendDataToSoracom asked for: the same values packed into 8
+bytes. Soracom's Binary Parser turns them back into JSON on the server side, so
+Harvest and soracom_to_arcgis.py still see the same keys.
+
+Record layout, version 1 (bit 7 is the MSB of each byte):
+
+  | byte | bits | field       | range                                        |
+  |------|------|-------------|----------------------------------------------|
+  | 0    | 7-5  | version     | GC_TELEMETRY_VERSION                         |
+  | 0    | 4-0  | health      | GC_HEALTH_* flags                            |
+  | 1    | 7-0  | id          | sensor device id, 0-255                      |
+  | 2    | 7    | (reserved)  | always 0                                     |
+  | 2    | 6-0  | fullness    | 0-100 %, GC_FULLNESS_UNKNOWN if no reading   |
+  | 3    | 7-0  | temperature | 0-255                                        |
+  | 4    | 7-0  | humidity    | 0-100 %                                      |
+  | 5    | 7-0  | seq         | counts up by one per record, wraps at 255    |
+  | 6-7  |      | age         | seconds since the reading was taken,         |
+  |      |      |             | big-endian, 0 if sent right away             |
+
+A new layout gets a new version number, so the server can tell them apart.
+Fields never cross a byte boundary (except the 16 bit age), which keeps both the
+encoder and the Binary Parser format simple.
+
+Link to the Soracom Binary Parser page:
+https://developers.soracom.io/en/docs/binary-parser/
+
+This header has no Arduino dependencies.
+*/
+
+#ifndef GC_TELEMETRY_H
+#define GC_TELEMETRY_H
+
+#include <stdint.h>
+
+// ======================== CONSTANTS ========================
+#define GC_TELEMETRY_VERSION    1
+#define GC_TELEMETRY_SIZE       8       // bytes per record
+
+#define GC_FULLNESS_UNKNOWN     127     // fullness value when there is no reading
+#define GC_AGE_UNKNOWN          0xFFFF  // age of a queued reading taken before the last reset
+
+// Health flags (byte 0, bits 4-0)
+#define GC_HEALTH_OK            0x01    // device status OK (the old "status": "OK")
+#define GC_HEALTH_SENSOR15      0x02    // the 15° sensor answered
+#define GC_HEALTH_SENSOR60      0x04    // the 60° sensor answered
+#define GC_HEALTH_TIME          0x08    // the clock was synced with the network
+#define GC_HEALTH_QUEUED        0x10    // the record was stored and sent later
+
+// Binary Parser format for the Soracom group (SIM Group > Binary Parser).
+// Paste the string without the quotes.
+#define GC_TELEMETRY_PARSER \
+  "version:0:uint:3:7 health:0:uint:5:4 id:1:uint8 fullness:2:uint:7:6 " \
+  "temperature:3:uint8 humidity:4:uint8 seq:5:uint8 age:6:uint16:big-endian"
+
+// ======================== STRUCTS ========================
+// One reading, as it is sent over the network
+struct TelemetryRecord {
+  uint8_t  id;            // sensor device id
+  uint8_t  fullness;      // 0-100 %, GC_FULLNESS_UNKNOWN if no reading
+  uint8_t  temperature;
+  uint8_t  humidity;      // 0-100 %
+  uint8_t  health;        // GC_HEALTH_* flags
+  uint8_t  seq;           // record counter
+  uint16_t age;           // seconds since the reading was taken
+};
+
+// ======================== FUNCTION DEFINITIONS ========================
+/*
+telemetryFullness - Clamp a fullness percentage to what fits in the record.
+
+Parameters:
+  fullness - Fullness from GetFullPer(), negative if there was no reading.
+*/
+inline uint8_t telemetryFullness(long fullness) {
+  if (fullness < 0) return GC_FULLNESS_UNKNOWN;
+  if (fullness > 100) return 100;
+  return (uint8_t)fullness;
+}
+
+/*
+encodeTelemetry - Pack a record into GC_TELEMETRY_SIZE bytes.
+
+Parameters:
+  r   - The record to pack.
+  out - Buffer of at least GC_TELEMETRY_SIZE bytes.
+
+Values that do not fit their field are cut to the field width.
+Returns the number of bytes written.
+*/
+inline uint8_t encodeTelemetry(const TelemetryRecord &r, uint8_t *out) {
+  out[0] = (uint8_t)((GC_TELEMETRY_VERSION << 5) | (r.health & 0x1F));
+  out[1] = r.id;
+  out[2] = r.fullness & 0x7F;
+  out[3] = r.temperature;
+  out[4] = r.humidity;
+  out[5] = r.seq;
+  out[6] = (uint8_t)(r.age >> 8);
+  out[7] = (uint8_t)(r.age & 0xFF);
+  return GC_TELEMETRY_SIZE;
+}
+
+/*
+decodeTelemetry - Unpack a record, the reverse of encodeTelemetry().
+
+Parameters:
+  in  - The received bytes.
+  len - Number of received bytes.
+  r   - Filled in with the decoded values.
+
+Returns false if the buffer is too short or has a different version.
+*/
+inline bool decodeTelemetry(const uint8_t *in, uint8_t len, TelemetryRecord &r) {
+  if (len < GC_TELEMETRY_SIZE || (in[0] >> 5) != GC_TELEMETRY_VERSION) {
+    return false;
+  }
+  r.health = in[0] & 0x1F;
+  r.id = in[1];
+  r.fullness = in[2] & 0x7F;
+  r.temperature = in[3];
+  r.humidity = in[4];
+  r.seq = in[5];
+  r.age = ((uint16_t)in[6] << 8) | in[7];
+  return true;
+}
+
+#endif
+// GC_TELEMETRY_H
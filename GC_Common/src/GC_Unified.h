@@ -0,0 +1,278 @@
+/*
+GreenCampus SmartDumpster - Shared Library
+- GC_Unified.h
+
+Uplink through Soracom's Unified Endpoint (uni.soracom.io) without HTTP.
+
+With HTTP, every report carries a request line and four headers, about 120
+bytes, and gets a response with its own headers back. That is several times
+the payload, which is 8 bytes in the binary format (GC_Telemetry.h). The
+Unified Endpoint takes the payload as it is, over UDP or plain TCP, and hands
+it to Harvest (and the Binary Parser) like an HTTP POST would.
+
+  | transport | bytes sent per binary report  | waits for             |
+  |-----------|-------------------------------|-----------------------|
+  | HTTP      | ~120 header + 8 payload       | status line + headers |
+  | TCP       | 8 payload                     | SEND OK from modem    |
+  | UDP       | 8 payload, one datagram       | SEND OK from modem    |
+
+(not counting the IP/TCP/UDP headers, which the modem adds in every case)
+
+Pick the transport in the sketch header, BEFORE including this file:
+
+  #define GC_TRANSPORT GC_TRANSPORT_UDP
+
+UplinkSession is then the session type for that transport. All three have the
+same open()/post()/close()/recheck() functions, so the sketches only declare one
+UplinkSession and pass it to postRecord, postBatch and sendQueued.
+
+UDP gives no delivery guarantee. The modem only reports that the datagram left,
+so a report lost on the way is not queued again. Use TCP or HTTP where that
+matters.
+
+Harvest has to be enabled for the SIM group, the same as for HTTP.
+Link to the Unified Endpoint page:
+https://developers.soracom.io/en/docs/unified-endpoint/
+*/
+
+#ifndef GC_UNIFIED_H
+#define GC_UNIFIED_H
+
+#include "GC_Soracom.h"
+
+// ======================== CONSTANTS ========================
+#define GC_TRANSPORT_HTTP     0     // HTTP POST to harvest.soracom.io (HarvestSession)
+#define GC_TRANSPORT_TCP      1     // raw TCP to uni.soracom.io
+#define GC_TRANSPORT_UDP      2     // one UDP datagram per report to uni.soracom.io
+
+#if !defined(GC_TRANSPORT)
+#define GC_TRANSPORT          GC_TRANSPORT_HTTP
+#endif
+
+#define GC_UNIFIED_HOST       "uni.soracom.io"    // Soracom Unified Endpoint
+#define GC_UNIFIED_PORT       23080               // Same port for TCP and UDP
+#define GC_UDP_MUX            1                   // Modem socket for UDP, TinyGsmClient uses 0
+#define GC_UDP_MAX_PAYLOAD    256                 // Largest JSON document sent over UDP
+#define GC_TCP_WRITE_SIZE     256                 // Bytes of JSON per TCP write, one AT+CIPSEND each
+
+// ======================== CLASS DEFINITIONS ========================
+/*
+UnifiedTcpSession - Raw TCP connection to the Unified Endpoint.
+
+Each post() writes only the payload on a connection that stays open. Nothing
+is framed, so the end of the TCP write is the end of the report. A JSON
+document goes out in one write too (WriteBuffer, GC_Soracom.h), up to
+GC_TCP_WRITE_SIZE bytes.
+*/
+template <typename Modem, typename Client>
+class UnifiedTcpSession {
+public:
+  UnifiedTcpSession(Modem &modem, Client &client) : modem(modem), client(client) {}
+
+  // Make sure the connection is open, not waiting past the deadline. Returns true if it is.
+  bool open(Stream &SerialMon, const TaskTimer &deadline = TaskTimer()) {
+    if (client.connected()) {
+      return true;
+    }
+    SerialMon.println("Connecting to Soracom Unified Endpoint (TCP)...");
+    GC_METRIC_BEGIN(GC_PHASE_CONNECT);
+    bool connected = gc_detail::connectWithin(client, GC_UNIFIED_HOST, GC_UNIFIED_PORT, deadline);
+    GC_METRIC_END(GC_PHASE_CONNECT, connected);
+    if (!connected) {
+      SerialMon.println("Failed to connect to Soracom Unified Endpoint.");
+    }
+    return connected;
+  }
+
+  void close() {
+    if (client.connected()) {
+      client.stop();
+    }
+  }
+
+  // Drop the connection if the modem says it is closed (HarvestSession::recheck)
+  bool recheck() {
+    if (!client.connected()) {
+      return false;
+    }
+    if (gc_detail::socketConnected(modem, GC_CLIENT_MUX)) {
+      return true;
+    }
+    client.stop();
+    return false;
+  }
+
+  bool post(Stream &SerialMon, JsonDocument &jsonDoc, const TaskTimer &deadline = TaskTimer()) {
+    if (!open(SerialMon, deadline)) {
+      return false;
+    }
+    size_t length = measureJson(jsonDoc);
+    GC_METRIC_BEGIN(GC_PHASE_WRITE);
+    WriteBuffer<Client, GC_TCP_WRITE_SIZE> out(client);
+    bool written = serializeJson(jsonDoc, out) == length;
+    return finish(SerialMon, out.finish() && written);
+  }
+
+  bool post(Stream &SerialMon, const uint8_t *payload, size_t length, const TaskTimer &deadline = TaskTimer()) {
+    if (!open(SerialMon, deadline)) {
+      return false;
+    }
+    GC_METRIC_BEGIN(GC_PHASE_WRITE);
+    return finish(SerialMon, client.write(payload, length) == length);
+  }
+
+private:
+  // Flush, drop whatever the endpoint answered, close on a failed write
+  bool finish(Stream &SerialMon, bool written) {
+    client.flush();
+    GC_METRIC_END(GC_PHASE_WRITE, written);
+    while (client.available() > 0) {
+      client.read();
+    }
+    if (!written) {
+      SerialMon.println("Unified Endpoint write failed.");
+      close();
+    }
+    return written;
+  }
+
+  Modem &modem;
+  Client &client;
+};
+
+
+/*
+UnifiedUdpSession - UDP socket to the Unified Endpoint.
+
+TinyGsm has no UDP client, so this talks to the SIM7000 directly, with
+AT+CIPSTART/AT+CIPSEND on its own socket (GC_UDP_MUX). TinyGsmClient keeps
+socket 0. Every post() is one datagram. A failed send closes the socket on
+the modem too, otherwise the next AT+CIPSTART only gets "ALREADY CONNECT"
+after an ERROR and the session never opens again.
+*/
+template <typename Modem, typename Client>
+class UnifiedUdpSession {
+public:
+  UnifiedUdpSession(Modem &modem, Client &client) : modem(modem), isOpen(false) { (void)client; }
+
+  // Open the UDP socket, not waiting past the deadline. Returns true if it is open.
+  bool open(Stream &SerialMon, const TaskTimer &deadline = TaskTimer()) {
+    if (isOpen) {
+      return true;
+    }
+    unsigned long waitMs = budgetMs(deadline, GC_CONNECT_TIMEOUT_MS);
+    if (waitMs == 0) {
+      return false;
+    }
+    SerialMon.println("Opening UDP socket to Soracom Unified Endpoint...");
+    GC_METRIC_BEGIN(GC_PHASE_CONNECT);
+    modem.sendAT(GF("+CIPSTART="), GC_UDP_MUX, GF(",\"UDP\",\"" GC_UNIFIED_HOST "\","), GC_UNIFIED_PORT);
+    if (modem.waitResponse() != 1) {
+      GC_METRIC_END(GC_PHASE_CONNECT, false);
+      return false;
+    }
+    int r = modem.waitResponse(waitMs, GF("CONNECT OK"), GF("ALREADY CONNECT"), GF("CONNECT FAIL"));
+    isOpen = (r == 1 || r == 2);
+    GC_METRIC_END(GC_PHASE_CONNECT, isOpen);
+    if (!isOpen) {
+      SerialMon.println("Failed to open UDP socket.");
+    }
+    return isOpen;
+  }
+
+  void close() {
+    if (isOpen) {
+      modem.sendAT(GF("+CIPCLOSE="), GC_UDP_MUX);
+      modem.waitResponse();
+      isOpen = false;
+    }
+  }
+
+  // Forget the socket if the modem says it is closed (HarvestSession::recheck)
+  bool recheck() {
+    if (isOpen && !gc_detail::socketConnected(modem, GC_UDP_MUX)) {
+      close();
+    }
+    return isOpen;
+  }
+
+  bool post(Stream &SerialMon, JsonDocument &jsonDoc, const TaskTimer &deadline = TaskTimer()) {
+    uint8_t buf[GC_UDP_MAX_PAYLOAD];
+    size_t length = measureJson(jsonDoc);
+    if (length >= sizeof(buf)) {    // serializeJson also writes a terminating 0
+      SerialMon.println("JSON too large for one UDP datagram.");
+      return false;
+    }
+    serializeJson(jsonDoc, (char *)buf, sizeof(buf));
+    return post(SerialMon, buf, length, deadline);
+  }
+
+  bool post(Stream &SerialMon, const uint8_t *payload, size_t length, const TaskTimer &deadline = TaskTimer()) {
+    if (!open(SerialMon, deadline)) {
+      return false;
+    }
+    GC_METRIC_BEGIN(GC_PHASE_WRITE);
+    modem.sendAT(GF("+CIPSEND="), GC_UDP_MUX, ',', (uint16_t)length);
+    if (modem.waitResponse(GF(">")) != 1) {
+      GC_METRIC_END(GC_PHASE_WRITE, false);
+      SerialMon.println("UDP send refused, reopening the socket next time.");
+      close();
+      return false;
+    }
+    modem.stream.write(payload, length);
+    modem.stream.flush();
+    GC_METRIC_END(GC_PHASE_WRITE, true);
+
+    GC_METRIC_BEGIN(GC_PHASE_RESPONSE);
+    bool sent = modem.waitResponse(budgetMs(deadline, 10000UL), GF("SEND OK"), GF("SEND FAIL")) == 1;
+    GC_METRIC_END(GC_PHASE_RESPONSE, sent);
+    if (!sent) {
+      SerialMon.println("UDP send failed.");
+      close();
+      return false;
+    }
+    return true;
+  }
+
+private:
+  Modem &modem;
+  bool isOpen;
+};
+
+
+// Let postRecord, postBatch and sendQueued send through these sessions
+template <typename Modem, typename Client>
+bool postToHarvest(UnifiedTcpSession<Modem, Client> &session, Stream &SerialMon, JsonDocument &jsonDoc,
+                   const TaskTimer &deadline = TaskTimer()) {
+  return session.post(SerialMon, jsonDoc, deadline);
+}
+
+template <typename Modem, typename Client>
+bool postToHarvest(UnifiedTcpSession<Modem, Client> &session, Stream &SerialMon, const uint8_t *payload, size_t length,
+                   const TaskTimer &deadline = TaskTimer()) {
+  return session.post(SerialMon, payload, length, deadline);
+}
+
+template <typename Modem, typename Client>
+bool postToHarvest(UnifiedUdpSession<Modem, Client> &session, Stream &SerialMon, JsonDocument &jsonDoc,
+                   const TaskTimer &deadline = TaskTimer()) {
+  return session.post(SerialMon, jsonDoc, deadline);
+}
+
+template <typename Modem, typename Client>
+bool postToHarvest(UnifiedUdpSession<Modem, Client> &session, Stream &SerialMon, const uint8_t *payload, size_t length,
+                   const TaskTimer &deadline = TaskTimer()) {
+  return session.post(SerialMon, payload, length, deadline);
+}
+
+// ======================== TRANSPORT SELECTION ========================
+#if GC_TRANSPORT == GC_TRANSPORT_TCP
+typedef UnifiedTcpSession<TinyGsm, TinyGsmClient> UplinkSession;
+#elif GC_TRANSPORT == GC_TRANSPORT_UDP
+typedef UnifiedUdpSession<TinyGsm, TinyGsmClient> UplinkSession;
+#else
+typedef HarvestSession<TinyGsm, TinyGsmClient> UplinkSession;
+#endif
+
+#endif
+// GC_UNIFIED_H
@@ -0,0 +1,653 @@
+/*
+GreenCampus SmartDumpster - Host tests
+- AtSim.h
+
+A SIM7000 on a serial port, for the host tests. AtSim is the Stream the
+TinyGsm stand-in (host/TinyGsmClient.h) talks to. It reads the AT commands the
+firmware sends and answers them from a transcript, a list of AtSteps:
+
+  const AtStep steps[] = {
+    { "AT+CGATT?", "\r\n+CGATT: 0\r\n\r\nOK\r\n", 20 },
+    { "AT+CIICR",  "\r\n+CME ERROR: 148\r\n", 800 },
+    { NULL,        "\r\n0, CLOSED\r\n", 5000 },
+  };
+
+- expect is the start of the command the firmware has to send next. A
+  different command is an error (see ok()) and gets "ERROR".
+- reply is what the modem answers, latencyMs after the command.
+- A step with expect NULL is not an answer. Its reply follows the step
+  before it, latencyMs after that reply (URCs like "+CDNSGIP:" or a closed
+  socket).
+- AT_PAYLOAD as expect answers the data of the AT+CIPSEND before it, after
+  all of it was written (e.g. "SEND FAIL").
+
+The sockets need no transcript. AT+CIPSTART, AT+CIPSEND, AT+CIPCLOSE and
+AT+CIPSTATUS=<mux> that the transcript does not expect are answered like the
+modem does, after setLatency() ms. The data of every AT+CIPSEND goes to the
+AtServer of that socket (serve()), which answers through receive()
+("+RECEIVE" URC) and can close the socket. HttpServer answers HTTP requests, RangeServer serves files
+with Range requests, SinkServer only keeps what it got.
+
+Faults: latency per step, dropNext() loses reply bytes on the way to the
+firmware, "+CME ERROR" and "<mux>, CLOSED" are plain replies.
+
+Everything is in fixed buffers, like on the boards.
+*/
+
+#ifndef GC_AT_SIM_H
+#define GC_AT_SIM_H
+
+#include <Arduino.h>
+
+#define AT_PAYLOAD          "<payload>"   // AtStep::expect for the data of an AT+CIPSEND
+#define AT_SIM_SOCKETS      4
+#define AT_SIM_OUT_SIZE     8192          // Reply bytes on the way to the firmware
+#define AT_SIM_CHUNKS       64            // Replies on the way
+#define AT_SIM_LOG_SIZE     512           // Commands kept for count()
+#define AT_SIM_LINE_SIZE    96            // Longest command line kept
+#define AT_SIM_SEND_SIZE    1460          // Largest AT+CIPSEND, as on the SIM7000
+
+struct AtStep {
+  const char *expect;       // Start of the command, NULL for a URC, AT_PAYLOAD for CIPSEND data
+  const char *reply;
+  unsigned long latencyMs;  // After the command (or after the reply before, for a URC)
+};
+
+class AtSim;
+
+// What sits behind a socket of the modem
+class AtServer {
+public:
+  virtual ~AtServer() {}
+  virtual void opened(AtSim &, uint8_t) {}
+  // The data of one AT+CIPSEND
+  virtual void received(AtSim &sim, uint8_t mux, const uint8_t *data, size_t length) = 0;
+};
+
+class AtSim : public Stream {
+public:
+  AtSim() { reset(); }
+
+  // Back to an idle modem without a transcript
+  void reset() {
+    steps = NULL;
+    stepCount = next = 0;
+    outHead = outTail = visible = 0;
+    chunkHead = chunkCount = 0;
+    lastReleaseUs = 0;
+    lineLength = 0;
+    payloadLeft = payloadLength = 0;
+    logCount = 0;
+    latencyMs = 20;
+    dropSkip = dropCount = 0;
+    dropReceived = false;
+    wire = 0;
+    failure[0] = '\0';
+    for (uint8_t i = 0; i < AT_SIM_SOCKETS; i++) {
+      sockets[i] = Socket();
+    }
+  }
+
+  // Answer from these steps, in order. The array must outlive the sim.
+  void script(const AtStep *list, uint8_t count) {
+    steps = list;
+    stepCount = count;
+    next = 0;
+    lastReleaseUs = hostNowUs();
+    queueUrcs();
+  }
+
+  void serve(uint8_t mux, AtServer &server) { sockets[mux].server = &server; }
+
+  // Latency of the answers that are not in the transcript
+  void setLatency(unsigned long ms) { latencyMs = ms; }
+
+  /*
+  dropNext - Lose bytes of the next reply on the way to the firmware.
+
+  Parameters:
+    count    - Bytes lost.
+    skip     - Bytes of the reply that get through before them.
+    received - Lose them from the next data received on a socket (the whole
+               "+RECEIVE" URC) instead of the next reply of any kind.
+  */
+  void dropNext(uint16_t count, uint16_t skip = 0, bool received = false) {
+    dropCount = count;
+    dropSkip = skip;
+    dropReceived = received;
+  }
+
+  // Data from the server on a socket, as the "+RECEIVE" URC
+  void receive(uint8_t mux, const uint8_t *data, size_t length, unsigned long latency) {
+    uint8_t urc[32 + AT_SIM_SEND_SIZE];
+    if (length > AT_SIM_SEND_SIZE) {
+      length = AT_SIM_SEND_SIZE;
+    }
+    int n = snprintf((char *)urc, 32, "\r\n+RECEIVE,%u,%u:\r\n", mux, (unsigned)length);
+    memcpy(urc + n, data, length);
+    queue(urc, n + length, hostNowUs() + (uint64_t)latency * 1000, true);
+  }
+  void receive(uint8_t mux, const char *text, unsigned long latency) {
+    receive(mux, (const uint8_t *)text, strlen(text), latency);
+  }
+
+  // The server closes the socket
+  void closeSocket(uint8_t mux, unsigned long latency) {
+    char text[24];
+    snprintf(text, sizeof(text), "\r\n%u, CLOSED\r\n", mux);
+    sockets[mux].open = false;
+    reply(text, hostNowUs() + (uint64_t)latency * 1000);
+  }
+
+  // ---- Checks ----
+  bool ok() const { return failure[0] == '\0'; }
+  // Every step of the transcript was used
+  bool done() const { return next == stepCount; }
+  // First command that did not match the transcript
+  const char *error() const { return failure; }
+
+  // Commands starting with prefix, of the last AT_SIM_LOG_SIZE
+  uint16_t count(const char *prefix) const {
+    uint16_t n = 0;
+    uint16_t kept = logCount < AT_SIM_LOG_SIZE ? logCount : AT_SIM_LOG_SIZE;
+    for (uint16_t i = 0; i < kept; i++) {
+      n += strncmp(log[i], prefix, strlen(prefix)) == 0;
+    }
+    return n;
+  }
+  uint16_t commands() const { return logCount; }
+
+  bool isOpen(uint8_t mux) const { return sockets[mux].open; }
+  const char *host(uint8_t mux) const { return sockets[mux].host; }
+  uint16_t connects(uint8_t mux) const { return sockets[mux].connects; }
+  uint16_t sends(uint8_t mux) const { return sockets[mux].sends; }           // AT+CIPSEND data delivered
+  uint32_t payloadBytes(uint8_t mux) const { return sockets[mux].bytes; }
+  uint32_t wireBytes() const { return wire; }   // Everything the firmware wrote, commands and data
+
+  // ---- Stream, the firmware's side ----
+  int available() override {
+    release();
+    return (int)(visible - outHead);
+  }
+  int read() override { return available() > 0 ? out[outHead++ % AT_SIM_OUT_SIZE] : -1; }
+  int peek() override { return available() > 0 ? out[outHead % AT_SIM_OUT_SIZE] : -1; }
+
+  using Print::write;
+  size_t write(uint8_t c) override {
+    wire++;
+    if (payloadLeft > 0) {
+      payload[payloadLength++] = c;
+      if (--payloadLeft == 0) {
+        payloadDone();
+      }
+      return 1;
+    }
+    if (c == '\n') {
+      line[lineLength] = '\0';
+      if (lineLength > 0) {
+        command(line);
+      }
+      lineLength = 0;
+    } else if (c != '\r' && lineLength + 1 < sizeof(line)) {
+      line[lineLength++] = (char)c;
+    }
+    return 1;
+  }
+
+private:
+  struct Socket {
+    AtServer *server = NULL;
+    bool open = false;
+    char host[40] = "";
+    uint16_t connects = 0;
+    uint16_t sends = 0;
+    uint32_t bytes = 0;
+  };
+
+  struct Chunk {
+    uint32_t end;          // outTail after the chunk
+    uint64_t releaseUs;
+  };
+
+  static bool startsWith(const char *s, const char *prefix) {
+    return strncmp(s, prefix, strlen(prefix)) == 0;
+  }
+
+  // ---- Replies ----
+  void queue(const uint8_t *data, size_t length, uint64_t releaseUs, bool received = false) {
+    if (releaseUs < lastReleaseUs) {
+      releaseUs = lastReleaseUs;    // bytes arrive in order
+    }
+    uint16_t skip = 0, drop = 0;
+    if (dropCount > 0 && (received || !dropReceived)) {
+      skip = dropSkip;
+      drop = dropCount;
+      dropCount = 0;
+    }
+    for (size_t i = 0; i < length; i++) {
+      if (skip > 0) {
+        skip--;
+      } else if (drop > 0) {
+        drop--;
+        continue;
+      }
+      if (outTail - outHead < AT_SIM_OUT_SIZE) {
+        out[outTail++ % AT_SIM_OUT_SIZE] = data[i];
+      }
+    }
+    if (chunkCount < AT_SIM_CHUNKS) {
+      chunks[(chunkHead + chunkCount++) % AT_SIM_CHUNKS] = Chunk{ outTail, releaseUs };
+    } else {
+      chunks[(chunkHead + AT_SIM_CHUNKS - 1) % AT_SIM_CHUNKS].end = outTail;
+    }
+    lastReleaseUs = releaseUs;
+  }
+
+  void reply(const char *text, uint64_t releaseUs) {
+    queue((const uint8_t *)text, strlen(text), releaseUs);
+  }
+
+  void reply(const char *text) { reply(text, hostNowUs() + (uint64_t)latencyMs * 1000); }
+
+  // Make the replies that are due readable
+  void release() {
+    uint64_t now = hostNowUs();
+    while (chunkCount > 0 && chunks[chunkHead].releaseUs <= now) {
+      visible = chunks[chunkHead].end;
+      chunkHead = (chunkHead + 1) % AT_SIM_CHUNKS;
+      chunkCount--;
+    }
+  }
+
+  // ---- Transcript ----
+  const AtStep *current() const { return next < stepCount ? &steps[next] : NULL; }
+
+  // Answer with the current step, then the URCs after it
+  void answer(const AtStep &step) {
+    next++;
+    reply(step.reply, hostNowUs() + (uint64_t)step.latencyMs * 1000);
+    queueUrcs();
+  }
+
+  void queueUrcs() {
+    while (current() != NULL && current()->expect == NULL) {
+      const AtStep &step = steps[next++];
+      reply(step.reply, lastReleaseUs + (uint64_t)step.latencyMs * 1000);
+    }
+  }
+
+  void command(const char *cmd) {
+    snprintf(log[logCount % AT_SIM_LOG_SIZE], AT_SIM_LINE_SIZE, "%s", cmd);
+    logCount++;
+
+    const AtStep *step = current();
+    if (step != NULL && strcmp(step->expect, AT_PAYLOAD) != 0 && startsWith(cmd, step->expect)) {
+      uint8_t index = next;
+      answer(*step);
+      follow(cmd, index);
+      return;
+    }
+    if (socketCommand(cmd)) {
+      return;
+    }
+    if (failure[0] == '\0') {
+      snprintf(failure, sizeof(failure), "expected \"%s\", got \"%s\"",
+               step != NULL ? step->expect : "end of transcript", cmd);
+    }
+    reply("\r\nERROR\r\n");
+  }
+
+  // Keep the sockets in step with the transcript answer steps[index]
+  void follow(const char *cmd, uint8_t index) {
+    unsigned mux = 0, length = 0;
+    if (sscanf(cmd, "AT+CIPSTART=%u", &mux) == 1 && mux < AT_SIM_SOCKETS) {
+      // The CONNECT OK is in the answer or in a URC right after it
+      for (uint8_t i = index; i < next; i++) {
+        if (strstr(steps[i].reply, "CONNECT OK") != NULL) {
+          opened(mux, cmd);
+          break;
+        }
+      }
+    } else if (sscanf(cmd, "AT+CIPSEND=%u,%u", &mux, &length) == 2 && strchr(steps[index].reply, '>') != NULL) {
+      startPayload(mux, length);
+    } else if (sscanf(cmd, "AT+CIPCLOSE=%u", &mux) == 1 && mux < AT_SIM_SOCKETS) {
+      sockets[mux].open = false;
+    }
+  }
+
+  // ---- Sockets ----
+  bool socketCommand(const char *cmd) {
+    unsigned mux = 0, length = 0;
+    char text[40];
+    if (sscanf(cmd, "AT+CIPSTART=%u", &mux) == 1 && mux < AT_SIM_SOCKETS) {
+      if (sockets[mux].open) {
+        snprintf(text, sizeof(text), "\r\nERROR\r\n\r\n%u, ALREADY CONNECT\r\n", mux);
+        reply(text);
+        return true;
+      }
+      reply("\r\nOK\r\n");
+      snprintf(text, sizeof(text), "\r\n%u, CONNECT OK\r\n", mux);
+      reply(text);
+      opened(mux, cmd);
+      return true;
+    }
+    if (sscanf(cmd, "AT+CIPSEND=%u,%u", &mux, &length) == 2 && mux < AT_SIM_SOCKETS) {
+      if (!sockets[mux].open || length == 0 || length > AT_SIM_SEND_SIZE) {
+        reply("\r\nERROR\r\n");
+        return true;
+      }
+      reply("\r\n> ");
+      startPayload(mux, length);
+      return true;
+    }
+    if (sscanf(cmd, "AT+CIPSTATUS=%u", &mux) == 1 && mux < AT_SIM_SOCKETS) {
+      char status[96];
+      snprintf(status, sizeof(status), "\r\n+CIPSTATUS: %u,0,\"TCP\",\"%s\",\"80\",\"%s\"\r\n\r\nOK\r\n",
+               mux, sockets[mux].host, sockets[mux].open ? "CONNECTED" : "CLOSED");
+      reply(status);
+      return true;
+    }
+    if (sscanf(cmd, "AT+CIPCLOSE=%u", &mux) == 1 && mux < AT_SIM_SOCKETS) {
+      if (sockets[mux].open) {
+        snprintf(text, sizeof(text), "\r\n%u, CLOSE OK\r\n", mux);
+        reply(text);
+        sockets[mux].open = false;
+      } else {
+        reply("\r\nERROR\r\n");
+      }
+      return true;
+    }
+    return false;
+  }
+
+  void opened(unsigned mux, const char *cmd) {
+    Socket &socket = sockets[mux];
+    socket.open = true;
+    socket.connects++;
+    // AT+CIPSTART=0,"TCP","host",80
+    const char *start = strchr(cmd, ',');
+    start = start != NULL ? strchr(start + 1, ',') : NULL;
+    socket.host[0] = '\0';
+    if (start != NULL && start[1] == '"') {
+      const char *end = strchr(start + 2, '"');
+      size_t n = end != NULL ? (size_t)(end - start - 2) : 0;
+      if (n >= sizeof(socket.host)) n = sizeof(socket.host) - 1;
+      memcpy(socket.host, start + 2, n);
+      socket.host[n] = '\0';
+    }
+    if (socket.server != NULL) {
+      socket.server->opened(*this, mux);
+    }
+  }
+
+  void startPayload(unsigned mux, unsigned length) {
+    payloadMux = (uint8_t)mux;
+    payloadLeft = length < AT_SIM_SEND_SIZE ? length : AT_SIM_SEND_SIZE;
+    payloadLength = 0;
+  }
+
+  void payloadDone() {
+    char text[32];
+    bool delivered = true;
+    const AtStep *step = current();
+    if (step != NULL && step->expect != NULL && strcmp(step->expect, AT_PAYLOAD) == 0) {
+      answer(*step);
+      delivered = strstr(step->reply, "SEND OK") != NULL;
+    } else {
+      snprintf(text, sizeof(text), "\r\n%u, SEND OK\r\n", payloadMux);
+      reply(text);
+    }
+    if (delivered) {
+      Socket &socket = sockets[payloadMux];
+      socket.sends++;
+      socket.bytes += payloadLength;
+      if (socket.server != NULL) {
+        socket.server->received(*this, payloadMux, payload, payloadLength);
+      }
+    }
+  }
+
+  const AtStep *steps;
+  uint8_t stepCount;
+  uint8_t next;
+
+  uint8_t out[AT_SIM_OUT_SIZE];
+  uint32_t outHead, outTail, visible;
+  Chunk chunks[AT_SIM_CHUNKS];
+  uint8_t chunkHead, chunkCount;
+  uint64_t lastReleaseUs;
+  unsigned long latencyMs;
+  uint16_t dropSkip, dropCount;
+  bool dropReceived;
+
+  char line[AT_SIM_LINE_SIZE];
+  size_t lineLength;
+  uint8_t payload[AT_SIM_SEND_SIZE];
+  size_t payloadLeft, payloadLength;
+  uint8_t payloadMux;
+
+  char log[AT_SIM_LOG_SIZE][AT_SIM_LINE_SIZE];
+  uint16_t logCount;
+  uint32_t wire;
+  char failure[160];
+  Socket sockets[AT_SIM_SOCKETS];
+};
+
+
+/*
+HttpServer - Harvest behind a socket. Collects the request until the headers
+and Content-Length bytes of body are in, then answers with `response`.
+*/
+class HttpServer : public AtServer {
+public:
+  explicit HttpServer(const char *response, unsigned long latencyMs = 300)
+    : response(response), latencyMs(latencyMs), closeAfter(false),
+      requestCount(0), length(0), lastLength(0), bodyAt(0) {}
+
+  void opened(AtSim &, uint8_t) override { length = 0; }
+
+  void received(AtSim &sim, uint8_t mux, const uint8_t *data, size_t size) override {
+    for (size_t i = 0; i < size && length < sizeof(request); i++) {
+      request[length++] = (char)data[i];
+    }
+
+    size_t end = headerEnd();
+    if (end == 0) {
+      return;
+    }
+    size_t body = 0;
+    for (size_t i = 0; i + 16 < end; i++) {
+      if (strncmp(request + i, "Content-Length: ", 16) == 0) {
+        body = (size_t)atol(request + i + 16);
+      }
+    }
+    if (length - end < body) {
+      return;
+    }
+    memcpy(last, request, length);
+    lastLength = length;
+    last[lastLength] = '\0';
+    bodyAt = end;
+    length = 0;
+    requestCount++;
+    sim.receive(mux, response, latencyMs);
+    if (closeAfter) {
+      sim.closeSocket(mux, latencyMs + 10);
+    }
+  }
+
+  // Requests answered, and the last one (headers as text, the body may be binary)
+  uint16_t requests() const { return requestCount; }
+  const char *lastRequest() const { return last; }
+  const uint8_t *lastBody() const { return (const uint8_t *)last + bodyAt; }
+  size_t lastBodyLength() const { return lastLength - bodyAt; }
+
+  const char *response;
+  unsigned long latencyMs;
+  bool closeAfter;      // hang up after every answer, like "Connection: close"
+
+private:
+  // Offset of the body, 0 while the headers are not complete
+  size_t headerEnd() const {
+    for (size_t i = 0; i + 4 <= length; i++) {
+      if (memcmp(request + i, "\r\n\r\n", 4) == 0) {
+        return i + 4;
+      }
+    }
+    return 0;
+  }
+
+  uint16_t requestCount;
+  char request[1024];
+  size_t length;
+  char last[1025];
+  size_t lastLength;
+  size_t bodyAt;
+};
+
+
+/*
+RangeServer - A file server behind a socket, like the one the OTA update
+downloads from. Answers "GET <path>" with the whole file (200), or with the
+bytes of a "Range: bytes=<first>-<last>" header (206). Other paths get 404.
+The body goes out in "+RECEIVE" URCs of up to AT_SIM_SEND_SIZE bytes.
+*/
+class RangeServer : public AtServer {
+public:
+  struct File {
+    const char *path;
+    const uint8_t *data;
+    size_t size;
+  };
+
+  // files must outlive the server
+  RangeServer(const File *files, uint8_t count, unsigned long latencyMs = 300)
+    : latencyMs(latencyMs), closeAfter(false), dropRequest(0), dropAfter(0),
+      files(files), fileCount(count), length(0) { clear(); }
+
+  void opened(AtSim &, uint8_t) override { length = 0; }
+
+  void received(AtSim &sim, uint8_t mux, const uint8_t *data, size_t size) override {
+    for (size_t i = 0; i < size && length + 1 < sizeof(request); i++) {
+      request[length++] = (char)data[i];
+    }
+    request[length] = '\0';
+    if (strstr(request, "\r\n\r\n") != NULL) {
+      answer(sim, mux);
+      length = 0;
+    }
+  }
+
+  void clear() {
+    requestCount = 0;
+    sent = 0;
+  }
+
+  uint16_t requests() const { return requestCount; }
+  uint32_t bodyBytes() const { return sent; }       // Body bytes sent, also of cut answers
+
+  unsigned long latencyMs;
+  bool closeAfter;      // hang up after every answer, like "Connection: close"
+  uint16_t dropRequest; // hang up in the middle of this answer (1 is the first), once, 0 never
+  size_t dropAfter;     // body bytes of that answer sent before
+
+private:
+  void answer(AtSim &sim, uint8_t mux) {
+    requestCount++;
+    char path[64] = "";
+    sscanf(request, "GET %63s", path);
+    const File *file = NULL;
+    for (uint8_t i = 0; i < fileCount; i++) {
+      if (strcmp(files[i].path, path) == 0) {
+        file = &files[i];
+      }
+    }
+    char head[160];
+    const char *connection = closeAfter ? "Connection: close\r\n" : "";
+    if (file == NULL) {
+      snprintf(head, sizeof(head), "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n%s\r\n", connection);
+      sim.receive(mux, head, latencyMs);
+      hangUp(sim, mux);
+      return;
+    }
+
+    unsigned long first = 0, last = file->size - 1;
+    const char *range = strstr(request, "Range: bytes=");
+    bool partial = range != NULL && sscanf(range, "Range: bytes=%lu-%lu", &first, &last) == 2;
+    if (last >= file->size) {
+      last = file->size - 1;
+    }
+    size_t size = first <= last ? last - first + 1 : 0;
+    if (partial) {
+      snprintf(head, sizeof(head), "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes %lu-%lu/%u\r\n"
+               "Content-Length: %u\r\n%s\r\n", first, last, (unsigned)file->size, (unsigned)size, connection);
+    } else {
+      snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n%s\r\n",
+               (unsigned)file->size, connection);
+    }
+    sim.receive(mux, head, latencyMs);
+
+    bool drop = requestCount == dropRequest && dropAfter < size;
+    size_t send = drop ? dropAfter : size;
+    if (drop) {
+      dropRequest = 0;    // once
+    }
+    for (size_t at = 0; at < send; at += AT_SIM_SEND_SIZE) {
+      size_t piece = send - at < AT_SIM_SEND_SIZE ? send - at : AT_SIM_SEND_SIZE;
+      sim.receive(mux, file->data + first + at, piece, latencyMs);
+    }
+    sent += send;
+    if (drop) {
+      sim.closeSocket(mux, latencyMs + 10);
+    } else {
+      hangUp(sim, mux);
+    }
+  }
+
+  void hangUp(AtSim &sim, uint8_t mux) {
+    if (closeAfter) {
+      sim.closeSocket(mux, latencyMs + 10);
+    }
+  }
+
+  const File *files;
+  uint8_t fileCount;
+  uint16_t requestCount;
+  uint32_t sent;
+  char request[512];
+  size_t length;
+};
+
+
+// SinkServer - Takes whatever is sent and keeps it, sends one after the other
+class SinkServer : public AtServer {
+public:
+  SinkServer() { clear(); }
+
+  void received(AtSim &, uint8_t, const uint8_t *bytes, size_t size) override {
+    sendCount++;
+    lastSize = size;
+    for (size_t i = 0; i < size && length < sizeof(data); i++) {
+      data[length++] = bytes[i];
+    }
+  }
+
+  void clear() {
+    sendCount = 0;
+    length = lastSize = 0;
+  }
+
+  uint16_t sends() const { return sendCount; }
+  const uint8_t *bytes() const { return data; }
+  size_t size() const { return length; }
+  size_t lastSendSize() const { return lastSize; }
+
+private:
+  uint16_t sendCount;
+  uint8_t data[2048];
+  size_t length;
+  size_t lastSize;
+};
+
+#endif
+// GC_AT_SIM_H
@@ -0,0 +1,73 @@
+/*
+GreenCampus SmartDumpster - Host tests
+- FloatFullness.h
+
+The floating point fullness model that GC_Geometry.h replaced, as the
+reference for the Q14 code:
+
+  h15 = H - dist15 * sin(15°)    h60 = H - (dist60 * sin(60°) + offsetHeight60)
+  x15 = L - dist15 * cos(15°)    x60 = L - dist60 * cos(60°)
+  if dist60 <= defaultD60 * 0.85:
+    vol = h60 * W * x60
+    if dist15 <= defaultD15 * 0.85:
+      vol = h60 * W * x60 + (x60 + x15) * (h15 - h60) / 2 * W
+  fullness = vol / total * 100
+
+floatFullness() does it in double with nothing rounded until the end.
+oldFullness() is the GetFullPer() of GC_Uno.cpp before GC_Geometry.h: float
+trig (double is float on the Uno) and h, x and the volumes kept in longs.
+
+Both return the fullness clamped to 0-100 like fullnessFromDistances().
+*/
+
+#ifndef GC_FLOAT_FULLNESS_H
+#define GC_FLOAT_FULLNESS_H
+
+#include <GC_Geometry.h>
+
+#include <math.h>
+
+// The exact model, in double
+inline double floatFullness(const DumpsterGeometry &g, long raw15, long raw60) {
+  double dist15 = raw15 + g.offsetDist15;
+  double dist60 = raw60 + g.offsetDist60;
+  double h15 = g.height - dist15 * sin(15 * GC_PI / 180);
+  double h60 = g.height - (dist60 * sin(60 * GC_PI / 180) + g.offsetHeight60);
+  double x15 = g.len - dist15 * cos(15 * GC_PI / 180);
+  double x60 = g.len - dist60 * cos(60 * GC_PI / 180);
+
+  double volume = 0;
+  if (dist60 <= g.defaultD60 * 0.85) {
+    volume = h60 * g.width * x60;
+    if (dist15 <= g.defaultD15 * 0.85) {
+      volume += (x60 + x15) * (h15 - h60) / 2 * g.width;
+    }
+  }
+  double fullness = volume / g.totalVolume * 100;
+  return fullness < 0 ? 0 : (fullness > 100 ? 100 : fullness);
+}
+
+// The old firmware, float trig and long variables
+inline long oldFullness(const DumpsterGeometry &g, long raw15, long raw60) {
+  long dist15 = raw15 + g.offsetDist15;
+  long dist60 = raw60 + g.offsetDist60;
+  long h15 = g.height - (dist15 * sinf(15 * (float)GC_PI / 180));
+  long h60 = g.height - (dist60 * sinf(60 * (float)GC_PI / 180) + g.offsetHeight60);
+  long x15 = g.len - (dist15 * cosf(15 * (float)GC_PI / 180));
+  long x60 = g.len - (dist60 * cosf(60 * (float)GC_PI / 180));
+
+  long trashVolume = 0;
+  if (dist60 <= g.defaultD60 * 0.85f) {
+    trashVolume = h60 * g.width * x60;
+    if (dist15 <= g.defaultD15 * 0.85f) {
+      long bottomVol = h60 * g.width * x60;
+      long topVol = (x60 + x15) * (h15 - h60) / 2 * g.width;
+      trashVolume = topVol + bottomVol;
+    }
+  }
+  long fullness = ((float)trashVolume / (float)g.totalVolume) * 100;
+  return fullness < 0 ? 0 : (fullness > 100 ? 100 : fullness);
+}
+
+#endif
+// GC_FLOAT_FULLNESS_H
@@ -0,0 +1,123 @@
+/*
+GreenCampus SmartDumpster - Host tests
+- GcTest.h
+
+The few pieces every test file needs, no test framework:
+
+  GC_TEST(name)     defines a test, it runs when the file's main() calls
+                    gcRunTests()
+  CHECK(cond)       counts a failure and prints where, the test goes on
+  CHECK_EQ(a, b)    same, prints both values (as long)
+  RamStore          byte storage for the Store-templated classes
+                    (ReadingQueue, CalibrationStore, ...), EEPROM in RAM
+
+Each test file is its own executable and its own ctest test.
+*/
+
+#ifndef GC_TEST_H
+#define GC_TEST_H
+
+#include <Arduino.h>
+
+#define GC_TEST_MAX         64
+#define GC_TEST_STORE_SIZE  4096
+
+namespace gc_test {
+  struct Test {
+    const char *name;
+    void (*run)();
+  };
+
+  inline Test *tests() {
+    static Test list[GC_TEST_MAX];
+    return list;
+  }
+  inline uint8_t &testCount() {
+    static uint8_t count = 0;
+    return count;
+  }
+  inline unsigned &failures() {
+    static unsigned count = 0;
+    return count;
+  }
+
+  struct Registrar {
+    Registrar(const char *name, void (*run)()) {
+      if (testCount() < GC_TEST_MAX) {
+        tests()[testCount()++] = Test{ name, run };
+      }
+    }
+  };
+
+  inline bool check(bool ok, const char *what, const char *file, int line) {
+    if (!ok) {
+      printf("    FAILED %s:%d: %s\n", file, line, what);
+      failures()++;
+    }
+    return ok;
+  }
+
+  inline bool checkEq(long a, long b, const char *what, const char *file, int line) {
+    if (a != b) {
+      printf("    FAILED %s:%d: %s (%ld != %ld)\n", file, line, what, a, b);
+      failures()++;
+    }
+    return a == b;
+  }
+}
+
+#define GC_TEST(name) \
+  static void name(); \
+  static gc_test::Registrar name##Registrar(#name, name); \
+  static void name()
+
+#define CHECK(cond)     gc_test::check((cond), #cond, __FILE__, __LINE__)
+#define CHECK_EQ(a, b)  gc_test::checkEq((long)(a), (long)(b), #a " == " #b, __FILE__, __LINE__)
+
+// Run every GC_TEST of the file, returns the exit code for main()
+inline int gcRunTests() {
+  for (uint8_t i = 0; i < gc_test::testCount(); i++) {
+    unsigned before = gc_test::failures();
+    gc_test::tests()[i].run();
+    printf("%-6s %s\n", gc_test::failures() == before ? "ok" : "FAIL", gc_test::tests()[i].name);
+  }
+  printf("%u failure(s)\n", gc_test::failures());
+  return gc_test::failures() == 0 ? 0 : 1;
+}
+
+/*
+RamStore - EEPROM in RAM, with the static begin/read/write/commit functions
+of EepromStore (GC_Queue.h). Erased bytes read 0xFF, like a new EEPROM.
+Counts writes and commits, so tests can check the wear.
+*/
+struct RamStore {
+  static uint8_t *bytes() {
+    static uint8_t data[GC_TEST_STORE_SIZE];
+    return data;
+  }
+  static uint32_t &writes() {
+    static uint32_t count = 0;
+    return count;
+  }
+  static uint32_t &commits() {
+    static uint32_t count = 0;
+    return count;
+  }
+
+  static void begin(int) {}
+  static uint8_t read(int addr) { return bytes()[addr]; }
+  static void write(int addr, uint8_t value) {
+    bytes()[addr] = value;
+    writes()++;
+  }
+  static void commit() { commits()++; }
+
+  // Back to a new EEPROM
+  static void erase() {
+    memset(bytes(), 0xFF, GC_TEST_STORE_SIZE);
+    writes() = commits() = 0;
+  }
+};
+
+#endif
+// GC_TEST_H
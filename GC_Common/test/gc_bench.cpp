@@ -0,0 +1,337 @@
+/*
+GreenCampus SmartDumpster - Host benchmark
+- gc_bench.cpp
+
+Times the hot paths of the firmware on the PC, with the GC_Common headers and
+the stand-ins in host/:
+
+- A02 parsing, byte by byte and through a port (A02Parser, DistanceSensor)
+- DistanceFilter::update at several window sizes, its worst case and a
+  median that sorts a copy of the window instead
+- the fullness model (fullnessFromDistances, fillVolume, GetFullPer), and
+  the floating point model it replaced (FloatFullness.h)
+- JSON against binary serialization of one reading
+- the upload path, a report through HarvestSession to a loopback client
+
+The times are PC times. They show how the paths compare with each other and
+catch regressions, they are not Uno or ESP32 cycle counts. Bytes and calls
+per report are the same as on the boards.
+
+On x86 the fullness cases also print cycles per call from rdtsc. Those are
+host TSC cycles: the PC has an FPU and does a float multiply in a few cycles,
+the Uno has none and needs over a hundred, so the Q14/float ratio on the PC
+is far smaller than on the board.
+
+Usage: gc_bench [--quick]
+  --quick  run every case with few iterations, used by ctest
+*/
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <GC_A02.h>
+#include <GC_Filter.h>
+#include <GC_Geometry.h>
+#include <GC_Sensor.h>
+#include <GC_Telemetry.h>
+#include <GC_Soracom.h>
+
+#include "FloatFullness.h"
+
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define GC_BENCH_RDTSC
+#endif
+
+// ======================== HELPERS ========================
+namespace {
+  uint32_t iterations = 1000000;
+  volatile long sink;     // keeps the compiler from dropping the work
+
+  // Nanoseconds per call of f, over n calls
+  template <typename F>
+  double nsPer(uint32_t n, F f) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < n; i++) {
+      f(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / n;
+  }
+
+#if defined(GC_BENCH_RDTSC)
+  // Host TSC cycles per call of f, over n calls
+  template <typename F>
+  double cyclesPer(uint32_t n, F f) {
+    uint64_t start = __rdtsc();
+    for (uint32_t i = 0; i < n; i++) {
+      f(i);
+    }
+    return (double)(__rdtsc() - start) / n;
+  }
+#endif
+
+  void row(const char *name, double value, const char *unit) {
+    printf("  %-44s %12.1f %s\n", name, value, unit);
+  }
+
+  // One A02 frame for a distance in mm
+  void a02Frame(uint16_t mm, uint8_t *out) {
+    out[0] = A02_FRAME_HEADER;
+    out[1] = mm >> 8;
+    out[2] = mm & 0xFF;
+    out[3] = (uint8_t)(out[0] + out[1] + out[2]);
+  }
+
+  const DumpsterGeometry bench = dumpsterGeometry(36, 24, 36, 4, 2, 3);
+
+  TelemetryRecord sampleRecord() {
+    TelemetryRecord r = { 1, 42, 71, 40, GC_HEALTH_OK | GC_HEALTH_SENSOR15 | GC_HEALTH_SENSOR60, 7, 0 };
+    return r;
+  }
+}
+
+/*
+LoopbackClient - A Client that is always connected and answers every request
+with an empty 201, as Harvest does. Counts what is written to it.
+*/
+class LoopbackClient : public Stream {
+public:
+  LoopbackClient() : open(false), writes(0), bytes(0) {}
+
+  int connect(const char *, uint16_t) { open = true; return 1; }
+  bool connected() { return open; }
+  void stop() { open = false; }
+
+  using Print::write;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *, size_t size) override {
+    writes++;
+    bytes += size;
+    return size;
+  }
+  void flush() override { response.feed("HTTP/1.1 201 Created\r\nContent-Length: 0\r\n\r\n"); }
+
+  int available() override { return response.available(); }
+  int read() override { return response.read(); }
+  int peek() override { return response.peek(); }
+
+  bool open;
+  uint32_t writes;      // write() calls, each one is an AT+CIPSEND on the modem
+  uint32_t bytes;
+
+private:
+  HostPort response;
+};
+
+// ======================== BENCHMARKS ========================
+static void benchA02() {
+  printf("A02 parsing\n");
+  const uint16_t count = 256;
+  static uint8_t stream[count * A02_FRAME_SIZE];
+  for (uint16_t i = 0; i < count; i++) {
+    a02Frame(200 + (i * 37) % 4000, stream + i * A02_FRAME_SIZE);
+  }
+
+  A02Parser parser;
+  double ns = nsPer(iterations / 4, [&](uint32_t i) {
+    const uint8_t *frame = stream + (i % count) * A02_FRAME_SIZE;
+    for (uint8_t b = 0; b < A02_FRAME_SIZE; b++) {
+      parser.push(frame[b]);
+    }
+    sink = parser.distanceMm();
+  });
+  row("A02Parser::push, per frame", ns, "ns");
+  row("A02Parser frames per CPU second", 1e9 / ns, "frames/s");
+
+  HardwareSerial port;
+  DistanceSensor<HardwareSerial> sensor(port);
+  ns = nsPer(iterations / 4, [&](uint32_t i) {
+    port.feed(stream + (i % count) * A02_FRAME_SIZE, A02_FRAME_SIZE);
+    sink = sensor.poll() ? sensor.inches() : -1;
+  });
+  row("DistanceSensor::poll, per frame", ns, "ns");
+}
+
+/*
+SortedMedian - The straightforward window median: keep the ring and
+insertion sort a copy of it on every reading, O(N^2). The reference for the
+O(N) sorted insert of DistanceFilter.
+*/
+template <uint8_t N>
+class SortedMedian {
+public:
+  SortedMedian() : count(0), head(0) {}
+
+  int16_t update(int16_t reading) {
+    ring[head] = reading;
+    head = (head + 1) % N;
+    if (count < N) count++;
+
+    int16_t sorted[N];
+    for (uint8_t i = 0; i < count; i++) {
+      int16_t r = ring[i];
+      uint8_t j = i;
+      while (j > 0 && sorted[j - 1] > r) {
+        sorted[j] = sorted[j - 1];
+        j--;
+      }
+      sorted[j] = r;
+    }
+    return sorted[(count - 1) / 2];
+  }
+
+private:
+  int16_t ring[N];
+  uint8_t count, head;
+};
+
+template <uint8_t N>
+static void benchFilter(const char *name) {
+  printf("  window %u\n", N);
+  DistanceFilter<N> filter(5, 200);
+  double ns = nsPer(iterations, [&](uint32_t i) {
+    // Slow drift with noise and a spike every 50 readings
+    int16_t reading = 80 + (int16_t)((i / 1000) % 40) + (int16_t)(i % 3);
+    if (i % 50 == 0) reading += 60;
+    sink = filter.update(reading);
+  });
+  row(name, ns, "ns");
+
+  // Every reading accepted and smaller than the whole window: the oldest
+  // (largest) is found at the far end and the new one shifts every slot
+  DistanceFilter<N> accepting(5, 200, 200);
+  ns = nsPer(iterations, [&](uint32_t i) {
+    sink = accepting.update(200 - (int16_t)(i % 190));
+  });
+  row("  worst case, every slot shifted", ns, "ns");
+
+  SortedMedian<N> sorting;
+  ns = nsPer(iterations, [&](uint32_t i) {
+    sink = sorting.update(200 - (int16_t)(i % 190));
+  });
+  row("  sorting a copy, median only, same readings", ns, "ns");
+}
+
+static void benchFullness() {
+  printf("Fullness\n");
+  double ns = nsPer(iterations, [](uint32_t i) {
+    sink = fullnessFromDistances(bench, 10 + i % 40, 10 + (i / 7) % 40).fullness;
+  });
+  row("fullnessFromDistances", ns, "ns");
+  ns = nsPer(iterations, [](uint32_t i) {
+    sink = oldFullness(bench, 10 + i % 40, 10 + (i / 7) % 40);
+  });
+  row("old float GetFullPer model", ns, "ns");
+  ns = nsPer(iterations, [](uint32_t i) {
+    sink = (long)floatFullness(bench, 10 + i % 40, 10 + (i / 7) % 40);
+  });
+  row("exact double model", ns, "ns");
+#if defined(GC_BENCH_RDTSC)
+  double cycles = cyclesPer(iterations, [](uint32_t i) {
+    sink = fullnessFromDistances(bench, 10 + i % 40, 10 + (i / 7) % 40).fullness;
+  });
+  row("fullnessFromDistances, host cycles", cycles, "cycles");
+  cycles = cyclesPer(iterations, [](uint32_t i) {
+    sink = oldFullness(bench, 10 + i % 40, 10 + (i / 7) % 40);
+  });
+  row("old float GetFullPer model, host cycles", cycles, "cycles");
+#endif
+
+  const SensorMount mounts[5] = {
+    sensorMount(75, 2, 3, gcFloorDistance(33, 75)),
+    sensorMount(60, 2, 3, gcFloorDistance(33, 60)),
+    sensorMount(45, 3, 0, gcWallDistance(36, 45)),
+    sensorMount(30, 3, 0, gcWallDistance(36, 30)),
+    sensorMount(15, 4, 0, gcWallDistance(36, 15)),
+  };
+  ns = nsPer(iterations, [&](uint32_t i) {
+    const long raw[5] = { 10 + (long)(i % 20), 12 + (long)(i % 25), 15 + (long)(i % 30), 18, 30 };
+    sink = fillVolume(bench, mounts, raw, 5);
+  });
+  row("fillVolume, 5 sensors", ns, "ns");
+
+  HardwareSerial port15, port60;
+  uint8_t frame15[A02_FRAME_SIZE], frame60[A02_FRAME_SIZE];
+  a02Frame(700, frame15);
+  a02Frame(500, frame60);
+  ns = nsPer(iterations / 20, [&](uint32_t) {
+    port15.feed(frame15, A02_FRAME_SIZE);
+    port60.feed(frame60, A02_FRAME_SIZE);
+    Serial.clearWritten();
+    sink = GetFullPer(Serial, port15, port60, bench);
+  });
+  row("GetFullPer, frames waiting, with debug prints", ns, "ns");
+}
+
+static void benchPayload() {
+  printf("Payload\n");
+  TelemetryRecord record = sampleRecord();
+  char json[256];
+  size_t jsonLength = 0;
+  double ns = nsPer(iterations / 4, [&](uint32_t i) {
+    StaticJsonDocument<256 + GC_METRICS_JSON_SIZE> doc;
+    record.seq = (uint8_t)i;
+    telemetryToJson(record, doc);
+    jsonLength = serializeJson(doc, json, sizeof(json));
+    sink = jsonLength;
+  });
+  row("JSON: telemetryToJson + serializeJson", ns, "ns");
+  row("JSON: bytes per reading", jsonLength, "bytes");
+
+  uint8_t binary[GC_TELEMETRY_SIZE];
+  ns = nsPer(iterations, [&](uint32_t i) {
+    record.seq = (uint8_t)i;
+    sink = encodeTelemetry(record, binary);
+  });
+  row("binary: encodeTelemetry", ns, "ns");
+  row("binary: bytes per reading", GC_TELEMETRY_SIZE, "bytes");
+}
+
+static void benchUpload() {
+  printf("Upload (HarvestSession, loopback client)\n");
+  HostPort modemPort;
+  TinyGsm modem(modemPort);
+  LoopbackClient client;
+  HarvestSession<TinyGsm, LoopbackClient> harvest(modem, client);
+  TelemetryRecord record = sampleRecord();
+  uint32_t n = iterations / 20;
+
+  client.writes = client.bytes = 0;
+  double ns = nsPer(n, [&](uint32_t) {
+    StaticJsonDocument<256 + GC_METRICS_JSON_SIZE> doc;
+    telemetryToJson(record, doc);
+    Serial.clearWritten();
+    sink = harvest.post(Serial, doc);
+  });
+  row("JSON report", ns, "ns");
+  row("JSON report: bytes written", (double)client.bytes / n, "bytes");
+  row("JSON report: write() calls", (double)client.writes / n, "calls");
+
+  client.writes = client.bytes = 0;
+  ns = nsPer(n, [&](uint32_t) {
+    uint8_t payload[GC_TELEMETRY_SIZE];
+    encodeTelemetry(record, payload);
+    Serial.clearWritten();
+    sink = harvest.post(Serial, payload, sizeof(payload));
+  });
+  row("binary report", ns, "ns");
+  row("binary report: bytes written", (double)client.bytes / n, "bytes");
+  row("binary report: write() calls", (double)client.writes / n, "calls");
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--quick") == 0) {
+    iterations = 2000;
+  }
+
+  benchA02();
+  printf("DistanceFilter::update\n");
+  benchFilter<5>("  drift, noise, spikes");
+  benchFilter<15>("  drift, noise, spikes");
+  benchFilter<31>("  drift, noise, spikes");
+  benchFullness();
+  benchPayload();
+  benchUpload();
+  return 0;
+}
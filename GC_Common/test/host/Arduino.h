@@ -0,0 +1,231 @@
+/*
+GreenCampus SmartDumpster - Host build
+- Arduino.h
+
+Just enough of the Arduino core to build the GC_Common headers on a PC, for
+the tests and the benchmark in GC_Common/test. Not part of the firmware, the
+sketches are still built with the Arduino IDE.
+
+Time is simulated. millis() and micros() read a clock that delay() moves
+forward, and every read moves it on by GC_HOST_TICK_US, so the busy-wait loops
+of the firmware (readLine, DistanceSensor::read, ...) still reach their
+timeouts. hostAdvanceMs() moves it from a test. Benchmarks measure with the
+PC's own clock instead.
+
+HostPort is the serial port of the host build: bytes the firmware reads are
+queued with feed(), bytes it writes are kept (or dropped) and counted.
+HardwareSerial and SoftwareSerial are HostPorts.
+*/
+
+#ifndef GC_HOST_ARDUINO_H
+#define GC_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+
+// ======================== CONSTANTS ========================
+#define LOW       0
+#define HIGH      1
+#define INPUT     0
+#define OUTPUT    1
+
+#define A0        14
+
+#define F(s)      (s)
+
+#define GC_HOST_TICK_US       10        // Clock step of every millis()/micros() read
+#define GC_HOST_PORT_SIZE     1024      // Bytes a HostPort holds in each direction
+
+// ======================== TIME ========================
+namespace gc_host {
+  inline uint64_t &clockUs() {
+    static uint64_t us = 0;
+    return us;
+  }
+}
+
+// Current simulated time without moving the clock, for the host classes
+inline uint64_t hostNowUs() { return gc_host::clockUs(); }
+inline void hostAdvanceMs(unsigned long ms) { gc_host::clockUs() += (uint64_t)ms * 1000; }
+
+inline unsigned long micros() {
+  gc_host::clockUs() += GC_HOST_TICK_US;
+  return (unsigned long)(uint32_t)gc_host::clockUs();
+}
+inline unsigned long millis() {
+  gc_host::clockUs() += GC_HOST_TICK_US;
+  return (unsigned long)(uint32_t)(gc_host::clockUs() / 1000);
+}
+inline void delay(unsigned long ms) { hostAdvanceMs(ms); }
+inline void delayMicroseconds(unsigned int us) { gc_host::clockUs() += us; }
+inline void yield() {}
+
+// ======================== PINS ========================
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+inline int analogRead(uint8_t) { return (int)(::random() & 0x3FF); }
+
+// ======================== RANDOM ========================
+inline void randomSeed(unsigned long seed) { srandom((unsigned int)seed); }
+inline long random(long howbig) { return howbig <= 0 ? 0 : ::random() % howbig; }
+inline long random(long howsmall, long howbig) {
+  return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+// ======================== STRING ========================
+// On the heap like the Arduino one, so test_heap.cpp sees a String that gets
+// into the report path
+class String {
+public:
+  String(const char *s = "") : buf(NULL) { set(s); }
+  String(const String &other) : buf(NULL) { set(other.buf); }
+  ~String() { free(buf); }
+  String &operator=(const String &other) {
+    if (this != &other) {
+      set(other.buf);
+    }
+    return *this;
+  }
+  const char *c_str() const { return buf; }
+  unsigned int length() const { return (unsigned int)strlen(buf); }
+  bool operator==(const char *s) const { return strcmp(buf, s) == 0; }
+
+private:
+  void set(const char *s) {
+    if (s == NULL) s = "";
+    char *copy = (char *)malloc(strlen(s) + 1);
+    strcpy(copy, s);
+    free(buf);
+    buf = copy;
+  }
+  char *buf;
+};
+
+// ======================== PRINT / STREAM ========================
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t size) {
+    size_t n = 0;
+    while (n < size && write(buf[n])) {
+      n++;
+    }
+    return n;
+  }
+  size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  virtual void flush() {}
+
+  // Like the Arduino core, a number is formatted first and written in one call
+  size_t print(const char *s) { return write(s); }
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int n) { return print((long)n); }
+  size_t print(unsigned int n) { return print((unsigned long)n); }
+  size_t print(long n) { return printFormat("%ld", n); }
+  size_t print(unsigned long n) { return printFormat("%lu", n); }
+  size_t print(double n, int digits = 2) { return printFormat("%.*f", digits, n); }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T &value) {
+    size_t n = print(value);
+    return n + println();
+  }
+
+private:
+  template <typename... Args>
+  size_t printFormat(const char *format, Args... args) {
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), format, args...);
+    return write((const uint8_t *)buf, n < 0 ? 0 : (size_t)n);
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+/*
+HostPort - A serial port of the host build.
+
+feed() queues bytes for the firmware to read. What the firmware writes is
+counted, and kept in a buffer the test can look at (written()) unless the
+port is set to echo it to stdout instead.
+*/
+class HostPort : public Stream {
+public:
+  HostPort() : rxHead(0), rxTail(0), txLength(0), txTotal(0), echo(false) {}
+
+  void begin(unsigned long) {}
+  void end() {}
+  operator bool() const { return true; }
+
+  // Queue bytes for the firmware to read, returns how many fit
+  size_t feed(const uint8_t *data, size_t length) {
+    size_t n = 0;
+    while (n < length && rxTail - rxHead < GC_HOST_PORT_SIZE) {
+      rx[rxTail++ % GC_HOST_PORT_SIZE] = data[n++];
+    }
+    return n;
+  }
+  size_t feed(const char *s) { return feed((const uint8_t *)s, strlen(s)); }
+
+  int available() override { return (int)(rxTail - rxHead); }
+  int read() override { return rxHead == rxTail ? -1 : rx[rxHead++ % GC_HOST_PORT_SIZE]; }
+  int peek() override { return rxHead == rxTail ? -1 : rx[rxHead % GC_HOST_PORT_SIZE]; }
+
+  using Print::write;
+  size_t write(uint8_t c) override {
+    txTotal++;
+    if (echo) {
+      fputc(c, stdout);
+    } else if (txLength + 1 < sizeof(tx)) {
+      tx[txLength++] = c;
+      tx[txLength] = '\0';
+    }
+    return 1;
+  }
+
+  // What the firmware wrote since clearWritten(), cut at the buffer size
+  const char *written() const { return txLength ? tx : ""; }
+  void clearWritten() { txLength = 0; tx[0] = '\0'; }
+  uint32_t bytesWritten() const { return txTotal; }
+
+  // Print what the firmware writes to stdout instead of keeping it
+  void setEcho(bool on) { echo = on; }
+
+  // Drop everything queued for reading
+  void clearInput() { rxHead = rxTail; }
+
+private:
+  uint8_t rx[GC_HOST_PORT_SIZE];
+  uint32_t rxHead, rxTail;
+  char tx[GC_HOST_PORT_SIZE];
+  size_t txLength;
+  uint32_t txTotal;
+  bool echo;
+};
+
+class HardwareSerial : public HostPort {
+public:
+  HardwareSerial() {}
+  explicit HardwareSerial(int) {}
+  void begin(unsigned long baud) { (void)baud; }
+  void begin(unsigned long baud, uint32_t, int8_t, int8_t) { (void)baud; }
+};
+
+// The serial monitor. Keeps its output, setEcho(true) prints it instead.
+inline HardwareSerial Serial;
+
+#endif
+// GC_HOST_ARDUINO_H
@@ -0,0 +1,782 @@
+/*
+GreenCampus SmartDumpster - Host build
+- ArduinoJson.h
+
+The part of the ArduinoJson 6 API the GC_Common headers use, for the host
+build only. The boards use the real library.
+
+Kept close to the real one where the tests depend on it:
+- StaticJsonDocument<N> keeps everything in its own N bytes, nothing is
+  allocated. When it is full, new values are dropped and overflowed() is set.
+- JSON_OBJECT_SIZE(n) and JSON_ARRAY_SIZE(n) are n slots, so the sizes
+  computed in the firmware mean the same here.
+- const char * values are linked, not copied. deserializeJson() copies the
+  strings of the input into the document.
+- serializeJson() to a Print writes one character at a time, like the real
+  library does without a buffering stream.
+- as<T>() returns 0 for a number that does not fit T, is<T>() is false.
+
+Supported: objects, arrays, integers, doubles, booleans, strings and null,
+StaticJsonDocument, JsonDocument, JsonObject, JsonArray, JsonArrayConst,
+JsonVariantConst, measureJson, serializeJson (Print or char buffer) and
+deserializeJson (const char *).
+*/
+
+#ifndef GC_HOST_ARDUINOJSON_H
+#define GC_HOST_ARDUINOJSON_H
+
+#include <Arduino.h>
+#include <errno.h>
+#include <limits>
+#include <type_traits>
+
+namespace gc_json {
+  enum Type : uint8_t { NUL, BOOL, INT, FLOAT, STR, OBJECT, ARRAY };
+
+  // One value, and its key when it is an object member. Ids are index + 1, 0 is none.
+  struct Slot {
+    const char *key;
+    union {
+      long i;
+      double f;
+      const char *s;
+      uint16_t child;   // first member or element
+    } v;
+    uint16_t next;      // next member or element of the parent
+    Type type;
+  };
+}
+
+#define JSON_OBJECT_SIZE(n)   ((n) * sizeof(gc_json::Slot))
+#define JSON_ARRAY_SIZE(n)    ((n) * sizeof(gc_json::Slot))
+
+namespace gc_json {
+  // Slots from the start of the buffer, strings from the end
+  class Pool {
+  public:
+    Pool(uint8_t *buf, size_t capacity) : buf(buf), capacity(capacity) { clear(); }
+
+    void clear() { slots = 0; strings = 0; overflow = false; }
+
+    Slot *slot(uint16_t id) const { return id ? (Slot *)buf + (id - 1) : NULL; }
+    uint16_t id(const Slot *s) const { return (uint16_t)(s - (Slot *)buf + 1); }
+
+    Slot *newSlot() {
+      if ((slots + 1) * sizeof(Slot) + strings > capacity) {
+        overflow = true;
+        return NULL;
+      }
+      Slot *s = (Slot *)buf + slots++;
+      memset(s, 0, sizeof(Slot));
+      return s;
+    }
+
+    char *newString(size_t length) {
+      if (slots * sizeof(Slot) + strings + length + 1 > capacity) {
+        overflow = true;
+        return NULL;
+      }
+      strings += length + 1;
+      return (char *)buf + capacity - strings;
+    }
+
+    size_t used() const { return slots * sizeof(Slot) + strings; }
+    bool overflowed() const { return overflow; }
+    size_t size() const { return capacity; }
+
+  private:
+    uint8_t *buf;
+    size_t capacity;
+    size_t slots;
+    size_t strings;
+    bool overflow;
+  };
+
+  inline void setNull(Slot *s) {
+    s->type = NUL;
+    s->v.i = 0;
+  }
+
+  // Append a new element to an array or object, NULL if the pool is full
+  inline Slot *append(Pool &pool, Slot *parent) {
+    Slot *s = pool.newSlot();
+    if (s == NULL) {
+      return NULL;
+    }
+    if (parent->v.child == 0) {
+      parent->v.child = pool.id(s);
+    } else {
+      Slot *last = pool.slot(parent->v.child);
+      while (last->next != 0) {
+        last = pool.slot(last->next);
+      }
+      last->next = pool.id(s);
+    }
+    return s;
+  }
+
+  inline Slot *member(const Pool &pool, const Slot *object, const char *key) {
+    if (object == NULL || object->type != OBJECT) {
+      return NULL;
+    }
+    for (Slot *s = pool.slot(object->v.child); s != NULL; s = pool.slot(s->next)) {
+      if (strcmp(s->key, key) == 0) {
+        return s;
+      }
+    }
+    return NULL;
+  }
+
+  inline Slot *element(const Pool &pool, const Slot *array, size_t index) {
+    if (array == NULL || array->type != ARRAY) {
+      return NULL;
+    }
+    Slot *s = pool.slot(array->v.child);
+    while (s != NULL && index-- > 0) {
+      s = pool.slot(s->next);
+    }
+    return s;
+  }
+
+  inline size_t count(const Pool &pool, const Slot *s) {
+    if (s == NULL || (s->type != ARRAY && s->type != OBJECT)) {
+      return 0;
+    }
+    size_t n = 0;
+    for (Slot *c = pool.slot(s->v.child); c != NULL; c = pool.slot(c->next)) {
+      n++;
+    }
+    return n;
+  }
+
+  // Find a member, or add it as null
+  inline Slot *memberOrAdd(Pool &pool, Slot *object, const char *key) {
+    if (object == NULL) {
+      return NULL;
+    }
+    if (object->type != OBJECT) {
+      object->type = OBJECT;
+      object->v.child = 0;
+    }
+    Slot *s = member(pool, object, key);
+    if (s == NULL && (s = append(pool, object)) != NULL) {
+      s->key = key;
+      setNull(s);
+    }
+    return s;
+  }
+
+  inline long toLong(const Slot *s) {
+    if (s == NULL) return 0;
+    switch (s->type) {
+      case BOOL:
+      case INT:   return s->v.i;
+      case FLOAT: return (long)s->v.f;
+      case STR:   return atol(s->v.s);
+      default:    return 0;
+    }
+  }
+
+  template <typename T>
+  bool fits(long value) {
+    if (std::is_signed<T>::value) {
+      return sizeof(T) >= sizeof(long) ||
+             (value >= (long)std::numeric_limits<T>::min() && value <= (long)std::numeric_limits<T>::max());
+    }
+    return value >= 0 && (sizeof(T) >= sizeof(long) ||
+                          (unsigned long)value <= (unsigned long)std::numeric_limits<T>::max());
+  }
+
+  template <typename T, typename Enable = void>
+  struct Converter;
+
+  template <typename T>
+  struct Converter<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+    static bool is(const Pool &, const Slot *s) { return s != NULL && s->type == INT && fits<T>(s->v.i); }
+    static T as(const Pool &, const Slot *s) {
+      long value = toLong(s);
+      return fits<T>(value) ? (T)value : 0;
+    }
+    static void set(Pool &, Slot *s, T value) {
+      s->type = INT;
+      s->v.i = (long)value;
+    }
+  };
+
+  template <>
+  struct Converter<bool> {
+    static bool is(const Pool &, const Slot *s) { return s != NULL && s->type == BOOL; }
+    static bool as(const Pool &, const Slot *s) { return toLong(s) != 0; }
+    static void set(Pool &, Slot *s, bool value) {
+      s->type = BOOL;
+      s->v.i = value;
+    }
+  };
+
+  template <typename T>
+  struct Converter<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static bool is(const Pool &, const Slot *s) { return s != NULL && (s->type == FLOAT || s->type == INT); }
+    static T as(const Pool &, const Slot *s) {
+      if (s != NULL && s->type == FLOAT) return (T)s->v.f;
+      return (T)toLong(s);
+    }
+    static void set(Pool &, Slot *s, T value) {
+      s->type = FLOAT;
+      s->v.f = value;
+    }
+  };
+
+  template <>
+  struct Converter<const char *> {
+    static bool is(const Pool &, const Slot *s) { return s != NULL && s->type == STR; }
+    static const char *as(const Pool &, const Slot *s) { return (s != NULL && s->type == STR) ? s->v.s : NULL; }
+    static void set(Pool &, Slot *s, const char *value) {
+      if (value == NULL) {
+        setNull(s);
+        return;
+      }
+      s->type = STR;
+      s->v.s = value;
+    }
+  };
+}
+
+// ======================== VARIANTS ========================
+class JsonVariantConst {
+public:
+  JsonVariantConst(const gc_json::Pool *pool = NULL, const gc_json::Slot *slot = NULL) : pool(pool), slot(slot) {}
+
+  template <typename T>
+  bool is() const { return slot != NULL && gc_json::Converter<T>::is(*pool, slot); }
+  template <typename T>
+  T as() const { return slot != NULL ? gc_json::Converter<T>::as(*pool, slot) : T(); }
+  template <typename T>
+  operator T() const { return as<T>(); }
+
+  bool isNull() const { return slot == NULL || slot->type == gc_json::NUL; }
+  size_t size() const { return slot != NULL ? gc_json::count(*pool, slot) : 0; }
+
+  JsonVariantConst operator[](const char *key) const {
+    return slot != NULL ? JsonVariantConst(pool, gc_json::member(*pool, slot, key)) : JsonVariantConst();
+  }
+  JsonVariantConst operator[](size_t index) const {
+    return slot != NULL ? JsonVariantConst(pool, gc_json::element(*pool, slot, index)) : JsonVariantConst();
+  }
+  JsonVariantConst operator[](int index) const { return (*this)[(size_t)index]; }
+
+protected:
+  const gc_json::Pool *pool;
+  const gc_json::Slot *slot;
+};
+
+class JsonArrayConst : public JsonVariantConst {
+public:
+  JsonArrayConst(const gc_json::Pool *pool = NULL, const gc_json::Slot *slot = NULL)
+    : JsonVariantConst(pool, slot != NULL && slot->type == gc_json::ARRAY ? slot : NULL) {}
+};
+
+namespace gc_json {
+  template <>
+  struct Converter<JsonArrayConst> {
+    static bool is(const Pool &, const Slot *s) { return s != NULL && s->type == ARRAY; }
+    static JsonArrayConst as(const Pool &pool, const Slot *s) { return JsonArrayConst(&pool, s); }
+  };
+}
+
+class JsonObject;
+class JsonArray;
+
+// doc["key"] and object["key"], the member is only added on assignment
+class JsonMemberProxy {
+public:
+  JsonMemberProxy(gc_json::Pool *pool, gc_json::Slot *object, const char *key)
+    : pool(pool), object(object), key(key) {}
+
+  template <typename T>
+  JsonMemberProxy &operator=(const T &value) {
+    gc_json::Slot *s = gc_json::memberOrAdd(*pool, object, key);
+    if (s != NULL) {
+      gc_json::Converter<T>::set(*pool, s, value);
+    }
+    return *this;
+  }
+  JsonMemberProxy &operator=(const char *value) {
+    gc_json::Slot *s = gc_json::memberOrAdd(*pool, object, key);
+    if (s != NULL) {
+      gc_json::Converter<const char *>::set(*pool, s, value);
+    }
+    return *this;
+  }
+
+  template <typename T>
+  bool is() const { return read().is<T>(); }
+  template <typename T>
+  T as() const { return read().as<T>(); }
+  template <typename T>
+  operator T() const { return read().as<T>(); }
+
+  bool isNull() const { return read().isNull(); }
+  size_t size() const { return read().size(); }
+  JsonVariantConst operator[](size_t index) const { return read()[index]; }
+  JsonVariantConst operator[](int index) const { return read()[(size_t)index]; }
+
+private:
+  JsonVariantConst read() const { return JsonVariantConst(pool, gc_json::member(*pool, object, key)); }
+
+  gc_json::Pool *pool;
+  gc_json::Slot *object;
+  const char *key;
+};
+
+class JsonObject {
+public:
+  JsonObject(gc_json::Pool *pool = NULL, gc_json::Slot *slot = NULL) : pool(pool), slot(slot) {}
+
+  JsonMemberProxy operator[](const char *key) { return JsonMemberProxy(pool, slot, key); }
+  JsonArray createNestedArray(const char *key);
+  JsonObject createNestedObject(const char *key);
+  size_t size() const { return slot != NULL ? gc_json::count(*pool, slot) : 0; }
+  bool isNull() const { return slot == NULL; }
+
+private:
+  gc_json::Pool *pool;
+  gc_json::Slot *slot;
+};
+
+class JsonArray {
+public:
+  JsonArray(gc_json::Pool *pool = NULL, gc_json::Slot *slot = NULL) : pool(pool), slot(slot) {}
+
+  template <typename T>
+  bool add(const T &value) {
+    gc_json::Slot *s = slot != NULL ? gc_json::append(*pool, slot) : NULL;
+    if (s != NULL) {
+      gc_json::Converter<T>::set(*pool, s, value);
+    }
+    return s != NULL;
+  }
+  bool add(const char *value) { return add<const char *>(value); }
+
+  JsonObject createNestedObject() {
+    gc_json::Slot *s = slot != NULL ? gc_json::append(*pool, slot) : NULL;
+    if (s != NULL) {
+      s->type = gc_json::OBJECT;
+    }
+    return JsonObject(pool, s);
+  }
+
+  size_t size() const { return slot != NULL ? gc_json::count(*pool, slot) : 0; }
+  bool isNull() const { return slot == NULL; }
+  JsonVariantConst operator[](size_t index) const {
+    return JsonVariantConst(pool, slot != NULL ? gc_json::element(*pool, slot, index) : NULL);
+  }
+
+private:
+  gc_json::Pool *pool;
+  gc_json::Slot *slot;
+};
+
+inline JsonArray JsonObject::createNestedArray(const char *key) {
+  gc_json::Slot *s = gc_json::memberOrAdd(*pool, slot, key);
+  if (s != NULL) {
+    s->type = gc_json::ARRAY;
+    s->v.child = 0;
+  }
+  return JsonArray(pool, s);
+}
+
+inline JsonObject JsonObject::createNestedObject(const char *key) {
+  gc_json::Slot *s = gc_json::memberOrAdd(*pool, slot, key);
+  if (s != NULL) {
+    s->type = gc_json::OBJECT;
+    s->v.child = 0;
+  }
+  return JsonObject(pool, s);
+}
+
+// ======================== DOCUMENTS ========================
+class JsonDocument {
+public:
+  JsonDocument(const JsonDocument &) = delete;
+  JsonDocument &operator=(const JsonDocument &) = delete;
+
+  JsonMemberProxy operator[](const char *key) { return JsonMemberProxy(&pool, &root, key); }
+  JsonVariantConst operator[](const char *key) const {
+    return JsonVariantConst(&pool, gc_json::member(pool, &root, key));
+  }
+
+  JsonArray createNestedArray(const char *key) { return JsonObject(&pool, &root).createNestedArray(key); }
+  JsonObject createNestedObject(const char *key) { return JsonObject(&pool, &root).createNestedObject(key); }
+  bool containsKey(const char *key) const { return gc_json::member(pool, &root, key) != NULL; }
+
+  template <typename T>
+  T as() const { return JsonVariantConst(&pool, &root).as<T>(); }
+
+  void clear() {
+    pool.clear();
+    gc_json::setNull(&root);
+  }
+  size_t size() const { return gc_json::count(pool, &root); }
+  size_t memoryUsage() const { return pool.used(); }
+  size_t capacity() const { return pool.size(); }
+  bool overflowed() const { return pool.overflowed(); }
+
+  // For the serializer and parser below
+  gc_json::Pool &data() { return pool; }
+  const gc_json::Pool &data() const { return pool; }
+  gc_json::Slot *rootSlot() { return &root; }
+  const gc_json::Slot *rootSlot() const { return &root; }
+
+protected:
+  JsonDocument(uint8_t *buf, size_t capacity) : pool(buf, capacity) { gc_json::setNull(&root); }
+
+private:
+  gc_json::Pool pool;
+  gc_json::Slot root;
+};
+
+template <size_t N>
+class StaticJsonDocument : public JsonDocument {
+public:
+  StaticJsonDocument() : JsonDocument(buf, N) {}
+
+private:
+  alignas(gc_json::Slot) uint8_t buf[N];
+};
+
+// ======================== SERIALIZATION ========================
+namespace gc_json {
+  // Writes to a Print one character at a time
+  struct PrintSink {
+    Print &out;
+    size_t n;
+    void put(char c) { n += out.write((uint8_t)c); }
+  };
+
+  // Writes to a buffer, keeps counting past its end
+  struct BufferSink {
+    char *buf;
+    size_t size;
+    size_t n;
+    void put(char c) {
+      if (n + 1 < size) buf[n] = c;
+      n++;
+    }
+  };
+
+  template <typename Sink>
+  void putText(Sink &sink, const char *s) {
+    while (*s) sink.put(*s++);
+  }
+
+  template <typename Sink>
+  void putString(Sink &sink, const char *s) {
+    sink.put('"');
+    for (; *s; s++) {
+      char c = *s;
+      switch (c) {
+        case '"':  putText(sink, "\\\""); break;
+        case '\\': putText(sink, "\\\\"); break;
+        case '\n': putText(sink, "\\n"); break;
+        case '\r': putText(sink, "\\r"); break;
+        case '\t': putText(sink, "\\t"); break;
+        default:
+          if ((uint8_t)c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", (unsigned)(uint8_t)c);
+            putText(sink, esc);
+          } else {
+            sink.put(c);
+          }
+      }
+    }
+    sink.put('"');
+  }
+
+  template <typename Sink>
+  void serialize(const Pool &pool, const Slot *s, Sink &sink) {
+    char num[32];
+    switch (s->type) {
+      case BOOL:
+        putText(sink, s->v.i ? "true" : "false");
+        break;
+      case INT:
+        snprintf(num, sizeof(num), "%ld", s->v.i);
+        putText(sink, num);
+        break;
+      case FLOAT:
+        snprintf(num, sizeof(num), "%.9g", s->v.f);
+        putText(sink, num);
+        break;
+      case STR:
+        putString(sink, s->v.s);
+        break;
+      case OBJECT:
+      case ARRAY: {
+        sink.put(s->type == OBJECT ? '{' : '[');
+        for (const Slot *c = pool.slot(s->v.child); c != NULL; c = pool.slot(c->next)) {
+          if (c != pool.slot(s->v.child)) sink.put(',');
+          if (s->type == OBJECT) {
+            putString(sink, c->key);
+            sink.put(':');
+          }
+          serialize(pool, c, sink);
+        }
+        sink.put(s->type == OBJECT ? '}' : ']');
+        break;
+      }
+      default:
+        putText(sink, "null");
+    }
+  }
+}
+
+inline size_t serializeJson(const JsonDocument &doc, Print &out) {
+  gc_json::PrintSink sink = { out, 0 };
+  gc_json::serialize(doc.data(), doc.rootSlot(), sink);
+  return sink.n;
+}
+
+// Writes a terminating 0, returns the length without it
+inline size_t serializeJson(const JsonDocument &doc, char *buf, size_t size) {
+  gc_json::BufferSink sink = { buf, size, 0 };
+  gc_json::serialize(doc.data(), doc.rootSlot(), sink);
+  if (size > 0) {
+    buf[sink.n < size ? sink.n : size - 1] = '\0';
+  }
+  return sink.n < size ? sink.n : size - 1;
+}
+
+inline size_t measureJson(const JsonDocument &doc) {
+  gc_json::BufferSink sink = { NULL, 0, 0 };
+  gc_json::serialize(doc.data(), doc.rootSlot(), sink);
+  return sink.n;
+}
+
+// ======================== DESERIALIZATION ========================
+class DeserializationError {
+public:
+  enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory, TooDeep };
+
+  DeserializationError(Code code = Ok) : code(code) {}
+  bool operator==(Code other) const { return code == other; }
+  bool operator!=(Code other) const { return code != other; }
+  explicit operator bool() const { return code != Ok; }
+
+  const char *c_str() const {
+    static const char *const names[] = { "Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory", "TooDeep" };
+    return names[code];
+  }
+
+private:
+  Code code;
+};
+
+namespace gc_json {
+  class Parser {
+  public:
+    Parser(Pool &pool, const char *p) : pool(pool), p(p), error(DeserializationError::Ok) {}
+
+    DeserializationError::Code parse(Slot *root) {
+      skip();
+      if (*p == '\0') {
+        return DeserializationError::EmptyInput;
+      }
+      value(root, 0);
+      return error;
+    }
+
+  private:
+    void fail(DeserializationError::Code code) {
+      if (error == DeserializationError::Ok) error = code;
+    }
+
+    void skip() {
+      while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+    }
+
+    bool literal(const char *word) {
+      size_t n = strlen(word);
+      if (strncmp(p, word, n) == 0) {
+        p += n;
+        return true;
+      }
+      fail(strlen(p) < n && strncmp(p, word, strlen(p)) == 0 ? DeserializationError::IncompleteInput
+                                                             : DeserializationError::InvalidInput);
+      return false;
+    }
+
+    void value(Slot *s, uint8_t depth) {
+      if (depth >= 10) {
+        fail(DeserializationError::TooDeep);
+        return;
+      }
+      skip();
+      char c = *p;
+      if (c == '{' || c == '[') {
+        container(s, depth);
+      } else if (c == '"') {
+        s->type = STR;
+        s->v.s = string();
+      } else if (c == 't' || c == 'f') {
+        s->type = BOOL;
+        s->v.i = c == 't';
+        literal(c == 't' ? "true" : "false");
+      } else if (c == 'n') {
+        setNull(s);
+        literal("null");
+      } else if (c == '-' || (c >= '0' && c <= '9')) {
+        number(s);
+      } else {
+        fail(c == '\0' ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput);
+      }
+    }
+
+    void container(Slot *s, uint8_t depth) {
+      bool object = *p++ == '{';
+      char close = object ? '}' : ']';
+      s->type = object ? OBJECT : ARRAY;
+      s->v.child = 0;
+      skip();
+      if (*p == close) {
+        p++;
+        return;
+      }
+      while (error == DeserializationError::Ok) {
+        skip();
+        const char *key = NULL;
+        if (object) {
+          if (*p != '"') {
+            fail(*p == '\0' ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput);
+            return;
+          }
+          key = string();
+          skip();
+          if (*p != ':') {
+            fail(*p == '\0' ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput);
+            return;
+          }
+          p++;
+        }
+        Slot *c = append(pool, s);
+        if (c == NULL) {
+          fail(DeserializationError::NoMemory);
+          return;
+        }
+        c->key = key;
+        value(c, depth + 1);
+        skip();
+        if (*p == ',') {
+          p++;
+        } else if (*p == close) {
+          p++;
+          return;
+        } else {
+          fail(*p == '\0' ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput);
+        }
+      }
+    }
+
+    // Copy a quoted string into the pool, with the escapes resolved
+    const char *string() {
+      const char *start = ++p;
+      while (*p != '"') {
+        if (*p == '\0') {
+          fail(DeserializationError::IncompleteInput);
+          return "";
+        }
+        if (*p == '\\' && p[1] != '\0') p++;
+        p++;
+      }
+      size_t raw = p - start;
+      p++;
+      char *out = pool.newString(raw);
+      if (out == NULL) {
+        fail(DeserializationError::NoMemory);
+        return "";
+      }
+      char *o = out;
+      for (const char *i = start; i < start + raw; i++) {
+        if (*i != '\\') {
+          *o++ = *i;
+          continue;
+        }
+        switch (*++i) {
+          case 'n': *o++ = '\n'; break;
+          case 'r': *o++ = '\r'; break;
+          case 't': *o++ = '\t'; break;
+          case 'b': *o++ = '\b'; break;
+          case 'f': *o++ = '\f'; break;
+          case 'u': {
+            unsigned code = 0;
+            for (uint8_t k = 0; k < 4 && i[1] != '\0' && i + 1 < start + raw; k++) {
+              char h = *++i;
+              code = code * 16 + (h <= '9' ? h - '0' : (h | 0x20) - 'a' + 10);
+            }
+            if (code < 0x80) {
+              *o++ = (char)code;
+            } else if (code < 0x800) {
+              *o++ = (char)(0xC0 | (code >> 6));
+              *o++ = (char)(0x80 | (code & 0x3F));
+            } else {
+              *o++ = (char)(0xE0 | (code >> 12));
+              *o++ = (char)(0x80 | ((code >> 6) & 0x3F));
+              *o++ = (char)(0x80 | (code & 0x3F));
+            }
+            break;
+          }
+          default: *o++ = *i;
+        }
+      }
+      *o = '\0';
+      return out;
+    }
+
+    void number(Slot *s) {
+      const char *start = p;
+      bool integer = true;
+      if (*p == '-') p++;
+      if (*p < '0' || *p > '9') {
+        fail(*p == '\0' ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput);
+        return;
+      }
+      while ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' ||
+             ((*p == '+' || *p == '-') && (p[-1] == 'e' || p[-1] == 'E'))) {
+        if (*p == '.' || *p == 'e' || *p == 'E') integer = false;
+        p++;
+      }
+      char *end;
+      if (integer) {
+        errno = 0;
+        long v = strtol(start, &end, 10);
+        if (errno == 0) {
+          s->type = INT;
+          s->v.i = v;
+          return;
+        }
+      }
+      s->type = FLOAT;
+      s->v.f = strtod(start, &end);
+    }
+
+    Pool &pool;
+    const char *p;
+    DeserializationError::Code error;
+  };
+}
+
+inline DeserializationError deserializeJson(JsonDocument &doc, const char *input) {
+  doc.clear();
+  if (input == NULL) {
+    return DeserializationError::EmptyInput;
+  }
+  gc_json::Parser parser(doc.data(), input);
+  DeserializationError::Code code = parser.parse(doc.rootSlot());
+  if (code != DeserializationError::Ok) {
+    doc.clear();
+  }
+  return code;
+}
+
+#endif
+// GC_HOST_ARDUINOJSON_H
@@ -0,0 +1,47 @@
+/*
+GreenCampus SmartDumpster - Host build
+- SoftwareSerial.h
+
+A HostPort that, like the real SoftwareSerial, only receives while it is the
+port that called listen() last. Bytes fed to a port that is not listening are
+lost, and listen() drops what the previous port had buffered.
+*/
+
+#ifndef GC_HOST_SOFTWARESERIAL_H
+#define GC_HOST_SOFTWARESERIAL_H
+
+#include <Arduino.h>
+
+class SoftwareSerial : public HostPort {
+public:
+  SoftwareSerial(uint8_t rxPin, uint8_t txPin) { (void)rxPin; (void)txPin; }
+
+  void begin(unsigned long) { listen(); }
+
+  bool listen() {
+    if (active() == this) {
+      return false;
+    }
+    if (active() != NULL) {
+      active()->clearInput();
+    }
+    active() = this;
+    return true;
+  }
+  bool isListening() const { return active() == this; }
+
+  // Received only while listening
+  size_t feed(const uint8_t *data, size_t length) {
+    return isListening() ? HostPort::feed(data, length) : 0;
+  }
+  size_t feed(const char *s) { return feed((const uint8_t *)s, strlen(s)); }
+
+private:
+  static SoftwareSerial *&active() {
+    static SoftwareSerial *port = NULL;
+    return port;
+  }
+};
+
+#endif
+// GC_HOST_SOFTWARESERIAL_H
@@ -0,0 +1,334 @@
+/*
+GreenCampus SmartDumpster - Host build
+- TinyGsmClient.h
+
+Stand-ins for TinyGsm and TinyGsmClient that talk AT commands to whatever
+Stream they are given, the way TinyGsm talks to a SIM7000 in multi-connection
+mode. In the tests that Stream is an AtSim (GC_Common/test/AtSim.h), which
+answers from a transcript.
+
+Only the calls the GC_Common headers make are here, and they send the same
+commands with the same waits as TinyGsm:
+
+  waitResponse()    reads until one of up to five answers ("OK", "ERROR",
+                    "+CME ERROR:", "+CMS ERROR:" by default), returns its
+                    number, 0 on timeout. Handles the socket URCs on the way.
+  testAT()          "AT" until it gets "OK"
+  restart()         "AT+CFUN=1,1", then "AT" again
+  gprsConnect()     AT+CIPSHUT, AT+CSTT, AT+CIICR, AT+CIFSR
+  isGprsConnected() AT+CGATT?
+  TinyGsmClient     AT+CIPSTART, AT+CIPSEND (one per write() call, as in
+                    TinyGsm), AT+CIPCLOSE. Data comes in as
+                    "+RECEIVE,<mux>,<length>:" URCs, a closed socket as
+                    "<mux>, CLOSED". A client takes the next "+RECEIVE"
+                    only once it read the last one, the modem keeps the
+                    rest (TinyGsm does that with AT+CIPRXGET).
+*/
+
+#ifndef GC_HOST_TINYGSMCLIENT_H
+#define GC_HOST_TINYGSMCLIENT_H
+
+#include <Arduino.h>
+
+#define GF(x)                 (x)
+#define GC_HOST_GSM_SOCKETS   4       // Sockets of the modem (mux 0-3)
+#define GC_HOST_GSM_RX_SIZE   2048    // Bytes each client buffers, more than one "+RECEIVE"
+
+class TinyGsmClient;
+
+class TinyGsm {
+public:
+  explicit TinyGsm(Stream &stream) : stream(stream), length(0) {
+    for (uint8_t i = 0; i < GC_HOST_GSM_SOCKETS; i++) {
+      sockets[i] = NULL;
+    }
+  }
+
+  template <typename... Args>
+  void sendAT(Args... cmd) {
+    stream.print("AT");
+    (stream.print(cmd), ...);
+    stream.print("\r\n");
+    stream.flush();
+  }
+
+  int8_t waitResponse(uint32_t timeoutMs, const char *r1 = "OK", const char *r2 = "ERROR",
+                      const char *r3 = "+CME ERROR:", const char *r4 = "+CMS ERROR:", const char *r5 = NULL) {
+    const char *answers[5] = { r1, r2, r3, r4, r5 };
+    length = 0;
+    unsigned long start = millis();
+    do {
+      while (stream.available() > 0) {
+        int c = stream.read();
+        if (c <= 0) {
+          continue;
+        }
+        append((char)c);
+        for (uint8_t i = 0; i < 5; i++) {
+          if (answers[i] != NULL && endsWith(answers[i])) {
+            return i + 1;
+          }
+        }
+        handleUrc();
+      }
+    } while (millis() - start < timeoutMs);
+    return 0;
+  }
+
+  int8_t waitResponse(const char *r1 = "OK", const char *r2 = "ERROR", const char *r3 = "+CME ERROR:",
+                      const char *r4 = "+CMS ERROR:", const char *r5 = NULL) {
+    return waitResponse(1000, r1, r2, r3, r4, r5);
+  }
+
+  // Handle the URCs that are waiting, up to the first "+RECEIVE", without waiting for more
+  void maintain() {
+    while (stream.available() > 0) {
+      int c = stream.read();
+      if (c > 0) {
+        append((char)c);
+        if (handleUrc()) {
+          return;
+        }
+      }
+    }
+  }
+
+  bool testAT(uint32_t timeoutMs = 10000L) {
+    for (unsigned long start = millis(); millis() - start < timeoutMs;) {
+      sendAT("");
+      if (waitResponse(200) == 1) {
+        return true;
+      }
+      delay(100);
+    }
+    return false;
+  }
+
+  bool restart() {
+    if (!testAT()) {
+      return false;
+    }
+    sendAT("+CFUN=1,1");
+    if (waitResponse(10000L) != 1) {
+      return false;
+    }
+    return testAT();
+  }
+
+  bool isNetworkConnected() {
+    sendAT("+CEREG?");
+    if (waitResponse("+CEREG:") != 1) {
+      return false;
+    }
+    char line[16];
+    readAnswer(line, sizeof(line));
+    waitResponse();
+    const char *status = strchr(line, ',');
+    return status != NULL && (atoi(status + 1) == 1 || atoi(status + 1) == 5);
+  }
+
+  bool gprsConnect(const char *apn, const char *user = NULL, const char *pwd = NULL) {
+    sendAT("+CIPSHUT");
+    if (waitResponse(60000L, "SHUT OK") != 1) {
+      return false;
+    }
+    sendAT("+CSTT=\"", apn, "\",\"", user != NULL ? user : "", "\",\"", pwd != NULL ? pwd : "", "\"");
+    if (waitResponse(60000L) != 1) {
+      return false;
+    }
+    sendAT("+CIICR");
+    if (waitResponse(60000L) != 1) {
+      return false;
+    }
+    sendAT("+CIFSR;E0");
+    return waitResponse(10000L) == 1;
+  }
+
+  bool isGprsConnected() {
+    sendAT("+CGATT?");
+    if (waitResponse("+CGATT:") != 1) {
+      return false;
+    }
+    char line[16];
+    readAnswer(line, sizeof(line));
+    waitResponse();
+    return atoi(line) == 1;
+  }
+
+  String getSimCCID() { return answer("+CCID"); }
+  String getIMEI() { return answer("+GSN"); }
+  String getIMSI() { return answer("+CIMI"); }
+  String getOperator() { return answer("+COPS?"); }
+
+  Stream &stream;
+
+private:
+  friend class TinyGsmClient;
+
+  void append(char c) {
+    if (length + 1 >= sizeof(data)) {
+      memmove(data, data + sizeof(data) / 2, length - sizeof(data) / 2);
+      length -= sizeof(data) / 2;
+    }
+    data[length++] = c;
+    data[length] = '\0';
+  }
+
+  bool endsWith(const char *s) const {
+    size_t n = strlen(s);
+    return n <= length && memcmp(data + length - n, s, n) == 0;
+  }
+
+  // Rest of the current line, without the line end
+  void readAnswer(char *buf, size_t size) {
+    size_t n = 0;
+    unsigned long start = millis();
+    while (millis() - start < 1000) {
+      int c = stream.available() > 0 ? stream.read() : -1;
+      if (c < 0 || c == '\r') continue;
+      if (c == '\n') break;
+      if (n + 1 < size) buf[n++] = (char)c;
+    }
+    buf[n] = '\0';
+  }
+
+  // First line of the answer to a command that answers with one line and OK
+  String answer(const char *cmd) {
+    sendAT(cmd);
+    char line[48];
+    line[0] = '\0';
+    unsigned long start = millis();
+    while (line[0] == '\0' && millis() - start < 1000) {
+      readAnswer(line, sizeof(line));
+    }
+    waitResponse();
+    return String(line);
+  }
+
+  int readNumber(char end) {
+    int value = 0;
+    unsigned long start = millis();
+    while (millis() - start < 1000) {
+      int c = stream.available() > 0 ? stream.read() : -1;
+      if (c < 0) continue;
+      if (c == end) break;
+      if (c >= '0' && c <= '9') value = value * 10 + (c - '0');
+    }
+    return value;
+  }
+
+  inline bool handleUrc();
+
+  char data[96];
+  size_t length;
+  TinyGsmClient *sockets[GC_HOST_GSM_SOCKETS];
+};
+
+class TinyGsmClient : public Stream {
+public:
+  explicit TinyGsmClient(TinyGsm &modem, uint8_t mux = 0)
+    : at(modem), mux(mux), sockConnected(false), rxHead(0), rxTail(0) {
+    at.sockets[mux] = this;
+  }
+
+  int connect(const char *host, uint16_t port, int timeout_s = 75) {
+    stop();
+    at.sendAT("+CIPSTART=", mux, ",\"TCP\",\"", host, "\",", port);
+    if (at.waitResponse() != 1) {
+      return 0;
+    }
+    int8_t r = at.waitResponse(timeout_s * 1000UL, "CONNECT OK", "CONNECT FAIL", "ALREADY CONNECT");
+    sockConnected = r == 1 || r == 3;
+    return sockConnected;
+  }
+
+  bool connected() {
+    if (available() > 0) {
+      return true;
+    }
+    return sockConnected;
+  }
+
+  void stop() {
+    if (sockConnected) {
+      at.sendAT("+CIPCLOSE=", mux);
+      at.waitResponse(5000L, "CLOSE OK", "ERROR");
+    }
+    sockConnected = false;
+    rxHead = rxTail = 0;
+  }
+
+  using Print::write;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+
+  // One AT+CIPSEND per call, like TinyGsm
+  size_t write(const uint8_t *buf, size_t size) override {
+    if (!sockConnected || size == 0) {
+      return 0;
+    }
+    at.sendAT("+CIPSEND=", mux, ',', (uint16_t)size);
+    if (at.waitResponse(">") != 1) {
+      return 0;
+    }
+    at.stream.write(buf, size);
+    at.stream.flush();
+    if (at.waitResponse(10000L, "SEND OK", "SEND FAIL") != 1) {
+      return 0;
+    }
+    return size;
+  }
+
+  int available() override {
+    if (rxHead == rxTail) {
+      at.maintain();
+    }
+    return (int)(rxTail - rxHead);
+  }
+  int read() override { return available() > 0 ? rx[rxHead++ % GC_HOST_GSM_RX_SIZE] : -1; }
+  int peek() override { return available() > 0 ? rx[rxHead % GC_HOST_GSM_RX_SIZE] : -1; }
+
+private:
+  friend class TinyGsm;
+
+  void received(uint8_t c) {
+    if (rxTail - rxHead < GC_HOST_GSM_RX_SIZE) {
+      rx[rxTail++ % GC_HOST_GSM_RX_SIZE] = c;
+    }
+  }
+
+  TinyGsm &at;
+  uint8_t mux;
+  bool sockConnected;
+  uint8_t rx[GC_HOST_GSM_RX_SIZE];
+  uint32_t rxHead, rxTail;
+};
+
+// "+RECEIVE,<mux>,<length>:\r\n<data>" and "<mux>, CLOSED". True after data came in.
+inline bool TinyGsm::handleUrc() {
+  if (endsWith("+RECEIVE,")) {
+    int mux = readNumber(',');
+    int size = readNumber(':');
+    readNumber('\n');
+    TinyGsmClient *client = mux < GC_HOST_GSM_SOCKETS ? sockets[mux] : NULL;
+    unsigned long start = millis();
+    while (size > 0 && millis() - start < 1000) {
+      if (stream.available() > 0) {
+        uint8_t c = (uint8_t)stream.read();
+        if (client != NULL) client->received(c);
+        size--;
+      }
+    }
+    length = 0;
+    return true;
+  } else if (endsWith(", CLOSED\r\n") && length >= 11) {
+    int mux = data[length - 11] - '0';
+    if (mux >= 0 && mux < GC_HOST_GSM_SOCKETS && sockets[mux] != NULL) {
+      sockets[mux]->sockConnected = false;
+    }
+    length = 0;
+  }
+  return false;
+}
+
+#endif
+// GC_HOST_TINYGSMCLIENT_H
@@ -0,0 +1,299 @@
+/*
+GreenCampus SmartDumpster - Host tests
+- test_a02.cpp
+
+A02Parser (GC_A02.h) on the byte streams a sensor really sends: 0xFF inside
+the data and the checksum, a read that starts in the middle of a frame, bad
+checksums and frames cut short. Then the frames per second DistanceSensor
+gets out of a sensor that sends every 100 ms, against the blocking
+readSensor() it replaced (listen, delay(100), wait for 0xFF, delay(10), read
+3 bytes, 300 ms timeout), in simulated time.
+*/
+
+#include "GcTest.h"
+
+#include <GC_A02.h>
+#include <GC_Sensor.h>
+
+// ======================== HELPERS ========================
+namespace {
+  const uint32_t FRAME_US = 100000;    // the A02YYUW sends a frame every 100 ms
+  const uint32_t BYTE_US = 1042;       // one byte at 9600 baud
+  const uint32_t RX_BUFFER = 64;       // SoftwareSerial keeps this many bytes
+
+  void frame(uint16_t mm, uint8_t *out) {
+    out[0] = A02_FRAME_HEADER;
+    out[1] = mm >> 8;
+    out[2] = mm & 0xFF;
+    out[3] = (uint8_t)(out[0] + out[1] + out[2]);
+  }
+
+  // Push bytes, returns the frames they completed
+  uint8_t pushAll(A02Parser &parser, const uint8_t *bytes, size_t length) {
+    uint8_t frames = 0;
+    for (size_t i = 0; i < length; i++) {
+      frames += parser.push(bytes[i]);
+    }
+    return frames;
+  }
+
+  /*
+  TimedSensor - An A02YYUW on a SoftwareSerial port, in simulated time. Frame k
+  is sent from k * FRAME_US on, one byte per BYTE_US. Only the port that called
+  listen() last receives, and it keeps at most RX_BUFFER bytes.
+  */
+  class TimedSensor : public Stream {
+  public:
+    TimedSensor(uint16_t mm, uint32_t offsetUs) : mm(mm), offsetUs(offsetUs), head(0) {}
+
+    bool listen() {
+      if (active() == this) {
+        return false;
+      }
+      active() = this;
+      head = arrived();
+      return true;
+    }
+
+    int available() override {
+      if (active() != this) {
+        return 0;
+      }
+      uint32_t last = arrived();
+      if (last - head > RX_BUFFER) {
+        head = last - RX_BUFFER;          // overflow, the oldest bytes are lost
+      }
+      return (int)(last - head);
+    }
+    int read() override { return available() > 0 ? byteAt(head++) : -1; }
+    int peek() override { return available() > 0 ? byteAt(head) : -1; }
+
+    using Print::write;
+    size_t write(uint8_t) override { return 1; }
+
+    // Distance of frame k, it moves a little from frame to frame
+    uint16_t mmAt(uint32_t k) const { return mm + k % 7; }
+
+  private:
+    static TimedSensor *&active() {
+      static TimedSensor *port = NULL;
+      return port;
+    }
+
+    // Bytes sent so far
+    uint32_t arrived() const {
+      uint64_t now = hostNowUs();
+      if (now < offsetUs) {
+        return 0;
+      }
+      uint64_t t = now - offsetUs;
+      uint32_t inFrame = (uint32_t)(t % FRAME_US) / BYTE_US;
+      return (uint32_t)(t / FRAME_US) * A02_FRAME_SIZE + (inFrame < A02_FRAME_SIZE ? inFrame : A02_FRAME_SIZE);
+    }
+
+    uint8_t byteAt(uint32_t n) const {
+      uint8_t bytes[A02_FRAME_SIZE];
+      frame(mmAt(n / A02_FRAME_SIZE), bytes);
+      return bytes[n % A02_FRAME_SIZE];
+    }
+
+    const uint16_t mm;
+    const uint32_t offsetUs;
+    uint32_t head;
+  };
+
+  // The reader before GC_A02.h, as it was in GC_Uno.cpp
+  long oldReadSensor(TimedSensor &sensor) {
+    sensor.listen(); // Switch to this sensor
+    delay(100); // Short stabilization delay
+
+    unsigned char data[4] = {0};
+    unsigned long startTime = millis();
+
+    while (millis() - startTime < 300) { // 300ms timeout
+      if (sensor.available() > 0) {
+        if (sensor.read() == 0xFF) {
+          delay(10); // Small delay to ensure data arrives
+          if (sensor.available() >= 3) {
+            data[1] = sensor.read(); // High byte
+            data[2] = sensor.read(); // Low byte
+            data[3] = sensor.read(); // Checksum
+
+            // Verify checksum (overflow handled by byte casting)
+            if (data[3] == (uint8_t)(0xFF + data[1] + data[2])) {
+              return ((data[1] << 8) + data[2]) * 0.0393700787; // Convert to inches
+            }
+          }
+        }
+      }
+    }
+    return -1; // Return error if timeout
+  }
+
+  // Readings of both sensors per simulated second, taking turns like GetFullPer
+  template <typename Read>
+  double pairsPerSecond(unsigned long seconds, Read readPair) {
+    uint64_t start = hostNowUs();
+    uint32_t pairs = 0;
+    while (hostNowUs() - start < (uint64_t)seconds * 1000000) {
+      pairs += readPair();
+    }
+    return pairs * 1e6 / (double)(hostNowUs() - start);
+  }
+}
+
+// ======================== PARSING ========================
+GC_TEST(framesBackToBack) {
+  A02Parser parser;
+  uint8_t bytes[3 * A02_FRAME_SIZE];
+  frame(300, bytes);
+  frame(1234, bytes + 4);
+  frame(4500, bytes + 8);
+  CHECK_EQ(pushAll(parser, bytes, sizeof(bytes)), 3);
+  CHECK_EQ(parser.distanceMm(), 4500);
+  CHECK_EQ(parser.errors(), 0);
+}
+
+GC_TEST(ffInsideTheDataAndTheChecksum) {
+  A02Parser parser;
+  uint8_t bytes[2 * A02_FRAME_SIZE];
+  frame(255, bytes);          // FF 00 FF FE, the low byte looks like a header
+  frame(511, bytes + 4);      // FF 01 FF FF, so does the checksum
+  CHECK_EQ(pushAll(parser, bytes, 4), 1);
+  CHECK_EQ(parser.distanceMm(), 255);
+  CHECK_EQ(pushAll(parser, bytes + 4, 4), 1);
+  CHECK_EQ(parser.distanceMm(), 511);
+  CHECK_EQ(pushAll(parser, bytes, sizeof(bytes)), 2);
+  CHECK_EQ(parser.errors(), 0);
+}
+
+GC_TEST(startInTheMiddleOfAFrame) {
+  A02Parser parser;
+  uint8_t bytes[3 * A02_FRAME_SIZE];
+  frame(255, bytes);
+  frame(300, bytes + 4);
+  frame(301, bytes + 8);
+  // From the 0xFF data byte of the first frame: FF FE | FF 01 2C 2C | ...
+  CHECK_EQ(pushAll(parser, bytes + 2, sizeof(bytes) - 2), 2);
+  CHECK_EQ(parser.distanceMm(), 301);
+  CHECK_EQ(parser.errors(), 1);       // FF FE FF 01, then back on the real header
+}
+
+GC_TEST(badChecksumIsSkipped) {
+  A02Parser parser;
+  uint8_t bytes[2 * A02_FRAME_SIZE];
+  frame(800, bytes);
+  frame(900, bytes + 4);
+  bytes[3] ^= 0x10;
+  CHECK_EQ(pushAll(parser, bytes, 4), 0);
+  CHECK_EQ(parser.distanceMm(), 0);
+  CHECK_EQ(parser.errors(), 1);
+  CHECK_EQ(pushAll(parser, bytes + 4, 4), 1);
+  CHECK_EQ(parser.distanceMm(), 900);
+}
+
+GC_TEST(truncatedFrameResyncs) {
+  A02Parser parser;
+  uint8_t bytes[2 + 2 * A02_FRAME_SIZE];
+  uint8_t whole[A02_FRAME_SIZE];
+  frame(1500, whole);
+  memcpy(bytes, whole, 2);            // cut after the high byte
+  frame(300, bytes + 2);
+  frame(310, bytes + 6);
+  CHECK_EQ(pushAll(parser, bytes, sizeof(bytes)), 2);
+  CHECK_EQ(parser.distanceMm(), 310);
+
+  // listen() on another port drops the rest of a frame, clearFrame() too
+  A02Parser other;
+  other.push(0xFF);
+  other.push(0x05);
+  other.clearFrame();
+  CHECK_EQ(pushAll(other, bytes + 2, 4), 1);
+  CHECK_EQ(other.distanceMm(), 300);
+  CHECK_EQ(other.errors(), 0);
+}
+
+GC_TEST(noisyStreamRecoversEveryIntactFrame) {
+  // Frames with a byte lost, flipped or an extra 0xFF here and there. A
+  // wrong distance only comes from a corrupt frame whose checksum happens to
+  // match, and the intact frames get through.
+  randomSeed(7);
+  A02Parser parser;
+  uint32_t intact = 0, got = 0, wrong = 0;
+  for (uint16_t k = 0; k < 5000; k++) {
+    uint16_t mm = 200 + random(0, 4300);
+    uint8_t bytes[A02_FRAME_SIZE + 1];
+    frame(mm, bytes);
+    size_t length = A02_FRAME_SIZE;
+    long fault = random(0, 10);
+    if (fault == 0) {
+      length--;                       // lost a byte
+      memmove(bytes + 1, bytes + 2, 2);
+    } else if (fault == 1) {
+      bytes[random(1, A02_FRAME_SIZE)] ^= 1 << random(0, 8);
+    } else if (fault == 2) {
+      bytes[length++] = 0xFF;         // a stray 0xFF after the frame
+    } else {
+      intact++;
+    }
+    for (size_t i = 0; i < length; i++) {
+      if (parser.push(bytes[i])) {
+        got++;
+        wrong += parser.distanceMm() != mm;
+      }
+    }
+  }
+  printf("    %u intact frames, %u distances, %u wrong\n", intact, got, wrong);
+  CHECK(wrong * 100 <= got);          // only checksum collisions of corrupt frames
+  CHECK(got >= intact);
+}
+
+// ======================== THROUGHPUT ========================
+GC_TEST(framesPerSecondAgainstTheBlockingReader) {
+  TimedSensor sensor15(700, 0), sensor60(500, 37000);
+
+  // Before: readSensor() for each, 50 ms apart (GetFullPer before GC_Sensor.h)
+  uint32_t failedOld = 0;
+  double before = pairsPerSecond(60, [&]() {
+    long d15 = oldReadSensor(sensor15);
+    delay(50);
+    long d60 = oldReadSensor(sensor60);
+    delay(50);
+    failedOld += d15 < 0 || d60 < 0;
+    return d15 >= 0 && d60 >= 0;
+  });
+
+  // Now: DistanceSensor::read(), done as soon as a frame is complete
+  DistanceSensor<TimedSensor> read15(sensor15), read60(sensor60);
+  uint32_t failedNew = 0;
+  double now = pairsPerSecond(60, [&]() {
+    long d15 = read15.read();
+    long d60 = read60.read();
+    failedNew += d15 < 0 || d60 < 0;
+    return d15 >= 0 && d60 >= 0;
+  });
+
+  // One sensor that keeps its port (ESP32 UART, A02Bus): every frame it sends
+  A02Parser parser;
+  uint32_t frames = 0;
+  sensor15.listen();
+  uint64_t start = hostNowUs();
+  while (hostNowUs() - start < 60ull * 1000000) {
+    frames += parser.poll(sensor15);
+    hostAdvanceMs(1);
+  }
+  double streaming = frames / 60.0;
+
+  printf("    readSensor():           %5.2f pairs/s (%u failed)\n", before, failedOld);
+  printf("    DistanceSensor::read(): %5.2f pairs/s (%u failed)\n", now, failedNew);
+  printf("    A02Parser::poll():      %5.2f frames/s of one sensor, it sends %.0f\n",
+         streaming, 1e6 / FRAME_US);
+  CHECK(now > before * 1.5);
+  CHECK_EQ(failedNew, 0);
+  CHECK(streaming > 9.9);
+  CHECK_EQ(parser.errors(), 0);
+}
+
+int main() {
+  return gcRunTests();
+}
@@ -0,0 +1,104 @@
+/*
+GreenCampus SmartDumpster - Host tests
+- test_calibration.cpp
+
+EmptyBinCalibrator and CalibrationStore (GC_Calibration.h) on the test bin of
+the sketches: a baseline taken from an empty bin, one taken from a bin that
+was not emptied and must not become the new zero, and the baseline in EEPROM
+across a restart.
+*/
+
+#include "GcTest.h"
+
+#include <GC_Calibration.h>
+
+// ======================== HELPERS ========================
+namespace {
+  // Nominal empty readings 37 (15°) and 41 (60°), casing offsets 4 and 2
+  const DumpsterGeometry testBin = dumpsterGeometry(36, 24, 36, 4, 2, 3);
+
+  // Feed the same pair of readings until the calibrator is done
+  uint8_t calibrate(EmptyBinCalibrator<> &calibrator, long raw15, long raw60, Baseline &baseline) {
+    calibrator.start();
+    uint8_t result = GC_CAL_BUSY;
+    for (uint8_t i = 0; i < 2 * GC_CAL_SAMPLES && result == GC_CAL_BUSY; i++) {
+      result = calibrator.add(testBin, raw15 + (i % 2), raw60 - (i % 2), baseline);
+    }
+    return result;
+  }
+}
+
+// ======================== TESTS ========================
+GC_TEST(emptyBinIsTaken) {
+  // A bit longer than nominal, the readings wobble by an inch
+  EmptyBinCalibrator<> calibrator;
+  Baseline baseline = {};
+  CHECK_EQ(calibrate(calibrator, 34, 40, baseline), GC_CAL_DONE);
+  CHECK_EQ(baseline.d15, 38);       // median plus the casing offset
+  CHECK_EQ(baseline.d60, 42);
+  CHECK(!calibrator.active());
+
+  // The new zero reads empty with the nominal threshold as well
+  CHECK(!seesTrash(mount15(testBin), baseline.d15 - testBin.offsetDist15));
+  CHECK(!seesTrash(mount60(testBin), baseline.d60 - testBin.offsetDist60));
+}
+
+GC_TEST(shortBaselineIsRejected) {
+  EmptyBinCalibrator<> calibrator;
+  Baseline baseline = {};
+
+  // Half full after a pickup that left trash behind: 23 of 37 inches used to
+  // pass the old 60% check and would have been saved as empty
+  CHECK_EQ(calibrate(calibrator, 19, 37, baseline), GC_CAL_REJECTED);
+
+  // Right at the seesTrash() threshold: 31 inches is trash for a 37 inch bin,
+  // 32 is not
+  CHECK(seesTrash(mount15(testBin), 31 - testBin.offsetDist15));
+  CHECK_EQ(calibrate(calibrator, 27, 39, baseline), GC_CAL_REJECTED);
+  CHECK_EQ(calibrate(calibrator, 28, 39, baseline), GC_CAL_DONE);
+
+  // Only the 60° sensor short
+  CHECK_EQ(calibrate(calibrator, 33, 30, baseline), GC_CAL_REJECTED);
+
+  // Past the far end
+  CHECK_EQ(calibrate(calibrator, 60, 39, baseline), GC_CAL_REJECTED);
+
+  // A sensor that times out every time
+  calibrator.start();
+  uint8_t result = GC_CAL_BUSY;
+  for (uint8_t i = 0; i < 2 * GC_CAL_SAMPLES; i++) {
+    result = calibrator.add(testBin, -1, 39, baseline);
+  }
+  CHECK_EQ(result, GC_CAL_REJECTED);
+  CHECK(!calibrator.active());
+}
+
+GC_TEST(baselineSurvivesARestart) {
+  RamStore::erase();
+  Baseline baseline = {};
+  {
+    CalibrationStore<RamStore> store(100);
+    CHECK(!store.load(testBin, baseline));     // new EEPROM
+    Baseline measured = { 38, 43 };
+    store.save(testBin, measured);
+    CHECK_EQ(RamStore::commits(), 1);
+  }
+
+  // After the restart
+  CalibrationStore<RamStore> store(100);
+  CHECK(store.load(testBin, baseline));
+  CHECK_EQ(baseline.d15, 38);
+  CHECK_EQ(baseline.d60, 43);
+
+  // Not for another geometry
+  const DumpsterGeometry fourYard = dumpsterGeometry(72, 60, 62, 4, 2, 3);
+  CHECK(!store.load(fourYard, baseline));
+
+  // Not if a byte went bad
+  RamStore::write(100 + 8, RamStore::read(100 + 8) ^ 0x01);
+  CHECK(!store.load(testBin, baseline));
+}
+
+int main() {
+  return gcRunTests();
+}
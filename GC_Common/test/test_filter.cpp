@@ -0,0 +1,120 @@
+/*
+GreenCampus SmartDumpster - Host tests
+- test_filter.cpp
+
+DistanceFilter (GC_Filter.h) on reading traces a bin really produces: a
+spike, the step of a pickup, a bin that fills slowly and a sensor that is
+stuck. The filter is set up as in Slightly_changed_but_commented_code.ino:
+window 5, changes of 2 inches go through, a jump needs 3 readings within 1
+inch of each other.
+*/
+
+#include "GcTest.h"
+
+#include <GC_Filter.h>
+
+// ======================== HELPERS ========================
+namespace {
+  typedef DistanceFilter<5> Filter;
+
+  Filter sketchFilter() {
+    return Filter(0, 200, 2, 1, 3);
+  }
+
+  // Feed a trace, out[i] is the filtered value after trace[i]
+  template <size_t L>
+  void run(Filter &filter, const int16_t (&trace)[L], int16_t *out) {
+    for (size_t i = 0; i < L; i++) {
+      out[i] = filter.update(trace[i]);
+    }
+  }
+
+  // Feed the same reading n times, returns the last filtered value
+  int16_t hold(Filter &filter, int16_t reading, uint16_t n) {
+    int16_t value = -1;
+    for (uint16_t i = 0; i < n; i++) {
+      value = filter.update(reading);
+    }
+    return value;
+  }
+}
+
+// ======================== TRACES ========================
+GC_TEST(spikeIsIgnored) {
+  Filter filter = sketchFilter();
+  // Something passes under the sensor: one reading, then two, then three
+  // that do not agree with each other
+  const int16_t trace[] = { 80, 81, 80, 81, 80, 20, 80, 81, 20, 21, 80, 81, 25, 40, 60, 80 };
+  int16_t out[16];
+  run(filter, trace, out);
+  for (size_t i = 0; i < 16; i++) {
+    CHECK(out[i] == 80 || out[i] == 81);
+  }
+  CHECK(filter.ready());
+  CHECK_EQ(filter.confirming(), 0);
+}
+
+GC_TEST(pickupIsAcceptedAfterThreeReadings) {
+  Filter filter = sketchFilter();
+  CHECK_EQ(hold(filter, 22, 10), 22);               // full bin
+
+  // Emptied: the third reading at the floor distance switches over, no
+  // reading in between comes out as a mix of the two
+  const int16_t trace[] = { 95, 96, 95, 95, 96, 95 };
+  int16_t out[6];
+  run(filter, trace, out);
+  CHECK_EQ(out[0], 22);
+  CHECK_EQ(out[1], 22);
+  CHECK_EQ(out[2], 95);
+  CHECK(out[3] == 95 && out[4] >= 95 && out[5] == 95);
+  CHECK_EQ(filter.size(), 4);
+  CHECK(filter.ready());                            // stays ready after the jump
+}
+
+GC_TEST(slowFillingIsFollowed) {
+  Filter filter = sketchFilter();
+  hold(filter, 95, 5);
+  // One inch less every 4 readings, the median trails by at most 2
+  int16_t value = 95;
+  for (int16_t reading = 95; reading >= 40; reading--) {
+    value = hold(filter, reading, 4);
+    CHECK(value - reading <= 2);
+  }
+  CHECK_EQ(value, 40);
+  CHECK_EQ(filter.confirming(), 0);
+}
+
+GC_TEST(stuckSensor) {
+  Filter filter = sketchFilter();
+  hold(filter, 60, 5);
+
+  // Stuck on one value, MAD is 0 and the threshold falls back to smallSpike.
+  // The filter cannot tell this from a bin that does not change.
+  CHECK_EQ(hold(filter, 55, 1000), 55);
+  CHECK_EQ(filter.confirming(), 0);
+
+  // Stuck on a value out of range (a timeout, a dead sensor): the last good
+  // value is kept
+  CHECK_EQ(hold(filter, 250, 1000), 55);
+  CHECK_EQ(hold(filter, -1, 1000), 55);
+
+  // When it comes back, a new distance takes the usual three readings
+  CHECK_EQ(filter.update(30), 55);
+  CHECK_EQ(filter.update(30), 55);
+  CHECK_EQ(filter.update(30), 30);
+}
+
+GC_TEST(noisySensorWidensTheWindow) {
+  Filter filter = sketchFilter();
+  // +-4 inches of noise: 3 * MAD lets it through, a single 15 inch spike not
+  const int16_t trace[] = { 70, 74, 66, 72, 68, 73, 67, 55, 71, 69 };
+  int16_t out[10];
+  run(filter, trace, out);
+  for (size_t i = 4; i < 10; i++) {
+    CHECK(out[i] >= 68 && out[i] <= 72);
+  }
+}
+
+int main() {
+  return gcRunTests();
+}
@@ -0,0 +1,82 @@
+/*
+GreenCampus SmartDumpster - Host tests
+- test_geometry.cpp
+
+fullnessFromDistances() (GC_Geometry.h, Q14 fixed point) against the floating
+point model it replaced (FloatFullness.h), for every pair of readings the
+A02YYUW can give: 3 cm to 450 cm, 0 to 177 whole inches. Prints the largest
+difference in percentage points and where it is.
+*/
+
+#include "GcTest.h"
+#include "FloatFullness.h"
+
+// ======================== HELPERS ========================
+namespace {
+  const long MAX_RAW = 177;          // 450 cm in whole inches
+
+  struct MaxError {
+    double error;
+    long raw15, raw60;
+  };
+
+  // Largest |Q14 - reference| over the whole sensor range
+  template <typename Reference>
+  MaxError maxError(const DumpsterGeometry &g, Reference reference) {
+    MaxError worst = { 0, 0, 0 };
+    for (long raw15 = 0; raw15 <= MAX_RAW; raw15++) {
+      for (long raw60 = 0; raw60 <= MAX_RAW; raw60++) {
+        double error = fabs(fullnessFromDistances(g, raw15, raw60).fullness - reference(g, raw15, raw60));
+        if (error > worst.error) {
+          worst = MaxError{ error, raw15, raw60 };
+        }
+      }
+    }
+    return worst;
+  }
+
+  void printMaxError(const char *name, const MaxError &e) {
+    printf("    %-28s max error %5.2f points (raw15 %ld, raw60 %ld)\n", name, e.error, e.raw15, e.raw60);
+  }
+
+  // The test bin of the sketches, and a 4 yard front load dumpster
+  const DumpsterGeometry testBin = dumpsterGeometry(36, 24, 36, 4, 2, 3);
+  const DumpsterGeometry fourYard = dumpsterGeometry(72, 60, 62, 4, 2, 3);
+}
+
+// ======================== TESTS ========================
+GC_TEST(matchesTheOldFirmware) {
+  // Same truncation to whole inches as the old long variables, Q14 sin/cos
+  // are close enough to the float ones that no reading comes out different
+  MaxError e = maxError(testBin, oldFullness);
+  printMaxError("test bin, old GetFullPer:", e);
+  CHECK(e.error == 0);
+
+  e = maxError(fourYard, oldFullness);
+  printMaxError("4 yard, old GetFullPer:", e);
+  CHECK(e.error == 0);
+}
+
+GC_TEST(closeToTheExactModel) {
+  // h and x are whole inches, as they were in the old firmware. In a small
+  // bin one inch of height is a few percent, that is the error here
+  // (4.66 points for the test bin, 3.16 for the 4 yard).
+  MaxError e = maxError(testBin, floatFullness);
+  printMaxError("test bin, exact float model:", e);
+  CHECK(e.error < 5);
+
+  e = maxError(fourYard, floatFullness);
+  printMaxError("4 yard, exact float model:", e);
+  CHECK(e.error < 4);
+}
+
+GC_TEST(emptyAndFull) {
+  CHECK_EQ(fullnessFromDistances(testBin, testBin.defaultD15, testBin.defaultD60).fullness, 0);
+  CHECK_EQ(fullnessFromDistances(testBin, MAX_RAW, MAX_RAW).fullness, 0);
+  CHECK_EQ(fullnessFromDistances(testBin, 0, 0).fullness, oldFullness(testBin, 0, 0));
+  CHECK(fullnessFromDistances(testBin, 0, 0).fullness > 80);
+}
+
+int main() {
+  return gcRunTests();
+}
@@ -0,0 +1,228 @@
+/*
+GreenCampus SmartDumpster - Host tests
+- test_heap.cpp
+
+The report path must not touch the heap: on the Uno it shares 2KB with the
+TinyGsm buffer and the SoftwareSerial buffers, and a String or a new per
+report fragments it over weeks of uptime. This file replaces malloc, calloc,
+realloc, free and operator new for the whole executable and counts every call
+made while a report is being sent. The stand-ins in host/ use fixed buffers,
+except String, which is on the heap like the Arduino one, so whatever is
+counted comes from the GC_Common code.
+
+Covered: postRecord, postBatch and sendQueued through a keep-alive
+HarvestSession, the per-report postToHarvest on a plain client, the Unified
+Endpoint over TCP and UDP, and the clock sync with getISOTimestamp.
+*/
+
+#include "GcTest.h"
+#include "AtSim.h"
+
+#include <TinyGsmClient.h>
+#include <GC_Unified.h>
+#include <GC_Batch.h>
+#include <GC_Queue.h>
+
+#include <new>
+#include <stdlib.h>
+
+// ======================== ALLOCATION COUNTER ========================
+namespace {
+  bool counting = false;
+  unsigned allocations = 0;
+
+  void counted() {
+    if (counting) {
+      allocations++;
+    }
+  }
+}
+
+#if defined(__GLIBC__)
+extern "C" {
+  void *__libc_malloc(size_t size);
+  void *__libc_calloc(size_t n, size_t size);
+  void *__libc_realloc(void *p, size_t size);
+  void __libc_free(void *p);
+
+  void *malloc(size_t size) { counted(); return __libc_malloc(size); }
+  void *calloc(size_t n, size_t size) { counted(); return __libc_calloc(n, size); }
+  void *realloc(void *p, size_t size) { counted(); return __libc_realloc(p, size); }
+  void free(void *p) { __libc_free(p); }
+}
+#endif
+
+// operator new is counted on its own, in case the C++ library does not go
+// through malloc (and on hosts without glibc)
+void *operator new(size_t size) {
+  counted();
+  bool was = counting;
+  counting = false;
+  void *p = malloc(size > 0 ? size : 1);
+  counting = was;
+  if (p == NULL) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+// ======================== HELPERS ========================
+namespace {
+  const char *const CREATED = "HTTP/1.1 201 Created\r\nContent-Length: 0\r\n\r\n";
+
+  const AtStep RESOLVE[] = {
+    { "AT+CDNSGIP=\"harvest.soracom.io\"", "\r\nOK\r\n", 20 },
+    { NULL, "\r\n+CDNSGIP: 1,\"harvest.soracom.io\",\"100.127.111.112\"\r\n", 400 },
+  };
+
+  TelemetryRecord reading(uint8_t fullness) {
+    TelemetryRecord r = { 1, fullness, 21, 40, GC_HEALTH_OK | GC_HEALTH_SENSOR15 | GC_HEALTH_SENSOR60, 0, 0 };
+    return r;
+  }
+
+  struct Bench {
+    AtSim sim;
+    TinyGsm modem;
+    TinyGsmClient client;
+
+    Bench() : modem(sim), client(modem, 0) {
+      Serial.clearWritten();
+    }
+  };
+
+  // Allocations made by f
+  template <typename F>
+  unsigned allocationsIn(F f) {
+    allocations = 0;
+    counting = true;
+    f();
+    counting = false;
+    return allocations;
+  }
+}
+
+// ======================== TESTS ========================
+GC_TEST(counterSeesAllocations) {
+  // The counter itself, or every other test passes for nothing
+  CHECK_EQ(allocationsIn([]() { free(malloc(16)); }), 1);
+  CHECK_EQ(allocationsIn([]() { delete new int(1); }), 1);
+  CHECK_EQ(allocationsIn([]() { String s("text"); (void)s; }), 1);
+}
+
+GC_TEST(harvestReports) {
+  Bench b;
+  HttpServer harvest(CREATED);
+  b.sim.serve(0, harvest);
+  b.sim.script(RESOLVE, 2);
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+
+  bool sent = true;
+  CHECK_EQ(allocationsIn([&]() {
+    for (uint8_t i = 0; i < 20; i++) {
+      sent &= postRecord(session, Serial, reading(40 + i));   // JSON
+      uint8_t payload[GC_TELEMETRY_SIZE];
+      uint8_t length = encodeTelemetry(reading(60 + i), payload);
+      sent &= postToHarvest(session, Serial, payload, length); // binary
+    }
+  }), 0);
+  CHECK(sent);
+  CHECK_EQ(harvest.requests(), 40);
+  CHECK(b.sim.ok());
+}
+
+GC_TEST(batchesAndTheQueue) {
+  Bench b;
+  HttpServer harvest(CREATED);
+  b.sim.serve(0, harvest);
+  b.sim.script(RESOLVE, 2);
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  RamStore::erase();
+  ReadingQueue<8, RamStore> queue;
+  queue.begin();
+
+  bool sent = true;
+  CHECK_EQ(allocationsIn([&]() {
+    ReadingBatch<4> batch;
+    for (uint8_t i = 0; i < 4; i++) {
+      batch.add(reading(10 + i));
+      hostAdvanceMs(60000);
+    }
+    sent &= postBatch(session, Serial, batch);
+    for (uint8_t i = 0; i < 5; i++) {
+      queue.push(reading(20 + i));
+    }
+    sent &= sendQueued<4>(session, Serial, queue) == 5;
+  }), 0);
+  CHECK(sent);
+  CHECK(strstr(harvest.lastRequest(), "\"age\":") != NULL);
+  CHECK(queue.empty());
+}
+
+GC_TEST(connectionPerReport) {
+  // postToHarvest on the client itself: connect, POST, read the answer, close
+  Bench b;
+  HttpServer harvest(CREATED);
+  b.sim.serve(0, harvest);
+
+  bool sent = true;
+  CHECK_EQ(allocationsIn([&]() {
+    for (uint8_t i = 0; i < 5; i++) {
+      StaticJsonDocument<256> doc;
+      telemetryToJson(reading(30 + i), doc);
+      sent &= postToHarvest(b.client, Serial, doc);
+    }
+  }), 0);
+  CHECK(sent);
+  CHECK_EQ(b.sim.connects(0), 5);
+}
+
+GC_TEST(unifiedEndpoint) {
+  Bench b;
+  SinkServer tcp, udp;
+  b.sim.serve(0, tcp);
+  b.sim.serve(GC_UDP_MUX, udp);
+  TinyGsmClient udpClient(b.modem, GC_UDP_MUX);
+  UnifiedTcpSession<TinyGsm, TinyGsmClient> tcpSession(b.modem, b.client);
+  UnifiedUdpSession<TinyGsm, TinyGsmClient> udpSession(b.modem, udpClient);
+
+  bool sent = true;
+  CHECK_EQ(allocationsIn([&]() {
+    for (uint8_t i = 0; i < 5; i++) {
+      sent &= postRecord(tcpSession, Serial, reading(50 + i));
+      sent &= postRecord(udpSession, Serial, reading(50 + i));
+    }
+  }), 0);
+  CHECK(sent);
+  CHECK_EQ(tcp.sends(), 5);
+  CHECK_EQ(udp.sends(), 5);
+}
+
+GC_TEST(clockSync) {
+  Bench b;
+  const AtStep steps[] = {
+    { "AT+CLTS=1", "\r\nOK\r\n", 10 },
+    { "AT+CCLK?", "\r\n+CCLK: \"24/04/13,13:37:20+08\"\r\n\r\nOK\r\n", 20 },
+  };
+  b.sim.script(steps, 2);
+
+  HostPort monitor;
+  char isoTime[GC_ISO_TIME_SIZE];
+  bool valid = false;
+  CHECK_EQ(allocationsIn([&]() {
+    valid = getISOTimestamp(b.modem, monitor, isoTime, sizeof(isoTime));
+  }), 0);
+  CHECK(valid);
+  CHECK(strcmp(isoTime, "2024-04-13T11:37:20.000Z") == 0);
+  CHECK(strstr(monitor.written(), "Clock synced: 2024-04-13T11:37:20.000Z") != NULL);
+  CHECK(strstr(Serial.written(), "Clock synced") == NULL);   // the monitor it was given
+  CHECK(b.sim.done());
+}
+
+int main() {
+  return gcRunTests();
+}
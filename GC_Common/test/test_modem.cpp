@@ -0,0 +1,684 @@
+/*
+GreenCampus SmartDumpster - Host tests
+- test_modem.cpp
+
+The uplink code against a simulated SIM7000 (AtSim.h): ensureGprs with its
+backoff, HarvestSession (keep-alive, DNS cache, downlink), the Unified
+Endpoint sessions over TCP and UDP, and sendQueued draining the queue. The
+faults are the ones seen in the field: "+CME ERROR" answers, sockets closed by
+the network, lost bytes and slow answers.
+*/
+
+#include "GcTest.h"
+#include "AtSim.h"
+
+#include <TinyGsmClient.h>
+#include <GC_Unified.h>
+#include <GC_Queue.h>
+
+// ======================== HELPERS ========================
+namespace {
+  const char *const CREATED = "HTTP/1.1 201 Created\r\nContent-Length: 0\r\n\r\n";
+
+  const AtStep RESOLVE[] = {
+    { "AT+CDNSGIP=\"harvest.soracom.io\"", "\r\nOK\r\n", 20 },
+    { NULL, "\r\n+CDNSGIP: 1,\"harvest.soracom.io\",\"100.127.111.112\"\r\n", 400 },
+  };
+
+  TelemetryRecord reading(uint8_t fullness) {
+    TelemetryRecord r = { 1, fullness, 21, 40, GC_HEALTH_OK, 0, 0 };
+    return r;
+  }
+
+  // One modem with a client on socket 0, fresh for every test
+  struct Bench {
+    AtSim sim;
+    TinyGsm modem;
+    TinyGsmClient client;
+
+    Bench() : modem(sim), client(modem, 0) {
+      Serial.clearWritten();
+      randomSeed(1);
+    }
+  };
+
+  bool logged(const char *text) { return strstr(Serial.written(), text) != NULL; }
+}
+
+// ======================== ensureGprs ========================
+GC_TEST(ensureGprsAlreadyUp) {
+  Bench b;
+  const AtStep steps[] = {
+    { "AT+CGATT?", "\r\n+CGATT: 1\r\n\r\nOK\r\n", 30 },
+  };
+  b.sim.script(steps, 1);
+  CHECK(ensureGprs(b.modem, Serial, TaskTimer()));
+  CHECK(b.sim.done());
+  CHECK_EQ(b.sim.commands(), 1);
+}
+
+GC_TEST(ensureGprsRetriesAfterCmeError) {
+  Bench b;
+  const AtStep steps[] = {
+    { "AT+CGATT?", "\r\n+CGATT: 0\r\n\r\nOK\r\n", 30 },
+    { "AT+CIPSHUT", "\r\nSHUT OK\r\n", 200 },
+    { "AT+CSTT=\"soracom.io\",\"sora\",\"sora\"", "\r\nOK\r\n", 20 },
+    { "AT+CIICR", "\r\n+CME ERROR: 148\r\n", 1500 },
+    { "AT+CGATT?", "\r\n+CGATT: 0\r\n\r\nOK\r\n", 30 },
+    // backoff
+    { "AT+CIPSHUT", "\r\nSHUT OK\r\n", 200 },
+    { "AT+CSTT=", "\r\nOK\r\n", 20 },
+    { "AT+CIICR", "\r\nOK\r\n", 2500 },
+    { "AT+CIFSR;E0", "\r\n10.160.2.7\r\n\r\nOK\r\n", 20 },
+  };
+  b.sim.script(steps, sizeof(steps) / sizeof(steps[0]));
+  unsigned long start = millis();
+  CHECK(ensureGprs(b.modem, Serial, TaskTimer()));
+  unsigned long elapsed = millis() - start;
+  CHECK(b.sim.ok());
+  CHECK(b.sim.done());
+  CHECK(logged("GPRS reconnect failed."));
+  // The answers take 4520ms, the backoff adds 500 to 1000ms
+  CHECK(elapsed >= 4520 + 500);
+  CHECK(elapsed <= 4520 + 1000 + 100);
+}
+
+GC_TEST(ensureGprsGivesUpAfterTheTries) {
+  Bench b;
+  static AtStep steps[1 + 4 * 4];
+  steps[0] = AtStep{ "AT+CGATT?", "\r\n+CGATT: 0\r\n\r\nOK\r\n", 30 };
+  for (uint8_t i = 0; i < GC_LINK_RETRY_ATTEMPTS; i++) {
+    steps[1 + i * 4] = AtStep{ "AT+CIPSHUT", "\r\nSHUT OK\r\n", 200 };
+    steps[2 + i * 4] = AtStep{ "AT+CSTT=", "\r\nOK\r\n", 20 };
+    steps[3 + i * 4] = AtStep{ "AT+CIICR", "\r\n+CME ERROR: 30\r\n", 800 };
+    steps[4 + i * 4] = AtStep{ "AT+CGATT?", "\r\n+CGATT: 0\r\n\r\nOK\r\n", 30 };
+  }
+  b.sim.script(steps, 1 + GC_LINK_RETRY_ATTEMPTS * 4);
+  CHECK(!ensureGprs(b.modem, Serial, TaskTimer()));
+  CHECK(b.sim.ok());
+  CHECK(b.sim.done());
+  CHECK_EQ(b.sim.count("AT+CIICR"), GC_LINK_RETRY_ATTEMPTS);
+  CHECK(logged("Giving up"));
+}
+
+GC_TEST(ensureGprsStopsAtTheDeadline) {
+  Bench b;
+  const AtStep steps[] = {
+    { "AT+CGATT?", "\r\n+CGATT: 0\r\n\r\nOK\r\n", 30 },
+    { "AT+CIPSHUT", "\r\nSHUT OK\r\n", 200 },
+    { "AT+CSTT=", "\r\nOK\r\n", 20 },
+    { "AT+CIICR", "\r\n+CME ERROR: 30\r\n", 800 },
+    { "AT+CGATT?", "\r\n+CGATT: 0\r\n\r\nOK\r\n", 30 },
+  };
+  b.sim.script(steps, sizeof(steps) / sizeof(steps[0]));
+  TaskTimer deadline;
+  deadline.start(1500);   // less than the first try and its backoff
+  CHECK(!ensureGprs(b.modem, Serial, deadline));
+  CHECK(b.sim.done());
+  CHECK_EQ(b.sim.count("AT+CIICR"), 1);
+}
+
+GC_TEST(ensureGprsSurvivesALostOk) {
+  Bench b;
+  const AtStep steps[] = {
+    { "AT+CGATT?", "\r\n+CGATT: 0\r\n\r\nOK\r\n", 30 },
+    { "AT+CIPSHUT", "\r\nSHUT OK\r\n", 200 },
+    { "AT+CSTT=", "\r\nOK\r\n", 20 },
+    { "AT+CIICR", "\r\nOK\r\n", 1500 },
+    { "AT+CIFSR;E0", "\r\n10.160.2.7\r\n", 20 },        // the OK never comes
+    { "AT+CGATT?", "\r\n+CGATT: 1\r\n\r\nOK\r\n", 30 },  // but the bearer is up
+  };
+  b.sim.script(steps, sizeof(steps) / sizeof(steps[0]));
+  CHECK(ensureGprs(b.modem, Serial, TaskTimer()));
+  CHECK(b.sim.done());
+  CHECK(b.sim.ok());
+  CHECK(!logged("GPRS reconnect failed."));
+}
+
+// ======================== HarvestSession ========================
+GC_TEST(harvestResolvesOnceAndKeepsTheConnection) {
+  Bench b;
+  HttpServer harvest(CREATED);
+  b.sim.serve(0, harvest);
+  b.sim.script(RESOLVE, 2);
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+
+  uint8_t payload[GC_TELEMETRY_SIZE];
+  encodeTelemetry(reading(42), payload);
+  CHECK(session.post(Serial, payload, sizeof(payload)));
+  CHECK_EQ(session.lastStatus(), 201);
+  CHECK(strcmp(session.address(), "100.127.111.112") == 0);
+  CHECK(strcmp(b.sim.host(0), "100.127.111.112") == 0);
+  CHECK(strstr(harvest.lastRequest(), "Content-Type: application/octet-stream\r\n") != NULL);
+  CHECK(strstr(harvest.lastRequest(), "Connection: keep-alive\r\n") != NULL);
+  CHECK_EQ(harvest.lastBodyLength(), GC_TELEMETRY_SIZE);
+  CHECK(memcmp(harvest.lastBody(), payload, GC_TELEMETRY_SIZE) == 0);
+
+  CHECK(session.post(Serial, payload, sizeof(payload)));
+  CHECK_EQ(harvest.requests(), 2);
+  CHECK_EQ(b.sim.connects(0), 1);          // same connection
+  CHECK_EQ(b.sim.count("AT+CDNSGIP"), 1);  // resolved once
+  CHECK(b.sim.ok());
+}
+
+GC_TEST(harvestReconnectsToTheCachedAddress) {
+  Bench b;
+  HttpServer harvest(CREATED);
+  b.sim.serve(0, harvest);
+  b.sim.script(RESOLVE, 2);
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  StaticJsonDocument<256> doc;
+  telemetryToJson(reading(42), doc);
+
+  CHECK(session.post(Serial, doc));
+  b.sim.closeSocket(0, 50);                // the network drops the idle connection
+  hostAdvanceMs(100);
+  CHECK(session.post(Serial, doc));
+  CHECK_EQ(b.sim.connects(0), 2);
+  CHECK_EQ(b.sim.count("AT+CDNSGIP"), 1);
+  CHECK(strcmp(b.sim.host(0), "100.127.111.112") == 0);
+  CHECK_EQ(harvest.requests(), 2);
+  CHECK(b.sim.ok());
+}
+
+GC_TEST(harvestRecheckFindsALostClose) {
+  Bench b;
+  HttpServer harvest(CREATED);
+  b.sim.serve(0, harvest);
+  b.sim.script(RESOLVE, 2);
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  StaticJsonDocument<256> doc;
+  telemetryToJson(reading(42), doc);
+
+  CHECK(session.post(Serial, doc));
+  CHECK(session.recheck());                // still open, nothing changes
+
+  // The network closes the connection while the sensors have the receiver
+  // (GC_SerialBus.h): the "CLOSED" never reaches TinyGsm
+  b.sim.closeSocket(0, 50);
+  hostAdvanceMs(100);
+  while (b.sim.available() > 0) {
+    b.sim.read();
+  }
+  CHECK(b.client.connected());             // TinyGsm does not know
+
+  CHECK(!session.recheck());
+  CHECK(!b.client.connected());
+  CHECK(session.post(Serial, doc));
+  CHECK(!logged("write failed"));
+  CHECK_EQ(b.sim.count("AT+CIPSTATUS=0"), 2);
+  CHECK_EQ(b.sim.connects(0), 2);
+  CHECK_EQ(harvest.requests(), 2);
+  CHECK(b.sim.ok());
+}
+
+GC_TEST(harvestWaitsStopAtTheDeadline) {
+  // The server takes the request and never answers: without a deadline the
+  // response wait is GC_HARVEST_TIMEOUT_MS
+  Bench b;
+  SinkServer silent;
+  b.sim.serve(0, silent);
+  b.sim.script(RESOLVE, 2);
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+
+  TaskTimer budget;
+  budget.start(3000);
+  unsigned long start = millis();
+  CHECK(!postRecord(session, Serial, reading(42), budget));
+  unsigned long took = millis() - start;
+  CHECK(took >= 2900 && took <= 3100);
+  CHECK(logged("No response from Soracom Harvest."));
+  CHECK_EQ(silent.sends(), 1);
+
+  // A connection that takes longer than the rest of the budget
+  Bench slow;
+  const AtStep steps[] = {
+    RESOLVE[0], RESOLVE[1],
+    { "AT+CIPSTART=0", "\r\nOK\r\n", 20 },
+    { NULL, "\r\n0, CONNECT OK\r\n", 60000 },
+  };
+  slow.sim.script(steps, 4);
+  HarvestSession<TinyGsm, TinyGsmClient> late(slow.modem, slow.client);
+  budget.start(5000);
+  start = millis();
+  CHECK(!postRecord(late, Serial, reading(42), budget));
+  took = millis() - start;
+  CHECK(took <= 5100);
+  CHECK_EQ(slow.sim.count("AT+CIPSTART"), 1);   // nothing tried past the deadline
+  CHECK(slow.sim.ok());
+}
+
+GC_TEST(harvestServerClosingAfterEachAnswer) {
+  Bench b;
+  HttpServer harvest("HTTP/1.1 201 Created\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+  harvest.closeAfter = true;
+  b.sim.serve(0, harvest);
+  b.sim.script(RESOLVE, 2);
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  uint8_t payload[GC_TELEMETRY_SIZE];
+  encodeTelemetry(reading(42), payload);
+
+  for (uint8_t i = 0; i < 3; i++) {
+    CHECK(session.post(Serial, payload, sizeof(payload)));
+    hostAdvanceMs(1000);
+  }
+  CHECK_EQ(harvest.requests(), 3);
+  CHECK_EQ(b.sim.connects(0), 3);
+  CHECK_EQ(b.sim.count("AT+CDNSGIP"), 1);
+  CHECK(b.sim.ok());
+}
+
+GC_TEST(harvestKeepsTheDownlink) {
+  Bench b;
+  HttpServer harvest("HTTP/1.1 200 OK\r\nContent-Length: 13\r\n\r\n{\"profile\":2}");
+  b.sim.serve(0, harvest);
+  b.sim.script(RESOLVE, 2);
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  uint8_t payload[GC_TELEMETRY_SIZE];
+  encodeTelemetry(reading(42), payload);
+
+  CHECK(session.post(Serial, payload, sizeof(payload)));
+  CHECK(strcmp(downlinkOf(session), "{\"profile\":2}") == 0);
+  Downlink downlink;
+  CHECK_EQ(parseDownlink(downlinkOf(session), downlink), GC_DOWNLINK_PROFILE);
+  CHECK_EQ(downlink.profileId, 2);
+  CHECK(b.sim.isOpen(0));
+}
+
+GC_TEST(harvestLostResponseBytesCloseTheConnection) {
+  Bench b;
+  const char *response = "HTTP/1.1 200 OK\r\nContent-Length: 13\r\n\r\n{\"profile\":2}";
+  HttpServer harvest(response);
+  b.sim.serve(0, harvest);
+  b.sim.script(RESOLVE, 2);
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  uint8_t payload[GC_TELEMETRY_SIZE];
+  encodeTelemetry(reading(42), payload);
+
+  // 4 bytes of the body never arrive. The URC starts with "\r\n+RECEIVE,0,52:\r\n".
+  size_t headers = strstr(response, "\r\n\r\n") + 4 - response;
+  b.sim.dropNext(4, 18 + headers + 3, true);
+  CHECK(session.post(Serial, payload, sizeof(payload)));   // 200 came through
+  CHECK_EQ(session.lastStatus(), 200);
+  CHECK(downlinkOf(session)[0] == '\0');   // no half a command
+  CHECK(!b.sim.isOpen(0));                 // closed, the stream is out of step
+
+  CHECK(session.post(Serial, payload, sizeof(payload)));
+  CHECK(strcmp(downlinkOf(session), "{\"profile\":2}") == 0);
+  CHECK_EQ(b.sim.connects(0), 2);
+  CHECK(b.sim.ok());
+}
+
+GC_TEST(harvestNoAnswerIsNotDelivered) {
+  Bench b;
+  HttpServer harvest(CREATED, 15000);      // later than GC_HARVEST_TIMEOUT_MS
+  b.sim.serve(0, harvest);
+  b.sim.script(RESOLVE, 2);
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  uint8_t payload[GC_TELEMETRY_SIZE];
+  encodeTelemetry(reading(42), payload);
+
+  CHECK(!session.post(Serial, payload, sizeof(payload)));
+  CHECK(logged("No response from Soracom Harvest."));
+  CHECK(!b.sim.isOpen(0));
+}
+
+GC_TEST(harvestConnectFailureResolvesAgain) {
+  Bench b;
+  HttpServer harvest(CREATED);
+  b.sim.serve(0, harvest);
+  const AtStep steps[] = {
+    RESOLVE[0], RESOLVE[1],
+    { "AT+CIPSTART=0,\"TCP\",\"100.127.111.112\",80", "\r\nOK\r\n\r\n0, CONNECT OK\r\n", 200 },
+    // harvest.soracom.io moved while the connection was open
+    { "AT+CIPSTART=0,\"TCP\",\"100.127.111.112\",80", "\r\nOK\r\n", 20 },
+    { NULL, "\r\n0, CONNECT FAIL\r\n", 3000 },
+    { "AT+CDNSGIP=", "\r\nOK\r\n", 20 },
+    { NULL, "\r\n+CDNSGIP: 1,\"harvest.soracom.io\",\"100.127.111.113\"\r\n", 400 },
+  };
+  b.sim.script(steps, sizeof(steps) / sizeof(steps[0]));
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  uint8_t payload[GC_TELEMETRY_SIZE];
+  encodeTelemetry(reading(42), payload);
+
+  CHECK(session.post(Serial, payload, sizeof(payload)));
+  b.sim.closeSocket(0, 10);
+  hostAdvanceMs(20);
+  CHECK(session.post(Serial, payload, sizeof(payload)));
+  CHECK(strcmp(session.address(), "100.127.111.113") == 0);
+  CHECK(strcmp(b.sim.host(0), "100.127.111.113") == 0);
+  CHECK(b.sim.done());
+  CHECK(b.sim.ok());
+}
+
+GC_TEST(harvestPostIsOneWrite) {
+  // Request line, headers and payload in one AT+CIPSEND on every Harvest path
+  Bench b;
+  HttpServer harvest(CREATED);
+  b.sim.serve(0, harvest);
+  b.sim.script(RESOLVE, 2);
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  CHECK(session.open(Serial));
+
+  StaticJsonDocument<256> doc;
+  telemetryToJson(reading(42), doc);
+  unsigned long start = millis();
+  CHECK(session.post(Serial, doc));
+  unsigned long jsonMs = millis() - start;
+  CHECK_EQ(b.sim.count("AT+CIPSEND"), 1);
+  CHECK(strstr(harvest.lastRequest(), "POST / HTTP/1.1\r\nHost: harvest.soracom.io\r\n") != NULL);
+  CHECK_EQ(harvest.lastBodyLength(), measureJson(doc));
+
+  uint8_t payload[GC_TELEMETRY_SIZE];
+  encodeTelemetry(reading(43), payload);
+  start = millis();
+  CHECK(session.post(Serial, payload, sizeof(payload)));
+  unsigned long binaryMs = millis() - start;
+  CHECK_EQ(b.sim.count("AT+CIPSEND"), 2);
+  CHECK(memcmp(harvest.lastBody(), payload, GC_TELEMETRY_SIZE) == 0);
+
+  // A connection per report
+  session.close();
+  CHECK(postToHarvest(b.client, Serial, doc));
+  CHECK(postToHarvest(b.client, Serial, payload, sizeof(payload)));
+  CHECK_EQ(b.sim.count("AT+CIPSEND"), 4);
+  CHECK_EQ(harvest.requests(), 4);
+  printf("    keep-alive post: JSON 1 AT+CIPSEND %lu ms, binary 1 AT+CIPSEND %lu ms\n",
+         jsonMs, binaryMs);
+  CHECK(b.sim.ok());
+}
+
+GC_TEST(harvestFailedWriteCloses) {
+  Bench b;
+  HttpServer harvest(CREATED);
+  b.sim.serve(0, harvest);
+  const AtStep steps[] = {
+    RESOLVE[0], RESOLVE[1],
+    { "AT+CIPSTART=0", "\r\nOK\r\n\r\n0, CONNECT OK\r\n", 100 },
+    { "AT+CIPSEND=0", "\r\n> ", 20 },
+    { AT_PAYLOAD, "\r\n0, SEND FAIL\r\n", 500 },
+  };
+  b.sim.script(steps, sizeof(steps) / sizeof(steps[0]));
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  uint8_t payload[GC_TELEMETRY_SIZE];
+  encodeTelemetry(reading(42), payload);
+
+  CHECK(!session.post(Serial, payload, sizeof(payload)));
+  CHECK(logged("Soracom Harvest write failed."));
+  CHECK(!b.sim.isOpen(0));
+  CHECK_EQ(harvest.requests(), 0);
+  CHECK(session.post(Serial, payload, sizeof(payload)));   // opens a new connection
+  CHECK_EQ(harvest.requests(), 1);
+  CHECK(b.sim.done());
+}
+
+// ======================== UNIFIED ENDPOINT ========================
+GC_TEST(unifiedTcpSendsOnlyThePayload) {
+  Bench b;
+  SinkServer uni;
+  b.sim.serve(0, uni);
+  UnifiedTcpSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  uint8_t payload[GC_TELEMETRY_SIZE];
+  encodeTelemetry(reading(42), payload);
+
+  CHECK(session.post(Serial, payload, sizeof(payload)));
+  CHECK(strcmp(b.sim.host(0), GC_UNIFIED_HOST) == 0);
+  CHECK_EQ(uni.size(), GC_TELEMETRY_SIZE);
+  CHECK(memcmp(uni.bytes(), payload, GC_TELEMETRY_SIZE) == 0);
+
+  StaticJsonDocument<256> doc;
+  telemetryToJson(reading(43), doc);
+  char json[256];
+  size_t length = serializeJson(doc, json, sizeof(json));
+  uni.clear();
+  CHECK(session.post(Serial, doc));
+  CHECK_EQ(uni.size(), length);
+  CHECK(memcmp(uni.bytes(), json, length) == 0);
+  CHECK_EQ(b.sim.connects(0), 1);
+  CHECK(b.sim.ok());
+}
+
+GC_TEST(unifiedTcpJsonIsOneWrite) {
+  StaticJsonDocument<256> doc;
+  telemetryToJson(reading(43), doc);
+  size_t length = measureJson(doc);
+
+  // Before: serializeJson straight into the client
+  Bench before;
+  SinkServer uni;
+  before.sim.serve(0, uni);
+  CHECK(before.client.connect(GC_UNIFIED_HOST, GC_UNIFIED_PORT));
+  uint32_t wire = before.sim.wireBytes();
+  unsigned long start = millis();
+  CHECK_EQ(serializeJson(doc, before.client), length);
+  unsigned long streamedMs = millis() - start;
+  uint16_t streamedSends = before.sim.count("AT+CIPSEND");
+  uint32_t streamedWire = before.sim.wireBytes() - wire;
+
+  // Now: one write through the session
+  Bench b;
+  uni.clear();
+  b.sim.serve(0, uni);
+  UnifiedTcpSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  CHECK(session.open(Serial));
+  wire = b.sim.wireBytes();
+  start = millis();
+  CHECK(session.post(Serial, doc));
+  unsigned long postMs = millis() - start;
+  CHECK_EQ(b.sim.count("AT+CIPSEND"), 1);
+  CHECK_EQ(uni.sends(), 1);
+  CHECK_EQ(uni.lastSendSize(), length);
+  CHECK(streamedSends > 10);
+  CHECK(postMs * 10 < streamedMs);
+  printf("    %u byte reading: %u AT+CIPSEND, %u bytes to the modem, %lu ms streamed; "
+         "1 AT+CIPSEND, %u bytes, %lu ms buffered\n",
+         (unsigned)length, streamedSends, (unsigned)streamedWire, streamedMs,
+         (unsigned)(b.sim.wireBytes() - wire), postMs);
+}
+
+GC_TEST(unifiedTcpReconnectsAfterClose) {
+  Bench b;
+  SinkServer uni;
+  b.sim.serve(0, uni);
+  UnifiedTcpSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  uint8_t payload[GC_TELEMETRY_SIZE];
+  encodeTelemetry(reading(42), payload);
+
+  CHECK(session.post(Serial, payload, sizeof(payload)));
+  b.sim.closeSocket(0, 10);
+  hostAdvanceMs(20);
+  CHECK(session.post(Serial, payload, sizeof(payload)));
+  CHECK_EQ(b.sim.connects(0), 2);
+  CHECK_EQ(uni.sends(), 2);
+}
+
+GC_TEST(unifiedTcpFailedSendCloses) {
+  Bench b;
+  SinkServer uni;
+  b.sim.serve(0, uni);
+  const AtStep steps[] = {
+    { "AT+CIPSEND=0,8", "\r\n> ", 20 },
+    { AT_PAYLOAD, "\r\n0, SEND FAIL\r\n", 500 },
+  };
+  b.sim.script(steps, 2);
+  UnifiedTcpSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  uint8_t payload[GC_TELEMETRY_SIZE];
+  encodeTelemetry(reading(42), payload);
+
+  CHECK(!session.post(Serial, payload, sizeof(payload)));
+  CHECK(logged("Unified Endpoint write failed."));
+  CHECK(!b.sim.isOpen(0));
+  CHECK_EQ(uni.sends(), 0);
+  CHECK(session.post(Serial, payload, sizeof(payload)));
+  CHECK_EQ(uni.sends(), 1);
+  CHECK(b.sim.done());
+}
+
+GC_TEST(unifiedUdpSendsOneDatagram) {
+  Bench b;
+  SinkServer uni;
+  b.sim.serve(GC_UDP_MUX, uni);
+  UnifiedUdpSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  uint8_t payload[GC_TELEMETRY_SIZE];
+  encodeTelemetry(reading(42), payload);
+
+  CHECK(session.post(Serial, payload, sizeof(payload)));
+  CHECK(strcmp(b.sim.host(GC_UDP_MUX), GC_UNIFIED_HOST) == 0);
+  CHECK_EQ(b.sim.count("AT+CIPSTART=1,\"UDP\""), 1);
+  CHECK_EQ(uni.sends(), 1);
+  CHECK_EQ(uni.lastSendSize(), GC_TELEMETRY_SIZE);
+
+  StaticJsonDocument<256> doc;
+  telemetryToJson(reading(43), doc);
+  CHECK(session.post(Serial, doc));
+  CHECK_EQ(uni.sends(), 2);                 // the whole document in one datagram
+  CHECK_EQ(uni.lastSendSize(), measureJson(doc));
+  CHECK_EQ(b.sim.connects(GC_UDP_MUX), 1);
+
+  session.close();
+  CHECK(!b.sim.isOpen(GC_UDP_MUX));
+  CHECK(b.sim.ok());
+}
+
+GC_TEST(unifiedUdpOpenAndSendFailures) {
+  Bench b;
+  SinkServer uni;
+  b.sim.serve(GC_UDP_MUX, uni);
+  const AtStep steps[] = {
+    { "AT+CIPSTART=1", "\r\n+CME ERROR: 3\r\n", 50 },
+    { "AT+CIPSTART=1", "\r\nOK\r\n", 50 },
+    { NULL, "\r\n1, CONNECT OK\r\n", 300 },
+    { "AT+CIPSEND=1,8", "\r\n> ", 20 },
+    { AT_PAYLOAD, "\r\n1, SEND FAIL\r\n", 200 },
+  };
+  b.sim.script(steps, sizeof(steps) / sizeof(steps[0]));
+  UnifiedUdpSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+  uint8_t payload[GC_TELEMETRY_SIZE];
+  encodeTelemetry(reading(42), payload);
+
+  CHECK(!session.post(Serial, payload, sizeof(payload)));   // +CME ERROR
+  CHECK(!session.post(Serial, payload, sizeof(payload)));   // SEND FAIL
+  CHECK(logged("UDP send failed."));
+  CHECK_EQ(uni.sends(), 0);
+  CHECK(b.sim.done());
+  CHECK(!b.sim.isOpen(GC_UDP_MUX));                         // closed on the modem too
+
+  // The next post opens the socket again instead of getting ALREADY CONNECT
+  CHECK(session.post(Serial, payload, sizeof(payload)));
+  CHECK_EQ(uni.sends(), 1);
+  CHECK_EQ(b.sim.connects(GC_UDP_MUX), 2);
+  CHECK(b.sim.ok());
+}
+
+// ======================== sendQueued ========================
+GC_TEST(sendQueuedKeepsTheOrderAcrossAFailure) {
+  Bench b;
+  RamStore::erase();
+  ReadingQueue<8, RamStore> queue;
+  queue.begin();
+  for (uint8_t i = 0; i < 3; i++) {
+    queue.push(reading(40 + i));
+  }
+
+  // Every report connects again
+  HttpServer harvest("HTTP/1.1 201 Created\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+  harvest.closeAfter = true;
+  b.sim.serve(0, harvest);
+  const AtStep steps[] = {
+    RESOLVE[0], RESOLVE[1],
+    { "AT+CIPSTART=0", "\r\nOK\r\n\r\n0, CONNECT OK\r\n", 100 },
+    { "AT+CIPSTART=0", "\r\nOK\r\n\r\n0, CONNECT OK\r\n", 100 },
+    // the third reading cannot be sent
+    { "AT+CIPSTART=0", "\r\nOK\r\n\r\n0, CONNECT FAIL\r\n", 100 },
+    { "AT+CDNSGIP=", "\r\n+CME ERROR: 8\r\n", 100 },
+    { "AT+CIPSTART=0,\"TCP\",\"harvest.soracom.io\"", "\r\nOK\r\n\r\n0, CONNECT FAIL\r\n", 100 },
+    // the next report finds the network back
+    RESOLVE[0], RESOLVE[1],
+  };
+  b.sim.script(steps, sizeof(steps) / sizeof(steps[0]));
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+
+  CHECK_EQ(sendQueued(session, Serial, queue), 2);
+  CHECK_EQ(queue.size(), 1);
+  CHECK(strstr(harvest.lastRequest(), "\"fullness\":41") != NULL);
+  CHECK(strstr(harvest.lastRequest(), "\"age\":") != NULL);
+
+  // Network back, the rest goes out in order
+  CHECK_EQ(sendQueued(session, Serial, queue), 1);
+  CHECK(strstr(harvest.lastRequest(), "\"fullness\":42") != NULL);
+  CHECK(queue.empty());
+  CHECK_EQ(harvest.requests(), 3);
+  CHECK(b.sim.done());
+  CHECK(b.sim.ok());
+}
+
+GC_TEST(sendQueuedGetsPastACorruptSlot) {
+  Bench b;
+  RamStore::erase();
+  ReadingQueue<8, RamStore> queue;
+  queue.begin();
+  for (uint8_t i = 0; i < 4; i++) {
+    queue.push(reading(50 + i));
+  }
+  // A bad byte in the record of the second reading
+  int addr = GC_QUEUE_HEADER_SIZE + 1 * GC_QUEUE_SLOT_SIZE + 7;
+  RamStore::write(addr, RamStore::read(addr) ^ 0xE0);
+
+  HttpServer harvest(CREATED);
+  b.sim.serve(0, harvest);
+  b.sim.script(RESOLVE, 2);
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+
+  CHECK_EQ(sendQueued(session, Serial, queue), 3);
+  CHECK(queue.empty());
+  CHECK_EQ(queue.dropped(), 1);
+  CHECK(strstr(harvest.lastRequest(), "\"fullness\":53") != NULL);
+  CHECK(b.sim.ok());
+}
+
+GC_TEST(sendQueuedSendsBatches) {
+  Bench b;
+  RamStore::erase();
+  ReadingQueue<8, RamStore> queue;
+  queue.begin();
+  for (uint8_t i = 0; i < 5; i++) {
+    queue.push(reading(60 + i));
+  }
+
+  HttpServer harvest("HTTP/1.1 201 Created\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+  harvest.closeAfter = true;
+  b.sim.serve(0, harvest);
+  const AtStep steps[] = {
+    RESOLVE[0], RESOLVE[1],
+    { "AT+CIPSTART=0", "\r\nOK\r\n\r\n0, CONNECT OK\r\n", 100 },
+    // the second batch cannot be sent
+    { "AT+CIPSTART=0", "\r\nOK\r\n\r\n0, CONNECT FAIL\r\n", 100 },
+    { "AT+CDNSGIP=", "\r\n+CME ERROR: 8\r\n", 100 },
+    { "AT+CIPSTART=0,\"TCP\",\"harvest.soracom.io\"", "\r\nOK\r\n\r\n0, CONNECT FAIL\r\n", 100 },
+    RESOLVE[0], RESOLVE[1],
+  };
+  b.sim.script(steps, sizeof(steps) / sizeof(steps[0]));
+  HarvestSession<TinyGsm, TinyGsmClient> session(b.modem, b.client);
+
+  // Three readings in one POST, the newest at the top
+  CHECK_EQ(sendQueued<3>(session, Serial, queue), 3);
+  CHECK_EQ(queue.size(), 2);
+  CHECK_EQ(harvest.requests(), 1);
+  const char *body = strstr(harvest.lastRequest(), "\r\n\r\n");
+  CHECK(body != NULL && strstr(body, "\"fullness\":62") < strstr(body, "\"readings\""));
+  CHECK(strstr(body, "\"fullness\":60") != NULL);
+  CHECK(strstr(body, "\"fullness\":61") != NULL);
+
+  // The failed batch stays queued and goes out whole next time
+  CHECK_EQ(sendQueued<3>(session, Serial, queue), 2);
+  CHECK(queue.empty());
+  CHECK_EQ(harvest.requests(), 2);
+  CHECK(strstr(harvest.lastRequest(), "\"fullness\":64") != NULL);
+  CHECK(strstr(harvest.lastRequest(), "\"fullness\":63") != NULL);
+  CHECK(b.sim.done());
+  CHECK(b.sim.ok());
+}
+
+int main() {
+  return gcRunTests();
+}
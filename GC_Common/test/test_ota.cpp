@@ -0,0 +1,379 @@
+/*
+GreenCampus SmartDumpster - Host tests
+- test_ota.cpp
+
+OtaUpdater (GC_Ota.h) downloading from a RangeServer (AtSim.h) through the
+simulated SIM7000, into a partition in RAM: the bytes it costs, plain and
+packed, resuming after a dropped connection and a reset, and what happens to
+an image that does not check out. The bootloader side of the rollback
+(pending verify, otaRollback) is ESP-IDF and only runs on the board.
+*/
+
+#include "GcTest.h"
+#include "AtSim.h"
+
+#include <TinyGsmClient.h>
+#include <GC_Queue.h>
+#include <GC_Ota.h>
+
+// ======================== HELPERS ========================
+namespace {
+  const uint32_t IMAGE_SIZE = 45000;     // 11 blocks, the last one short
+  const uint32_t CURRENT = 1;            // GC_FIRMWARE_VERSION of the running firmware
+
+  // ---- SHA-256 (FIPS 180-4), what mbedtls computes on the board ----
+  const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+  };
+
+  uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+  void sha256Block(uint32_t h[8], const uint8_t *p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+      w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+      uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+      uint32_t t1 = k + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+      uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+      k = g; g = f; f = e; e = d + t1;
+      d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+  }
+
+  void sha256(const uint8_t *data, size_t size, uint8_t digest[32]) {
+    uint32_t h[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    size_t done = 0;
+    for (; size - done >= 64; done += 64) {
+      sha256Block(h, data + done);
+    }
+    uint8_t tail[128] = {};
+    size_t rest = size - done;
+    memcpy(tail, data + done, rest);
+    tail[rest] = 0x80;
+    size_t tailSize = rest < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t)size * 8;
+    for (int i = 0; i < 8; i++) {
+      tail[tailSize - 1 - i] = bits >> (8 * i);
+    }
+    for (size_t i = 0; i < tailSize; i += 64) {
+      sha256Block(h, tail + i);
+    }
+    for (int i = 0; i < 32; i++) {
+      digest[i] = h[i / 4] >> (24 - 8 * (i % 4));
+    }
+  }
+
+  // ---- LZ4 block format, a greedy packer like ota_pack.py writes ----
+  void putLength(uint8_t *dst, size_t &o, size_t rest) {
+    for (; rest >= 255; rest -= 255) {
+      dst[o++] = 255;
+    }
+    dst[o++] = (uint8_t)rest;
+  }
+
+  uint32_t read32(const uint8_t *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+  size_t lz4Pack(const uint8_t *src, size_t n, uint8_t *dst) {
+    int32_t table[4096];
+    for (int i = 0; i < 4096; i++) table[i] = -1;
+    size_t anchor = 0, i = 0, o = 0;
+    size_t limit = n > 12 ? n - 12 : 0;     // the last match starts 12 bytes before the end
+    while (i < limit) {
+      uint32_t seq = read32(src + i);
+      uint32_t hash = (seq * 2654435761u) >> 20;
+      int32_t ref = table[hash];
+      table[hash] = (int32_t)i;
+      if (ref < 0 || i - ref > 65535 || read32(src + ref) != seq) {
+        i++;
+        continue;
+      }
+      size_t match = 4;
+      while (i + match < n - 5 && src[ref + match] == src[i + match]) match++;
+      size_t literals = i - anchor;
+      size_t token = o++;
+      dst[token] = (uint8_t)((literals < 15 ? literals : 15) << 4 | (match - 4 < 15 ? match - 4 : 15));
+      if (literals >= 15) putLength(dst, o, literals - 15);
+      memcpy(dst + o, src + anchor, literals);
+      o += literals;
+      dst[o++] = (uint8_t)(i - ref);
+      dst[o++] = (uint8_t)((i - ref) >> 8);
+      if (match - 4 >= 15) putLength(dst, o, match - 4 - 15);
+      i += match;
+      anchor = i;
+    }
+    size_t literals = n - anchor;
+    dst[o++] = (uint8_t)((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15) putLength(dst, o, literals - 15);
+    memcpy(dst + o, src + anchor, literals);
+    return o + literals;
+  }
+
+  // ---- What is on the server ----
+  uint8_t image[IMAGE_SIZE];
+  uint8_t packed[IMAGE_SIZE + 1024];
+  size_t packedSize;
+  char manifest[128];
+
+  // Code-like: runs that repeat with a few changes, and some noise
+  void makeImage() {
+    uint32_t x = 12345;
+    for (uint32_t i = 0; i < IMAGE_SIZE; i++) {
+      x = x * 1103515245 + 12345;
+      image[i] = (i / 64) % 2 == 0 ? (uint8_t)(x >> 24) : (uint8_t)(i % 64 * 3 + i / 4096);
+    }
+  }
+
+  // The packed image of image[], see GC_Ota.h for the layout
+  void makePacked() {
+    uint32_t count = (IMAGE_SIZE + GC_OTA_CHUNK_SIZE - 1) / GC_OTA_CHUNK_SIZE;
+    packed[0] = count >> 8;
+    packed[1] = count;
+    packedSize = 2 + 2 * count;
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t offset = i * GC_OTA_CHUNK_SIZE;
+      uint32_t length = IMAGE_SIZE - offset < GC_OTA_CHUNK_SIZE ? IMAGE_SIZE - offset : GC_OTA_CHUNK_SIZE;
+      size_t size = lz4Pack(image + offset, length, packed + packedSize);
+      packed[2 + 2 * i] = size >> 8;
+      packed[3 + 2 * i] = size;
+      packedSize += size;
+    }
+  }
+
+  void makeManifest(uint32_t version, bool lz4) {
+    uint8_t digest[32];
+    sha256(image, IMAGE_SIZE, digest);
+    int n = snprintf(manifest, sizeof(manifest), "%u %u ", (unsigned)version, (unsigned)IMAGE_SIZE);
+    for (int i = 0; i < 32; i++) {
+      n += snprintf(manifest + n, sizeof(manifest) - n, "%02x", digest[i]);
+    }
+    snprintf(manifest + n, sizeof(manifest) - n, "%s\n", lz4 ? " lz4" : "");
+  }
+
+  // The OTA partition in RAM
+  struct RamPartition {
+    uint8_t flash[48 * 1024];
+    bool activated = false;
+    bool rejects = false;      // activate() fails, like esp_ota_set_boot_partition on a bad image
+
+    bool begin(uint32_t size) { return size <= sizeof(flash); }
+    uint32_t address() const { return 0x110000; }
+    bool write(uint32_t offset, const uint8_t *data, size_t length) {
+      memcpy(flash + offset, data, length);
+      return true;
+    }
+    bool sha256(uint32_t size, uint8_t *digest) {
+      ::sha256(flash, size, digest);
+      return true;
+    }
+    bool activate() {
+      activated = !rejects;
+      return activated;
+    }
+  };
+
+  typedef OtaUpdater<TinyGsmClient, RamPartition, RamStore> Updater;
+
+  // The modem, the file server on GC_OTA_MUX and the partition, fresh for every test
+  struct Bench {
+    AtSim sim;
+    TinyGsm modem;
+    TinyGsmClient client;
+    RangeServer::File files[3];
+    RangeServer server;
+    RamPartition partition;
+
+    Bench(bool lz4, bool withPacked = true)
+      : modem(sim), client(modem, GC_OTA_MUX),
+        files{ { GC_OTA_MANIFEST_PATH, (const uint8_t *)manifest, 0 },
+               { GC_OTA_IMAGE_PATH, image, IMAGE_SIZE },
+               { GC_OTA_PACKED_PATH, packed, 0 } },
+        server(files, withPacked ? 3 : 2) {
+      makeImage();
+      makePacked();
+      makeManifest(CURRENT + 1, lz4);
+      files[0].size = strlen(manifest);
+      files[2].size = packedSize;
+      memset(partition.flash, 0xFF, sizeof(partition.flash));
+      sim.serve(GC_OTA_MUX, server);
+      RamStore::erase();
+      Serial.clearWritten();
+    }
+
+    bool flashed() const { return memcmp(partition.flash, image, IMAGE_SIZE) == 0; }
+  };
+
+  bool logged(const char *text) { return strstr(Serial.written(), text) != NULL; }
+
+  const uint32_t BLOCKS = (IMAGE_SIZE + GC_OTA_CHUNK_SIZE - 1) / GC_OTA_CHUNK_SIZE;
+}
+
+// ======================== TESTS ========================
+GC_TEST(upToDateFetchesOnlyTheManifest) {
+  Bench b(false);
+  makeManifest(CURRENT, false);
+  b.files[0].size = strlen(manifest);
+  Updater updater(b.client, b.partition, 0);
+  CHECK_EQ(updater.update(Serial, CURRENT), GC_OTA_NONE);
+  CHECK_EQ(b.server.requests(), 1);
+  CHECK_EQ(updater.bytesReceived(), strlen(manifest));
+  CHECK(!b.partition.activated);
+}
+
+GC_TEST(plainImageInSectorChunks) {
+  Bench b(false);
+  Updater updater(b.client, b.partition, 0);
+  CHECK_EQ(updater.update(Serial, CURRENT), GC_OTA_READY);
+  CHECK(b.flashed());
+  CHECK(b.partition.activated);
+  CHECK(!updater.pending());
+  // The manifest, then one Range request per sector, every byte once
+  CHECK_EQ(b.server.requests(), 1 + BLOCKS);
+  CHECK_EQ(updater.bytesReceived(), strlen(manifest) + IMAGE_SIZE);
+  CHECK_EQ(b.sim.connects(GC_OTA_MUX), 1);
+  CHECK(b.sim.ok());
+}
+
+GC_TEST(packedImageCostsLess) {
+  Bench b(true);
+  Updater updater(b.client, b.partition, 0);
+  CHECK_EQ(updater.update(Serial, CURRENT), GC_OTA_READY);
+  CHECK(b.flashed());
+  CHECK(b.partition.activated);
+  // The manifest, the block sizes, then one Range request per block
+  CHECK_EQ(b.server.requests(), 2 + BLOCKS);
+  CHECK_EQ(updater.bytesReceived(), strlen(manifest) + packedSize);
+  CHECK(packedSize < IMAGE_SIZE * 6 / 10);
+  printf("    packed image: %u of %u bytes (%u%%)\n",
+         (unsigned)packedSize, (unsigned)IMAGE_SIZE, (unsigned)(100 * packedSize / IMAGE_SIZE));
+}
+
+GC_TEST(missingPackedImageFallsBackToThePlainOne) {
+  Bench b(true, false);
+  Updater updater(b.client, b.partition, 0);
+  CHECK_EQ(updater.update(Serial, CURRENT), GC_OTA_READY);
+  CHECK(logged("Packed firmware not available: 404"));
+  CHECK(b.flashed());
+  CHECK_EQ(updater.bytesReceived(), strlen(manifest) + IMAGE_SIZE);
+}
+
+GC_TEST(plainResumesAfterADroppedConnectionAndAReset) {
+  Bench b(false);
+  b.server.dropRequest = 1 + 4;         // the 4th chunk
+  b.server.dropAfter = 1000;
+  uint32_t received;
+  {
+    Updater updater(b.client, b.partition, 0);
+    CHECK_EQ(updater.update(Serial, CURRENT), GC_OTA_PARTIAL);
+    CHECK(updater.pending());
+    received = updater.bytesReceived();
+    CHECK_EQ(received, strlen(manifest) + 3 * GC_OTA_CHUNK_SIZE + 1000);
+  }
+
+  // The board resets, the next boot goes on with the 4th chunk
+  b.server.clear();
+  Updater updater(b.client, b.partition, 0);
+  CHECK_EQ(updater.update(Serial, CURRENT), GC_OTA_READY);
+  CHECK(logged("from byte 12288 of 45000"));
+  CHECK_EQ(b.server.requests(), 1 + BLOCKS - 3);
+  CHECK_EQ(updater.bytesReceived(), strlen(manifest) + IMAGE_SIZE - 3 * GC_OTA_CHUNK_SIZE);
+  CHECK(b.flashed());
+  CHECK(b.partition.activated);
+  CHECK_EQ(b.sim.connects(GC_OTA_MUX), 2);
+}
+
+GC_TEST(packedResumesAfterADroppedConnection) {
+  Bench b(true);
+  b.server.dropRequest = 2 + 6;         // the 6th block
+  b.server.dropAfter = 50;
+  Updater updater(b.client, b.partition, 0);
+  CHECK_EQ(updater.update(Serial, CURRENT), GC_OTA_PARTIAL);
+  uint32_t first = updater.bytesReceived();
+
+  b.server.clear();
+  CHECK_EQ(updater.update(Serial, CURRENT), GC_OTA_READY);
+  CHECK(logged("from byte 20480 of 45000"));
+  // The manifest and the block sizes again, and the 50 bytes that were cut
+  uint32_t table = 2 + 2 * BLOCKS;
+  CHECK_EQ(updater.bytesReceived(), 2 * strlen(manifest) + table + packedSize + 50);
+  CHECK_EQ(b.server.requests(), 2 + BLOCKS - 5);
+  CHECK(first < updater.bytesReceived());
+  CHECK(b.flashed());
+}
+
+GC_TEST(deadlineStopsBetweenChunks) {
+  Bench b(false);
+  Updater updater(b.client, b.partition, 0);
+  TaskTimer budget;
+  budget.start(1);
+  CHECK_EQ(updater.update(Serial, CURRENT, budget), GC_OTA_PARTIAL);
+  CHECK(updater.pending());
+  CHECK_EQ(updater.update(Serial, CURRENT), GC_OTA_READY);
+  CHECK(b.flashed());
+}
+
+GC_TEST(imageThatDoesNotMatchIsDiscarded) {
+  Bench b(false);
+  image[30000] ^= 0x01;                 // the server has a broken copy
+  Updater updater(b.client, b.partition, 0);
+  CHECK_EQ(updater.update(Serial, CURRENT), GC_OTA_FAILED);
+  CHECK(logged("Firmware hash does not match, discarded"));
+  CHECK(!b.partition.activated);
+  CHECK(!updater.pending());
+
+  // Fixed on the server, the next try starts over from the first byte
+  image[30000] ^= 0x01;
+  Serial.clearWritten();
+  CHECK_EQ(updater.update(Serial, CURRENT), GC_OTA_READY);
+  CHECK(logged("from byte 0 of 45000"));
+  CHECK(b.flashed());
+  CHECK(b.partition.activated);
+}
+
+GC_TEST(corruptBlockStartsOver) {
+  Bench b(true);
+  uint32_t table = 2 + 2 * BLOCKS;
+  packed[table] = 0x0F;                 // no literals, then a match with nothing before it
+  Updater updater(b.client, b.partition, 0);
+  CHECK_EQ(updater.update(Serial, CURRENT), GC_OTA_FAILED);
+  CHECK(logged("Packed firmware block 0 is corrupt"));
+  CHECK(!b.partition.activated);
+  CHECK(!updater.pending());
+}
+
+GC_TEST(rejectedImageIsNotBooted) {
+  Bench b(true);
+  b.partition.rejects = true;
+  Updater updater(b.client, b.partition, 0);
+  CHECK_EQ(updater.update(Serial, CURRENT), GC_OTA_FAILED);
+  CHECK(logged("Firmware image rejected"));
+  CHECK(!b.partition.activated);
+  CHECK(!updater.pending());
+}
+
+GC_TEST(manifestWithLz4IsRead) {
+  OtaManifest m = {};
+  CHECK(parseOtaManifest("2 1048576 9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08 lz4\n", m));
+  CHECK(m.packed);
+  CHECK(parseOtaManifest("2 1048576 9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08\n", m));
+  CHECK(!m.packed);
+  CHECK_EQ(m.size, 1048576);
+}
+
+int main() {
+  return gcRunTests();
+}
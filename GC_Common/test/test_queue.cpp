@@ -0,0 +1,260 @@
+/*
+GreenCampus SmartDumpster - Host tests
+- test_queue.cpp
+
+ReadingQueue (GC_Queue.h) on a RAM EEPROM: order, resets, a full ring, the
+ages of readings queued in an earlier boot, and a slot that went bad.
+*/
+
+#include "GcTest.h"
+
+#include <GC_Queue.h>
+
+#include <new>
+
+// ======================== HELPERS ========================
+namespace {
+  typedef ReadingQueue<8, RamStore, 1> Queue;
+
+  TelemetryRecord reading(uint8_t fullness) {
+    TelemetryRecord r = { 1, fullness, 21, 40, GC_HEALTH_OK, 0, 0 };
+    return r;
+  }
+
+  // Flip the version bits of the record in the slot of seq, decodeTelemetry()
+  // no longer takes it
+  void corruptSlot(uint8_t slots, uint16_t seq) {
+    int addr = GC_QUEUE_HEADER_SIZE + (seq & (slots - 1)) * GC_QUEUE_SLOT_SIZE + 7;
+    RamStore::write(addr, RamStore::read(addr) ^ 0xE0);
+  }
+
+  // A reset: the next boot builds a new queue on the same EEPROM
+  template <typename Q>
+  void reboot(Q &queue) {
+    queue.~Q();
+    new (&queue) Q();
+    queue.begin();
+  }
+}
+
+// ======================== TESTS ========================
+GC_TEST(keepsTheOrder) {
+  RamStore::erase();
+  Queue queue;
+  CHECK_EQ(queue.begin(), 0);
+  for (uint8_t i = 0; i < 5; i++) {
+    queue.push(reading(10 + i));
+  }
+  CHECK_EQ(queue.size(), 5);
+  TelemetryRecord record = {};
+  for (uint8_t i = 0; i < 5; i++) {
+    CHECK(queue.peek(record));
+    CHECK_EQ(record.fullness, 10 + i);
+    CHECK(record.health & GC_HEALTH_QUEUED);
+    queue.pop();
+  }
+  CHECK(!queue.peek(record));
+  queue.commit();
+  CHECK(queue.empty());
+}
+
+GC_TEST(survivesAReset) {
+  RamStore::erase();
+  Queue queue;
+  queue.begin();
+  for (uint8_t i = 0; i < 3; i++) {
+    queue.push(reading(20 + i));
+  }
+  TelemetryRecord record = {};
+  queue.peek(record);
+  queue.pop();
+  queue.commit();             // the first one was sent
+
+  reboot(queue);
+  CHECK_EQ(queue.size(), 2);
+  CHECK(queue.peek(record));
+  CHECK_EQ(record.fullness, 21);
+}
+
+GC_TEST(fullQueueDropsTheOldest) {
+  RamStore::erase();
+  Queue queue;
+  queue.begin();
+  for (uint8_t i = 0; i < 8 + 3; i++) {
+    queue.push(reading(i));
+  }
+  CHECK_EQ(queue.size(), 8);
+  TelemetryRecord record = {};
+  CHECK(queue.peek(record));
+  CHECK_EQ(record.fullness, 3);
+
+  reboot(queue);
+  CHECK_EQ(queue.size(), 8);
+  CHECK(queue.peek(record));
+  CHECK_EQ(record.fullness, 3);
+}
+
+GC_TEST(ageOfAReadingFromThisBoot) {
+  RamStore::erase();
+  Queue queue;
+  queue.begin();
+  queue.push(reading(30));
+  hostAdvanceMs(42500);
+  TelemetryRecord record = {};
+  CHECK(queue.peek(record));
+  CHECK_EQ(record.age, 42);
+}
+
+GC_TEST(ageOfAReadingFromAnotherBootIsUnknown) {
+  RamStore::erase();
+  Queue queue;
+  queue.begin();
+  queue.push(reading(40));
+
+  // millis() starts again after a reset. The host clock does not go back,
+  // so without the boot number the old stamp would give a plausible age.
+  reboot(queue);
+  hostAdvanceMs(5000);
+  TelemetryRecord record = {};
+  CHECK(queue.peek(record));
+  CHECK_EQ(record.fullness, 40);
+  CHECK_EQ(record.age, GC_AGE_UNKNOWN);
+
+  // A reading of this boot behind it still gets its age
+  queue.push(reading(41));
+  hostAdvanceMs(7000);
+  queue.pop();
+  CHECK(queue.peek(record));
+  CHECK_EQ(record.fullness, 41);
+  CHECK_EQ(record.age, 7);
+}
+
+GC_TEST(stagedReadingsGetTheirAge) {
+  RamStore::erase();
+  ReadingQueue<8, RamStore, 4> queue;
+  queue.begin();
+  queue.push(reading(50));
+  hostAdvanceMs(3000);
+  TelemetryRecord record = {};
+  CHECK(queue.peek(record));   // still in RAM
+  CHECK_EQ(record.age, 3);
+}
+
+GC_TEST(bootThatQueuesNothingWritesNothing) {
+  RamStore::erase();
+  Queue queue;
+  queue.begin();
+  queue.push(reading(60));
+
+  uint32_t writes = RamStore::writes();
+  reboot(queue);
+  reboot(queue);
+  CHECK_EQ(RamStore::writes(), writes);
+
+  // The first reading of a boot writes the boot number once
+  queue.push(reading(61));
+  queue.push(reading(62));
+  CHECK_EQ(RamStore::writes() - writes, 2 * GC_QUEUE_SLOT_SIZE + 1);
+}
+
+GC_TEST(bootNumberWrapsPastQueuedSlots) {
+  RamStore::erase();
+  Queue queue;
+  queue.begin();
+  queue.push(reading(70));
+  uint8_t written = RamStore::read(6);
+
+  // 255 boots later the next number would be the one in the queued slot
+  RamStore::write(6, written - 1);
+  reboot(queue);
+  TelemetryRecord record = {};
+  CHECK(queue.peek(record));
+  CHECK_EQ(record.age, GC_AGE_UNKNOWN);
+}
+
+GC_TEST(olderLayoutIsFormatted) {
+  RamStore::erase();
+  Queue queue;
+  queue.begin();
+  queue.push(reading(80));
+  RamStore::write(2, 1);     // version 1, slots without the boot number
+  reboot(queue);
+  CHECK(queue.empty());
+}
+
+GC_TEST(corruptSlotIsDropped) {
+  RamStore::erase();
+  Queue queue;
+  queue.begin();
+  for (uint8_t i = 0; i < 5; i++) {
+    queue.push(reading(90 + i));
+  }
+  corruptSlot(8, 1);
+  corruptSlot(8, 4);          // the last one too
+
+  // The bad slots are skipped, the readings behind them still come out
+  TelemetryRecord record = {};
+  const uint8_t expected[] = { 90, 92, 93 };
+  for (uint8_t i = 0; i < 3; i++) {
+    CHECK(queue.peek(record));
+    CHECK_EQ(record.fullness, expected[i]);
+    queue.pop();
+  }
+  CHECK(!queue.peek(record));
+  CHECK(queue.empty());
+  CHECK_EQ(queue.dropped(), 2);
+
+  // The drain is saved, the bad slots do not come back after a reset
+  queue.commit();
+  reboot(queue);
+  CHECK(queue.empty());
+}
+
+GC_TEST(stagedReadingBehindACorruptSlot) {
+  RamStore::erase();
+  ReadingQueue<8, RamStore, 4> queue;
+  queue.begin();
+  queue.push(reading(95));
+  queue.flush();
+  corruptSlot(8, 0);
+  queue.push(reading(96));    // still in RAM
+  hostAdvanceMs(2000);
+  TelemetryRecord record = {};
+  CHECK(queue.peek(record));
+  CHECK_EQ(record.fullness, 96);
+  CHECK_EQ(record.age, 2);
+  CHECK_EQ(queue.dropped(), 1);
+}
+
+GC_TEST(peekAhead) {
+  RamStore::erase();
+  ReadingQueue<8, RamStore, 4> queue;
+  queue.begin();
+  for (uint8_t i = 0; i < 3; i++) {
+    queue.push(reading(30 + i));
+  }
+  queue.flush();
+  queue.push(reading(33));    // still in RAM
+
+  // EEPROM slots first, then the staged reading, nothing is taken out
+  TelemetryRecord record = {};
+  for (uint8_t i = 0; i < 4; i++) {
+    CHECK(queue.peek(record, i));
+    CHECK_EQ(record.fullness, 30 + i);
+  }
+  CHECK(!queue.peek(record, 4));
+  CHECK_EQ(queue.size(), 4);
+
+  // A bad slot further back ends the look-ahead, it is dropped once it is at the front
+  corruptSlot(8, 1);
+  CHECK(queue.peek(record, 0));
+  CHECK(!queue.peek(record, 1));
+  queue.pop();
+  CHECK(queue.peek(record, 1));
+  CHECK_EQ(record.fullness, 33);
+  CHECK_EQ(queue.dropped(), 1);
+}
+
+int main() {
+  return gcRunTests();
+}
@@ -0,0 +1,62 @@
+/*
+GreenCampus SmartDumpster - Host tests
+- test_task.cpp
+
+StageTiming (GC_Task.h): durations, the gap between runs, and an average that
+stays right after more than 4295 s of stage time, where a 32 bit sum of
+microseconds wraps.
+*/
+
+#include "GcTest.h"
+
+#include <GC_Task.h>
+
+// ======================== HELPERS ========================
+namespace {
+  const uint32_t CALL_US = 10;    // the host clock moves 10 us per micros() call
+
+  // One run of the stage that takes ms, then idle ms until the next one
+  void run(StageTiming &t, uint32_t ms, uint32_t idleMs = 0) {
+    t.begin();
+    hostAdvanceMs(ms);
+    t.end();
+    hostAdvanceMs(idleMs);
+  }
+}
+
+// ======================== TESTS ========================
+GC_TEST(durationsAndGap) {
+  StageTiming t = {};
+  run(t, 20, 4980);
+  run(t, 50, 4950);
+  run(t, 30, 30000);       // the next start is late
+  run(t, 10);
+  CHECK_EQ(t.runs, 4);
+  CHECK_EQ(t.lastUs, 10000 + CALL_US);
+  CHECK_EQ(t.maxUs, 50000 + CALL_US);
+  CHECK_EQ(t.averageUs(), 27500 + CALL_US);
+  CHECK_EQ(t.maxGapMs, 30030);
+}
+
+GC_TEST(averagePastTheWrap) {
+  // An uplink stage of 12 s per report: 400 reports are 4800 s of stage time
+  StageTiming t = {};
+  for (uint16_t i = 0; i < 400; i++) {
+    run(t, 12000, 1000);
+  }
+  CHECK(t.totalUs > 0xFFFFFFFFULL);
+  CHECK_EQ(t.runs, 400);
+  CHECK_EQ(t.averageUs(), 12000000 + CALL_US);
+  CHECK_EQ(t.maxUs, 12000000 + CALL_US);
+}
+
+GC_TEST(noRunsYet) {
+  StageTiming t = {};
+  CHECK_EQ(t.averageUs(), 0);
+  t.begin();
+  CHECK_EQ(t.maxGapMs, 0);
+}
+
+int main() {
+  return gcRunTests();
+}
@@ -0,0 +1,250 @@
+/*
+GreenCampus SmartDumpster - Host tests
+- test_telemetry.cpp
+
+The binary record (GC_Telemetry.h) through both ends: encodeTelemetry() on
+the board, then GC_TELEMETRY_PARSER the way Soracom's Binary Parser reads it.
+The parser below follows the format of
+https://developers.soracom.io/en/docs/binary-parser/ for the types the
+record can use, so a wrong byte offset, bit position, byte order or a signed
+type in the string shows up here and not in Harvest.
+*/
+
+#include "GcTest.h"
+
+#include <GC_Telemetry.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+// ======================== BINARY PARSER ========================
+namespace {
+  const uint8_t MAX_FIELDS = 16;
+
+  struct Field {
+    char name[16];
+    long value;
+    uint8_t offset;
+    uint8_t bits;     // width in bits
+    uint8_t lsb;      // bit position of the lowest bit, 0 to 7, in the last byte
+  };
+
+  /*
+  binaryParse - Decode bytes with a Binary Parser format string.
+
+  Each space separated field is name:offset:type with the types
+    uint8, int8                      one byte
+    uint16, int16, uint32, int32     followed by :big-endian or :little-endian
+    uint:bits:pos, int:bits:pos      bits bits from bit pos (7 is the MSB) down
+  The byte order has to be given, the string should not depend on a default.
+
+  Returns the number of fields, 0 if the string cannot be read or a field
+  reaches past the bytes.
+  */
+  uint8_t binaryParse(const char *format, const uint8_t *bytes, size_t length, Field *fields) {
+    char copy[256];
+    strncpy(copy, format, sizeof(copy) - 1);
+    copy[sizeof(copy) - 1] = '\0';
+
+    uint8_t n = 0;
+    char *saveField = NULL;
+    for (char *token = strtok_r(copy, " ", &saveField); token != NULL; token = strtok_r(NULL, " ", &saveField)) {
+      char *part[5] = {};
+      uint8_t parts = 0;
+      char *saveColon = NULL;
+      for (char *p = strtok_r(token, ":", &saveColon); p != NULL && parts < 5; p = strtok_r(NULL, ":", &saveColon)) {
+        part[parts++] = p;
+      }
+      if (parts < 3 || n == MAX_FIELDS) {
+        return 0;
+      }
+
+      Field &f = fields[n];
+      strncpy(f.name, part[0], sizeof(f.name) - 1);
+      f.name[sizeof(f.name) - 1] = '\0';
+      f.offset = (uint8_t)atoi(part[1]);
+      const char *type = part[2];
+      bool isSigned = type[0] == 'i';
+      const char *unsignedType = isSigned ? type : type + 1;
+
+      if (strcmp(unsignedType, "int") == 0) {
+        // Bit field inside one byte
+        if (parts != 5) return 0;
+        f.bits = (uint8_t)atoi(part[3]);
+        uint8_t top = (uint8_t)atoi(part[4]);
+        if (f.bits == 0 || top > 7 || f.bits > top + 1 || f.offset >= length) return 0;
+        f.lsb = top + 1 - f.bits;
+        unsigned long raw = (bytes[f.offset] >> f.lsb) & ((1u << f.bits) - 1);
+        f.value = (long)raw;
+        if (isSigned && (raw >> (f.bits - 1))) {
+          f.value -= 1L << f.bits;
+        }
+      } else {
+        uint8_t size = strcmp(unsignedType, "int8") == 0 ? 1
+                     : strcmp(unsignedType, "int16") == 0 ? 2
+                     : strcmp(unsignedType, "int32") == 0 ? 4 : 0;
+        if (size == 0 || f.offset + size > length) return 0;
+        bool bigEndian = true;
+        if (size > 1) {
+          if (parts != 4) return 0;
+          if (strcmp(part[3], "big-endian") == 0) bigEndian = true;
+          else if (strcmp(part[3], "little-endian") == 0) bigEndian = false;
+          else return 0;
+        } else if (parts != 3) {
+          return 0;
+        }
+        unsigned long raw = 0;
+        for (uint8_t i = 0; i < size; i++) {
+          uint8_t b = bytes[f.offset + (bigEndian ? i : size - 1 - i)];
+          raw = (raw << 8) | b;
+        }
+        f.bits = size * 8;
+        f.lsb = 0;
+        f.value = (long)raw;
+        if (isSigned && (raw >> (f.bits - 1))) {
+          f.value = (long)raw - (long)(1ULL << f.bits);
+        }
+      }
+      n++;
+    }
+    return n;
+  }
+
+  // Value of the field called name, -99999 if there is none
+  long field(const Field *fields, uint8_t n, const char *name) {
+    for (uint8_t i = 0; i < n; i++) {
+      if (strcmp(fields[i].name, name) == 0) {
+        return fields[i].value;
+      }
+    }
+    return -99999;
+  }
+
+  TelemetryRecord record(uint8_t id, uint8_t fullness, uint8_t temperature, uint8_t humidity,
+                         uint8_t health, uint8_t seq, uint16_t age) {
+    TelemetryRecord r = { id, fullness, temperature, humidity, health, seq, age };
+    return r;
+  }
+
+  // Encode r, decode it with GC_TELEMETRY_PARSER and compare every field
+  void roundTrip(const TelemetryRecord &r) {
+    uint8_t bytes[GC_TELEMETRY_SIZE];
+    CHECK_EQ(encodeTelemetry(r, bytes), GC_TELEMETRY_SIZE);
+    Field fields[MAX_FIELDS];
+    uint8_t n = binaryParse(GC_TELEMETRY_PARSER, bytes, sizeof(bytes), fields);
+    CHECK_EQ(n, 8);
+    CHECK_EQ(field(fields, n, "version"), GC_TELEMETRY_VERSION);
+    CHECK_EQ(field(fields, n, "health"), r.health & 0x1F);
+    CHECK_EQ(field(fields, n, "id"), r.id);
+    CHECK_EQ(field(fields, n, "fullness"), r.fullness & 0x7F);
+    CHECK_EQ(field(fields, n, "temperature"), r.temperature);
+    CHECK_EQ(field(fields, n, "humidity"), r.humidity);
+    CHECK_EQ(field(fields, n, "seq"), r.seq);
+    CHECK_EQ(field(fields, n, "age"), r.age);
+  }
+}
+
+// ======================== TESTS ========================
+GC_TEST(parserOfTheTestFormats) {
+  // The parser itself, on the examples of the three kinds of field
+  const uint8_t bytes[] = { 0xA5, 0x12, 0x34, 0xFE };
+  Field fields[MAX_FIELDS];
+  uint8_t n = binaryParse("hi:0:uint:4:7 lo:0:uint:4:3 s:0:int:3:2 "
+                          "be:1:uint16:big-endian le:1:uint16:little-endian "
+                          "u:3:uint8 i:3:int8 i16:2:int16:big-endian", bytes, sizeof(bytes), fields);
+  CHECK_EQ(n, 8);
+  CHECK_EQ(field(fields, n, "hi"), 0xA);
+  CHECK_EQ(field(fields, n, "lo"), 0x5);
+  CHECK_EQ(field(fields, n, "s"), -3);        // 101
+  CHECK_EQ(field(fields, n, "be"), 0x1234);
+  CHECK_EQ(field(fields, n, "le"), 0x3412);
+  CHECK_EQ(field(fields, n, "u"), 254);
+  CHECK_EQ(field(fields, n, "i"), -2);
+  CHECK_EQ(field(fields, n, "i16"), 0x34FE);
+
+  CHECK_EQ(binaryParse("x:3:uint16:big-endian", bytes, sizeof(bytes), fields), 0);  // past the end
+  CHECK_EQ(binaryParse("x:1:uint16", bytes, sizeof(bytes), fields), 0);            // no byte order
+}
+
+GC_TEST(fieldsDoNotOverlap) {
+  // Every bit of the record belongs to one field, except the reserved bit 7
+  // of byte 2
+  uint8_t zeros[GC_TELEMETRY_SIZE] = {};
+  Field fields[MAX_FIELDS];
+  uint8_t n = binaryParse(GC_TELEMETRY_PARSER, zeros, sizeof(zeros), fields);
+  CHECK_EQ(n, 8);
+  uint8_t used[GC_TELEMETRY_SIZE] = {};
+  for (uint8_t i = 0; i < n; i++) {
+    uint8_t bytes = fields[i].bits > 8 ? fields[i].bits / 8 : 1;
+    for (uint8_t b = 0; b < bytes; b++) {
+      uint8_t mask = fields[i].bits >= 8 ? 0xFF : (uint8_t)(((1u << fields[i].bits) - 1) << fields[i].lsb);
+      CHECK_EQ(used[fields[i].offset + b] & mask, 0);
+      used[fields[i].offset + b] |= mask;
+    }
+  }
+  const uint8_t expected[GC_TELEMETRY_SIZE] = { 0xFF, 0xFF, 0x7F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+  for (uint8_t i = 0; i < GC_TELEMETRY_SIZE; i++) {
+    CHECK_EQ(used[i], expected[i]);
+  }
+}
+
+GC_TEST(typicalRecord) {
+  roundTrip(record(1, 42, 71, 40, GC_HEALTH_OK | GC_HEALTH_SENSOR15 | GC_HEALTH_SENSOR60, 7, 0));
+}
+
+GC_TEST(byteOrderOfTheAge) {
+  // 0x1234 seconds must not come out as 0x3412
+  roundTrip(record(1, 42, 71, 40, GC_HEALTH_OK | GC_HEALTH_QUEUED, 8, 0x1234));
+  roundTrip(record(1, 42, 71, 40, GC_HEALTH_OK | GC_HEALTH_QUEUED, 9, 0x00FF));
+  roundTrip(record(1, 42, 71, 40, GC_HEALTH_OK | GC_HEALTH_QUEUED, 10, 0xFF00));
+}
+
+GC_TEST(highValuesStayPositive) {
+  // Top bits set in every field: all unsigned, nothing reads back negative
+  roundTrip(record(255, GC_FULLNESS_UNKNOWN, 255, 255, 0x1F, 255, GC_AGE_UNKNOWN));
+  roundTrip(record(200, 100, 200, 100, GC_HEALTH_QUEUED, 128, 0x8000));
+
+  uint8_t bytes[GC_TELEMETRY_SIZE];
+  encodeTelemetry(record(255, GC_FULLNESS_UNKNOWN, 255, 255, 0x1F, 255, GC_AGE_UNKNOWN), bytes);
+  Field fields[MAX_FIELDS];
+  uint8_t n = binaryParse(GC_TELEMETRY_PARSER, bytes, sizeof(bytes), fields);
+  for (uint8_t i = 0; i < n; i++) {
+    CHECK(fields[i].value >= 0);
+  }
+}
+
+GC_TEST(everyFieldOnItsOwn) {
+  // One field at a time set to a value with a single bit, the rest 0: each
+  // bit lands in its own field and nowhere else
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    uint8_t v = (uint8_t)(1u << bit);
+    roundTrip(record(v, 0, 0, 0, 0, 0, 0));
+    roundTrip(record(0, v & 0x7F, 0, 0, 0, 0, 0));
+    roundTrip(record(0, 0, v, 0, 0, 0, 0));
+    roundTrip(record(0, 0, 0, v, 0, 0, 0));
+    roundTrip(record(0, 0, 0, 0, v & 0x1F, 0, 0));
+    roundTrip(record(0, 0, 0, 0, 0, v, 0));
+    roundTrip(record(0, 0, 0, 0, 0, 0, v));
+    roundTrip(record(0, 0, 0, 0, 0, 0, (uint16_t)(v << 8)));
+  }
+}
+
+GC_TEST(randomRecordsMatchDecodeTelemetry) {
+  randomSeed(11);
+  for (uint16_t i = 0; i < 2000; i++) {
+    TelemetryRecord r = record(random(0, 256), telemetryFullness(random(-1, 102)), random(0, 256),
+                               random(0, 101), random(0, 32), random(0, 256), random(0, 65536));
+    roundTrip(r);
+
+    // The board's own decoder agrees with the Binary Parser
+    uint8_t bytes[GC_TELEMETRY_SIZE];
+    encodeTelemetry(r, bytes);
+    TelemetryRecord back = {};
+    CHECK(decodeTelemetry(bytes, sizeof(bytes), back));
+    CHECK_EQ(memcmp(&back, &r, sizeof(r)), 0);
+  }
+}
+
+int main() {
+  return gcRunTests();
+}
@@ -20,159 +20,58 @@ used throughout the project.
 #include "GC_esp32.h"
 
 // ======================== GLOBAL VARIABLES ========================
-// Entrypoint for Soracom Harvest
-const char entrypoint[] = "harvest.soracom.io";     // Entrypoint for Soracom Harvest, where data will be sent
-
-// Port for Soracom Harvest
-const int soracomPort = 80;         // Port for Soracom Harvest, default is 80 for HTTP communication. 
-const char apn[] = "soracom.io";    // APN for Soracom, used for GPRS reconnection
-const char User[] = "sora";         // User for Soracom, used for GPRS reconnection
-const char Pass[] = "sora";         // Password for Soracom, used for GPRS reconnection
-
+// The Soracom endpoint, APN and the modem helpers (powerOnModem, getISOTimestamp)
+// are shared with the other builds and live in the GC_Common library (GC_Soracom.h).
 // Link to the Soracom Harvest Overview page:
 // https://developers.soracom.io/en/docs/harvest/
 
+// Readings that could not be sent, kept in NVS until the connection works again
+ReadingQueue<READING_QUEUE_SLOTS, EepromStore> readingQueue;
 
-// ======================== FUNCTION DEFINITIONS ========================
-/*
-powerOnModem - Power on the modem using the RST and PWR pins
+// Readings waiting to be sent together in one POST
+ReadingBatch<GC_BATCH_SIZE> readingBatch;
 
-Parameters:
-  RST - Pin number for the RST pin (reset pin)
-  PWR - Pin number for the PWR pin (power key pin)
+// Connection to Soracom, kept open between reports (GC_TRANSPORT picks HTTP, TCP or UDP)
+UplinkSession harvest(modem, client);
 
-This function initializes the modem by cycling/toggling the RST and PWR pins.
-This is to ensure the modem powers on correctly and is ready for communication.
+// Sequence number of the next reading. In RTC memory, so it keeps counting
+// across deep sleep (GC_DUTY_CYCLE) instead of starting at 0 on every wake.
+RTC_DATA_ATTR uint8_t telemetrySeq = 0;
 
-This is set in mind for Arduino Uno and SIM7000A, but can be adapted for other 
-boards. So, check whether you need to change hold times when adapting to the
-Arduino Nano ESP32 or ESP8266. Pins can be changed in the .ino file.
+// Firmware updates (GC_Ota.h), over a second connection so the Harvest one
+// stays open. The download progress is kept in NVS right after the queue.
+TinyGsmClient otaClient(modem, GC_OTA_MUX);
+static_assert(GC_OTA_MUX != GC_UDP_MUX && GC_OTA_MUX != 0, "the OTA download needs a modem socket of its own");
+EspOtaPartition otaPartition;
+OtaUpdater<TinyGsmClient, EspOtaPartition, EepromStore> otaUpdater(
+  otaClient, otaPartition, ReadingQueue<READING_QUEUE_SLOTS, EepromStore>::STORAGE_SIZE);
 
-Link to the SIM7000A schematic:
-https://github.com/botletics/SIM7000-LTE-Shield/blob/master/Schematics/SIM7000%20Shield%20Schematic%20v6.png
-*/
-void powerOnModem(int RST, int PWR) {
-  // Setup RST Pin
-  pinMode(RST, OUTPUT);
-  // Toggle RST low for 0.1s
-  digitalWrite(RST, LOW);
-  delay(100);                   // Hold Time for RST Low
-  digitalWrite(RST, HIGH);
-
-  // Setup PWR Pin
-  pinMode(PWR, OUTPUT);
-  // Hold PWR low for 1.2s, then high for 8s
-  digitalWrite(PWR, LOW);
-  delay(1200);                  // Hold Time for PWR Low
-  digitalWrite(PWR, HIGH);
-  delay(8000);                  // Hold Time for PWR High
-}
+// Check for a newer firmware with the next report: after power on, and when a
+// downlink asks for it. In RTC memory, so waking from deep sleep does not check again.
+RTC_DATA_ATTR bool firmwareCheckDue = true;
 
 
+// ======================== FUNCTION DEFINITIONS ========================
+TelemetryRecord takeReading();
+void sendReading(Stream &SerialMon, const TelemetryRecord &record, unsigned long stamp);
+static void checkFirmware(Stream &SerialMon, bool delivered);
+static void updateFirmware(Stream &SerialMon);
+
 /*
-getISOTimestamp - Get the current timestamp from the modem in ISO-8601 format.
+prewarmSoracom - Open the connection to Soracom Harvest ahead of the next report.
 
 Parameters:
-  modem - The TinyGsm object representing the modem.
-
-This function sends an AT command to the modem to retrieve the current date 
-and time. We do this to ensure the time is accurate and in the correct format 
-for Soracom Harvest. Soracom Harvest already sets a timestamp on the server side, 
-but we can use this to provide a more accurate timestamp in case of network delays 
-or other issues. 
-
-
-CURRENTLY UNUSED, BUT LEFT FOR FUTURE IMPLEMENTATION.
-- Returned time string is incorrect
-- Honestly, I'd recommend just rewriting this entirely
-- Alternatively, you can use the Soracom Harvest timestamp instead of this one.
-  BUT, stakeholdrs might want accurate timestamps for their data.
-
+  SerialMon - The serial monitor stream for debug output.
 
-Examples of valid timestamps used by Soracom Harvest:
-Date/Time (ISO-8601): 2022-10-05T11:30:45.000Z
-Unix Time (seconds): 1633433445
-Unix Time (milliseconds): 1633433445000
+Call it before reading the sensors. The report after the reading then only
+sends the request. Does nothing if the next reading will not be sent yet
+(GC_BATCH_SIZE), or if GPRS is down (the report reconnects it).
 */
-String getISOTimestamp(TinyGsm& modem) {
-  // Send AT command to get time
-  modem.sendAT("+CCLK?");
-
-  // Wait for response and store in 'response'
-  String response = "";
-  if (modem.waitResponse(1000L, response) != 1) {
-    Serial.println("Failed to get modem time.");
-    return "";
-  }
-
-  // Example response: +CCLK: "24/04/13,13:37:20+00"
-  int startQuote = response.indexOf('"');
-  int endQuote = response.lastIndexOf('"');
-
-  if (startQuote == -1 || endQuote == -1 || endQuote <= startQuote) {
-    Serial.println("Malformed time response.");
-    return "";
-  }
-
-  // Extract the date/time string from the response
-  String timeStr = response.substring(startQuote + 1, endQuote); // Ex. 24/04/13,13:37:20+00
-  int commaIndex = timeStr.indexOf(',');
-  if (commaIndex == -1) {
-    Serial.println("Malformed date/time structure.");
-    return "";
-  }
-
-  String datePart = timeStr.substring(0, commaIndex);    // "24/04/13"
-  String timePart = timeStr.substring(commaIndex + 1);   // "13:37:20+00"
-
-  // Extract offset
-  int offsetSignIndex = timePart.indexOf('+');
-  if (offsetSignIndex == -1) offsetSignIndex = timePart.indexOf('-');
-
-  String offsetStr = "+00"; // default to UTC
-  if (offsetSignIndex != -1) {
-    offsetStr = timePart.substring(offsetSignIndex);  // "+00", "-05", etc.
-    timePart = timePart.substring(0, offsetSignIndex); // trim offset from time
-  }
-
-  // Parse time components
-  int yy = datePart.substring(0, 2).toInt();
-  int mm = datePart.substring(3, 5).toInt();
-  int dd = datePart.substring(6, 8).toInt();
-  // Normalize year (assuming years >= 70 are 1970s, else 2000s)
-  int fullYear = (yy >= 70) ? (1900 + yy) : (2000 + yy);
-
-  int hour = timePart.substring(0, 2).toInt();
-  int minute = timePart.substring(3, 5).toInt();
-  int second = timePart.substring(6, 8).toInt();
-
-  // Parse offset
-  int offsetMinutes = 0;
-  if (offsetStr.length() >= 3) {
-    int sign = (offsetStr[0] == '-') ? -1 : 1;
-    offsetMinutes = sign * offsetStr.substring(1, 3).toInt() * 15;  // <-- 15 minute units
+void prewarmSoracom(Stream &SerialMon) {
+  if (readingBatch.size() + 1 < GC_BATCH_SIZE || !modem.isGprsConnected()) {
+    return;
   }
-
-  // Adjust time to UTC
-  tmElements_t tm;
-  tm.Year = fullYear - 1970;
-  tm.Month = mm;
-  tm.Day = dd;
-  tm.Hour = hour;
-  tm.Minute = minute;
-  tm.Second = second;
-
-  time_t localTime = makeTime(tm);
-  time_t utcTime = localTime - (offsetMinutes * 60);
-
-  // Break down UTC time into components
-  breakTime(utcTime, tm);
-
-  // Format to ISO-8601
-  char isoTime[30];  // Enough room for full ISO string
-  snprintf(isoTime, sizeof(isoTime), "%04d-%02d-%02dT%02d:%02d:%02d.000Z",
-           tm.Year + 1970, tm.Month, tm.Day, tm.Hour, tm.Minute, tm.Second);
-  return String(isoTime);
+  harvest.open(SerialMon);
 }
 
 
@@ -184,6 +83,13 @@ Parameters:
 
 This function connects to the Soracom Harvest endpoint and sends JSON data.
 It handles GPRS connection, client connection, and HTTP POST request.
+The connection to Harvest stays open between calls (UplinkSession, GC_Unified.h).
+
+With GC_BATCH_SIZE above 1 (GC_esp32.h), readings are collected in readingBatch
+and sent together in one POST once the batch is full or GC_BATCH_MAX_AGE_MS old.
+
+If the send fails, the readings go into readingQueue (GC_Queue.h, stored in
+NVS through the EEPROM library) and is sent after the next send that works.
   
     
 CURRENTLY SENDS ONLY MOCK DATA FOR TESTING.
@@ -214,102 +120,248 @@ Todo for upcoming semester (2025 Fall):
   You can modify everything except the HTTP POST request part. This part is correct, so don't change it.
 */
 void sendDataToSoracom(Stream &SerialMon) {
-  TinyGsmClient client(modem, 0);
-
-  // Create JSON document
-  // Currently just mock (fake) data for testing
-  // Replace with actual data from your sensors
-  StaticJsonDocument<1024> jsonDoc;
-  jsonDoc["id"] = random(1,7);
-  jsonDoc["fullness"] = random(0,100);
-  jsonDoc["temperature"] = random(0, 120);
-  jsonDoc["status"] = "OK";
-
-
-  // Optional: Add timestamp to JSON
-  // Uncomment the following lines to add a timestamp to the JSON payload
-/*  
-  // Soracom Harvest expects ISO-8601 Date/Time
-  // Date/Time (ISO-8601): 2022-10-05T11:30:45.000Z
-  String isoTime = getISOTimestamp(modem);
-  delay(10000);
-  if (isoTime.length()) {
-    jsonDoc["time"] = isoTime;
-  } else {
-    jsonDoc["time"] = "1970-01-01T00:00:00.000Z"; // Fallback or leave empty
-  }
+  sendReading(SerialMon, takeReading(), millis());
+}
+
+
+/*
+takeReading - Create one reading (GC_Telemetry.h).
+
+SCAFFOLD, mock (fake) data for testing: see GC_MOCK_READINGS in GC_esp32.h
+for what reading the sensors here takes. Until then GC_PIPELINE's sensor task
+only shows the sampling cadence and the hand-off, not sensor timing.
 */
+TelemetryRecord takeReading() {
+  TelemetryRecord record;
+  record.id = random(1,7);
+  record.fullness = random(0,100);
+  record.temperature = random(0, 120);
+  record.humidity = random(20, 60);
+  record.health = GC_HEALTH_OK;
+  if (deviceClock().valid()) {
+    record.health |= GC_HEALTH_TIME; // "time" can be sent with it
+  }
+  record.seq = telemetrySeq++;
+  record.age = 0; // Sent right away
+  return record;
+}
+
 
-  // Measure JSON size
-  int contentLength = measureJson(jsonDoc);
+/*
+sendReading - Send one reading, or keep it for later.
 
-  // Close previous connection if still open
-  SerialMon.println("Preparing client to connect to Soracom Harvest...");
-  if (client.connected()) {
-    SerialMon.println("Previous client still connected. Closing...");
-    client.stop();
-    delay(100);
+Parameters:
+  SerialMon - The serial monitor stream for debug output.
+  record    - The reading, from takeReading().
+  stamp     - millis() when it was taken.
+*/
+void sendReading(Stream &SerialMon, const TelemetryRecord &record, unsigned long stamp) {
+  // Collect readings until the batch is full or old enough (GC_BATCH_SIZE)
+  readingBatch.add(record, stamp);
+  if (!readingBatch.due(GC_BATCH_MAX_AGE_MS)) {
+    return;
   }
 
-  // Ensure GPRS is still connected
-  if (!modem.isGprsConnected()) {
-    SerialMon.println("GPRS not connected. Attempting to reconnect...");
-    if (!modem.gprsConnect(apn, User, Pass)) {
-      SerialMon.println("GPRS reconnect failed. Aborting send.");
-      return;
+  // Ensure GPRS is still connected. If it is not, or the POST fails, keep the
+  // readings in NVS instead of retrying forever and stalling the loop.
+  // All retries and waits of this report, down to the connection to Harvest
+  // and its response, share GC_REPORT_BUDGET_MS (GC_Retry.h).
+  // The clock is only read from the modem when a resync is due (GC_Clock.h)
+  TaskTimer budget;
+  budget.start(GC_REPORT_BUDGET_MS);
+  bool online = ensureGprs(modem, SerialMon, budget);
+  if (online) {
+    syncClock(modem, SerialMon);
+  }
+  if (!online || !postBatch(harvest, SerialMon, readingBatch, budget)) {
+    for (uint8_t i = 0; i < readingBatch.size(); i++) {
+      readingQueue.push(readingBatch.get(i, millis()), readingBatch.stamp(i));
     }
+    readingBatch.clear();
+    SerialMon.print("Send failed, queued readings: "); SerialMon.println(readingQueue.size());
+    checkFirmware(SerialMon, false);
+    return;
   }
+  readingBatch.clear();
+  checkFirmware(SerialMon, true);
 
-  // Connect to Soracom Harvest
-  SerialMon.println("Connecting to Soracom Harvest...");
-  int retries = 0;
-  // Keep trying to connect until success or max retries
-  // This is to ensure the connection is established before sending data
-  while (!client.connect(entrypoint, soracomPort) && retries < 5) {
-    SerialMon.println("Failed to connect to Soracom Harvest, retrying in 5 seconds...");
-    retries++;
-    delay(5000);
+  // The response may ask for a firmware check (GC_Soracom.h)
+  Downlink downlink;
+  if (parseDownlink(downlinkOf(harvest), downlink) & GC_DOWNLINK_UPDATE) {
+    firmwareCheckDue = true;
   }
 
-  if (!client.connected()) {
-    SerialMon.println("Failed to connect after 5 attempts. Giving up.");
+  // The connection works, send what was queued while it did not,
+  // as much as the budget allows
+  sendQueued<GC_BATCH_SIZE>(harvest, SerialMon, readingQueue, budget);
+
+  // Then go on with a firmware download, if one is due
+  updateFirmware(SerialMon);
+}
+
+
+/*
+checkFirmware - Keep a freshly updated firmware, or go back to the previous one.
+
+Parameters:
+  SerialMon - The serial monitor stream for debug output.
+  delivered - True if the report that was just sent arrived.
+
+The first delivered report confirms the new firmware. If there was none
+GC_OTA_CONFIRM_MS after start up, the previous firmware is booted again.
+Does nothing once the firmware is confirmed.
+*/
+static void checkFirmware(Stream &SerialMon, bool delivered) {
+  if (!otaPendingVerify()) {
     return;
   }
+  if (delivered) {
+    otaConfirm();
+    SerialMon.print("Firmware "); SerialMon.print(GC_FIRMWARE_VERSION); SerialMon.println(" confirmed");
+  } else if (millis() >= GC_OTA_CONFIRM_MS) {
+    SerialMon.println("New firmware cannot report, rolling back");
+    readingQueue.flush();
+    otaRollback();
+  }
+}
+
+
+/*
+updateFirmware - Check for a newer firmware and download a part of it.
+
+Parameters:
+  SerialMon - The serial monitor stream for debug output.
+
+Runs when a check is due or a download was started before (also before a
+reset), for at most GC_OTA_BUDGET_MS. Once the new firmware is verified,
+the readings are saved and the board restarts into it.
+*/
+static void updateFirmware(Stream &SerialMon) {
+  if (!firmwareCheckDue && !otaUpdater.pending()) {
+    return;
+  }
+  TaskTimer budget;
+  budget.start(GC_OTA_BUDGET_MS);
+  uint8_t result = otaUpdater.update(SerialMon, GC_FIRMWARE_VERSION, budget);
+  otaUpdater.print(SerialMon);
+  if (result == GC_OTA_PARTIAL) {
+    return;   // goes on with the next report
+  }
+  firmwareCheckDue = false;
+  if (result == GC_OTA_READY) {
+    readingQueue.flush();
+    harvest.close();
+    SerialMon.flush();
+    ESP.restart();
+  }
+}
+
+/*
+prepareForSleep - Save everything that only lives in RAM before deep sleep.
+
+Parameters:
+  SerialMon - The serial monitor stream for debug output.
+
+Deep sleep clears RAM. Readings still waiting in readingBatch go into
+readingQueue, and the readings staged in RAM are written to NVS, so the next
+wake sends them. The connection is closed, the modem drops it in PSM anyway.
+*/
+void prepareForSleep(Stream &SerialMon) {
+  for (uint8_t i = 0; i < readingBatch.size(); i++) {
+    readingQueue.push(readingBatch.get(i, millis()), readingBatch.stamp(i));
+  }
+  readingBatch.clear();
+  readingQueue.flush();
+  harvest.close();
+  SerialMon.print("Sleeping, queued readings: "); SerialMon.println(readingQueue.size());
+}
+
 
-  // HTTP Post request
-  // DO NOT MODIFY THIS PART
-  // 
-  // These lines format the HTTP POST request. They are correct, so don't change them.
-  // The only thing you might want to change is the content of the jsonDoc payload above.
-  client.println("POST / HTTP/1.1");
-  client.print("Host: "); client.println(entrypoint);
-  client.println("Content-Type: application/json");
-  client.print("Content-Length: "); client.println(contentLength);
-  client.println("Connection: close");
-  client.println();
-  serializeJson(jsonDoc, client);   // Send payload directly
-  client.flush();  // Ensure it's sent
-
-  // Read server response
-  SerialMon.println("Reading server response");
-  String response = "";
-  unsigned long timeout = millis();
-  while (client.connected() || client.available()) {
-      if (client.available()) {
-          String line = client.readStringUntil('\n');
-          response += line + "\n";
-          SerialMon.println(line);
-          timeout = millis();  // Reset timeout after successful read
-      }
-
-      if (millis() - timeout > 10000) {  // 10 seconds timeout
-          break;
-      }
+// ======================== PIPELINE ========================
+// GC_PIPELINE: sensing on GC_SENSOR_CORE, modem and uplink on GC_UPLINK_CORE.
+// A stuck modem (a 30s connect timeout, a GPRS retry) only delays the uplink
+// task. The sensor task keeps its GC_SAMPLE_INTERVAL_MS cadence and its
+// readings wait in the hand-off queue.
+
+// One reading on its way from the sensor task to the uplink task
+struct PipelineItem {
+  TelemetryRecord record;
+  unsigned long stamp;
+};
+
+static SpscQueue<PipelineItem, GC_PIPELINE_DEPTH> pipelineQueue;
+static StageTiming sensorTiming;
+static StageTiming uplinkTiming;
+static volatile uint32_t pipelineDropped = 0;    // written by the sensor task only
+static volatile uint8_t pipelineMaxDepth = 0;    // written by the sensor task only
+static Stream *pipelineMon = nullptr;
+
+// Producer: take a reading every GC_SAMPLE_INTERVAL_MS (mock readings for
+// now, GC_MOCK_READINGS)
+static void sensorTask(void *) {
+  TickType_t wake = xTaskGetTickCount();
+  for (;;) {
+    sensorTiming.begin();
+    PipelineItem item;
+    item.record = takeReading();
+    item.stamp = millis();
+    if (!pipelineQueue.push(item)) {
+      pipelineDropped = pipelineDropped + 1;    // uplink too far behind, the reading is lost
+    }
+    uint8_t depth = pipelineQueue.size();
+    if (depth > pipelineMaxDepth) pipelineMaxDepth = depth;
+    sensorTiming.end();
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(GC_SAMPLE_INTERVAL_MS));
   }
+}
 
-  SerialMon.println("Server Response: " + response);
-  if (client.connected()) {
-    client.stop();
-    delay(100); // Allow socket to fully close
+// Consumer: the only task that talks to the modem
+static void uplinkTask(void *) {
+  for (;;) {
+    PipelineItem item;
+    if (!pipelineQueue.pop(item)) {
+      vTaskDelay(pdMS_TO_TICKS(50));
+      continue;
+    }
+    uplinkTiming.begin();
+    sendReading(*pipelineMon, item.record, item.stamp);
+    uplinkTiming.end();
   }
 }
+
+
+/*
+startPipeline - Start the sensor and uplink tasks (GC_PIPELINE).
+
+Parameters:
+  SerialMon - The serial monitor stream for debug output.
+
+Call at the end of setup(), once the modem is connected. From then on only the
+uplink task may use the modem, loop() must not call sendDataToSoracom().
+*/
+void startPipeline(Stream &SerialMon) {
+  pipelineMon = &SerialMon;
+  xTaskCreatePinnedToCore(uplinkTask, "uplink", 8192, nullptr, 1, nullptr, GC_UPLINK_CORE);
+  xTaskCreatePinnedToCore(sensorTask, "sensor", 4096, nullptr, 2, nullptr, GC_SENSOR_CORE);
+  SerialMon.println("Pipeline started (mock readings, GC_MOCK_READINGS)");
+}
+
+
+/*
+printPipelineStats - Print the timing of both pipeline stages.
+
+Parameters:
+  SerialMon - The serial monitor stream for debug output.
+
+The sensor "max gap" should stay close to GC_SAMPLE_INTERVAL_MS even while the
+uplink "max" shows a long modem stall.
+*/
+void printPipelineStats(Stream &SerialMon) {
+  sensorTiming.print(SerialMon, "sensor");
+  uplinkTiming.print(SerialMon, "uplink");
+  SerialMon.print("hand-off queue: "); SerialMon.print(pipelineQueue.size());
+  SerialMon.print("/"); SerialMon.print(pipelineQueue.capacity());
+  SerialMon.print(", max "); SerialMon.print(pipelineMaxDepth);
+  SerialMon.print(", dropped "); SerialMon.println(pipelineDropped);
+  GC_METRICS_PRINT(SerialMon);    // Phase timings, if GC_METRICS is on (GC_esp32.h)
+}
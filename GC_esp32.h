@@ -6,21 +6,140 @@
 #define TINY_GSM_USE_GPRS true
 #define TINY_GSM_USE_WIFI false
 
+// ======================== TRANSPORT ========================
+// How reports are sent (GC_Unified.h):
+//   GC_TRANSPORT_HTTP - HTTP POST to harvest.soracom.io
+//   GC_TRANSPORT_TCP  - payload only, raw TCP to uni.soracom.io
+//   GC_TRANSPORT_UDP  - payload only, one UDP datagram to uni.soracom.io
+#define GC_TRANSPORT GC_TRANSPORT_HTTP
+
+// ======================== RETRIES ========================
+// Longest time one report may spend retrying (GPRS, connection, queued
+// readings). Past it, the readings are queued and sent with the next report.
+// The retry waits themselves are in GC_Retry.h.
+#define GC_REPORT_BUDGET_MS  30000UL
+
+// ======================== METRICS ========================
+// 1 = time every modem, uplink and sensor phase with micros() and count sensor
+//     timeouts and checksum errors (GC_Metrics.h), printed after each report.
+//     Costs about 300 bytes of RAM.
+// 0 = compiled out
+#define GC_METRICS            0
+// 1 = also send the last phase times and counters with each JSON report
+#define GC_METRICS_IN_PAYLOAD 0
+
+// ======================== FIRMWARE UPDATES ========================
+// Version of this firmware. Raise it for every build that is published for
+// the OTA update, boards only download a higher version (GC_Ota.h).
+#define GC_FIRMWARE_VERSION  1
+// Where the manifest and the image are (see GC_Ota.h for the format)
+#define GC_OTA_HOST          "harvest-files.soracom.io"
+#define GC_OTA_MANIFEST_PATH "/firmware/esp32.txt"
+#define GC_OTA_IMAGE_PATH    "/firmware/esp32.bin"
+#define GC_OTA_PACKED_PATH   "/firmware/esp32.pack"   // LZ4 blocks of the image, made by ota_pack.py
+// Longest time one report may spend downloading firmware. The download goes
+// on with the next report, so a 1 MB image takes a few reports.
+// With GC_DUTY_CYCLE these wakes run past GC_WAKE_BUDGET_MS.
+#define GC_OTA_BUDGET_MS     60000UL
+
 // ======================== INCLUDES ========================
 #include <TinyGsmClient.h>
 #include <ArduinoJson.h>
 #include <Arduino.h>
 // #include <HardwareSerial.h>
-#include <TimeLib.h>
+#include <GC_Soracom.h>     // powerOnModem, getISOTimestamp, postToHarvest (GC_Common library)
+#include <GC_Unified.h>     // HTTP/TCP/UDP uplink selection (GC_Common library)
+#include <GC_Queue.h>       // store-and-forward queue in EEPROM/NVS (GC_Common library)
+#include <GC_Batch.h>       // several readings per POST (GC_Common library)
+#include <GC_Sleep.h>       // deep sleep, modem PSM/eDRX (GC_Common library)
+#include <GC_Spsc.h>        // lock-free queue between the pipeline tasks (GC_Common library)
+#include <GC_Task.h>        // StageTiming for the pipeline tasks (GC_Common library)
+#include <GC_Metrics.h>     // per-phase timings and counters (GC_Common library)
+#include <GC_Ota.h>         // firmware updates over the modem, with rollback (GC_Common library)
+
+// ======================== QUEUE ========================
+// Number of unsent readings kept in NVS (power of two, 15 bytes each).
+// The firmware download progress (GC_Ota.h) is stored right after the queue.
+#define READING_QUEUE_SLOTS 64
+
+// ======================== BATCHING ========================
+// Readings sent together in one HTTP POST. 1 sends every reading right away.
+// JSON only, GC_PAYLOAD_BINARY needs 1.
+#define GC_BATCH_SIZE        1
+// Send a batch that is not full yet once its oldest reading is this old (ms)
+#define GC_BATCH_MAX_AGE_MS  60000UL
+
+// ======================== DUTY CYCLE ========================
+// 1 = report once per wake and deep sleep in between (GC_Sleep.h),
+// 0 = stay awake and report every 5 seconds from loop()
+#define GC_DUTY_CYCLE        0
+// Time between reports in deep sleep (s)
+#define GC_SLEEP_INTERVAL_S  300
+// Longest acceptable time from wake up to the report being sent (ms)
+#define GC_WAKE_BUDGET_MS    15000UL
+// PSM timers asked from the network: periodic TAU and active time (s)
+#define GC_PSM_TAU_S         3600
+#define GC_PSM_ACTIVE_S      10
+// eDRX cycle for LTE Cat-M1 (AT+CEDRXS), "0101" = 81.92s
+#define GC_EDRX_CYCLE        "0101"
+
+// ======================== SENSORS ========================
+// SCAFFOLD: this build has no sensor code yet. takeReading() (GC_esp32.cpp)
+// makes up random readings, so the reports, the queue and GC_PIPELINE's
+// sensor task can be tried out, but nothing is measured. The mock readings
+// are sent without GC_HEALTH_SENSOR15/60, the server can tell them apart.
+// UART0 is the monitor and UART1 the modem, which leaves UART2 for the two
+// A02 sensors. Real readings need a second free port (or the two sensors
+// taking turns on UART2), then A02Bus (GC_A02Bus.h), a DistanceFilter
+// (GC_Filter.h) per sensor and fullnessFromDistances (GC_Geometry.h) in
+// takeReading(), the way Fullness_Dection_esp32.ino reads them.
+// 1 = mock readings, 0 = stops the build until takeReading() reads sensors
+#define GC_MOCK_READINGS     1
+
+// ======================== PIPELINE ========================
+// 1 = sensing and the modem run as two FreeRTOS tasks on separate cores,
+//     handing readings over through a lock-free queue (GC_Spsc.h)
+// 0 = everything runs one after the other in loop()
+#define GC_PIPELINE          0
+// Time between readings of the sensor task (ms)
+#define GC_SAMPLE_INTERVAL_MS 5000
+// Readings the sensor task can get ahead of the modem task (power of two)
+#define GC_PIPELINE_DEPTH    16
+// Cores: the modem task shares core 0 with the radio stacks,
+// the sensor task runs on core 1 next to loop()
+#define GC_UPLINK_CORE       0
+#define GC_SENSOR_CORE       1
+
+#if GC_PIPELINE && GC_DUTY_CYCLE
+#error "GC_PIPELINE and GC_DUTY_CYCLE cannot be used together"
+#endif
+
+#if GC_DUTY_CYCLE && GC_BATCH_SIZE > 1
+#error "GC_DUTY_CYCLE sends one reading per wake, set GC_BATCH_SIZE to 1"
+#endif
+
+#if !GC_MOCK_READINGS
+#error "takeReading() in GC_esp32.cpp only has mock readings, read the sensors there first"
+#endif
+
+#if defined(GC_PAYLOAD_BINARY) && GC_BATCH_SIZE > 1
+#error "The Binary Parser decodes one record per POST, set GC_BATCH_SIZE to 1 with GC_PAYLOAD_BINARY"
+#endif
 
 // ======================== EXTERNAL OBJECTS ========================
 // Declare objects only if they are defined in the main .ino file
 extern TinyGsm modem;
+extern TinyGsmClient client;
 extern Stream &SerialMon;
+extern ReadingQueue<READING_QUEUE_SLOTS, EepromStore> readingQueue;
+extern ReadingBatch<GC_BATCH_SIZE> readingBatch;
+extern UplinkSession harvest;
 
 // ======================== FUNCTION DECLARATIONS ========================
-void powerOnModem(int RST, int PWR);
+void prewarmSoracom(Stream &SerialMon);
 void sendDataToSoracom(Stream &SerialMon);
-String getISOTimestamp(TinyGsm& modem);
+void prepareForSleep(Stream &SerialMon);
+void startPipeline(Stream &SerialMon);
+void printPipelineStats(Stream &SerialMon);
 
 #endif
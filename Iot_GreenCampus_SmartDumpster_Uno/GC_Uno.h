@@ -21,7 +21,7 @@ It includes the necessary libraries and defines the constants used throughout th
 #include <TinyGsmClient.h>
 #include <ArduinoJson.h>
 #include <SoftwareSerial.h>
-#include <TimeLib.h>
+#include <GC_Soracom.h>            // powerOnModem, getISOTimestamp, postToHarvest (GC_Common library)
 
 extern TinyGsm modem;
 extern TinyGsmClient client;
@@ -29,9 +29,7 @@ extern Stream &SerialMon;
 
 // ======================== FUNCTION DECLARATIONS ========================
 // Add your function declarations here
-void powerOnModem(int RST, int PWR);
 void sendDataToSoracom(Stream &SerialMon);
-String getISOTimestamp(TinyGsm& modem);
 
 #endif 
 // GC_UNO_H
@@ -17,7 +17,7 @@ Required Libraries:
 - ArduinoJson by Benoit Blanchon
 - SoftwareSerial (built-in)
 - StreamDebugger (optional, for debugging)
-- Time by Michael Margolis (for time handling)
+- GC_Common (shared GreenCampus library in this repo, copy the GC_Common folder into your Arduino libraries folder)
 - GC_Uno.h (custom header file for GreenCampus functions)
 - GC_Uno.cpp (custom source file for GreenCampus functions)
 
@@ -110,6 +110,7 @@ void setup() {
     delay(10);
     // DBG("==== SIM7000A Uno ====");
     SerialMon.println("==== SIM7000A Uno ====");
+    seedJitter();                   // retry waits differ from bin to bin (GC_Retry.h)
 
     // Initialize pins
     powerOnModem(MODEM_RST, MODEM_PWRKEY);
@@ -1,6 +1,8 @@
 //This is the current working code with the sensors as of 3-3
 #include <SoftwareSerial.h>
 #include <AltSoftSerial.h>
+#include <GC_A02.h> // shared A02 frame parser (GC_Common library)
+#include <GC_Filter.h> // per-sensor distance filter (GC_Common library)
 
 // Sensor 1 (60-degree)
 AltSoftSerial mySerial1; // RX=8, TX=9 
@@ -10,11 +12,9 @@ int pinRX15 = 10;
 int pinTX15 = 11;
 SoftwareSerial mySerial2(pinRX15, pinTX15);
 
-// Data buffers for each sensor
-unsigned char data_buffer1[4] = {0};
-unsigned char data_buffer2[4] = {0};
-int buffer_index1 = 0;
-int buffer_index2 = 0;
+// Frame parsers for each sensor, they keep partial frames between loops
+A02Parser parser1;
+A02Parser parser2;
 
 // Distance readings in inches
 int distance15 = -1;
@@ -45,31 +45,17 @@ long angleBottom = 60;
 unsigned long lastPrintTime = 0;
 const unsigned long PRINT_INTERVAL = 1000;
 
-// Moving average filter variables
+// Filter settings
 const int FILTER_SIZE = 5;  // Changes how many values are saved
-int readings60[FILTER_SIZE];
-int readings15[FILTER_SIZE];
-int readIndex60 = 0;
-int readIndex15 = 0;
-long total60 = 0;
-long total15 = 0;
-int average60 = -1;
-int average15 = -1;
-
-// Filter readiness tracking
-bool filtersReady = false;
-int validReadings60 = 0;
-int validReadings15 = 0;
-
-// Spike detection parameters
 const int CONSECUTIVE_READINGS = 3;  // This can change how many values is needed to change, right now its 3
-int consecutiveCount60 = 0;
-int consecutiveCount15 = 0;
-int lastRawReading60 = -1;
-int lastRawReading15 = -1;
 const int SMALL_SPIKE_THRESHOLD = 2;  // Reject spikes smaller than 2 inches
 const int CONSISTENCY_TOLERANCE = 1;   // Readings within 1 inch are "consistent"
 
+// One filter per sensor, each keeps its own window and jump state
+//Right now max and min distances are hardcoded here
+DistanceFilter<FILTER_SIZE> filter60(0, 200, SMALL_SPIKE_THRESHOLD, CONSISTENCY_TOLERANCE, CONSECUTIVE_READINGS);
+DistanceFilter<FILTER_SIZE> filter15(0, 200, SMALL_SPIKE_THRESHOLD, CONSISTENCY_TOLERANCE, CONSECUTIVE_READINGS);
+
 
 void setup() {
   Serial.begin(115200);
@@ -80,12 +66,6 @@ void setup() {
   mySerial2.begin(9600);
   delay(500);
   
-  // Initialize filter arrays to zero
-  for (int i = 0; i < FILTER_SIZE; i++) {
-    readings60[i] = 0;
-    readings15[i] = 0;
-  }
-  
   
   emptyVolume = testDumpHeight * testDumpWidth * testDumpLen;
   emptyVolumeSeen = ((testDumpHeight - topyoffset) * (testDumpLen - topxoffset)) + (.5*(testDumpHeight-topyoffset)*(testDumpHeight-bottomyoffset)*(topxoffset-bottomxoffset));
@@ -100,28 +80,13 @@ void loop() {
   unsigned long startTime = millis();
   while (millis() - startTime < 100) {
     while (mySerial1.available() > 0) {
-      unsigned char c = mySerial1.read();
-      
-      if (buffer_index1 == 0 && c != 0xFF) {
-        continue;
-      }
-      
-      data_buffer1[buffer_index1++] = c;
-      
-      if (buffer_index1 >= 4) {
-        int newDist = processA02Data(data_buffer1, 1);
-        if (newDist >= 0) {
-          // Apply calibration factor
-          int calibratedDist = (int)(newDist);
-          
-          //Right now max and min distances are hardcoded when we call the filter
-          distance60 = addToFilterSmart(calibratedDist, readings60, readIndex60, 
-                                        total60, average60, validReadings60,
-                                        consecutiveCount60, lastRawReading60,
-                                        .5, 200);
-          sensor1Updated = true;
-        }
-        buffer_index1 = 0;
+      if (parser1.push(mySerial1.read())) {
+        int newDist = parser1.distanceInches();
+        // Apply calibration factor
+        int calibratedDist = (int)(newDist);
+        
+        distance60 = filter60.update(calibratedDist);
+        sensor1Updated = true;
       }
     }
   }
@@ -132,28 +97,13 @@ void loop() {
   startTime = millis();
   while (millis() - startTime < 100) {
     while (mySerial2.available() > 0) {
-      unsigned char c = mySerial2.read();
-      
-      if (buffer_index2 == 0 && c != 0xFF) {
-        continue;
-      }
-      
-      data_buffer2[buffer_index2++] = c;
-      
-      if (buffer_index2 >= 4) {
-        int newDist = processA02Data(data_buffer2, 2);
-        if (newDist >= 0) {
-          // Apply calibration factor
-          int calibratedDist = (int)(newDist);
-          
-          //Right now max and min distances are hardcoded when we call the filter
-          distance15 = addToFilterSmart(calibratedDist, readings15, readIndex15, 
-                                        total15, average15, validReadings15,
-                                        consecutiveCount15, lastRawReading15,
-                                        .5, 200);
-          sensor2Updated = true;
-        }
-        buffer_index2 = 0;
+      if (parser2.push(mySerial2.read())) {
+        int newDist = parser2.distanceInches();
+        // Apply calibration factor
+        int calibratedDist = (int)(newDist);
+        
+        distance15 = filter15.update(calibratedDist);
+        sensor2Updated = true;
       }
     }
   }
@@ -170,9 +120,9 @@ if (millis() - lastPrintTime >= PRINT_INTERVAL) {
     if (distance60 >= 0) {
       Serial.print(distance60);
       Serial.print(" inches");
-      if (consecutiveCount60 > 0) {
+      if (filter60.confirming() > 0) {
         Serial.print(" (confirming jump: ");
-        Serial.print(consecutiveCount60);
+        Serial.print(filter60.confirming());
         Serial.print("/");
         Serial.print(CONSECUTIVE_READINGS);
         Serial.print(")");
@@ -186,9 +136,9 @@ if (millis() - lastPrintTime >= PRINT_INTERVAL) {
     if (distance15 >= 0) {
       Serial.print(distance15);
       Serial.print(" inches");
-      if (consecutiveCount15 > 0) {
+      if (filter15.confirming() > 0) {
         Serial.print(" (confirming jump: ");
-        Serial.print(consecutiveCount15);
+        Serial.print(filter15.confirming());
         Serial.print("/");
         Serial.print(CONSECUTIVE_READINGS);
         Serial.print(")");
@@ -199,13 +149,13 @@ if (millis() - lastPrintTime >= PRINT_INTERVAL) {
     }
     
     // FIX: Check if BOTH sensors have enough valid readings
-    if (validReadings60 < FILTER_SIZE || validReadings15 < FILTER_SIZE) {
+    if (!filter60.ready() || !filter15.ready()) {
       Serial.print("Stabilizing... (60°: ");
-      Serial.print(validReadings60);
+      Serial.print(filter60.size());
       Serial.print("/");
       Serial.print(FILTER_SIZE);
       Serial.print(", 15°: ");
-      Serial.print(validReadings15);
+      Serial.print(filter15.size());
       Serial.print("/");
       Serial.print(FILTER_SIZE);
       Serial.println(")");
@@ -225,81 +175,6 @@ if (millis() - lastPrintTime >= PRINT_INTERVAL) {
 
 
 
-// Enhanced filter function with smart jump detection
-int addToFilterSmart(int newReading, int* readings, int& readIndex, 
-                     long& total, int& average, int& validCount,
-                     int& consecutiveCount, int& lastRawReading,
-                     int minValid, int maxValid) {
-  
-  // Reject obvious outliers
-  if (newReading < minValid || newReading > maxValid) {
-    return average;
-  }
-  
-  // If we don't have a stable average yet, just add it
-  if (average < 0) {
-    total = total - readings[readIndex];
-    readings[readIndex] = newReading;
-    total = total + newReading;
-    readIndex = (readIndex + 1) % FILTER_SIZE;
-    
-    if (validCount < FILTER_SIZE) validCount++;
-    if (validCount >= FILTER_SIZE) filtersReady = true;
-    
-    average = total / max(validCount, 1);
-    lastRawReading = newReading;
-    return average;
-  }
-  
-  // Calculate difference from current average
-  int difference = abs(newReading - average);
-  
-  // CASE 1: Small spike (noise) - reject it
-  if (difference <= SMALL_SPIKE_THRESHOLD) {
-    // Allow small changes through immediately
-    total = total - readings[readIndex];
-    readings[readIndex] = newReading;
-    total = total + newReading;
-    readIndex = (readIndex + 1) % FILTER_SIZE;
-    
-    if (validCount < FILTER_SIZE) validCount++;
-    average = total / FILTER_SIZE;
-    
-    lastRawReading = newReading;
-    consecutiveCount = 0;
-    return average;
-  }
-  
-  // CASE 2: Large jump - need consecutive confirmation
-  // Check if this reading is consistent with the last raw reading
-  bool isConsistent = (lastRawReading > 0 && 
-                       abs(newReading - lastRawReading) <= CONSISTENCY_TOLERANCE);
-  
-  if (isConsistent) {
-    consecutiveCount++;
-  } else {
-    consecutiveCount = 1;  // Reset count, start new sequence
-  }
-  
-  lastRawReading = newReading;
-  
-  // If we have enough consecutive readings, accept the jump
-  if (consecutiveCount >= CONSECUTIVE_READINGS) {
-    // Clear the filter and reset with new value
-    for (int i = 0; i < FILTER_SIZE; i++) {
-      readings[i] = newReading;
-    }
-    total = newReading * FILTER_SIZE;
-    average = newReading;
-    validCount = FILTER_SIZE;
-    consecutiveCount = 0;
-    
-    return average;
-  }
-  
-  return average;
-}
-
 float calculateVolume(float len, float width, float height,
                       float dist60, float dist15,
                       float topxoffset, float bottomxoffset,
@@ -347,20 +222,3 @@ float calculateVolume(float len, float width, float height,
 
   return percentFull;
 }
-
-int processA02Data(unsigned char* buffer, int sensorNum) {
-  if (buffer[0] == 0xFF) {
-    unsigned char CS = (buffer[0] + buffer[1] + buffer[2]) & 0xFF;
-    
-    if (CS == buffer[3]) {
-      int distance_mm = (buffer[1] << 8) | buffer[2];
-      int distance_inches = distance_mm * 0.03937;
-      
-      return distance_inches;
-    } else {
-      return -1;
-    }
-  }
-  
-  return -1;
-}
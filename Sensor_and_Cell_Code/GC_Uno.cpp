@@ -20,436 +20,344 @@ used throughout the project.
 #include "GC_Uno.h"
 
 // ======================== GLOBAL VARIABLES ========================
-const char entrypoint[] = "harvest.soracom.io";     // Entrypoint for Soracom Harvest, where data will be sent
-const int soracomPort = 80;         // Port for Soracom Harvest, default is 80 for HTTP communication. 
-
-const char apn[] = "soracom.io";    // APN for Soracom, used for GPRS reconnection
-const char User[] = "sora";         // User for Soracom, used for GPRS reconnection
-const char Pass[] = "sora";         // Password for Soracom, used for GPRS reconnection
-
+// The Soracom endpoint, APN and the modem/sensor helpers (powerOnModem, getISOTimestamp,
+// readSensor, GetFullPer) are shared with the ESP32 build and live in the GC_Common library.
 // Link to the Soracom Harvest Overview page:
 // https://developers.soracom.io/en/docs/harvest/
 
 
-// Variables for the sensor function
-// Yeah, I know this is bad practice, but it's easier to do it this way for now
-// and I don't want to deal with passing variables around everywhere.
-// Time was tight and this was last minute.
-long defaultHeight1,duration, distance, defaultHeight2, dist15, dist60, h15, h60;
-long x15, x60;
+//Specs of the dumpsters on campus, one line per size (GC_Profiles.h)
+//Add a line for each new size, the id is what BIN_PROFILE (GC_Uno.h) and a downlink pick
+//Lengths in inches, angles in degrees
+const GeometryProfile binProfiles[] = {
+  // id, len, width, height, offset15, offset60, offsetHeight60, angle15, angle60
+  {  1,  36,  24,    36,     4,        2,        3,              15,      60 },   // test dumpster
+};
+const uint8_t binProfileCount = sizeof(binProfiles) / sizeof(binProfiles[0]);
 
-//Specs for the test dumpster
-long testDumpLen = 36;
-long testDumpWidth = 24;
-long testDumpHeight = 36;
+// The profile in use, its geometry (derived values worked out once in useProfile)
+// and that geometry with the empty-bin readings measured on site once there are
+// some (GC_Calibration.h). binGeometry is what the readings are computed with.
+GeometryProfile binProfile;
+DumpsterGeometry dumpster;
+DumpsterGeometry binGeometry;
 
-//Change these values to real dumpster's specs when the time comes
-long dumpsterHeight = testDumpHeight; //height of the dumpster in inches
-long dumpsterWidth = testDumpWidth; //Width of the dumpster in inches
-long dumpsterlen = testDumpLen; //length of the dumpster in inches
+// Readings that could not be sent, kept in EEPROM until the connection works again
+ReadingQueue<READING_QUEUE_SLOTS, EepromStore> readingQueue;
 
-//Distance when the sensors are not reading anything
-long defaultD15= dumpsterlen / cos(radians(15));; //User input of default distance for 15-degree angle
-long defaultD60 = dumpsterHeight / cos(radians(30)); //User input of default distance for 60-degree angle
-long realHeight = 0; //final height we're taking for the trash
+// Empty-bin baseline, kept in EEPROM right after the queue
+CalibrationStore<EepromStore> calibrationStore(ReadingQueue<READING_QUEUE_SLOTS, EepromStore>::STORAGE_SIZE);
+EmptyBinCalibrator<GC_CAL_SAMPLES> calibrator;
 
-//These are offsets of the test casing
-long offsetDist60 = 4.5*cos(60*PI/180); //the offset distance the sensor are placed away from the wall
-long offsetHeight60 = 3; //the offset height the sensor are placed away from the wall
+// Profile picked by a downlink, kept in EEPROM right after the calibration
+ProfileStore<EepromStore> profileStore(ReadingQueue<READING_QUEUE_SLOTS, EepromStore>::STORAGE_SIZE + GC_CAL_STORAGE_SIZE);
 
-long offsetDist15 = 4.5;
+// Readings waiting to be sent together in one POST
+ReadingBatch<GC_BATCH_SIZE> readingBatch;
 
-long trashVolume = 0; //volume of trash
-long totalVolume = dumpsterHeight*dumpsterWidth*dumpsterlen; //volume of the dumpster in cubic inches
-long fullnessPer = 0; // fullness percentage
-// Fix later when optimizing sensor code
+// Connection to Soracom, kept open between reports (GC_TRANSPORT picks HTTP, TCP or UDP)
+UplinkSession harvest(modem, client);
 
 
 // ===================== FUNCTION DEFINITIONS =======================
 /*
-powerOnModem - Power on the modem using the RST and PWR pins
+makeRecord - Pack one reading into a record (GC_Telemetry.h).
 
 Parameters:
-  RST - Pin number for the RST pin (reset pin)
-  PWR - Pin number for the PWR pin (power key pin)
+  id        - The sensor device ID.
+  fullness  - The fullness percentage, negative if there was no reading.
+*/
+static TelemetryRecord makeRecord(long id, long fullness) {
+  static uint8_t seq = 0;
+  TelemetryRecord record;
+  record.id = id; // Sensor ID
+  record.fullness = telemetryFullness(fullness); // Fullness percentage
+  record.temperature = random(0, 120);
+  record.humidity = random(20, 60);
+  record.health = GC_HEALTH_OK;
+  if (deviceClock().valid()) {
+    record.health |= GC_HEALTH_TIME; // "time" can be sent with it
+  }
+  record.seq = seq++;
+  record.age = 0; // Sent right away
+  return record;
+}
 
-This function initializes the modem by cycling/toggling the RST and PWR pins.
-This is to ensure the modem powers on correctly and is ready for communication.
 
-This is set in mind for Arduino Uno and SIM7000A, but can be adapted for other 
-boards. So, check whether you need to change hold times when adapting to the
-Arduino Nano ESP32 or ESP8266.
+/*
+prewarmSoracom - Open the connection to Soracom Harvest ahead of the next report.
 
-Link to the SIM7000A schematic:
-https://github.com/botletics/SIM7000-LTE-Shield/blob/master/Schematics/SIM7000%20Shield%20Schematic%20v6.png
+Parameters:
+  SerialMon - The serial monitor stream for debug output.
+
+Call it before reading the sensors. The report after the reading then only
+sends the request, unless the connection was closed while the sensors had the
+receiver. loop() checks that with harvest.recheck(), and the report connects
+again. Does nothing if the next reading will not be sent yet
+(GC_BATCH_SIZE), or if GPRS is down (the report reconnects it).
 */
-void powerOnModem(int RST, int PWR) {
-  // Setup RST Pin
-  pinMode(RST, OUTPUT);
-  // Toggle RST low for 0.1s
-  digitalWrite(RST, LOW);
-  delay(100);                   // Hold Time for RST Low
-  digitalWrite(RST, HIGH);
-
-  // Setup PWR Pin
-  pinMode(PWR, OUTPUT);
-  // Hold PWR low for 1.2s, then high for 8s
-  digitalWrite(PWR, LOW);
-  delay(1200);                  // Hold Time for PWR Low
-  digitalWrite(PWR, HIGH);
-  delay(8000);                  // Hold Time for PWR High
+void prewarmSoracom(Stream &SerialMon) {
+  if (readingBatch.size() + 1 < GC_BATCH_SIZE || !modem.isGprsConnected()) {
+    return;
+  }
+  harvest.open(SerialMon);
 }
 
 
 /*
-getISOTimestamp - Get the current timestamp from the modem in ISO-8601 format.
+sendDataToSoracom - Send the fullness to Soracom Harvest.
 
 Parameters:
-  modem - The TinyGsm object representing the modem.
+  SerialMon - The serial monitor stream for debug output.
+  id        - The sensor device ID.
+  fullness  - The fullness percentage, negative if there was no reading.
+  sendNow   - Send right away, even if the batch is not full (e.g. a pickup).
 
-This function sends an AT command to the modem to retrieve the current date 
-and time. We do this to ensure the time is accurate and in the correct format 
-for Soracom Harvest. Soracom Harvest already sets a timestamp on the server side, 
-but we can use this to provide a more accurate timestamp in case of network delays 
-or other issues. 
+This function connects to the Soracom Harvest endpoint and sends JSON data,
+or the 8 byte binary record when GC_PAYLOAD_BINARY is defined (GC_Uno.h).
+It handles GPRS connection, client connection, and HTTP POST request.
+The connection to Harvest stays open between calls (UplinkSession, GC_Unified.h).
 
+With GC_BATCH_SIZE above 1 (GC_Uno.h), readings are collected in readingBatch
+and sent together in one POST once the batch is full or GC_BATCH_MAX_AGE_MS old.
 
-CURRENTLY UNUSED, BUT LEFT FOR FUTURE IMPLEMENTATION.
-- Returned time string is incorrect
-- Honestly, I'd recommend just rewriting this entirely
-- Alternatively, you can use the Soracom Harvest timestamp instead of this one.
-  BUT, stakeholdrs might want accurate timestamps for their data.
+If the send fails, the readings go into readingQueue (GC_Queue.h, stored in
+EEPROM) and is sent after the next send that works. A bin with bad coverage
+gives up after GC_REPORT_BUDGET_MS (GC_Uno.h) at the latest, so loop() gets
+back to sensing.
 
+Soracom Harvest sets the timestamp on the server side. A queued reading carries
+its age in seconds as well. Once the modem clock is synced (syncClock, asked
+at most once an hour), the JSON also gets a "time" key with the epoch seconds
+when the reading was taken (GC_Clock.h).
+  
+Todo for upcoming semester (2025 Fall):
+Current Improvements:
+- Replace with actual data from your sensors. There are two ways to do this.
+  1. Replace the mock data with actual sensor data in the JSON payload. You can
+  do this by calling or calculating the fullness in the function itself.
 
-Examples of valid timestamps used by Soracom Harvest:
-Date/Time (ISO-8601): 2022-10-05T11:30:45.000Z
-Unix Time (seconds): 1633433445
-Unix Time (milliseconds): 1633433445000
+  2. Pass the sensor data as parameters to the function. So you can call or
+  calculate the fullness in the main loop and pass it to this function. 
 
-*/
-String getISOTimestamp(TinyGsm& modem) {
-  // Send AT command to get time
-  modem.sendAT("+CCLK?");
-
-  // Wait for response and store in 'response'
-  String response = "";
-  if (modem.waitResponse(1000L, response) != 1) {
-    Serial.println("Failed to get modem time.");
-    return "";
-  }
 
-  // Example response: +CCLK: "24/04/13,13:37:20+00"
-  int startQuote = response.indexOf('"');
-  int endQuote = response.lastIndexOf('"');
+Future Improvements:
+- The binary format is done, see GC_Telemetry.h for the bit segment layout.
+  Fullness uses 7 bits, and the whole record is 8 bytes instead of ~70 bytes
+  of JSON. If you add a field, add it to GC_TELEMETRY_PARSER too and bump
+  GC_TELEMETRY_VERSION.
 
-  if (startQuote == -1 || endQuote == -1 || endQuote <= startQuote) {
-    Serial.println("Malformed time response.");
-    return "";
+  - Optimize/Modifiy the function to your hearts content. Just keep it functional and working.
+  You can modify everything except the HTTP POST request part. This part is correct, so don't change it.
+*/
+void sendDataToSoracom(Stream &SerialMon, long id, long fullness, bool sendNow) {
+  // Pack the reading into a record (GC_Telemetry.h)
+  // postBatch sends it as JSON, or as binary with GC_PAYLOAD_BINARY
+  TelemetryRecord record = makeRecord(id, fullness);
+
+  // Collect readings until the batch is full or old enough (GC_BATCH_SIZE)
+  readingBatch.add(record);
+  if (!sendNow && !readingBatch.due(GC_BATCH_MAX_AGE_MS)) {
+    return;
   }
 
-  // Extract the date/time string from the response
-  String timeStr = response.substring(startQuote + 1, endQuote); // Ex. 24/04/13,13:37:20+00
-  int commaIndex = timeStr.indexOf(',');
-  if (commaIndex == -1) {
-    Serial.println("Malformed date/time structure.");
-    return "";
+  // Ensure GPRS is still connected. If it is not, or the POST fails, keep the
+  // readings in EEPROM instead of retrying forever and stalling the loop.
+  // All retries and waits of this report, down to the connection to Harvest
+  // and its response, share GC_REPORT_BUDGET_MS (GC_Retry.h).
+  // The clock is only read from the modem when a resync is due (GC_Clock.h)
+  TaskTimer budget;
+  budget.start(GC_REPORT_BUDGET_MS);
+  bool online = ensureGprs(modem, SerialMon, budget);
+  if (online) {
+    syncClock(modem, SerialMon);
   }
-
-  String datePart = timeStr.substring(0, commaIndex);    // "24/04/13"
-  String timePart = timeStr.substring(commaIndex + 1);   // "13:37:20+00"
-
-  // Extract offset
-  int offsetSignIndex = timePart.indexOf('+');
-  if (offsetSignIndex == -1) offsetSignIndex = timePart.indexOf('-');
-
-  String offsetStr = "+00"; // default to UTC
-  if (offsetSignIndex != -1) {
-    offsetStr = timePart.substring(offsetSignIndex);  // "+00", "-05", etc.
-    timePart = timePart.substring(0, offsetSignIndex); // trim offset from time
+  if (!online || !postBatch(harvest, SerialMon, readingBatch, budget)) {
+    for (uint8_t i = 0; i < readingBatch.size(); i++) {
+      readingQueue.push(readingBatch.get(i, millis()), readingBatch.stamp(i));
+    }
+    readingBatch.clear();
+    SerialMon.print("Send failed, queued readings: "); SerialMon.println(readingQueue.size());
+    return;
   }
+  readingBatch.clear();
 
-  // Parse time components
-  int yy = datePart.substring(0, 2).toInt();
-  int mm = datePart.substring(3, 5).toInt();
-  int dd = datePart.substring(6, 8).toInt();
-  // Normalize year (assuming years >= 70 are 1970s, else 2000s)
-  int fullYear = (yy >= 70) ? (1900 + yy) : (2000 + yy);
-
-  int hour = timePart.substring(0, 2).toInt();
-  int minute = timePart.substring(3, 5).toInt();
-  int second = timePart.substring(6, 8).toInt();
-
-  // Parse offset
-  int offsetMinutes = 0;
-  if (offsetStr.length() >= 3) {
-    int sign = (offsetStr[0] == '-') ? -1 : 1;
-    offsetMinutes = sign * offsetStr.substring(1, 3).toInt() * 15;  // <-- 15 minute units
-  }
+  // The response may carry a new profile or a calibration request (GC_Profiles.h)
+  applyDownlink(SerialMon);
 
-  // Adjust time to UTC
-  tmElements_t tm;
-  tm.Year = fullYear - 1970;
-  tm.Month = mm;
-  tm.Day = dd;
-  tm.Hour = hour;
-  tm.Minute = minute;
-  tm.Second = second;
-
-  time_t localTime = makeTime(tm);
-  time_t utcTime = localTime - (offsetMinutes * 60);
-
-  // Break down UTC time into components
-  breakTime(utcTime, tm);
-
-  // Format to ISO-8601
-  char isoTime[30];  // Enough room for full ISO string
-  snprintf(isoTime, sizeof(isoTime), "%04d-%02d-%02dT%02d:%02d:%02d.000Z",
-           tm.Year + 1970, tm.Month, tm.Day, tm.Hour, tm.Minute, tm.Second);
-  return String(isoTime);
+  // The connection works, send what was queued while it did not,
+  // as much as the budget allows
+  sendQueued<GC_BATCH_SIZE>(harvest, SerialMon, readingQueue, budget);
 }
 
 
 /*
-sendDataToSoracom - Send JSON data to Soracom Harvest.
+queueDataForSoracom - Keep a reading for later, while the modem is not up yet.
 
 Parameters:
   SerialMon - The serial monitor stream for debug output.
+  id        - The sensor device ID.
+  fullness  - The fullness percentage, negative if there was no reading.
 
-This function connects to the Soracom Harvest endpoint and sends JSON data.
-It handles GPRS connection, client connection, and HTTP POST request.
-  
-Todo for upcoming semester (2025 Fall):
-Current Improvements:
-- Replace with actual data from your sensors. There are two ways to do this.
-  1. Replace the mock data with actual sensor data in the JSON payload. You can
-  do this by calling or calculating the fullness in the function itself.
+The reading goes straight into readingQueue and is sent by the first
+sendDataToSoracom() that works, with its age.
+*/
+void queueDataForSoracom(Stream &SerialMon, long id, long fullness) {
+  readingQueue.push(makeRecord(id, fullness));
+  SerialMon.print("Modem not ready, queued readings: "); SerialMon.println(readingQueue.size());
+}
 
-  2. Pass the sensor data as parameters to the function. So you can call or
-  calculate the fullness in the main loop and pass it to this function. 
 
+/*
+printBaseline - Print the empty-bin readings binGeometry uses.
+*/
+static void printBaseline(Stream &SerialMon, const char *source) {
+  SerialMon.print("Empty bin ("); SerialMon.print(source);
+  SerialMon.print("): d15 "); SerialMon.print(binGeometry.defaultD15);
+  SerialMon.print(", d60 "); SerialMon.println(binGeometry.defaultD60);
+}
 
-Future Improvements:
-- Reduce payload size by converting the JSON to a binary format. This will 
-  reduce the size of the payload and make it easier to send over the network.
-  This will be complicated, but can be done. ECE 270, ECE 362, and ECE 404 
-  references will be helpful for this. If you took them. If not, you can 
-  try to find students who took them and ask them for help.
 
-  Ex. 0101010010|10101010101|010101|0101|01010|10101|01010101|0101010101010101|010101010
-  You can divide up a binary string into bit segments and send them over the network.
-  Each segment will be hold a specific value. You can use this method to view certain segments
-  and decide what each segment means and what it will hold. 
+/*
+loadCalibration - Use the baseline stored in EEPROM, if there is one.
 
-  Using the two Most Significant Bits (MSB) as examples:
-  0101010010 could be the fullness of the dumpster. 10101010101 could be the time.
-  Since fullness is a percentage (0-100), you can use the first 7 bits to represent the fullness.
+Parameters:
+  SerialMon - The serial monitor stream for debug output.
 
-  - Optimize/Modifiy the function to your hearts content. Just keep it functional and working.
-  You can modify everything except the HTTP POST request part. This part is correct, so don't change it.
+Called by loadProfile() and whenever the profile changes. Without a stored
+baseline (first boot, or another profile), the nominal values from dumpster
+stay.
 */
-void sendDataToSoracom(Stream &SerialMon, long id, long fullness) {
-  TinyGsmClient client(modem, 0);
-
-  // Create JSON document
-  // Currently just mock (fake) data for testing
-  // Replace with actual data from your sensors
-  StaticJsonDocument<2048> jsonDoc;
-  jsonDoc["id"] = id; // Sensor ID
-  jsonDoc["fullness"] = fullness; // Fullness percentage
-  jsonDoc["temperature"] = random(0, 120);
-  jsonDoc["humidity"] = random(20, 60);
-  jsonDoc["status"] = "OK";
-
-
-  // Optional: Add timestamp to JSON
-  // Uncomment the following lines to add a timestamp to the JSON payload
-/*  
-  // Soracom Harvest expects ISO-8601 Date/Time
-  // Date/Time (ISO-8601): 2022-10-05T11:30:45.000Z
-  String isoTime = getISOTimestamp(modem);
-  delay(10000);
-  if (isoTime.length()) {
-    jsonDoc["time"] = isoTime;
+void loadCalibration(Stream &SerialMon) {
+  Baseline baseline;
+  binGeometry = dumpster;
+  if (calibrationStore.load(dumpster, baseline)) {
+    applyBaseline(binGeometry, baseline);
+    printBaseline(SerialMon, "calibrated");
   } else {
-    jsonDoc["time"] = "1970-01-01T00:00:00.000Z"; // Fallback or leave empty
+    printBaseline(SerialMon, "nominal");
   }
-*/
+}
 
-  // Measure JSON size
-  int contentLength = measureJson(jsonDoc);
 
-  // Close previous connection if still open
-  SerialMon.println("Preparing client to connect to Soracom Harvest...");
-  if (client.connected()) {
-    SerialMon.println("Previous client still connected. Closing...");
-    client.stop();
-    delay(100);
-  }
+/*
+startCalibration - Measure the empty bin with the next readings.
 
-  // Ensure GPRS is still connected
-  if (!modem.isGprsConnected()) {
-    SerialMon.println("GPRS not connected. Attempting to reconnect...");
-    while (!modem.gprsConnect(apn, User, Pass)) {
-        if (modem.isGprsConnected()) { break; }
-      SerialMon.println("GPRS reconnect failed. Delaying 10s and retrying...");
-      delay(10000);
-    }
-  }
+Parameters:
+  SerialMon - The serial monitor stream for debug output.
 
-  // Connect to Soracom Harvest
-  SerialMon.println("Connecting to Soracom Harvest...");
-  int retries = 0;
-  // Keep trying to connect until success or max retries
-  // This is to ensure the connection is established before sending data
-  while (!client.connect(entrypoint, soracomPort) && retries < 5) {
-    SerialMon.println("Failed to connect to Soracom Harvest, retrying in 5 seconds...");
-    retries++;
-    delay(5000);
-  }
+Call right after a pickup, or on command. Pass every following reading to
+calibrateWith() until it is done.
+*/
+void startCalibration(Stream &SerialMon) {
+  calibrator.start();
+  SerialMon.println("Calibrating the empty bin...");
+}
 
-  if (!client.connected()) {
-    SerialMon.println("Failed to connect after 5 attempts. Giving up.");
-    return;
-  }
 
-  // HTTP Post request
-  // DO NOT MODIFY THIS PART
-  // 
-  // These lines format the HTTP POST request. They are correct, so don't change them.
-  // The only thing you might want to change is the content of the jsonDoc payload above.
-  client.println("POST / HTTP/1.1");
-  client.print("Host: "); client.println(entrypoint);
-  client.println("Content-Type: application/json");
-  client.print("Content-Length: "); client.println(contentLength);
-  client.println("Connection: close");
-  client.println();
-  serializeJson(jsonDoc, client);   // Send payload directly
-  client.flush();  // ensure it's sent
-
-  // Read server response
-  SerialMon.println("Reading server response");
-  String response = "";
-  while (client.connected() || client.available()) {
-      if (client.available()) {
-          String line = client.readStringUntil('\n');
-          response += line + "\n";
-          SerialMon.println(line);
-      }
+/*
+calibrateWith - Give one reading to a running calibration.
+
+Parameters:
+  SerialMon - The serial monitor stream for debug output.
+  raw15     - Reading of the 15 degree sensor in inches, -1 on timeout.
+  raw60     - Reading of the 60 degree sensor in inches, -1 on timeout.
+
+Once enough readings agree, the baseline is used right away and saved to EEPROM.
+Does nothing if no calibration is running.
+*/
+void calibrateWith(Stream &SerialMon, long raw15, long raw60) {
+  if (!calibrator.active()) {
+    return;
   }
-  SerialMon.println("Server Response: " + response);
-  if (client.connected()) {
-    client.stop();
-    delay(100); // Allow socket to fully close
+  Baseline baseline;
+  uint8_t result = calibrator.add(dumpster, raw15, raw60, baseline);
+  if (result == GC_CAL_DONE) {
+    applyBaseline(binGeometry, baseline);
+    calibrationStore.save(dumpster, baseline);
+    printBaseline(SerialMon, "calibrated");
+  } else if (result == GC_CAL_REJECTED) {
+    SerialMon.println("Calibration rejected, readings did not agree or were out of range");
   }
 }
 
 
-
 /*
-readSensor - Read data from the ultrasonic sensor.
+useProfile - Compute the geometry of a profile and read with it from now on.
 
 Parameters:
-  sensor - The SoftwareSerial object representing the sensor.
-
-This function reads data from the ultrasonic sensor connected to the
-SoftwareSerial port. It waits for the sensor to send data and verifies the checksum.
-It returns the distance in inches. If the sensor times out or fails to read data, it 
-returns -1.
+  SerialMon - The serial monitor stream for debug output.
+  profile   - The profile to use.
 
+The sin/cos constants and the volume are worked out here, once, not per
+reading. The calibration is loaded again, since a baseline only counts for
+the geometry it was measured with.
 */
-long readSensor(SoftwareSerial &sensor) {
-  sensor.listen(); // Switch to this sensor
-  delay(100); // Short stabilization delay
-  
-  unsigned char data[4] = {0};
-  unsigned long startTime = millis();
-  
-  while (millis() - startTime < 300) { // 300ms timeout
-    if (sensor.available() > 0) {
-      if (sensor.read() == 0xFF) {
-        delay(10); // Small delay to ensure data arrives
-        if (sensor.available() >= 3) {
-          data[1] = sensor.read(); // High byte
-          data[2] = sensor.read(); // Low byte
-          data[3] = sensor.read(); // Checksum
-          
-          // Verify checksum (overflow handled by byte casting)
-          if (data[3] == (byte)(0xFF + data[1] + data[2])) {
-            return ((data[1] << 8) + data[2]) * 0.0393700787; // Convert to inches
-          }
-        }
-      }
-    }
-  }
-  return -1; // Return error if timeout
+static void useProfile(Stream &SerialMon, const GeometryProfile &profile) {
+  calibrator.stop();
+  binProfile = profile;
+  dumpster = geometryFromProfile(profile);
+  SerialMon.print("Dumpster profile "); SerialMon.print(profile.id);
+  SerialMon.print(": "); SerialMon.print(profile.len);
+  SerialMon.print(" x "); SerialMon.print(profile.width);
+  SerialMon.print(" x "); SerialMon.println(profile.height);
+  loadCalibration(SerialMon);
 }
 
 
-/* 
-GetFullPer - Get the fullness percentage of the dumpster.
+/*
+loadProfile - Pick the dumpster profile at boot.
 
 Parameters:
-  Serial - The serial monitor stream for debug output.
-  sensor15 - The SoftwareSerial object for the 15-degree sensor.
-  sensor60 - The SoftwareSerial object for the 60-degree sensor.
+  SerialMon - The serial monitor stream for debug output.
+
+Uses the profile a downlink stored in EEPROM, or BIN_PROFILE (GC_Uno.h) if
+there is none. A stored table id is looked up in binProfiles again, so a
+corrected line in the table applies after flashing. Call in setup() before
+the first reading, it loads the calibration too.
+*/
+void loadProfile(Stream &SerialMon) {
+  GeometryProfile stored;
+  const GeometryProfile *profile = NULL;
+  if (profileStore.load(stored)) {
+    profile = stored.id == GC_PROFILE_CUSTOM ? &stored : findProfile(binProfiles, binProfileCount, stored.id);
+  }
+  if (profile == NULL) {
+    profile = findProfile(binProfiles, binProfileCount, BIN_PROFILE);
+  }
+  if (profile == NULL) {
+    profile = &binProfiles[0];
+  }
+  useProfile(SerialMon, *profile);
+}
 
-This function reads data from the two ultrasonic sensors (15-degree and 60-degree)
-and calculates the fullness percentage of the dumpster. It uses trigonometry to calculate
-the height and distance of the trash based on the sensor readings. The fullness percentage
-is calculated based on the volume of the trash and the total volume of the dumpster.
 
-It returns the fullness percentage as a long integer.
+/*
+applyDownlink - Do what the response to the last report asked for.
 
-Todo:
-- Fix the function to work with the two sensors and return the fullness percentage.
-- Modify the function to send the fullness percentage to Soracom Harvest.
-- Figure out why the function disconnects from the network and refuses to connect again.
+Parameters:
+  SerialMon - The serial monitor stream for debug output.
 
+A new profile is used and saved to EEPROM, a calibration request starts
+startCalibration(). See parseDownlink (GC_Soracom.h) for the format. Does
+nothing if the response had no body, or with the TCP/UDP transports.
 */
-long GetFullPer(Stream &Serial, SoftwareSerial &sensor15, SoftwareSerial &sensor60) {
-  dist15 = readSensor(sensor15) + offsetDist15; //distance reading of 15-degree sesnsor
-  delay(50); // Delay between sensor reads
-  dist60 = readSensor(sensor60) + offsetDist60; //distance reading of 60-degree sesnsor
-  delay(50); // Delay between sensor reads
-
-  h15 = dumpsterHeight - (dist15 * sin(15*PI/180)); //height reading of the 15 degree sensor
-  h60 = dumpsterHeight - ((dist60) * sin(60*PI/180) + offsetHeight60); //height reading of the 60 degree sensor
-  x15 = dumpsterlen - (dist15 * cos(radians(15))); //x-axis distance reading of the 15 degree sensor from the end of the bin's wall to trash
-  x60 = dumpsterlen - (dist60 * cos(radians(60))); //x-axis distance reading of the 60 degree senso from the end of the bin's wall to trash
-  
-  Serial.print("dist15: ");
-  Serial.println(dist15 - offsetDist15);
-  Serial.print("dist60: ");
-  Serial.println(dist60 - offsetDist60);
-  Serial.print("h60: ");
-  Serial.println(h60);
-  Serial.print("h15: ");
-  Serial.println(h15);
-
-  trashVolume = 0;
-
-  //Check 60-degree if reading things
-  //if the detected ditance is shorter than 85% of the defualt distance -> sensor is detecting trash
-  if(dist60 <= defaultD60*0.85){
-    trashVolume = h60 * dumpsterWidth * x60;
-    if(dist15 <= defaultD15*0.85){   
-      //Seperate into 2 volume
-      //Serial.println("True");
-      long bottomVol = h60 * dumpsterWidth * x60;
-      long topVol = (x60 + x15) * (h15-h60) / 2 * dumpsterWidth;
-      trashVolume = topVol+bottomVol;
-      }
+void applyDownlink(Stream &SerialMon) {
+  Downlink downlink;
+  uint8_t flags = parseDownlink(downlinkOf(harvest), downlink);
+  if (flags & GC_DOWNLINK_PROFILE) {
+    const GeometryProfile *profile = findProfile(binProfiles, binProfileCount, downlink.profileId);
+    if (profile == NULL) {
+      SerialMon.print("Unknown dumpster profile: "); SerialMon.println(downlink.profileId);
+    } else if (profile->id != binProfile.id) {
+      profileStore.save(*profile);
+      useProfile(SerialMon, *profile);
+    }
+  } else if (flags & GC_DOWNLINK_GEOMETRY) {
+    profileStore.save(downlink.geometry);
+    useProfile(SerialMon, downlink.geometry);
+  }
+  if (flags & GC_DOWNLINK_CALIBRATE) {
+    startCalibration(SerialMon);
   }
-
-  Serial.print("Trash Vol: ");
-  Serial.println(trashVolume);
-
-  Serial.print("Total Vol: ");
-  Serial.println(totalVolume);
-  
-  fullnessPer = ((float)trashVolume / (float)totalVolume) * 100; //Calculte the fullness percentage
-  Serial.print(fullnessPer);
-  Serial.println("%");
-  delay(1000); // Main loop delay
-  return fullnessPer; //Return the fullness percentage
 }
@@ -17,23 +17,95 @@ It includes the necessary libraries and defines the constants used throughout th
 // ======================== LIBRARY DEFINES ========================
 #define TINY_GSM_MODEM_SIM7000
 
+// ======================== PAYLOAD FORMAT ========================
+// Uncomment to send the 8 byte binary record (GC_Telemetry.h) instead of JSON.
+// Set the Binary Parser of the SIM group to GC_TELEMETRY_PARSER first, so
+// Harvest still stores the same keys.
+// #define GC_PAYLOAD_BINARY
+
+// ======================== TRANSPORT ========================
+// How reports are sent (GC_Unified.h):
+//   GC_TRANSPORT_HTTP - HTTP POST to harvest.soracom.io
+//   GC_TRANSPORT_TCP  - payload only, raw TCP to uni.soracom.io
+//   GC_TRANSPORT_UDP  - payload only, one UDP datagram to uni.soracom.io
+#define GC_TRANSPORT GC_TRANSPORT_HTTP
+
+// ======================== QUEUE ========================
+// Number of unsent readings kept in EEPROM (power of two, 15 bytes each).
+// The calibration (GC_Calibration.h) and the dumpster profile (GC_Profiles.h)
+// are stored right after the queue, and all three have to fit in the Uno's
+// 1024 bytes.
+#define READING_QUEUE_SLOTS 32
+
+// ======================== DUMPSTER PROFILE ========================
+// id of the line in binProfiles (GC_Uno.cpp) with this bin's size. Used until
+// a downlink picks another one (applyDownlink), which is kept in EEPROM.
+#define BIN_PROFILE 1
+
+// ======================== BATCHING ========================
+// Readings sent together in one HTTP POST. 1 sends every reading right away.
+// Each extra reading costs 12 bytes of RAM. JSON only, GC_PAYLOAD_BINARY
+// needs 1.
+#define GC_BATCH_SIZE        1
+// Send a batch that is not full yet once its oldest reading is this old (ms)
+#define GC_BATCH_MAX_AGE_MS  60000UL
+
+#if defined(GC_PAYLOAD_BINARY) && GC_BATCH_SIZE > 1
+#error "The Binary Parser decodes one record per POST, set GC_BATCH_SIZE to 1 with GC_PAYLOAD_BINARY"
+#endif
+
+// ======================== RETRIES ========================
+// Longest time one report may spend retrying (GPRS, connection, queued
+// readings). Past it, the readings are queued and sent with the next report.
+// The retry waits themselves are in GC_Retry.h.
+#define GC_REPORT_BUDGET_MS  30000UL
+
+// ======================== METRICS ========================
+// 1 = time every modem, uplink and sensor phase with micros() and count sensor
+//     timeouts and checksum errors (GC_Metrics.h), printed after each report.
+//     Costs about 260 bytes of RAM.
+// 0 = compiled out
+#define GC_METRICS            0
+// 1 = also send the last phase times and counters with each JSON report
+#define GC_METRICS_IN_PAYLOAD 0
+
 // ======================== INCLUDES ========================
 #include <TinyGsmClient.h>
 #include <ArduinoJson.h>
 #include <SoftwareSerial.h>
-#include <TimeLib.h>
+#include <GC_Soracom.h>            // powerOnModem, getISOTimestamp, postToHarvest (GC_Common library)
+#include <GC_Unified.h>            // HTTP/TCP/UDP uplink selection (GC_Common library)
+#include <GC_Sensor.h>             // readSensor, GetFullPer (GC_Common library)
+#include <GC_Telemetry.h>          // binary telemetry record (GC_Common library)
+#include <GC_Queue.h>              // store-and-forward queue in EEPROM (GC_Common library)
+#include <GC_Batch.h>              // several readings per POST (GC_Common library)
+#include <GC_Report.h>             // deadband/pickup/heartbeat reporting (GC_Common library)
+#include <GC_Task.h>               // millis() deadlines for the loop tasks (GC_Common library)
+#include <GC_Metrics.h>            // per-phase timings and counters (GC_Common library)
+#include <GC_SerialBus.h>          // modem/sensor SoftwareSerial receiver sharing (GC_Common library)
+#include <GC_Calibration.h>        // empty-bin baseline in EEPROM (GC_Common library)
+#include <GC_Profiles.h>           // dumpster sizes picked at run time (GC_Common library)
 
 extern TinyGsm modem;
 extern TinyGsmClient client;
 extern Stream &SerialMon;
+extern GeometryProfile binProfile;
+extern DumpsterGeometry dumpster;
+extern DumpsterGeometry binGeometry;
+extern ReadingQueue<READING_QUEUE_SLOTS, EepromStore> readingQueue;
+extern ReadingBatch<GC_BATCH_SIZE> readingBatch;
+extern UplinkSession harvest;
 
 // ======================== FUNCTION DECLARATIONS ========================
 // Add your function declarations here
-void powerOnModem(int RST, int PWR);
-void sendDataToSoracom(Stream &SerialMon, long id, long fullness);
-String getISOTimestamp(TinyGsm& modem);
-long readSensor(Stream &sensor);
-long GetFullPer(Stream &Serial, SoftwareSerial &sensor15, SoftwareSerial &sensor60);
+void prewarmSoracom(Stream &SerialMon);
+void sendDataToSoracom(Stream &SerialMon, long id, long fullness, bool sendNow = false);
+void queueDataForSoracom(Stream &SerialMon, long id, long fullness);
+void loadProfile(Stream &SerialMon);
+void applyDownlink(Stream &SerialMon);
+void loadCalibration(Stream &SerialMon);
+void startCalibration(Stream &SerialMon);
+void calibrateWith(Stream &SerialMon, long raw15, long raw60);
 
 #endif 
 // GC_UNO_H
@@ -17,27 +17,31 @@ The main difference between this code and IoT_GreenCampus_SmartDumpster_Uni.ino
 that this code attempts to calculate the fullness percentage of the dumpster using the 
 two sensors and send the data to Soracom.
 
-So far, the code isn't functional, but it's a work in progress.
-
-Whenever the GetFullPer function is called, it disconnects from the network and refuses to
-connect again. The main guess is that the two sensors interfere with the modem, but it's not
-clear yet. 
+Calling GetFullPer used to disconnect the modem from the network for good. The
+modem and both sensors are SoftwareSerial ports, and only one of them receives at
+a time. Reading a sensor switched the receiver away from the modem, and whatever the
+modem answered in that time was lost. Now serialBus (GC_SerialBus.h) decides who
+receives: the sensors are only read while the modem is quiet, and the modem gets the
+receiver back right after, with a quick "AT" to get TinyGsm back in step. What the
+modem sent in the window is still lost, so the open connection to Harvest is checked
+with the modem (AT+CIPSTATUS) before the report.
+
+Don't call GetFullPer or readSensor directly in here, they switch the receiver
+without asking serialBus. Use the sampler in loop().
 
 Todo:
-- Fix the GetFullPer function to work with the two sensors and return the fullness percentage.
-    * GetFullPer can already calculate the fullness percentage, but it needs to be modified 
-    to send the fullness to the sendDataToSoracom function without disconnecting from the
-    network.
-- Fix the sendDataToSoracom function to accept the fullness percentage and send it to 
-    Soracom Harvest.
+- Try the modem on AltSoftSerial (GC_MODEM_ALTSERIAL below), then the modem keeps
+    receiving while the sensors are read.
 
 
 Required Libraries:
 - TinyGSM by Volodymyr Shymanskyy
 - ArduinoJson by Benoit Blanchon
 - SoftwareSerial (built-in)
+- AltSoftSerial by Paul Stoffregen (optional, only with GC_MODEM_ALTSERIAL)
+- EEPROM (built-in, for the queue of unsent readings)
 - StreamDebugger (optional, for debugging)
-- Time by Michael Margolis (for time handling)
+- GC_Common (shared GreenCampus library in this repo, copy the GC_Common folder into your Arduino libraries folder)
 - GC_Uno.h (custom header file for GreenCampus functions)
 - GC_Uno.cpp (custom source file for GreenCampus functions)
 
@@ -64,6 +68,17 @@ Notes:
 // the JSON Data. Just ask for the CCID.
 #define SENSOR_ID       1
 
+// ======================== REPORTING ========================
+// Readings are taken every 5s, but only sent when they matter (GC_Report.h)
+#define REPORT_DEADBAND       5             // Send when the fullness moved this many % since the last report
+#define REPORT_PICKUP_DROP    20            // A drop this large is a pickup, sent right away
+#define REPORT_HEARTBEAT_MS   3600000UL     // Send at least once an hour, even if nothing changed
+
+// ======================== SENSING ========================
+#define SAMPLE_INTERVAL_MS    5000UL        // Time between readings
+// Set to 1 to read the sensors, 0 sends a hardcoded fullness of 0 for testing.
+#define READ_SENSORS          1
+
 // ======================== LIBRARY DEFINES ========================
 // TinyGSM requires certain defines to be set for the modem and connection type.
 // The following defines are for the SIM7000A modem and GPRS connection.
@@ -86,8 +101,20 @@ Notes:
 
 #define SENSOR15_RX 12 //echo pin
 #define SENSOR15_TX 13 //trig pin -- rightmost wire - white wire
+
+// 1 = the modem is on AltSoftSerial, which only works on pins 8 (RX) and 9 (TX).
+//     It receives at the same time as the sensors, so no modem byte is lost.
+//     Wire the shield's TX/RX to pins 8/9 and the 60 degree sensor to 10/11.
+// 0 = the modem shares the SoftwareSerial receiver with the sensors (serialBus)
+#define GC_MODEM_ALTSERIAL 0
+
+#if GC_MODEM_ALTSERIAL
+#define SENSOR60_RX 10
+#define SENSOR60_TX 11
+#else
 #define SENSOR60_RX 8
 #define SENSOR60_TX 9
+#endif
 
 // Link to the SIM7000A schematic:
 // https://github.com/botletics/SIM7000-LTE-Shield/blob/master/Schematics/SIM7000%20Shield%20Schematic%20v6.png
@@ -98,9 +125,19 @@ Notes:
 
 
 #include <SoftwareSerial.h>
+#if GC_MODEM_ALTSERIAL
+#include <AltSoftSerial.h>
+AltSoftSerial SerialAT;                         // RX 8, TX 9, fixed by AltSoftSerial
+typedef AltSoftSerial ModemSerial;
+#else
 SoftwareSerial SerialAT(MODEM_RX, MODEM_TX);  // RX, TX
-SoftwareSerial sensor15(SENSOR15_RX, SENSOR15_TX);      // Could be causing issues
-SoftwareSerial sensor60(SENSOR60_RX, SENSOR60_TX);      // Could be causing issues
+typedef SoftwareSerial ModemSerial;
+#endif
+SoftwareSerial sensor15(SENSOR15_RX, SENSOR15_TX);
+SoftwareSerial sensor60(SENSOR60_RX, SENSOR60_TX);
+
+// Decides when the sensors may take the SoftwareSerial receiver from the modem
+SerialBus<ModemSerial> serialBus(SerialAT);
 
 // Buffer size for AT commands
 #if !defined(TINY_GSM_RX_BUFFER)
@@ -128,6 +165,23 @@ TinyGsm        modem(debugger);
 #else
 TinyGsm        modem(SerialAT);
 #endif
+TinyGsmClient  client(modem, GC_CLIENT_MUX);    // One client for the whole run, so the connection can stay open
+
+// Decides which readings are sent
+ReportGate reportGate(REPORT_DEADBAND, REPORT_PICKUP_DROP, REPORT_HEARTBEAT_MS);
+
+// Starts the modem while loop() keeps running (GC_Soracom.h)
+ModemStartup<TinyGsm> modemStartup(modem, MODEM_RST, MODEM_PWRKEY);
+
+// Reads both sensors without blocking loop() (GC_Sensor.h)
+// with the calibrated empty-bin readings (binGeometry, GC_Uno.cpp)
+FullnessSampler<SoftwareSerial, SoftwareSerial> sampler(sensor15, sensor60, binGeometry);
+
+// When the next reading is taken
+TaskTimer sampleTimer;
+
+// A reading is due, but the modem was not quiet yet
+bool samplePending = false;
 
 void setup() {
     // Initialize debug serial
@@ -135,86 +189,102 @@ void setup() {
     delay(10);
     // DBG("==== SIM7000A Uno ====");
     SerialMon.println("==== SIM7000A Uno ====");
+    seedJitter();                   // retry waits differ from bin to bin (GC_Retry.h)
 
-    // Initialize pins
-    powerOnModem(MODEM_RST, MODEM_PWRKEY);
+    // Load the readings that were not sent before the last reset
+    uint16_t queued = readingQueue.begin();
+    SerialMon.print("Queued readings: "); SerialMon.println(queued);
+
+    // Pick the dumpster profile (GC_Profiles.h), and use the empty-bin
+    // baseline measured before the reset, if there is one
+    loadProfile(SerialMon);
 
     // Begin communication with modem
     const long baud = 9600;     // DO NOT EVER DELETE. CODE WANTS CONSTANT LONG, DONT TRY TO OPTIMIZE
     sensor15.begin(baud);
-    delay(300);
-    sensor60.begin(baud);       // Could be causing issues 
-    delay(300);
-    SerialAT.begin(baud);       // Could be causing issues
-    delay(300);  // Allow time for the modem to settle
-
-    // Initialize modem
-    // Keep trying to restart until success
-    // DBG("Initializing modem...");
-    SerialMon.println("Initialzing Modem");
-    while(!modem.restart()) {
-        // DBG("Failed to restart modem, delaying 10s and retrying");
-        SerialMon.println("Failed to restart modem, delaying 10s and retrying");
-        delay(10000);
-    }
-    // DBG("Modem initialized successfully.");
-    SerialMon.println("Modem initialized successfully.");
-    delay(10000);  // Give time to restart
-
-    // Network Connection
-    // Keep trying to connect until success
-    // DBG("Connecting to", apn);
-    SerialMon.print("Connecting to "); SerialMon.println(apn);
-    while(!modem.gprsConnect(apn, User, Pass)) {
-        // DBG("Failed to connect, delaying 10s and retrying");
-        SerialMon.print("Failed to connect, delaying 10s and retrying");
-        delay(10000);
-    }
-
-    // GPRS Status
-    if (modem.isGprsConnected()) {
-        // DBG("✅ GPRS is connected");
-        SerialMon.println("✅ GPRS is connected");
-
-
-        String ccid = modem.getSimCCID();
-        // DBG("CCID:", ccid);
-        SerialMon.print("CCID:"); SerialMon.println(ccid);
+    sensor60.begin(baud);
+    SerialAT.begin(baud);       // Began last, so the modem has the receiver
 
+    // Power on, restart and connect the modem from loop(), no waiting here.
+    // Readings are taken in the meantime and queued until the modem is ready.
+    modemStartup.begin();
+    sampleTimer.start(SAMPLE_INTERVAL_MS);
+}
 
-        String imei = modem.getIMEI();
-        // DBG("IMEI:", imei);
-        SerialMon.print("IMEI:"); SerialMon.println(imei);
+/*
+reportReading - Send a reading if it matters, or queue it while the modem starts.
 
+Parameters:
+  fullPer - The fullness percentage, negative if there was no reading.
+*/
+void reportReading(long fullPer) {
+    // Only send when the fullness changed, the bin was emptied, or the heartbeat is due
+    uint8_t reason = reportGate.check(fullPer);
+    if (reason == GC_REPORT_NONE) {
+        return;
+    }
+    // The bin was just emptied, measure it while it is (GC_Calibration.h)
+    if (reason == GC_REPORT_PICKUP) {
+        startCalibration(SerialMon);
+    }
+    if (modemStartup.ready()) {
+        sendDataToSoracom(SerialMon, SENSOR_ID, fullPer, reason == GC_REPORT_PICKUP);
+        serialBus.modemUsed();
+    } else {
+        queueDataForSoracom(SerialMon, SENSOR_ID, fullPer);
+    }
+    GC_METRICS_PRINT(SerialMon);    // Phase timings, if GC_METRICS is on (GC_Uno.h)
+}
 
-        String imsi = modem.getIMSI();
-        // DBG("IMSI:", imsi);
-        SerialMon.print("IMSI:"); SerialMon.println(imsi);
+void loop() {
+    // Each task does what is due and returns, nothing in here waits with delay()
 
+    // Serial monitor command: 'c' measures the empty bin (e.g. after installing)
+    if (SerialMon.available() > 0 && SerialMon.read() == 'c') {
+        startCalibration(SerialMon);
+    }
 
-        String cop = modem.getOperator();
-        // DBG("Operator:", cop);
-        SerialMon.print("Operator:"); SerialMon.println(cop);
+    // Modem: power on, restart and GPRS, one step at a time.
+    // Not while the sensors have the receiver, the modem's answers would be lost.
+    if (!serialBus.sensorsActive()) {
+        modemStartup.step(SerialMon);
+    }
 
-    } else {
-        SerialMon.println("❌ GPRS not connected");
+    // Sensors: start a reading every SAMPLE_INTERVAL_MS
+    if (sampleTimer.due()) {
+        // Open the connection before reading the sensors, so the report is just the request
+        if (modemStartup.ready() && !serialBus.sensorsActive()) {
+            prewarmSoracom(SerialMon);
+            serialBus.modemUsed();
+        }
+#if READ_SENSORS
+        samplePending = true;
+#else
+        // Hardcoded fullness percentage for testing
+        reportReading(0);
+#endif
     }
 
-    // DBG("✅ Network connected!");
-    SerialMon.println("✅ Network connected!");
-}
+#if READ_SENSORS
+    // Sensors: only take the receiver while the modem is quiet (GC_SerialBus.h)
+    if (samplePending && serialBus.sensorsMayRead()) {
+        samplePending = false;
+        serialBus.beginSensors();
+        sampler.start();
+    }
 
-void loop() {
-    // Send JSON data to Soracom
-
-    // Get the fullness percentage from the sensors
-    // When commented, the code works.
-    // Uncommenting this line causes the code to disconnect from the network
-    // and refuse to connect again.
-    // long fullPer = GetFullPer(SerialMon, sensor15, sensor60);
-    
-    // Hardcoded fullness percentage for testing
-    long fullPer = 0;
-    sendDataToSoracom(SerialMon, SENSOR_ID, fullPer);
-    delay(5000);
+    // Sensors: take the bytes that arrived, report once both sensors answered
+    if (sampler.step(SerialMon)) {
+        // Give the receiver back to the modem, and get TinyGsm back in step
+        // before anything else is sent. A "CLOSED" for the open connection
+        // may have come while the sensors had the receiver, so ask the modem.
+        serialBus.endSensors();
+        if (modemStartup.ready()) {
+            serialBus.resync(modem);
+            harvest.recheck();
+        }
+        calibrateWith(SerialMon, sampler.distance15(), sampler.distance60());
+        reportReading(sampler.fullness());
+    }
+#endif
 }
@@ -17,7 +17,6 @@ Required Libraries:
 - ArduinoJson by Benoit Blanchon
 - SoftwareSerial (built-in)
 - StreamDebugger (optional, for debugging)
-- Time by Michael Margolis (for time handling)
 - GC_Uno.h (custom header file for GreenCampus functions)
 - GC_Uno.cpp (custom source file for GreenCampus functions)
 
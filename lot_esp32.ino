@@ -33,31 +33,104 @@ TinyGsm        modem(debugger);
 #else
 TinyGsm        modem(SerialAT);
 #endif
+TinyGsmClient  client(modem, 0);    // One client for the whole run, so the connection can stay open
+
+// A new firmware stays "pending verify" until it delivered a report
+// (checkFirmware, GC_esp32.cpp), and is rolled back if it never does.
+// Without this the Arduino core confirms every firmware right at boot.
+bool verifyRollbackLater() {
+    return true;
+}
+
+#if GC_DUTY_CYCLE
+// Wake-to-report times, kept across deep sleep (GC_Sleep.h)
+RTC_DATA_ATTR WakeStats wakeStats = {0, 0, 0, 0, 0};
+
+/*
+reportAndSleep - Send one report, then deep sleep until the next one.
+
+Does not return. The ESP32 starts over in setup() after GC_SLEEP_INTERVAL_S.
+The time from wake up to here is checked against GC_WAKE_BUDGET_MS.
+*/
+void reportAndSleep() {
+    sendDataToSoracom(SerialMon);
+    GC_METRICS_PRINT(SerialMon);    // Phase timings, if GC_METRICS is on (GC_esp32.h)
+    if (wokeFromSleep()) {
+        wakeStatsRecord(wakeStats, millis(), GC_WAKE_BUDGET_MS, SerialMon);
+    }
+    prepareForSleep(SerialMon);
+    SerialMon.flush();
+    deepSleepFor(GC_SLEEP_INTERVAL_S);
+}
+#endif
 
 void setup() {
     SerialMon.begin(115200);        // Set Serial Monitor to 115200 Baud
     delay(10);
     SerialMon.println("==== SIM7000A ESP32 ====");
+    seedJitter();                   // retry waits differ from bin to bin (GC_Retry.h)
+
+    // Load the readings that were not sent before the last reset
+    uint16_t queued = readingQueue.begin();
+    SerialMon.print("Queued readings: "); SerialMon.println(queued);
+
+#if GC_DUTY_CYCLE
+    // Woken by the sleep timer: the modem sat in PSM and is still registered,
+    // so wake it up instead of powering it on and restarting it
+    if (wokeFromSleep()) {
+        const long wakeBaud = 9600;
+        SerialAT.begin(wakeBaud, SERIAL_8N1, MODEM_RX, MODEM_TX);
+        if (modemWake(modem, MODEM_PWRKEY) && modem.init()) {
+            reportAndSleep();
+        }
+        SerialMon.println("Modem did not wake up, starting it over");
+    }
+#endif
 
     powerOnModem(MODEM_RST, MODEM_PWRKEY);
     const long baud = 9600;     // DO NOT EVER DELETE. CODE WANTS CONSTANT LONG, DONT TRY TO OPTIMIZE
     SerialAT.begin(baud, SERIAL_8N1, MODEM_RX, MODEM_TX);
     delay(300);  // Allow time for the modem to settle
 
+    // Without the modem there is nothing to do, so keep trying, with a
+    // longer wait after each failure (GC_Retry.h)
     SerialMon.println("Initialzing Modem...");
+    Backoff retry(GC_STARTUP_RETRY_MS, GC_STARTUP_RETRY_MAX_MS);
+    GC_METRIC_BEGIN(GC_PHASE_RESTART);
     while(!modem.restart()) {
-        SerialMon.println("Failed to restart modem, delaying 10s and retrying");
-        delay(10000);
+        GC_METRIC_END(GC_PHASE_RESTART, false);
+        SerialMon.println("Failed to restart modem, retrying");
+        retry.wait();
+        GC_METRIC_BEGIN(GC_PHASE_RESTART);
     }
+    GC_METRIC_END(GC_PHASE_RESTART, true);
     SerialMon.println("Modem initialized successfully.");
     delay(10000);  // Give time to restart
 
+    SerialMon.println("Waiting for the network...");
+    GC_METRIC_BEGIN(GC_PHASE_REGISTER);
+    bool registered = modem.waitForNetwork(GC_REGISTER_TIMEOUT_MS);
+    GC_METRIC_END(GC_PHASE_REGISTER, registered);
+    if (!registered) {
+        SerialMon.println("Not registered, trying GPRS anyway");
+    }
+
+    // GPRS only gets a few tries here. If the coverage is bad, the readings
+    // are queued and each report tries again (ensureGprs, GC_Soracom.h).
     SerialMon.print("Connecting to "); SerialMon.println(apn);
-    while(!modem.gprsConnect(apn, User, Pass)) {
-        // DBG("Failed to connect, delaying 10s and retrying");
-        SerialMon.print("Failed to connect, delaying 10s and retrying");
-        delay(10000);
+    TaskTimer budget;
+    budget.start(GC_REPORT_BUDGET_MS);
+    Backoff gprsRetry(GC_LINK_RETRY_MS, GC_LINK_RETRY_MAX_MS, GC_LINK_RETRY_ATTEMPTS);
+    GC_METRIC_BEGIN(GC_PHASE_GPRS);
+    bool attached;
+    while(!(attached = modem.gprsConnect(apn, User, Pass))) {
+        // DBG("Failed to connect, retrying");
+        SerialMon.println("Failed to connect");
+        if (!gprsRetry.wait(budget)) {
+            break;
+        }
     }
+    GC_METRIC_END(GC_PHASE_GPRS, attached);
     if (modem.isGprsConnected()) {
         // DBG("✅ GPRS is connected");
         SerialMon.println("✅ GPRS is connected");
@@ -81,10 +154,37 @@ void setup() {
         SerialMon.println("❌ GPRS not connected");
     }
     SerialMon.println("✅ Network connected!");
+
+#if GC_DUTY_CYCLE
+    // Let the modem sleep between reports. The network may refuse, the cycle
+    // still works then, the modem just draws more while the ESP32 sleeps.
+    if (!modemEnablePsm(modem, GC_PSM_TAU_S, GC_PSM_ACTIVE_S)) {
+        SerialMon.println("PSM not accepted by the modem");
+    }
+    if (!modemEnableEdrx(modem, GC_EDRX_CYCLE)) {
+        SerialMon.println("eDRX not accepted by the modem");
+    }
+    reportAndSleep();
+#endif
+
+#if GC_PIPELINE
+    // From here on the sensor and uplink tasks do the work, loop() only reports
+    startPipeline(SerialMon);
+#endif
 }
 
 void loop() {
+#if GC_PIPELINE
+    // Show how long each stage takes and if the sensor task keeps its cadence
+    printPipelineStats(SerialMon);
+    delay(60000);
+#else
+    // Open the connection before reading the sensors, so the report is just the request
+    prewarmSoracom(SerialMon);
+
     // Send JSON data to Soracom
     sendDataToSoracom(SerialMon);
+    GC_METRICS_PRINT(SerialMon);    // Phase timings, if GC_METRICS is on (GC_esp32.h)
     delay(5000);
+#endif
 }
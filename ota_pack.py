@@ -0,0 +1,51 @@
+"""
+Pack an ESP32 firmware for the OTA update (GC_Common/src/GC_Ota.h).
+
+Usage: python ota_pack.py <version> firmware.bin [esp32.pack]
+
+Writes the packed image (every 4096 bytes of the firmware an LZ4 block of
+their own, after a table of the block sizes) and prints the manifest line
+with "lz4". Put both files on the server next to the .bin, the manifest last.
+
+Needs the lz4 package: pip install lz4
+"""
+import hashlib
+import struct
+import sys
+
+import lz4.block
+
+# --- 1. MUST MATCH GC_Ota.h ---
+CHUNK_SIZE = 4096      # GC_OTA_CHUNK_SIZE
+MAX_BLOCKS = 512       # GC_OTA_MAX_BLOCKS
+
+
+# --- 2. THE SCRIPT ---
+def pack(image):
+    """
+    Returns the packed image: block count, block sizes, then the blocks.
+    """
+    blocks = [
+        lz4.block.compress(image[i:i + CHUNK_SIZE], mode="high_compression", store_size=False)
+        for i in range(0, len(image), CHUNK_SIZE)
+    ]
+    if len(blocks) > MAX_BLOCKS:
+        raise SystemExit(f"Firmware has {len(blocks)} blocks, the board takes {MAX_BLOCKS}")
+    table = struct.pack(f">H{len(blocks)}H", len(blocks), *(len(b) for b in blocks))
+    return table + b"".join(blocks)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) not in (3, 4):
+        raise SystemExit(__doc__)
+    version, bin_path = sys.argv[1], sys.argv[2]
+    pack_path = sys.argv[3] if len(sys.argv) == 4 else "esp32.pack"
+
+    with open(bin_path, "rb") as f:
+        image = f.read()
+    packed = pack(image)
+    with open(pack_path, "wb") as f:
+        f.write(packed)
+
+    print(f"Packed {len(image)} bytes to {len(packed)} ({100 * len(packed) // len(image)}%)", file=sys.stderr)
+    print(f"{version} {len(image)} {hashlib.sha256(image).hexdigest()} lz4")